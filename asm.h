@@ -0,0 +1,238 @@
+#ifndef ASM_H
+#define ASM_H
+
+#include <stdint.h>
+
+#include "bitset.h"
+#include "ir.h"
+#include "stats.h"
+#include "writer.h"
+
+// --- x86-64 Assembly ---
+// The backend's program representation: one instruction array per function,
+// in the same style as the IR. Instruction selection first produces operands
+// that name IR temporaries (pseudo registers); later passes replace them with
+// machine registers or stack slots and then rewrite any instruction whose
+// operand combination x86-64 cannot encode.
+
+//--- Registers ---
+typedef enum
+{
+    REG_AX,
+    REG_CX,
+    REG_DX,
+    REG_BX,
+    REG_SI,
+    REG_DI,
+    REG_SP,
+    REG_BP,
+    REG_R8,
+    REG_R9,
+    REG_R10,
+    REG_R11,
+    REG_R12,
+    REG_R13,
+    REG_R14,
+    REG_R15,
+    REG_COUNT
+} AsmReg;
+
+//--- Operand Kinds ---
+typedef enum
+{
+    ASM_OPERAND_NONE,
+    ASM_OPERAND_IMM,        // value is an immediate
+    ASM_OPERAND_REG,        // reg
+    ASM_OPERAND_PSEUDO,     // value is an IR temporary, before allocation
+    ASM_OPERAND_STACK       // value(%rbp)
+} AsmOperandKind;
+
+//--- Operand Structure ---
+typedef struct
+{
+    AsmOperandKind kind;
+    AsmReg reg;
+    int32_t value;
+} AsmOperand;
+
+//--- Condition Codes ---
+typedef enum
+{
+    COND_E,
+    COND_NE,
+    COND_L,
+    COND_LE,
+    COND_G,
+    COND_GE
+} AsmCond;
+
+//--- Opcodes ---
+// Arithmetic works on 32-bit operands; stack adjustments and pushes on 64-bit ones.
+typedef enum
+{
+    ASM_NOP,            // Deleted instruction, not emitted
+    ASM_MOV,            // movl src, dst
+    ASM_NEG,            // negl dst
+    ASM_NOT,            // notl dst
+    ASM_ADD,            // addl src, dst
+    ASM_SUB,            // subl src, dst
+    ASM_IMUL,           // imull src, dst
+    ASM_LEA,            // leal disp(src, index, scale), dst
+    ASM_SAR,            // sarl src, dst (src is an immediate or %cl)
+    ASM_SHR,            // shrl src, dst (src is an immediate or %cl)
+    ASM_CMP,            // cmpl src, dst
+    ASM_TEST,           // testl src, dst
+    ASM_XOR,            // xorl src, dst
+    ASM_CDQ,            // cltd: sign-extend %eax into %edx
+    ASM_IDIV,           // idivl src: %eax = %edx:%eax / src, %edx = remainder
+    ASM_IMUL_WIDE,      // imull src: %edx:%eax = %eax * src
+    ASM_SETCC,          // setCC dst (low byte)
+    ASM_JMP,            // jmp label
+    ASM_JCC,            // jCC label
+    ASM_LABEL,          // label:
+    ASM_PUSH,           // pushq src
+    ASM_CALL,           // call function
+    ASM_ALLOC_STACK,    // subq $value, %rsp
+    ASM_DEALLOC_STACK,  // addq $value, %rsp
+    ASM_RET,            // function epilogue and ret
+    ASM_TAIL_CALL,      // function epilogue and jmp function
+    ASM_OPCODE_COUNT
+} AsmOpcode;
+
+//--- Instruction Structure ---
+typedef struct
+{
+    AsmOpcode op;
+    AsmCond cond;       // ASM_SETCC, ASM_JCC
+    AsmOperand src;
+    AsmOperand dst;
+    union
+    {
+        int32_t label;  // ASM_JMP, ASM_JCC, ASM_LABEL: IR label number
+        int32_t callee; // ASM_CALL, ASM_TAIL_CALL: index into AsmProgram.functions
+        int32_t amount; // ASM_ALLOC_STACK, ASM_DEALLOC_STACK: bytes
+        int32_t disp;   // ASM_LEA: displacement
+    };
+    int32_t reg_args;   // ASM_CALL, ASM_TAIL_CALL: arguments passed in registers
+    AsmOperand index;   // ASM_LEA: index register, or asm_none(); src is the base, or asm_none()
+    int32_t scale;      // ASM_LEA: 1, 2, 4 or 8
+    int32_t branch;     // ASM_JCC: profile branch id of the IR jump, negated once inverted; 0 for none
+} AsmInstr;
+
+//--- Function Structure ---
+typedef struct
+{
+    char *name;
+    int defined;        // 0 for an external function, which is called through the PLT
+
+    AsmInstr *instrs;
+    int instr_count;
+    int instr_capacity;
+
+    int pseudo_count;   // IR temporaries referenced by pseudo operands
+    int frame_size;     // Bytes reserved below the saved registers, set by stack allocation
+    unsigned saved_regs; // Callee-saved registers the body writes, one bit per AsmReg
+    int frame_pointer;  // 1 if the prologue sets up %rbp, decided by codegen_fixup
+
+    uint64_t entry_count;           // -fprofile-use: times the function was entered
+    const uint64_t *branch_counts;  // -fprofile-use: the program's branch counters, or NULL
+} AsmFunction;
+
+//--- Program Structure ---
+typedef struct
+{
+    AsmFunction *functions;
+    int function_count;
+
+    int branch_count;           // Branch ids handed out by profile_number_branches
+    uint64_t *profile;          // -fprofile-use: copy of the IR program's counters, or NULL
+    const char *profile_path;   // -fprofile-generate: file the instrumented program writes, or NULL
+    uint64_t profile_checksum;  // -fprofile-generate: checksum of the unoptimized IR
+} AsmProgram;
+
+// --- Operand Constructors ---
+static inline AsmOperand asm_none(void) { AsmOperand o = {ASM_OPERAND_NONE, REG_AX, 0}; return o; }
+static inline AsmOperand asm_imm(int32_t value) { AsmOperand o = {ASM_OPERAND_IMM, REG_AX, value}; return o; }
+static inline AsmOperand asm_reg(AsmReg reg) { AsmOperand o = {ASM_OPERAND_REG, reg, 0}; return o; }
+static inline AsmOperand asm_pseudo(int32_t temp) { AsmOperand o = {ASM_OPERAND_PSEUDO, REG_AX, temp}; return o; }
+static inline AsmOperand asm_stack(int32_t offset) { AsmOperand o = {ASM_OPERAND_STACK, REG_AX, offset}; return o; }
+
+static inline int asm_is_memory(AsmOperand o) { return o.kind == ASM_OPERAND_STACK; }
+
+AsmInstr *asm_emit(AsmFunction *fn, AsmOpcode op, AsmOperand src, AsmOperand dst);
+void asm_program_free(AsmProgram *program);
+int asm_same_operand(AsmOperand x, AsmOperand y);
+int asm_is_callee_saved(AsmReg reg);
+
+// --- Backend Liveness ---
+// Liveness over an assembly function whose operands may still be pseudo
+// registers. Variables are numbered with pseudo registers first and machine
+// registers after them, at pseudo_count + reg. Each instruction i has two
+// positions: 2i where it reads its operands and 2i + 1 where it writes them.
+
+#define ASM_MAX_USE_DEF 16
+
+//--- Instruction Uses and Definitions ---
+typedef struct
+{
+    int uses[ASM_MAX_USE_DEF];
+    int use_count;
+    int defs[ASM_MAX_USE_DEF];
+    int def_count;
+} AsmUseDef;
+
+//--- Liveness ---
+typedef struct
+{
+    int var_count;      // pseudo_count + REG_COUNT
+    int block_count;
+    int *block_start;   // Block b is instructions block_start[b] .. block_start[b + 1]
+    int *succs;         // Two entries per block, -1 when unused
+    size_t words;       // Bitset words per row
+    BitWord *live_in;   // block_count rows, indexed by variable
+    BitWord *live_out;
+    long *frequency;    // Instruction -> estimated execution count, for spill weights
+} AsmLiveness;
+
+void asm_use_def(const AsmFunction *fn, const AsmInstr *instr, AsmUseDef *ud);
+void asm_liveness_compute(AsmLiveness *live, const AsmFunction *fn);
+void asm_liveness_free(AsmLiveness *live);
+
+AsmProgram *codegen_program(const IrProgram *ir, OptStats *stats);
+void codegen_assign_stack(AsmProgram *program);
+void codegen_fixup(AsmProgram *program, OptStats *stats);
+
+// --- Register Allocation ---
+// Linear scan is the fast allocator used at -O1; iterated register coalescing
+// produces better code at -O2. Both allocators assign machine registers to
+// pseudo registers and leave the ones they spill for codegen_assign_stack.
+// %r10 and %r11 stay free as scratch registers for codegen_fixup. Both hand
+// out registers in the order of asm_allocatable.
+
+#define ASM_ALLOCATABLE_COUNT 12
+
+extern const AsmReg asm_allocatable[ASM_ALLOCATABLE_COUNT];
+
+void regalloc_linear_scan(AsmProgram *program, OptStats *stats);
+void regalloc_graph_color(AsmProgram *program, OptStats *stats);
+
+// --- Stack Slot Sharing ---
+// At every level, spilled pseudo registers with disjoint live ranges are
+// renamed to share one stack slot before codegen_assign_stack. A function
+// with more than 4096 spilled pseudo registers is left alone, and each of
+// them keeps a slot of its own.
+
+void stack_share_slots(AsmProgram *program, OptStats *stats);
+
+// --- Peephole Optimization ---
+
+void peephole_program(AsmProgram *program, OptStats *stats);
+
+// --- Backend ---
+// Instruction selection through peephole optimization, in order.
+
+AsmProgram *codegen_compile(const IrProgram *ir, int opt_level, OptStats *stats);
+
+void asm_print_program(Writer *w, const AsmProgram *program, const char *source_name);
+
+#endif
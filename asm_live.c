@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm.h"
+#include "profile.h"
+
+// --- Backend Liveness ---
+// Register allocation runs after instruction selection, where fixed registers
+// (argument registers, %eax around idiv and calls) sit next to pseudo
+// registers, so liveness is recomputed over the assembly rather than reused
+// from the IR.
+
+static const AsmReg arg_regs[6] = {REG_DI, REG_SI, REG_DX, REG_CX, REG_R8, REG_R9};
+static const AsmReg caller_saved[] = {REG_AX, REG_CX, REG_DX, REG_SI, REG_DI, REG_R8, REG_R9, REG_R10, REG_R11};
+
+// Caller-saved registers first, so callee-saved ones are only pushed when needed.
+const AsmReg asm_allocatable[ASM_ALLOCATABLE_COUNT] = {
+    REG_AX, REG_CX, REG_DX, REG_SI, REG_DI, REG_R8, REG_R9,
+    REG_BX, REG_R12, REG_R13, REG_R14, REG_R15,
+};
+
+/**
+ * @brief Maps an operand to its liveness variable.
+ * @param fn The function.
+ * @param operand The operand.
+ * @return The variable number, or -1 for immediates, stack slots and no operand.
+ */
+static int operand_var(const AsmFunction *fn, AsmOperand operand)
+{
+    if (operand.kind == ASM_OPERAND_PSEUDO) return operand.value;
+    if (operand.kind == ASM_OPERAND_REG) return fn->pseudo_count + operand.reg;
+    return -1;
+}
+
+/**
+ * @brief Adds a variable to a use or definition list, ignoring non-variables.
+ * @param list The list.
+ * @param count The list length, updated.
+ * @param var The variable, or -1.
+ */
+static void add_var(int *list, int *count, int var)
+{
+    if (var >= 0 && *count < ASM_MAX_USE_DEF)
+        list[(*count)++] = var;
+}
+
+/**
+ * @brief Lists the variables an instruction reads and writes, including implicit registers.
+ * @param fn The function containing the instruction.
+ * @param instr The instruction.
+ * @param ud Receives the uses and definitions.
+ */
+void asm_use_def(const AsmFunction *fn, const AsmInstr *instr, AsmUseDef *ud)
+{
+    int src = operand_var(fn, instr->src);
+    int dst = operand_var(fn, instr->dst);
+    int reg = fn->pseudo_count;
+    ud->use_count = 0;
+    ud->def_count = 0;
+
+    switch (instr->op)
+    {
+        case ASM_MOV:
+            add_var(ud->uses, &ud->use_count, src);
+            add_var(ud->defs, &ud->def_count, dst);
+            break;
+        case ASM_NEG:
+        case ASM_NOT:
+        case ASM_SETCC:
+            add_var(ud->uses, &ud->use_count, dst);
+            add_var(ud->defs, &ud->def_count, dst);
+            break;
+        case ASM_ADD:
+        case ASM_SUB:
+        case ASM_IMUL:
+        case ASM_SAR:
+        case ASM_SHR:
+            add_var(ud->uses, &ud->use_count, src);
+            add_var(ud->uses, &ud->use_count, dst);
+            add_var(ud->defs, &ud->def_count, dst);
+            break;
+        case ASM_XOR:
+            // xor r, r is the zero idiom and reads nothing.
+            if (!asm_same_operand(instr->src, instr->dst))
+            {
+                add_var(ud->uses, &ud->use_count, src);
+                add_var(ud->uses, &ud->use_count, dst);
+            }
+            add_var(ud->defs, &ud->def_count, dst);
+            break;
+        case ASM_CMP:
+        case ASM_TEST:
+            add_var(ud->uses, &ud->use_count, src);
+            add_var(ud->uses, &ud->use_count, dst);
+            break;
+        case ASM_LEA:
+            add_var(ud->uses, &ud->use_count, src);
+            add_var(ud->uses, &ud->use_count, operand_var(fn, instr->index));
+            add_var(ud->defs, &ud->def_count, dst);
+            break;
+        case ASM_CDQ:
+            add_var(ud->uses, &ud->use_count, reg + REG_AX);
+            add_var(ud->defs, &ud->def_count, reg + REG_DX);
+            break;
+        case ASM_IDIV:
+            add_var(ud->uses, &ud->use_count, src);
+            add_var(ud->uses, &ud->use_count, reg + REG_AX);
+            add_var(ud->uses, &ud->use_count, reg + REG_DX);
+            add_var(ud->defs, &ud->def_count, reg + REG_AX);
+            add_var(ud->defs, &ud->def_count, reg + REG_DX);
+            break;
+        case ASM_IMUL_WIDE:
+            add_var(ud->uses, &ud->use_count, src);
+            add_var(ud->uses, &ud->use_count, reg + REG_AX);
+            add_var(ud->defs, &ud->def_count, reg + REG_AX);
+            add_var(ud->defs, &ud->def_count, reg + REG_DX);
+            break;
+        case ASM_PUSH:
+            add_var(ud->uses, &ud->use_count, src);
+            break;
+        case ASM_TAIL_CALL:
+            // The callee returns straight to this function's caller.
+            for (int i = 0; i < instr->reg_args; i++)
+                add_var(ud->uses, &ud->use_count, reg + arg_regs[i]);
+            break;
+        case ASM_CALL:
+            for (int i = 0; i < instr->reg_args; i++)
+                add_var(ud->uses, &ud->use_count, reg + arg_regs[i]);
+            for (size_t i = 0; i < sizeof(caller_saved) / sizeof(caller_saved[0]); i++)
+                add_var(ud->defs, &ud->def_count, reg + caller_saved[i]);
+            break;
+        case ASM_RET:
+            add_var(ud->uses, &ud->use_count, reg + REG_AX);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Checks whether an instruction ends a basic block.
+ * @param op The opcode.
+ * @return 1 for jumps, returns and tail calls.
+ */
+static int ends_block(AsmOpcode op)
+{
+    return op == ASM_JMP || op == ASM_JCC || op == ASM_RET || op == ASM_TAIL_CALL;
+}
+
+/**
+ * @brief Weighs each instruction by 10 to the power of its loop depth.
+ *
+ * A backward jump spans a loop body, so the depth of an instruction is the
+ * number of backward jumps covering it.
+ *
+ * @param live The liveness being computed; receives the frequencies.
+ * @param fn The function.
+ * @param label_pos Label -> its instruction, or -1.
+ */
+static void estimate_frequency(AsmLiveness *live, const AsmFunction *fn, const int *label_pos)
+{
+    int n = fn->instr_count;
+    int *depth = calloc(n + 1, sizeof(int));
+    for (int i = 0; i < n; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        if ((instr->op == ASM_JMP || instr->op == ASM_JCC) && label_pos[instr->label] >= 0 && label_pos[instr->label] <= i)
+        {
+            depth[label_pos[instr->label]]++;
+            depth[i + 1]--;
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        if (i > 0)
+            depth[i] += depth[i - 1];
+        live->frequency[i] = 1;
+        for (int d = 0; d < depth[i] && d < 5; d++)
+            live->frequency[i] *= 10;
+    }
+    free(depth);
+}
+
+/**
+ * @brief Weighs each instruction by its block's count in the profile.
+ *
+ * One is added so that code the training run never reached still has a
+ * nonzero weight.
+ *
+ * @param live The liveness being computed, with blocks and successors; receives the frequencies.
+ * @param fn The function, with a profile attached.
+ */
+static void measure_frequency(AsmLiveness *live, const AsmFunction *fn)
+{
+    int blocks = live->block_count;
+    long *edge_counts = malloc((2 * blocks + 1) * sizeof(long));
+    long *counts = malloc((blocks + 1) * sizeof(long));
+    for (int b = 0; b < blocks; b++)
+    {
+        const AsmInstr *last = &fn->instrs[live->block_start[b + 1] - 1];
+        uint64_t taken, not_taken;
+        edge_counts[2 * b] = edge_counts[2 * b + 1] = -1;
+        if (last->op == ASM_JCC && profile_branch(fn->branch_counts, last->branch, &taken, &not_taken))
+        {
+            edge_counts[2 * b] = (long)taken;
+            edge_counts[2 * b + 1] = (long)not_taken;
+        }
+    }
+    profile_block_counts(live->succs, edge_counts, blocks, (long)fn->entry_count, counts);
+    for (int b = 0; b < blocks; b++)
+    {
+        for (int i = live->block_start[b]; i < live->block_start[b + 1]; i++)
+            live->frequency[i] = 1 + counts[b];
+    }
+    free(counts);
+    free(edge_counts);
+}
+
+/**
+ * @brief Splits a function into blocks and computes the registers and pseudo registers live at each boundary.
+ *
+ * Also estimates how often each instruction runs, for spill weights: from
+ * the branch counts under -fprofile-use, otherwise as 10 to the power of
+ * its loop depth, found from backward jumps.
+ *
+ * @param live Receives the result; free with asm_liveness_free.
+ * @param fn The function.
+ */
+void asm_liveness_compute(AsmLiveness *live, const AsmFunction *fn)
+{
+    int n = fn->instr_count;
+    live->var_count = fn->pseudo_count + REG_COUNT;
+    live->words = bitset_words(live->var_count);
+
+    // Blocks start at labels and after jumps.
+    int max_label = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        if ((instr->op == ASM_LABEL || instr->op == ASM_JMP || instr->op == ASM_JCC) && instr->label > max_label)
+            max_label = instr->label;
+    }
+    int *label_block = malloc((max_label + 1) * sizeof(int));
+    int *label_pos = malloc((max_label + 1) * sizeof(int));
+    for (int l = 0; l <= max_label; l++)
+        label_block[l] = label_pos[l] = -1;
+
+    live->block_start = malloc((n + 2) * sizeof(int));
+    int blocks = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        int leader = i == 0 || instr->op == ASM_LABEL || ends_block(fn->instrs[i - 1].op);
+        if (leader && (blocks == 0 || live->block_start[blocks - 1] != i))
+            live->block_start[blocks++] = i;
+        if (instr->op == ASM_LABEL)
+        {
+            label_block[instr->label] = blocks - 1;
+            label_pos[instr->label] = i;
+        }
+    }
+    live->block_start[blocks] = n;
+    live->block_count = blocks;
+
+    live->succs = malloc((blocks + 1) * 2 * sizeof(int));
+    for (int b = 0; b < blocks; b++)
+    {
+        int *succ = &live->succs[2 * b];
+        succ[0] = succ[1] = -1;
+        const AsmInstr *last = &fn->instrs[live->block_start[b + 1] - 1];
+        if (last->op == ASM_JMP || last->op == ASM_JCC)
+            succ[0] = label_block[last->label];
+        if (last->op != ASM_JMP && last->op != ASM_RET && last->op != ASM_TAIL_CALL && b + 1 < blocks)
+            succ[1] = b + 1;
+    }
+
+    live->frequency = malloc((n + 1) * sizeof(long));
+    if (fn->branch_counts && fn->entry_count > 0)
+        measure_frequency(live, fn);
+    else
+        estimate_frequency(live, fn, label_pos);
+
+    // Per-block upward-exposed uses and definitions.
+    size_t words = live->words;
+    live->live_in = calloc((size_t)(blocks + 1) * words, sizeof(BitWord));
+    live->live_out = calloc((size_t)(blocks + 1) * words, sizeof(BitWord));
+    BitWord *gen = calloc((size_t)(blocks + 1) * words, sizeof(BitWord));
+    BitWord *kill = calloc((size_t)(blocks + 1) * words, sizeof(BitWord));
+    for (int b = 0; b < blocks; b++)
+    {
+        BitWord *g = gen + b * words;
+        BitWord *k = kill + b * words;
+        for (int i = live->block_start[b]; i < live->block_start[b + 1]; i++)
+        {
+            AsmUseDef ud;
+            asm_use_def(fn, &fn->instrs[i], &ud);
+            for (int u = 0; u < ud.use_count; u++)
+            {
+                if (!bitset_test(k, ud.uses[u]))
+                    bitset_set(g, ud.uses[u]);
+            }
+            for (int d = 0; d < ud.def_count; d++)
+                bitset_set(k, ud.defs[d]);
+        }
+    }
+
+    // Blocks are in layout order, so walking them backwards converges quickly.
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int b = blocks - 1; b >= 0; b--)
+        {
+            BitWord *in = live->live_in + b * words;
+            BitWord *out = live->live_out + b * words;
+            for (int s = 0; s < 2; s++)
+            {
+                int succ = live->succs[2 * b + s];
+                if (succ >= 0)
+                    bitset_union_into(out, live->live_in + succ * words, words);
+            }
+            const BitWord *g = gen + b * words;
+            const BitWord *k = kill + b * words;
+            for (size_t w = 0; w < words; w++)
+            {
+                BitWord next = g[w] | (out[w] & ~k[w]);
+                if (next != in[w])
+                {
+                    in[w] = next;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    free(gen);
+    free(kill);
+    free(label_block);
+    free(label_pos);
+}
+
+/**
+ * @brief Frees the arrays of a liveness result.
+ * @param live The result.
+ */
+void asm_liveness_free(AsmLiveness *live)
+{
+    free(live->block_start);
+    free(live->succs);
+    free(live->live_in);
+    free(live->live_out);
+    free(live->frequency);
+}
@@ -0,0 +1,569 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm.h"
+#include "profile.h"
+
+// --- Assembly Printer ---
+// Writes AT&T syntax in the layout GCC uses (see return_2.s): directives and
+// instructions indented by a tab, a tab between mnemonic and operands.
+//
+// Under -fprofile-generate the printer also instruments the program: each
+// function counts its entries, and each numbered conditional jump counts
+// the fall-through path inline and the taken path in a stub after the
+// function, which then jumps on to the real target. The counters live in
+// .Lprof.data behind a ProfileHeader, and .Lprof.dump, run from .fini_array
+// at exit, adds them into the profile file or replaces it.
+
+// The dump reads the old profile through a buffer of this many bytes on the stack.
+#define PROFILE_DUMP_BUFFER 4096
+
+//--- Name ---
+// A string with its length, so the hot paths copy it without strlen.
+typedef struct
+{
+    const char *text;
+    size_t len;
+} Name;
+
+#define NAME(s) { s, sizeof(s) - 1 }
+
+static const Name reg_names_32[REG_COUNT] = {
+    NAME("%eax"), NAME("%ecx"), NAME("%edx"), NAME("%ebx"), NAME("%esi"), NAME("%edi"), NAME("%esp"), NAME("%ebp"),
+    NAME("%r8d"), NAME("%r9d"), NAME("%r10d"), NAME("%r11d"), NAME("%r12d"), NAME("%r13d"), NAME("%r14d"), NAME("%r15d"),
+};
+
+static const Name reg_names_64[REG_COUNT] = {
+    NAME("%rax"), NAME("%rcx"), NAME("%rdx"), NAME("%rbx"), NAME("%rsi"), NAME("%rdi"), NAME("%rsp"), NAME("%rbp"),
+    NAME("%r8"), NAME("%r9"), NAME("%r10"), NAME("%r11"), NAME("%r12"), NAME("%r13"), NAME("%r14"), NAME("%r15"),
+};
+
+static const Name reg_names_8[REG_COUNT] = {
+    NAME("%al"), NAME("%cl"), NAME("%dl"), NAME("%bl"), NAME("%sil"), NAME("%dil"), NAME("%spl"), NAME("%bpl"),
+    NAME("%r8b"), NAME("%r9b"), NAME("%r10b"), NAME("%r11b"), NAME("%r12b"), NAME("%r13b"), NAME("%r14b"), NAME("%r15b"),
+};
+
+static const Name cond_names[] = {
+    [COND_E] = NAME("e"), [COND_NE] = NAME("ne"), [COND_L] = NAME("l"),
+    [COND_LE] = NAME("le"), [COND_G] = NAME("g"), [COND_GE] = NAME("ge"),
+};
+
+// Mnemonics with their surrounding tabs.
+static const Name mnemonics[ASM_OPCODE_COUNT] = {
+    [ASM_MOV] = NAME("\tmovl\t"), [ASM_NEG] = NAME("\tnegl\t"), [ASM_NOT] = NAME("\tnotl\t"),
+    [ASM_ADD] = NAME("\taddl\t"), [ASM_SUB] = NAME("\tsubl\t"), [ASM_IMUL] = NAME("\timull\t"),
+    [ASM_SAR] = NAME("\tsarl\t"), [ASM_SHR] = NAME("\tshrl\t"), [ASM_CMP] = NAME("\tcmpl\t"),
+    [ASM_TEST] = NAME("\ttestl\t"), [ASM_XOR] = NAME("\txorl\t"),
+    [ASM_IDIV] = NAME("\tidivl\t"), [ASM_IMUL_WIDE] = NAME("\timull\t"),
+    [ASM_PUSH] = NAME("\tpushq\t"), [ASM_ALLOC_STACK] = NAME("\tsubq\t"), [ASM_DEALLOC_STACK] = NAME("\taddq\t"),
+};
+
+/**
+ * @brief Appends a length-tagged name.
+ * @param w The writer.
+ * @param name The name.
+ */
+static inline void put_name(Writer *w, Name name)
+{
+    if (w->capacity - w->len < name.len)
+    {
+        writer_write(w, name.text, name.len);
+        return;
+    }
+    memcpy(w->data + w->len, name.text, name.len);
+    w->len += name.len;
+}
+
+/**
+ * @brief Writes an operand.
+ * @param w The writer.
+ * @param operand The operand; pseudo registers must already be replaced.
+ * @param size The operand size in bytes: 1, 4 or 8.
+ */
+static void print_operand(Writer *w, AsmOperand operand, int size)
+{
+    switch (operand.kind)
+    {
+        case ASM_OPERAND_IMM:
+            writer_putc(w, '$');
+            writer_put_long(w, operand.value);
+            break;
+        case ASM_OPERAND_REG:
+            put_name(w, size == 1 ? reg_names_8[operand.reg] : size == 8 ? reg_names_64[operand.reg] : reg_names_32[operand.reg]);
+            break;
+        case ASM_OPERAND_STACK:
+            writer_put_long(w, operand.value);
+            writer_write(w, "(%rbp)", 6);
+            break;
+        default:
+            writer_puts(w, "<invalid>");
+            break;
+    }
+}
+
+/**
+ * @brief Writes a local label name, unique within the output file.
+ * @param w The writer.
+ * @param prefix The function's label prefix, ".L<name>.".
+ * @param label The IR label number.
+ */
+static void print_label(Writer *w, Name prefix, int label)
+{
+    put_name(w, prefix);
+    writer_put_long(w, label);
+}
+
+/**
+ * @brief Writes an increment of one of the profile counters.
+ *
+ * The increment writes the flags; where a later instruction still reads
+ * them it goes through %r11, which holds nothing between instructions.
+ *
+ * @param w The writer.
+ * @param counter The counter's index after the header.
+ * @param keep_flags 1 to leave the flags alone.
+ */
+static void print_counter_increment(Writer *w, long counter, int keep_flags)
+{
+    writer_puts(w, keep_flags ? "\tmovq\t.Lprof.counts+" : "\tincq\t.Lprof.counts+");
+    writer_put_long(w, counter * 8);
+    writer_puts(w, "(%rip)");
+    if (!keep_flags)
+    {
+        writer_putc(w, '\n');
+        return;
+    }
+    writer_puts(w, ", %r11\n\tleaq\t1(%r11), %r11\n\tmovq\t%r11, .Lprof.counts+");
+    writer_put_long(w, counter * 8);
+    writer_puts(w, "(%rip)\n");
+}
+
+/**
+ * @brief Finds the counter for one outcome of an instrumented conditional jump.
+ * @param program The program.
+ * @param branch The jump's branch id.
+ * @param taken 1 for the counter of the jump being taken, 0 for falling through.
+ * @return The counter's index after the header.
+ */
+static long branch_counter(const AsmProgram *program, int32_t branch, int taken)
+{
+    long slot = branch > 0 ? branch - 1 : -branch - 1;
+    int inverted = branch < 0;
+    return program->function_count + 2 * slot + (taken ? inverted : !inverted);
+}
+
+/**
+ * @brief Checks whether the flags are read after an instruction before anything sets them again.
+ * @param fn The function.
+ * @param i The instruction.
+ * @return 1 if a later conditional jump or set reads them.
+ */
+static int flags_read_after(const AsmFunction *fn, int i)
+{
+    for (int j = i + 1; j < fn->instr_count; j++)
+    {
+        switch (fn->instrs[j].op)
+        {
+            case ASM_JCC:
+            case ASM_SETCC:
+                return 1;
+            case ASM_NOP:
+            case ASM_MOV:
+            case ASM_LEA:
+            case ASM_NOT:
+            case ASM_CDQ:
+            case ASM_PUSH:
+                continue;
+            default:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes the label of the stub that counts a conditional jump being taken.
+ * @param w The writer.
+ * @param prefix The function's label prefix.
+ * @param i The jump's instruction index.
+ */
+static void print_stub_label(Writer *w, Name prefix, int i)
+{
+    put_name(w, prefix);
+    writer_putc(w, 'p');
+    writer_put_long(w, i);
+}
+
+/**
+ * @brief Writes a one- or two-operand instruction.
+ * @param w The writer.
+ * @param mnemonic The mnemonic, including its size suffix and tabs.
+ * @param src The first operand, or asm_none().
+ * @param dst The second operand, or asm_none().
+ * @param size The operand size in bytes.
+ */
+static void print_simple(Writer *w, Name mnemonic, AsmOperand src, AsmOperand dst, int size)
+{
+    put_name(w, mnemonic);
+    if (src.kind != ASM_OPERAND_NONE)
+        print_operand(w, src, size);
+    if (dst.kind != ASM_OPERAND_NONE)
+    {
+        if (src.kind != ASM_OPERAND_NONE)
+            writer_write(w, ", ", 2);
+        print_operand(w, dst, size);
+    }
+    writer_putc(w, '\n');
+}
+
+/**
+ * @brief Writes the frame teardown that precedes a ret or a tail call.
+ *
+ * Leaves %rsp where it was on entry, pointing at the return address.
+ *
+ * @param w The writer.
+ * @param fn The function.
+ */
+static void print_epilogue(Writer *w, const AsmFunction *fn)
+{
+    if (!fn->frame_pointer)
+    {
+        // Undo the alignment padding and pop the saved registers in reverse.
+        if (fn->frame_size > 0)
+            print_simple(w, mnemonics[ASM_DEALLOC_STACK], asm_imm(fn->frame_size), asm_reg(REG_SP), 8);
+        for (int reg = REG_COUNT - 1; reg >= 0; reg--)
+        {
+            if (!(fn->saved_regs & (1u << reg))) continue;
+            writer_puts(w, "\tpopq\t");
+            put_name(w, reg_names_64[reg]);
+            writer_putc(w, '\n');
+        }
+        return;
+    }
+
+    // Reload the saved registers from where the prologue pushed them.
+    int offset = 0;
+    for (int reg = 0; reg < REG_COUNT; reg++)
+    {
+        if (!(fn->saved_regs & (1u << reg))) continue;
+        offset -= 8;
+        writer_puts(w, "\tmovq\t");
+        writer_put_long(w, offset);
+        writer_puts(w, "(%rbp), ");
+        put_name(w, reg_names_64[reg]);
+        writer_putc(w, '\n');
+    }
+    writer_puts(w, "\tmovq\t%rbp, %rsp\n\tpopq\t%rbp\n");
+}
+
+/**
+ * @brief Writes one instruction.
+ * @param w The writer.
+ * @param program The program, for call targets.
+ * @param fn The function containing the instruction.
+ * @param prefix The function's label prefix.
+ * @param instr The instruction.
+ */
+static void print_instr(Writer *w, const AsmProgram *program, const AsmFunction *fn, Name prefix, const AsmInstr *instr)
+{
+    switch (instr->op)
+    {
+        case ASM_NOP:
+            break;
+        case ASM_SAR:
+        case ASM_SHR:
+            // The count register is named by its low byte.
+            put_name(w, mnemonics[instr->op]);
+            print_operand(w, instr->src, instr->src.kind == ASM_OPERAND_REG ? 1 : 4);
+            writer_write(w, ", ", 2);
+            print_operand(w, instr->dst, 4);
+            writer_putc(w, '\n');
+            break;
+        case ASM_LEA:
+            // The address is formed from the full registers; the result is truncated to 32 bits.
+            writer_write(w, "\tleal\t", 6);
+            if (instr->disp != 0 || instr->src.kind == ASM_OPERAND_NONE)
+                writer_put_long(w, instr->disp);
+            writer_putc(w, '(');
+            if (instr->src.kind != ASM_OPERAND_NONE)
+                print_operand(w, instr->src, 8);
+            if (instr->index.kind != ASM_OPERAND_NONE)
+            {
+                writer_putc(w, ',');
+                print_operand(w, instr->index, 8);
+                writer_putc(w, ',');
+                writer_put_long(w, instr->scale);
+            }
+            writer_write(w, "), ", 3);
+            print_operand(w, instr->dst, 4);
+            writer_putc(w, '\n');
+            break;
+        case ASM_CDQ:
+            writer_puts(w, "\tcltd\n");
+            break;
+        case ASM_SETCC:
+            writer_write(w, "\tset", 4);
+            put_name(w, cond_names[instr->cond]);
+            writer_putc(w, '\t');
+            print_operand(w, instr->dst, 1);
+            writer_putc(w, '\n');
+            break;
+        case ASM_JMP:
+            writer_write(w, "\tjmp\t", 5);
+            print_label(w, prefix, instr->label);
+            writer_putc(w, '\n');
+            break;
+        case ASM_JCC:
+            writer_write(w, "\tj", 2);
+            put_name(w, cond_names[instr->cond]);
+            writer_putc(w, '\t');
+            if (program->profile_path && instr->branch != 0)
+            {
+                int i = (int)(instr - fn->instrs);
+                print_stub_label(w, prefix, i);
+                writer_putc(w, '\n');
+                print_counter_increment(w, branch_counter(program, instr->branch, 0), flags_read_after(fn, i));
+                break;
+            }
+            print_label(w, prefix, instr->label);
+            writer_putc(w, '\n');
+            break;
+        case ASM_LABEL:
+            print_label(w, prefix, instr->label);
+            writer_write(w, ":\n", 2);
+            break;
+        case ASM_PUSH:
+            print_simple(w, mnemonics[ASM_PUSH], instr->src, asm_none(), 8);
+            break;
+        case ASM_CALL:
+        {
+            const AsmFunction *callee = &program->functions[instr->callee];
+            writer_puts(w, "\tcall\t");
+            writer_puts(w, callee->name);
+            if (!callee->defined)
+                writer_puts(w, "@PLT");
+            writer_putc(w, '\n');
+            break;
+        }
+        case ASM_ALLOC_STACK:
+        case ASM_DEALLOC_STACK:
+            print_simple(w, mnemonics[instr->op], asm_imm(instr->amount), asm_reg(REG_SP), 8);
+            break;
+        case ASM_RET:
+            print_epilogue(w, fn);
+            writer_puts(w, "\tret\n");
+            break;
+        case ASM_TAIL_CALL:
+        {
+            // The arguments are already in their registers, which the epilogue leaves alone.
+            const AsmFunction *callee = &program->functions[instr->callee];
+            print_epilogue(w, fn);
+            writer_puts(w, "\tjmp\t");
+            writer_puts(w, callee->name);
+            if (!callee->defined)
+                writer_puts(w, "@PLT");
+            writer_putc(w, '\n');
+            break;
+        }
+        default:
+            print_simple(w, mnemonics[instr->op], instr->src, instr->dst, 4);
+            break;
+    }
+}
+
+/**
+ * @brief Writes one function, with its symbol directives and frame setup.
+ * @param w The writer.
+ * @param program The program.
+ * @param fn The function.
+ */
+static void print_function(Writer *w, const AsmProgram *program, const AsmFunction *fn)
+{
+    writer_puts(w, "\t.globl\t");
+    writer_puts(w, fn->name);
+    writer_puts(w, "\n\t.type\t");
+    writer_puts(w, fn->name);
+    writer_puts(w, ", @function\n");
+    writer_puts(w, fn->name);
+    writer_puts(w, ":\n");
+    if (program->profile_path)
+        print_counter_increment(w, fn - program->functions, 0);
+    if (fn->frame_pointer)
+        writer_puts(w, "\tpushq\t%rbp\n\tmovq\t%rsp, %rbp\n");
+    for (int reg = 0; reg < REG_COUNT; reg++)
+    {
+        if (!(fn->saved_regs & (1u << reg))) continue;
+        writer_puts(w, "\tpushq\t");
+        put_name(w, reg_names_64[reg]);
+        writer_putc(w, '\n');
+    }
+    // Labels are formatted often enough that their prefix is built once.
+    size_t name_len = strlen(fn->name);
+    char *text = malloc(name_len + 4);
+    text[0] = '.';
+    text[1] = 'L';
+    memcpy(text + 2, fn->name, name_len);
+    text[name_len + 2] = '.';
+    text[name_len + 3] = '\0';
+    Name prefix = { text, name_len + 3 };
+
+    for (int i = 0; i < fn->instr_count; i++)
+        print_instr(w, program, fn, prefix, &fn->instrs[i]);
+
+    // Stubs counting the taken side of each instrumented conditional jump.
+    for (int i = 0; i < fn->instr_count && program->profile_path; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        if (instr->op != ASM_JCC || instr->branch == 0) continue;
+        print_stub_label(w, prefix, i);
+        writer_write(w, ":\n", 2);
+        print_counter_increment(w, branch_counter(program, instr->branch, 1), 0);
+        writer_write(w, "\tjmp\t", 5);
+        print_label(w, prefix, instr->label);
+        writer_putc(w, '\n');
+    }
+    free(text);
+    writer_puts(w, "\t.size\t");
+    writer_puts(w, fn->name);
+    writer_puts(w, ", .-");
+    writer_puts(w, fn->name);
+    writer_putc(w, '\n');
+}
+
+/**
+ * @brief Writes a string literal for .string, escaping quotes, backslashes and control characters.
+ * @param w The writer.
+ * @param text The string.
+ */
+static void print_string_literal(Writer *w, const char *text)
+{
+    writer_putc(w, '"');
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            writer_putc(w, '\\');
+            writer_putc(w, *c);
+        }
+        else if (*c < 0x20 || *c >= 0x7f)
+        {
+            writer_putc(w, '\\');
+            writer_putc(w, '0' + (*c >> 6));
+            writer_putc(w, '0' + ((*c >> 3) & 7));
+            writer_putc(w, '0' + (*c & 7));
+        }
+        else
+            writer_putc(w, *c);
+    }
+    writer_putc(w, '"');
+}
+
+/**
+ * @brief Writes the -fprofile-generate counters and the exit-time function that saves them.
+ *
+ * .Lprof.dump opens the profile file and, if it starts with this program's
+ * header, adds its counters into the ones in memory. It then writes the
+ * header and counters over the file. read may return fewer bytes than asked
+ * for, so .Lprof.read_all repeats it until the header or a buffer of
+ * counters is complete; a file that ends early contributes only the
+ * counters it holds in full.
+ *
+ * @param w The writer.
+ * @param program The program, with profile_path set.
+ */
+static void print_profile_runtime(Writer *w, const AsmProgram *program)
+{
+    long counter_bytes = 8 * ((long)program->function_count + 2 * (long)program->branch_count);
+    long total_bytes = (long)sizeof(ProfileHeader) + counter_bytes;
+
+    writer_puts(w, "\t.data\n\t.align\t8\n.Lprof.data:\n\t.string\t\"" PROFILE_MAGIC "\"\n\t.quad\t");
+    writer_put_long(w, (long)program->profile_checksum);
+    writer_puts(w, "\n\t.quad\t");
+    writer_put_long(w, program->function_count);
+    writer_puts(w, "\n\t.quad\t");
+    writer_put_long(w, program->branch_count);
+    writer_puts(w, "\n.Lprof.counts:\n\t.zero\t");
+    writer_put_long(w, counter_bytes);
+    writer_puts(w, "\n\t.section\t.rodata\n.Lprof.path:\n\t.string\t");
+    print_string_literal(w, program->profile_path);
+
+    // Four pushes and the buffer with 8 bytes of padding keep %rsp 16-byte
+    // aligned at the calls.
+    writer_puts(w, "\n\t.text\n.Lprof.dump:\n\tpushq\t%rbx\n\tpushq\t%r12\n\tpushq\t%r13\n\tpushq\t%r14\n"
+                   "\tsubq\t$");
+    writer_put_long(w, PROFILE_DUMP_BUFFER + 8);
+    writer_puts(w, ", %rsp\n\tleaq\t.Lprof.path(%rip), %rdi\n\tmovl\t$");
+    writer_put_long(w, O_RDWR | O_CREAT);
+    writer_puts(w, ", %esi\n\tmovl\t$420, %edx\n\txorl\t%eax, %eax\n\tcall\topen@PLT\n"
+                   "\ttestl\t%eax, %eax\n\tjs\t.Lprof.done\n\tmovl\t%eax, %ebx\n");
+
+    // Merge only into a profile of this program: compare the old header first.
+    writer_puts(w, "\tmovq\t%rsp, %rsi\n\tmovl\t$");
+    writer_put_long(w, (long)sizeof(ProfileHeader));
+    writer_puts(w, ", %edx\n\tcall\t.Lprof.read_all\n\tcmpq\t$");
+    writer_put_long(w, (long)sizeof(ProfileHeader));
+    writer_puts(w, ", %rax\n\tjne\t.Lprof.write\n\tleaq\t.Lprof.data(%rip), %rsi\n");
+    for (long offset = 0; offset < (long)sizeof(ProfileHeader); offset += 8)
+    {
+        writer_puts(w, "\tmovq\t");
+        writer_put_long(w, offset);
+        writer_puts(w, "(%rsp), %rax\n\tcmpq\t");
+        writer_put_long(w, offset);
+        writer_puts(w, "(%rsi), %rax\n\tjne\t.Lprof.write\n");
+    }
+    // %r12 is the next counter, %r13 the bytes left to merge and %r14 the
+    // size of the current buffer load.
+    writer_puts(w, "\tleaq\t.Lprof.counts(%rip), %r12\n\tmovq\t$");
+    writer_put_long(w, counter_bytes);
+    writer_puts(w, ", %r13\n.Lprof.merge:\n\ttestq\t%r13, %r13\n\tjz\t.Lprof.write\n\tmovl\t$");
+    writer_put_long(w, PROFILE_DUMP_BUFFER);
+    writer_puts(w, ", %r14d\n\tcmpq\t%r14, %r13\n\tcmovbq\t%r13, %r14\n\tmovq\t%rsp, %rsi\n\tmovq\t%r14, %rdx\n"
+                   "\tcall\t.Lprof.read_all\n\tandq\t$-8, %rax\n\tjz\t.Lprof.write\n"
+                   "\txorl\t%ecx, %ecx\n.Lprof.add:\n\tmovq\t(%rsp,%rcx), %rdx\n\taddq\t%rdx, (%r12)\n"
+                   "\taddq\t$8, %r12\n\taddq\t$8, %rcx\n\tcmpq\t%rax, %rcx\n\tjb\t.Lprof.add\n"
+                   "\tcmpq\t%r14, %rax\n\tjne\t.Lprof.write\n\tsubq\t%r14, %r13\n\tjmp\t.Lprof.merge\n");
+
+    writer_puts(w, ".Lprof.write:\n\tmovl\t%ebx, %edi\n\txorl\t%esi, %esi\n\txorl\t%edx, %edx\n\tcall\tlseek@PLT\n"
+                   "\tmovl\t%ebx, %edi\n\tleaq\t.Lprof.data(%rip), %rsi\n\tmovq\t$");
+    writer_put_long(w, total_bytes);
+    writer_puts(w, ", %rdx\n\tcall\twrite@PLT\n\tmovl\t%ebx, %edi\n\tmovq\t$");
+    writer_put_long(w, total_bytes);
+    writer_puts(w, ", %rsi\n\tcall\tftruncate@PLT\n\tmovl\t%ebx, %edi\n\tcall\tclose@PLT\n"
+                   ".Lprof.done:\n\taddq\t$");
+    writer_put_long(w, PROFILE_DUMP_BUFFER + 8);
+    writer_puts(w, ", %rsp\n\tpopq\t%r14\n\tpopq\t%r13\n\tpopq\t%r12\n\tpopq\t%rbx\n\tret\n");
+
+    // .Lprof.read_all reads %rdx bytes from the file in %ebx to %rsi and
+    // returns how many it got, fewer only at the end of the file or on an
+    // error. It keeps the buffer on its stack; three pushes realign %rsp.
+    writer_puts(w, ".Lprof.read_all:\n\tpushq\t%rbp\n\tpushq\t%r15\n\tpushq\t%rsi\n\tmovq\t%rdx, %r15\n"
+                   "\txorl\t%ebp, %ebp\n.Lprof.read_more:\n\tmovl\t%ebx, %edi\n\tmovq\t(%rsp), %rsi\n"
+                   "\taddq\t%rbp, %rsi\n\tmovq\t%r15, %rdx\n\tsubq\t%rbp, %rdx\n\tcall\tread@PLT\n"
+                   "\ttestq\t%rax, %rax\n\tjle\t.Lprof.read_done\n\taddq\t%rax, %rbp\n\tcmpq\t%r15, %rbp\n"
+                   "\tjb\t.Lprof.read_more\n.Lprof.read_done:\n\tmovq\t%rbp, %rax\n\tpopq\t%rsi\n\tpopq\t%r15\n"
+                   "\tpopq\t%rbp\n\tret\n"
+                   "\t.section\t.fini_array,\"aw\"\n\t.align\t8\n\t.quad\t.Lprof.dump\n");
+}
+
+/**
+ * @brief Writes a program as an assembly file.
+ * @param w The writer.
+ * @param program The program after fix-up.
+ * @param source_name The file name recorded in the .file directive.
+ */
+void asm_print_program(Writer *w, const AsmProgram *program, const char *source_name)
+{
+    writer_puts(w, "\t.file\t\"");
+    writer_puts(w, source_name);
+    writer_puts(w, "\"\n\t.text\n");
+    for (int f = 0; f < program->function_count; f++)
+    {
+        if (program->functions[f].defined)
+            print_function(w, program, &program->functions[f]);
+    }
+    if (program->profile_path)
+        print_profile_runtime(w, program);
+    writer_puts(w, "\t.section\t.note.GNU-stack,\"\",@progbits\n");
+}
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+
+/**
+ * @brief Turns an AST node kind into the name used by the AST dumps.
+ * @param kind The node kind to convert.
+ * @return A pointer to the name of the node kind.
+ */
+const char *ast_kind_to_string(AstKind kind)
+{
+    switch (kind) 
+    {
+        case AST_PROGRAM: return "Program";
+        case AST_FUNCTION: return "Function";
+        case AST_RETURN: return "Return";
+        case AST_CONSTANT: return "Constant";
+        default: return "Unknown";
+    }
+}
+
+/**
+ * @brief Allocates a new, childless AST node.
+ * @param kind The kind of node to create.
+ * @return A pointer to the new node, or NULL on allocation failure.
+ */
+AstNode *ast_new(AstKind kind)
+{
+    AstNode *node = calloc(1, sizeof(AstNode));
+    if (!node) return NULL;
+    node->kind = kind;
+    return node;
+}
+
+/**
+ * @brief Appends a child to an AST node, growing its child array as needed.
+ * @param parent The node receiving the child.
+ * @param child The child node. Ownership passes to the parent.
+ */
+void ast_add_child(AstNode *parent, AstNode *child)
+{
+    if (parent->child_count == parent->child_capacity) 
+    {
+        parent->child_capacity = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        parent->children = realloc(parent->children, parent->child_capacity * sizeof(AstNode *));
+    }
+    parent->children[parent->child_count++] = child;
+}
+
+/**
+ * @brief Frees an AST iteratively, so arbitrarily deep trees cannot overflow the C stack.
+ * @param root The root of the tree to free. May be NULL.
+ */
+void ast_free(AstNode *root)
+{
+    if (!root) return;
+
+    int stack_count = 0;
+    int stack_capacity = 64;
+    AstNode **stack = malloc(stack_capacity * sizeof(AstNode *));
+    stack[stack_count++] = root;
+
+    while (stack_count > 0) 
+    {
+        AstNode *node = stack[--stack_count];
+        for (int i = 0; i < node->child_count; i++) 
+        {
+            if (stack_count == stack_capacity) 
+            {
+                stack_capacity *= 2;
+                stack = realloc(stack, stack_capacity * sizeof(AstNode *));
+            }
+            stack[stack_count++] = node->children[i];
+        }
+        free(node->children);
+        free(node->name);
+        free(node);
+    }
+
+    free(stack);
+}
@@ -0,0 +1,29 @@
+#ifndef AST_H
+#define AST_H
+
+//--- AST Node Kinds ---
+typedef enum
+{
+    AST_PROGRAM,  // children: function definitions
+    AST_FUNCTION, // name, children: body statements
+    AST_RETURN,   // children: returned expression
+    AST_CONSTANT  // value
+} AstKind;
+
+//--- AST Node Structure ---
+typedef struct AstNode
+{
+    AstKind kind;
+    char *name;
+    long value;
+    struct AstNode **children;
+    int child_count;
+    int child_capacity;
+} AstNode;
+
+const char *ast_kind_to_string(AstKind kind);
+AstNode *ast_new(AstKind kind);
+void ast_add_child(AstNode *parent, AstNode *child);
+void ast_free(AstNode *root);
+
+#endif
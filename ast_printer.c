@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ast_printer.h"
+
+#define INDENT_WIDTH 2
+
+//--- Traversal Frame ---
+typedef struct
+{
+    const AstNode *node;
+    int next_child;
+} PrintFrame;
+
+/**
+ * @brief Writes a string as a JSON string literal, escaping quotes and backslashes.
+ * @param w The writer.
+ * @param s The string to write.
+ */
+static void write_json_string(Writer *w, const char *s)
+{
+    writer_putc(w, '"');
+    for (; *s; s++) 
+    {
+        if (*s == '"' || *s == '\\') 
+            writer_putc(w, '\\');
+        writer_putc(w, *s);
+    }
+    writer_putc(w, '"');
+}
+
+/**
+ * @brief Writes the opening of a node: its kind and scalar fields.
+ * @param w The writer.
+ * @param node The node being opened.
+ * @param format The dump format.
+ */
+static void write_node_open(Writer *w, const AstNode *node, AstFormat format)
+{
+    if (format == AST_FORMAT_SEXPR) 
+    {
+        writer_putc(w, '(');
+        writer_puts(w, ast_kind_to_string(node->kind));
+        if (node->name) 
+        {
+            writer_putc(w, ' ');
+            writer_puts(w, node->name);
+        }
+        if (node->kind == AST_CONSTANT) 
+        {
+            writer_putc(w, ' ');
+            writer_put_long(w, node->value);
+        }
+        return;
+    }
+
+    writer_puts(w, "{\"kind\": ");
+    write_json_string(w, ast_kind_to_string(node->kind));
+    if (node->name) 
+    {
+        writer_puts(w, ", \"name\": ");
+        write_json_string(w, node->name);
+    }
+    if (node->kind == AST_CONSTANT) 
+    {
+        writer_puts(w, ", \"value\": ");
+        writer_put_long(w, node->value);
+    }
+    if (node->child_count > 0) 
+        writer_puts(w, ", \"children\": [");
+}
+
+/**
+ * @brief Writes the closing of a node once all of its children are printed.
+ * @param w The writer.
+ * @param node The node being closed.
+ * @param depth The nesting depth of the node.
+ * @param format The dump format.
+ */
+static void write_node_close(Writer *w, const AstNode *node, int depth, AstFormat format)
+{
+    if (format == AST_FORMAT_SEXPR) 
+    {
+        writer_putc(w, ')');
+        return;
+    }
+
+    if (node->child_count > 0) 
+    {
+        writer_putc(w, '\n');
+        writer_indent(w, depth * INDENT_WIDTH);
+        writer_putc(w, ']');
+    }
+    writer_putc(w, '}');
+}
+
+/**
+ * @brief Dumps an AST in the requested format, one node per line.
+ *
+ * The traversal keeps its own stack instead of recursing, so the depth of the
+ * tree is limited only by memory and the output is produced in a single pass.
+ *
+ * @param w The writer to print to. The caller flushes it.
+ * @param root The root of the tree to print.
+ * @param format AST_FORMAT_SEXPR or AST_FORMAT_JSON.
+ */
+void ast_print(Writer *w, const AstNode *root, AstFormat format)
+{
+    int stack_count = 0;
+    int stack_capacity = 64;
+    PrintFrame *stack = malloc(stack_capacity * sizeof(PrintFrame));
+
+    write_node_open(w, root, format);
+    stack[stack_count++] = (PrintFrame){root, 0};
+
+    while (stack_count > 0) 
+    {
+        PrintFrame *top = &stack[stack_count - 1];
+        const AstNode *node = top->node;
+
+        if (top->next_child == node->child_count) 
+        {
+            write_node_close(w, node, stack_count - 1, format);
+            stack_count--;
+            continue;
+        }
+
+        const AstNode *child = node->children[top->next_child];
+        if (format == AST_FORMAT_JSON && top->next_child > 0) 
+            writer_putc(w, ',');
+        top->next_child++;
+
+        writer_putc(w, '\n');
+        writer_indent(w, stack_count * INDENT_WIDTH);
+        write_node_open(w, child, format);
+
+        if (stack_count == stack_capacity) 
+        {
+            stack_capacity *= 2;
+            stack = realloc(stack, stack_capacity * sizeof(PrintFrame));
+        }
+        stack[stack_count++] = (PrintFrame){child, 0};
+    }
+
+    writer_putc(w, '\n');
+    free(stack);
+}
@@ -0,0 +1,16 @@
+#ifndef AST_PRINTER_H
+#define AST_PRINTER_H
+
+#include "ast.h"
+#include "writer.h"
+
+//--- AST Dump Formats ---
+typedef enum
+{
+    AST_FORMAT_SEXPR,
+    AST_FORMAT_JSON
+} AstFormat;
+
+void ast_print(Writer *w, const AstNode *root, AstFormat format);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Dense Bitsets ---
+// Temporaries and blocks are numbered densely, so sets of them are plain word
+// arrays. Callers keep the word count (bitset_words) next to the pointer.
+
+typedef uint64_t BitWord;
+
+#define BITSET_WORD_BITS 64
+
+static inline size_t bitset_words(int bits)
+{
+    return ((size_t)bits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+}
+
+static inline BitWord *bitset_new(int bits)
+{
+    return calloc(bitset_words(bits) ? bitset_words(bits) : 1, sizeof(BitWord));
+}
+
+static inline void bitset_set(BitWord *set, int bit)
+{
+    set[bit / BITSET_WORD_BITS] |= (BitWord)1 << (bit % BITSET_WORD_BITS);
+}
+
+static inline void bitset_clear(BitWord *set, int bit)
+{
+    set[bit / BITSET_WORD_BITS] &= ~((BitWord)1 << (bit % BITSET_WORD_BITS));
+}
+
+static inline int bitset_test(const BitWord *set, int bit)
+{
+    return (int)((set[bit / BITSET_WORD_BITS] >> (bit % BITSET_WORD_BITS)) & 1);
+}
+
+static inline void bitset_zero(BitWord *set, size_t words)
+{
+    memset(set, 0, words * sizeof(BitWord));
+}
+
+static inline void bitset_copy(BitWord *dst, const BitWord *src, size_t words)
+{
+    memcpy(dst, src, words * sizeof(BitWord));
+}
+
+/**
+ * @brief dst |= src.
+ * @return 1 if dst changed, 0 otherwise.
+ */
+static inline int bitset_union_into(BitWord *dst, const BitWord *src, size_t words)
+{
+    BitWord changed = 0;
+    for (size_t i = 0; i < words; i++)
+    {
+        BitWord merged = dst[i] | src[i];
+        changed |= merged ^ dst[i];
+        dst[i] = merged;
+    }
+    return changed != 0;
+}
+
+#endif
@@ -0,0 +1,647 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfg.h"
+
+/**
+ * @brief Finds the last instruction of a block that is not a nop.
+ * @param fn The function the block belongs to.
+ * @param block The block.
+ * @return The instruction index, or -1 if the block holds only nops.
+ */
+int cfg_last_instr(const IrFunction *fn, const BasicBlock *block)
+{
+    for (int i = block->end - 1; i >= block->start; i--)
+    {
+        if (fn->instrs[i].op != IR_NOP)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Summarizes how control leaves each block.
+ * @param fn The function.
+ * @param cfg Its CFG.
+ * @param exits Receives one summary per block.
+ */
+void cfg_summarize_exits(const IrFunction *fn, const Cfg *cfg, BlockExit *exits)
+{
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        BlockExit *exit = &exits[b];
+        int next = b + 1 < cfg->block_count ? b + 1 : -1;
+        int last = cfg_last_instr(fn, block);
+        const IrInstr *instr = last >= 0 ? &fn->instrs[last] : NULL;
+
+        exit->body_start = block->label >= 0 ? block->start + 1 : block->start;
+        exit->body_end = block->end;
+        exit->target = next;
+        exit->fall = next;
+
+        if (instr && ir_is_jump(instr->op))
+        {
+            exit->body_end = last;
+            exit->target = cfg->label_block[instr->label];
+            if (instr->op == IR_JUMP)
+                exit->kind = EXIT_JUMP;
+            else
+            {
+                exit->kind = EXIT_COND;
+                exit->cond_op = instr->op;
+                exit->cond = instr->a;
+                exit->branch = instr->branch;
+            }
+        }
+        else if (instr && instr->op == IR_RETURN)
+            exit->kind = EXIT_RETURN;
+        else
+            exit->kind = next >= 0 ? EXIT_JUMP : EXIT_FALL_OFF;
+
+        exit->body_size = 0;
+        for (int i = exit->body_start; i < exit->body_end; i++)
+        {
+            if (fn->instrs[i].op != IR_NOP && fn->instrs[i].op != IR_LABEL)
+                exit->body_size++;
+        }
+    }
+}
+
+/**
+ * @brief Appends an instruction to the emitter's output.
+ * @param e The emitter.
+ * @param op The opcode.
+ * @param a The operand.
+ * @param label The label or jump target.
+ * @return The new instruction.
+ */
+IrInstr *cfg_emit(BlockEmitter *e, IrOpcode op, IrValue a, int label)
+{
+    IrInstr *instr = &e->out[e->count++];
+    memset(instr, 0, sizeof(IrInstr));
+    instr->op = op;
+    instr->a = a;
+    instr->label = label;
+    return instr;
+}
+
+/**
+ * @brief Emits whatever transfers control to a block from the end of another.
+ *
+ * Nothing is needed when the target is laid out next. With inline_returns
+ * set, a jump to a block that only returns is replaced by a copy of the
+ * return.
+ *
+ * @param e The emitter.
+ * @param target The destination block, or -1 to fall off the function.
+ * @param next The block laid out next, or -1.
+ */
+void cfg_emit_goto(BlockEmitter *e, int target, int next)
+{
+    if (target == next)
+        return;
+    if (target < 0)
+    {
+        cfg_emit(e, IR_RETURN, ir_const(0), 0);
+        return;
+    }
+
+    const BlockExit *exit = &e->exits[target];
+    if (e->inline_returns && exit->kind == EXIT_RETURN && exit->body_size == 1)
+    {
+        for (int i = exit->body_start; i < exit->body_end; i++)
+        {
+            if (e->fn->instrs[i].op == IR_RETURN)
+                e->out[e->count++] = e->fn->instrs[i];
+        }
+        return;
+    }
+    cfg_emit(e, IR_JUMP, ir_none(), e->label_of[target]);
+}
+
+/**
+ * @brief Emits a block's label, its body and its exit, given the block that follows it.
+ *
+ * A conditional jump whose target is laid out next is inverted to jump to
+ * the other successor, negating its profile branch id to match.
+ *
+ * @param e The emitter.
+ * @param b The block.
+ * @param next The block laid out next, or -1.
+ * @return 1 if the block's conditional jump was inverted, 0 otherwise.
+ */
+int cfg_emit_block(BlockEmitter *e, int b, int next)
+{
+    const BlockExit *exit = &e->exits[b];
+    const IrInstr *instrs = e->fn->instrs;
+
+    cfg_emit(e, IR_LABEL, ir_none(), e->label_of[b]);
+    for (int j = exit->body_start; j < exit->body_end; j++)
+    {
+        if (instrs[j].op != IR_NOP && instrs[j].op != IR_LABEL)
+            e->out[e->count++] = instrs[j];
+    }
+
+    switch (exit->kind)
+    {
+        case EXIT_RETURN:
+            break;
+        case EXIT_FALL_OFF:
+            if (next >= 0)
+                cfg_emit(e, IR_RETURN, ir_const(0), 0);
+            break;
+        case EXIT_JUMP:
+            cfg_emit_goto(e, exit->target, next);
+            break;
+        case EXIT_COND:
+            if (exit->target == next && exit->fall >= 0 && exit->fall != exit->target)
+            {
+                IrOpcode inverted = exit->cond_op == IR_JUMP_IF_ZERO ? IR_JUMP_IF_NOT_ZERO : IR_JUMP_IF_ZERO;
+                cfg_emit(e, inverted, exit->cond, e->label_of[exit->fall])->branch = -exit->branch;
+                return 1;
+            }
+            if (exit->target >= 0)
+            {
+                cfg_emit(e, exit->cond_op, exit->cond, e->label_of[exit->target])->branch = exit->branch;
+                cfg_emit_goto(e, exit->fall, next);
+            }
+            else
+            {
+                // Taken means falling off the end, so jump to a return of its own.
+                int off = ir_new_label(e->fn);
+                cfg_emit(e, exit->cond_op, exit->cond, off)->branch = exit->branch;
+                cfg_emit_goto(e, exit->fall, next);
+                cfg_emit(e, IR_LABEL, ir_none(), off);
+                cfg_emit(e, IR_RETURN, ir_const(0), 0);
+            }
+            break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Orders the reachable blocks in reverse postorder with an explicit DFS stack.
+ * @param cfg The CFG whose rpo and rpo_index arrays are filled.
+ */
+static void compute_rpo(Cfg *cfg)
+{
+    int n = cfg->block_count;
+    cfg->rpo = malloc((n + 1) * sizeof(int));
+    cfg->rpo_index = malloc((n + 1) * sizeof(int));
+    cfg->rpo_count = 0;
+    for (int i = 0; i < n; i++)
+        cfg->rpo_index[i] = -1;
+    if (n == 0) return;
+
+    int *stack = malloc(n * sizeof(int));
+    int *next_succ = calloc(n, sizeof(int));
+    int *postorder = malloc(n * sizeof(int));
+    int post_count = 0;
+    int depth = 0;
+
+    // rpo_index doubles as the visited mark until the final numbering.
+    stack[depth++] = 0;
+    cfg->rpo_index[0] = 0;
+    while (depth > 0)
+    {
+        int b = stack[depth - 1];
+        if (next_succ[b] < cfg->blocks[b].succ_count)
+        {
+            int s = cfg->blocks[b].succs[next_succ[b]++];
+            if (cfg->rpo_index[s] < 0)
+            {
+                cfg->rpo_index[s] = 0;
+                stack[depth++] = s;
+            }
+            continue;
+        }
+        postorder[post_count++] = b;
+        depth--;
+    }
+
+    for (int i = 0; i < post_count; i++)
+    {
+        int b = postorder[post_count - 1 - i];
+        cfg->rpo[i] = b;
+        cfg->rpo_index[b] = i;
+    }
+    cfg->rpo_count = post_count;
+
+    free(postorder);
+    free(next_succ);
+    free(stack);
+}
+
+/**
+ * @brief Splits a function into basic blocks and links them into a CFG.
+ *
+ * A block starts at the first instruction, at every label and after every jump
+ * or return. Its successors are its jump target and, unless it ends in an
+ * unconditional transfer, the next block in instruction order. The reverse
+ * postorder of reachable blocks is computed as part of construction.
+ *
+ * @param fn The function to analyze.
+ * @return The CFG. Free it with cfg_free.
+ */
+Cfg *cfg_build(const IrFunction *fn)
+{
+    Cfg *cfg = calloc(1, sizeof(Cfg));
+    cfg->label_count = fn->label_count;
+    cfg->label_block = malloc((fn->label_count + 1) * sizeof(int));
+    for (int i = 0; i < fn->label_count; i++)
+        cfg->label_block[i] = -1;
+
+    // Count leaders so the block array is allocated once.
+    int leaders = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (i == 0 || fn->instrs[i].op == IR_LABEL || ir_is_jump(fn->instrs[i - 1].op) ||
+            fn->instrs[i - 1].op == IR_RETURN)
+            leaders++;
+    }
+
+    cfg->blocks = calloc(leaders + 1, sizeof(BasicBlock));
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        const IrInstr *instr = &fn->instrs[i];
+        if (i == 0 || instr->op == IR_LABEL || ir_is_jump(fn->instrs[i - 1].op) ||
+            fn->instrs[i - 1].op == IR_RETURN)
+        {
+            BasicBlock *block = &cfg->blocks[cfg->block_count++];
+            block->start = i;
+            block->label = -1;
+            if (instr->op == IR_LABEL)
+            {
+                block->label = instr->label;
+                cfg->label_block[instr->label] = cfg->block_count - 1;
+            }
+        }
+        cfg->blocks[cfg->block_count - 1].end = i + 1;
+    }
+
+    int edge_count = 0;
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        BasicBlock *block = &cfg->blocks[b];
+        int last = cfg_last_instr(fn, block);
+        IrOpcode op = last >= 0 ? fn->instrs[last].op : IR_NOP;
+
+        if (ir_is_jump(op))
+        {
+            int target = cfg->label_block[fn->instrs[last].label];
+            if (target >= 0)
+                block->succs[block->succ_count++] = target;
+        }
+        if (!ir_is_terminator(op) && b + 1 < cfg->block_count)
+        {
+            if (block->succ_count == 0 || block->succs[0] != b + 1)
+                block->succs[block->succ_count++] = b + 1;
+        }
+        edge_count += block->succ_count;
+    }
+
+    // Predecessor lists in one array: count, prefix-sum, fill.
+    cfg->preds = malloc((edge_count + 1) * sizeof(int));
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        for (int s = 0; s < cfg->blocks[b].succ_count; s++)
+            cfg->blocks[cfg->blocks[b].succs[s]].pred_count++;
+    }
+    int offset = 0;
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        cfg->blocks[b].pred_start = offset;
+        offset += cfg->blocks[b].pred_count;
+        cfg->blocks[b].pred_count = 0;
+    }
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        for (int s = 0; s < cfg->blocks[b].succ_count; s++)
+        {
+            BasicBlock *succ = &cfg->blocks[cfg->blocks[b].succs[s]];
+            cfg->preds[succ->pred_start + succ->pred_count++] = b;
+        }
+    }
+
+    compute_rpo(cfg);
+    return cfg;
+}
+
+/**
+ * @brief Walks two blocks up the dominator tree until they meet.
+ * @param cfg The CFG with a partially computed idom array.
+ * @param a The first block.
+ * @param b The second block.
+ * @return The nearest common dominator found so far.
+ */
+static int intersect(const Cfg *cfg, int a, int b)
+{
+    while (a != b)
+    {
+        while (cfg->rpo_index[a] > cfg->rpo_index[b])
+            a = cfg->idom[a];
+        while (cfg->rpo_index[b] > cfg->rpo_index[a])
+            b = cfg->idom[b];
+    }
+    return a;
+}
+
+/**
+ * @brief Computes immediate dominators and the dominator tree.
+ *
+ * Uses the iterative algorithm of Cooper, Harvey and Kennedy over reverse
+ * postorder, which converges in two or three passes on reducible graphs. The
+ * tree is then numbered in pre- and postorder so cfg_dominates is O(1).
+ *
+ * @param cfg The CFG to annotate.
+ */
+void cfg_compute_dominators(Cfg *cfg)
+{
+    int n = cfg->block_count;
+    cfg->idom = malloc((n + 1) * sizeof(int));
+    for (int i = 0; i < n; i++)
+        cfg->idom[i] = -1;
+    if (n > 0)
+        cfg->idom[cfg->rpo[0]] = cfg->rpo[0];
+
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 1; i < cfg->rpo_count; i++)
+        {
+            int b = cfg->rpo[i];
+            const BasicBlock *block = &cfg->blocks[b];
+            int new_idom = -1;
+            for (int p = 0; p < block->pred_count; p++)
+            {
+                int pred = cfg->preds[block->pred_start + p];
+                if (cfg->idom[pred] < 0) continue;
+                new_idom = new_idom < 0 ? pred : intersect(cfg, pred, new_idom);
+            }
+            if (cfg->idom[b] != new_idom)
+            {
+                cfg->idom[b] = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    // Children lists in one array: count, prefix-sum, fill.
+    cfg->dom_child_start = calloc(n + 2, sizeof(int));
+    cfg->dom_children = malloc((n + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+    {
+        if (cfg->idom[b] >= 0 && cfg->idom[b] != b)
+            cfg->dom_child_start[cfg->idom[b] + 1]++;
+    }
+    for (int b = 0; b < n; b++)
+        cfg->dom_child_start[b + 1] += cfg->dom_child_start[b];
+    int *fill = malloc((n + 1) * sizeof(int));
+    memcpy(fill, cfg->dom_child_start, (n + 1) * sizeof(int));
+    for (int i = 0; i < cfg->rpo_count; i++)
+    {
+        int b = cfg->rpo[i];
+        if (cfg->idom[b] != b)
+            cfg->dom_children[fill[cfg->idom[b]]++] = b;
+    }
+    free(fill);
+
+    cfg->dom_pre = malloc((n + 1) * sizeof(int));
+    cfg->dom_post = malloc((n + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+    {
+        cfg->dom_pre[b] = -1;
+        cfg->dom_post[b] = -1;
+    }
+    if (n == 0) return;
+
+    int *stack = malloc(n * sizeof(int));
+    int *next_child = malloc(n * sizeof(int));
+    int depth = 0, pre = 0, post = 0;
+    stack[depth++] = cfg->rpo[0];
+    next_child[cfg->rpo[0]] = cfg->dom_child_start[cfg->rpo[0]];
+    cfg->dom_pre[cfg->rpo[0]] = pre++;
+    while (depth > 0)
+    {
+        int b = stack[depth - 1];
+        if (next_child[b] < cfg->dom_child_start[b + 1])
+        {
+            int c = cfg->dom_children[next_child[b]++];
+            cfg->dom_pre[c] = pre++;
+            next_child[c] = cfg->dom_child_start[c];
+            stack[depth++] = c;
+            continue;
+        }
+        cfg->dom_post[b] = post++;
+        depth--;
+    }
+    free(next_child);
+    free(stack);
+}
+
+/**
+ * @brief Checks whether block a dominates block b. Requires cfg_compute_dominators.
+ * @param cfg The CFG.
+ * @param a The candidate dominator.
+ * @param b The block.
+ * @return 1 if every path from the entry to b passes through a, 0 otherwise.
+ */
+int cfg_dominates(const Cfg *cfg, int a, int b)
+{
+    if (cfg->dom_pre[a] < 0 || cfg->dom_pre[b] < 0)
+        return 0;
+    return cfg->dom_pre[a] <= cfg->dom_pre[b] && cfg->dom_post[b] <= cfg->dom_post[a];
+}
+
+/**
+ * @brief Computes dominance frontiers. Requires cfg_compute_dominators.
+ *
+ * For every join point, walks each predecessor up the dominator tree to the
+ * join's immediate dominator, adding the join to the frontier of every block
+ * passed (Cooper, Harvey and Kennedy). Since joins are processed one at a time,
+ * a duplicate is always the most recent entry of a list.
+ *
+ * @param cfg The CFG to annotate.
+ */
+void cfg_compute_frontiers(Cfg *cfg)
+{
+    int n = cfg->block_count;
+    int *counts = calloc(n + 1, sizeof(int));
+    int *capacity = calloc(n + 1, sizeof(int));
+    int **lists = calloc(n + 1, sizeof(int *));
+    int total = 0;
+
+    for (int b = 0; b < n; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        if (block->pred_count < 2 || cfg->idom[b] < 0) continue;
+
+        for (int p = 0; p < block->pred_count; p++)
+        {
+            int runner = cfg->preds[block->pred_start + p];
+            if (cfg->idom[runner] < 0) continue;
+            while (runner != cfg->idom[b])
+            {
+                if (counts[runner] == 0 || lists[runner][counts[runner] - 1] != b)
+                {
+                    if (counts[runner] == capacity[runner])
+                    {
+                        capacity[runner] = capacity[runner] ? capacity[runner] * 2 : 4;
+                        lists[runner] = realloc(lists[runner], capacity[runner] * sizeof(int));
+                    }
+                    lists[runner][counts[runner]++] = b;
+                    total++;
+                }
+                if (runner == cfg->idom[runner]) break;
+                runner = cfg->idom[runner];
+            }
+        }
+    }
+
+    cfg->df_start = malloc((n + 1) * sizeof(int));
+    cfg->df = malloc((total + 1) * sizeof(int));
+    int offset = 0;
+    for (int b = 0; b < n; b++)
+    {
+        cfg->df_start[b] = offset;
+        if (counts[b] > 0)
+            memcpy(cfg->df + offset, lists[b], counts[b] * sizeof(int));
+        offset += counts[b];
+        free(lists[b]);
+    }
+    cfg->df_start[n] = offset;
+
+    free(lists);
+    free(capacity);
+    free(counts);
+}
+
+/**
+ * @brief Computes live-in and live-out sets of temporaries for every block.
+ *
+ * A phi's result is defined on entry to its block, and each phi argument is a
+ * use at the end of the predecessor it names. Blocks are revisited in
+ * postorder until no set changes.
+ *
+ * @param cfg The CFG to annotate.
+ * @param fn The function the CFG was built from.
+ */
+void cfg_compute_liveness(Cfg *cfg, IrFunction *fn)
+{
+    int n = cfg->block_count;
+    size_t words = bitset_words(fn->temp_count);
+    if (words == 0) words = 1;
+    cfg->live_words = words;
+    cfg->live_in = calloc((size_t)(n + 1) * words, sizeof(BitWord));
+    cfg->live_out = calloc((size_t)(n + 1) * words, sizeof(BitWord));
+
+    BitWord *gen = calloc((size_t)(n + 1) * words, sizeof(BitWord));
+    BitWord *kill = calloc((size_t)(n + 1) * words, sizeof(BitWord));
+    BitWord *phi_uses = calloc((size_t)(n + 1) * words, sizeof(BitWord));
+
+    for (int b = 0; b < n; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        BitWord *g = gen + b * words;
+        BitWord *k = kill + b * words;
+        for (int i = block->start; i < block->end; i++)
+        {
+            IrInstr *instr = &fn->instrs[i];
+            if (instr->op == IR_PHI)
+            {
+                for (int j = 0; j < instr->arg_count; j++)
+                {
+                    IrValue value = fn->args[instr->arg_start + j];
+                    int label = fn->arg_labels[instr->arg_start + j];
+                    int pred = label < cfg->label_count ? cfg->label_block[label] : -1;
+                    if (value.kind == IR_VAL_TEMP && pred >= 0)
+                        bitset_set(phi_uses + pred * words, value.value);
+                }
+            }
+            else
+            {
+                int uses = ir_use_count(instr);
+                for (int j = 0; j < uses; j++)
+                {
+                    IrValue *use = ir_use(fn, instr, j);
+                    if (use->kind == IR_VAL_TEMP && !bitset_test(k, use->value))
+                        bitset_set(g, use->value);
+                }
+            }
+            if (instr->dst.kind == IR_VAL_TEMP)
+                bitset_set(k, instr->dst.value);
+        }
+    }
+
+    // Visit reachable blocks in postorder, then any unreachable ones.
+    int *order = malloc((n + 1) * sizeof(int));
+    int count = 0;
+    for (int i = cfg->rpo_count - 1; i >= 0; i--)
+        order[count++] = cfg->rpo[i];
+    for (int b = 0; b < n; b++)
+    {
+        if (cfg->rpo_index[b] < 0)
+            order[count++] = b;
+    }
+
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 0; i < count; i++)
+        {
+            int b = order[i];
+            const BasicBlock *block = &cfg->blocks[b];
+            BitWord *out = cfg->live_out + b * words;
+            BitWord *in = cfg->live_in + b * words;
+
+            bitset_union_into(out, phi_uses + b * words, words);
+            for (int s = 0; s < block->succ_count; s++)
+                bitset_union_into(out, cfg->live_in + block->succs[s] * words, words);
+
+            const BitWord *g = gen + b * words;
+            const BitWord *k = kill + b * words;
+            for (size_t w = 0; w < words; w++)
+            {
+                BitWord next = g[w] | (out[w] & ~k[w]);
+                if (next != in[w])
+                {
+                    in[w] = next;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    free(order);
+    free(phi_uses);
+    free(kill);
+    free(gen);
+}
+
+/**
+ * @brief Frees a CFG and every analysis attached to it.
+ * @param cfg The CFG to free. May be NULL.
+ */
+void cfg_free(Cfg *cfg)
+{
+    if (!cfg) return;
+    free(cfg->blocks);
+    free(cfg->preds);
+    free(cfg->label_block);
+    free(cfg->rpo);
+    free(cfg->rpo_index);
+    free(cfg->idom);
+    free(cfg->dom_child_start);
+    free(cfg->dom_children);
+    free(cfg->dom_pre);
+    free(cfg->dom_post);
+    free(cfg->df_start);
+    free(cfg->df);
+    free(cfg->live_in);
+    free(cfg->live_out);
+    free(cfg);
+}
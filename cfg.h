@@ -0,0 +1,102 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "bitset.h"
+#include "ir.h"
+
+// --- Control-Flow Graph ---
+// Blocks are ranges of a function's instruction array, so the CFG is an
+// analysis over the linear IR: a pass that rewrites instructions rebuilds it.
+
+//--- Basic Block ---
+typedef struct
+{
+    int start;          // Index of the block's first instruction
+    int end;            // One past the block's last instruction
+    int label;          // Label defined by the first instruction, or -1
+    int succs[2];       // Jump target and/or fall-through block
+    int succ_count;
+    int pred_start;     // First predecessor in Cfg.preds
+    int pred_count;
+} BasicBlock;
+
+//--- CFG Structure ---
+typedef struct
+{
+    BasicBlock *blocks;
+    int block_count;
+    int *preds;             // Predecessor lists, indexed by BasicBlock.pred_start
+    int *label_block;       // Label number -> defining block, -1 if undefined
+    int label_count;
+
+    int *rpo;               // Reachable blocks in reverse postorder; rpo[0] is the entry
+    int rpo_count;
+    int *rpo_index;         // Block -> position in rpo, -1 if unreachable
+
+    // cfg_compute_dominators
+    int *idom;              // Immediate dominator; the entry maps to itself, unreachable blocks to -1
+    int *dom_child_start;   // Dominator tree children of b: dom_children[dom_child_start[b] .. dom_child_start[b + 1])
+    int *dom_children;
+    int *dom_pre;           // Preorder and postorder numbers in the dominator tree
+    int *dom_post;
+
+    // cfg_compute_frontiers
+    int *df_start;          // Dominance frontier of b: df[df_start[b] .. df_start[b + 1])
+    int *df;
+
+    // cfg_compute_liveness
+    BitWord *live_in;       // block_count rows of live_words words, indexed by temporary
+    BitWord *live_out;
+    size_t live_words;
+} Cfg;
+
+//--- Block Exit Kinds ---
+typedef enum
+{
+    EXIT_RETURN,    // Ends in a return
+    EXIT_JUMP,      // Unconditional transfer to target (jump or fall-through)
+    EXIT_COND,      // Conditional jump to target, else fall-through
+    EXIT_FALL_OFF   // Runs off the end of the function (implicit return 0)
+} ExitKind;
+
+//--- Block Exit ---
+// How control leaves a block, for passes that lay the blocks out again.
+typedef struct
+{
+    ExitKind kind;
+    IrOpcode cond_op;   // EXIT_COND: IR_JUMP_IF_ZERO or IR_JUMP_IF_NOT_ZERO
+    IrValue cond;       // EXIT_COND: tested operand
+    int32_t branch;     // EXIT_COND: profile branch id of the jump
+    int target;         // EXIT_JUMP, EXIT_COND: taken successor, -1 for falling off
+    int fall;           // EXIT_COND: not-taken successor, -1 for falling off
+    int body_start;     // Instructions between the label and the exit jump
+    int body_end;
+    int body_size;      // Non-nop instructions in the body
+} BlockExit;
+
+//--- Block Emitter ---
+// Writes blocks back out as linear IR in a new order. Each block takes at
+// most its label, its body and four exit instructions.
+typedef struct
+{
+    IrFunction *fn;         // Source of the block bodies; new labels come from it
+    const BlockExit *exits;
+    const int *label_of;    // Block -> label
+    IrInstr *out;
+    int count;
+    int inline_returns;     // Replace a jump to a block that only returns with the return
+} BlockEmitter;
+
+Cfg *cfg_build(const IrFunction *fn);
+void cfg_compute_dominators(Cfg *cfg);
+void cfg_compute_frontiers(Cfg *cfg);
+void cfg_compute_liveness(Cfg *cfg, IrFunction *fn);
+int cfg_dominates(const Cfg *cfg, int a, int b);
+int cfg_last_instr(const IrFunction *fn, const BasicBlock *block);
+void cfg_summarize_exits(const IrFunction *fn, const Cfg *cfg, BlockExit *exits);
+IrInstr *cfg_emit(BlockEmitter *e, IrOpcode op, IrValue a, int label);
+void cfg_emit_goto(BlockEmitter *e, int target, int next);
+int cfg_emit_block(BlockEmitter *e, int b, int next);
+void cfg_free(Cfg *cfg);
+
+#endif
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+#include "cfg.h"
+
+// --- Copy Coalescing ---
+// Leaving SSA turns phis into copies between temporaries whose live ranges
+// usually do not overlap. When the two sides of a copy never interfere they
+// can share one temporary, and the copy becomes a no-op. Interference is only
+// tested for pairs connected by a copy: walking each block backwards from its
+// live-out set, a definition of x interferes with a partner y that is live at
+// that point, unless the definition is the copy x = y itself.
+//
+// Each round merges every temporary at most once, so the interference facts
+// it computed stay valid; rounds repeat until no copy can be removed.
+
+//--- Pass State ---
+typedef struct
+{
+    IrFunction *fn;
+    int *partner_start;     // Copy partners of t: partners[partner_start[t] .. partner_start[t + 1])
+    int *partners;
+    unsigned char *interferes; // Parallel to partners
+} Coalesce;
+
+/**
+ * @brief Finds a partner's index in a temporary's partner list.
+ * @param c The pass state.
+ * @param x The temporary.
+ * @param y The partner.
+ * @return The index into partners, or -1.
+ */
+static int find_partner(const Coalesce *c, int x, int y)
+{
+    for (int k = c->partner_start[x]; k < c->partner_start[x + 1]; k++)
+    {
+        if (c->partners[k] == y)
+            return k;
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the temporary copied by an instruction, or -1.
+ * @param instr The instruction.
+ * @return The copy's source temporary.
+ */
+static int copy_source(const IrInstr *instr)
+{
+    if (instr->op != IR_COPY || instr->dst.kind != IR_VAL_TEMP || instr->a.kind != IR_VAL_TEMP)
+        return -1;
+    return instr->a.value;
+}
+
+/**
+ * @brief Collects, for every temporary, the temporaries it is copied to or from.
+ * @param c The pass state.
+ * @return The number of copies between distinct temporaries.
+ */
+static int collect_partners(Coalesce *c)
+{
+    IrFunction *fn = c->fn;
+    int temps = fn->temp_count;
+    int copies = 0;
+    c->partner_start = calloc(temps + 2, sizeof(int));
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        int y = copy_source(&fn->instrs[i]);
+        int x = fn->instrs[i].dst.value;
+        if (y < 0 || x == y) continue;
+        c->partner_start[x + 1]++;
+        c->partner_start[y + 1]++;
+        copies++;
+    }
+    for (int t = 0; t < temps; t++)
+        c->partner_start[t + 1] += c->partner_start[t];
+
+    c->partners = malloc((c->partner_start[temps] + 1) * sizeof(int));
+    c->interferes = calloc(c->partner_start[temps] + 1, 1);
+    int *fill = malloc((temps + 1) * sizeof(int));
+    memcpy(fill, c->partner_start, (temps + 1) * sizeof(int));
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        int y = copy_source(&fn->instrs[i]);
+        int x = fn->instrs[i].dst.value;
+        if (y < 0 || x == y) continue;
+        c->partners[fill[x]++] = y;
+        c->partners[fill[y]++] = x;
+    }
+    free(fill);
+    return copies;
+}
+
+/**
+ * @brief Marks a pair as interfering in both partner lists.
+ * @param c The pass state.
+ * @param x One temporary.
+ * @param y The other.
+ */
+static void mark_interference(Coalesce *c, int x, int y)
+{
+    int k = find_partner(c, x, y);
+    if (k >= 0) c->interferes[k] = 1;
+    k = find_partner(c, y, x);
+    if (k >= 0) c->interferes[k] = 1;
+}
+
+/**
+ * @brief Finds which copy-related pairs have overlapping live ranges.
+ * @param c The pass state.
+ * @param cfg The function's CFG with liveness computed.
+ */
+static void compute_interference(Coalesce *c, const Cfg *cfg)
+{
+    IrFunction *fn = c->fn;
+    size_t words = cfg->live_words;
+    BitWord *live = malloc(words * sizeof(BitWord));
+
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        bitset_copy(live, cfg->live_out + b * words, words);
+        for (int i = block->end - 1; i >= block->start; i--)
+        {
+            IrInstr *instr = &fn->instrs[i];
+            if (instr->dst.kind == IR_VAL_TEMP)
+            {
+                int x = instr->dst.value;
+                int source = copy_source(instr);
+                for (int k = c->partner_start[x]; k < c->partner_start[x + 1]; k++)
+                {
+                    int y = c->partners[k];
+                    if (y != source && bitset_test(live, y))
+                        mark_interference(c, x, y);
+                }
+                bitset_clear(live, x);
+            }
+            int uses = ir_use_count(instr);
+            for (int j = 0; j < uses; j++)
+            {
+                IrValue *use = ir_use(fn, instr, j);
+                if (use->kind == IR_VAL_TEMP)
+                    bitset_set(live, use->value);
+            }
+        }
+    }
+
+    // Parameters are all defined on entry, so each one interferes with the
+    // other parameters and with anything else live into the function.
+    const BitWord *entry_in = cfg->live_in;
+    for (int x = 0; x < fn->param_count; x++)
+    {
+        for (int k = c->partner_start[x]; k < c->partner_start[x + 1]; k++)
+        {
+            int y = c->partners[k];
+            if (y < fn->param_count || bitset_test(entry_in, y))
+                mark_interference(c, x, y);
+        }
+    }
+    free(live);
+}
+
+/**
+ * @brief Runs one round of coalescing.
+ * @param ctx The function to rewrite and its analyses.
+ * @return The number of copies removed.
+ */
+static int coalesce_once(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    Coalesce c;
+    memset(&c, 0, sizeof(Coalesce));
+    c.fn = fn;
+    if (collect_partners(&c) == 0)
+    {
+        free(c.interferes);
+        free(c.partners);
+        free(c.partner_start);
+        return 0;
+    }
+
+    compute_interference(&c, pass_liveness(ctx));
+
+    // Merge each non-interfering copy pair whose temporaries are untouched this
+    // round, keeping the lower number so parameters stay parameters.
+    int *rename = malloc((fn->temp_count + 1) * sizeof(int));
+    unsigned char *touched = calloc(fn->temp_count + 1, 1);
+    for (int t = 0; t < fn->temp_count; t++)
+        rename[t] = t;
+    int merged = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        int y = copy_source(&fn->instrs[i]);
+        int x = fn->instrs[i].dst.value;
+        if (y < 0 || x == y || touched[x] || touched[y]) continue;
+        if (c.interferes[find_partner(&c, x, y)]) continue;
+        int keep = x < y ? x : y;
+        int drop = x < y ? y : x;
+        rename[drop] = keep;
+        touched[x] = touched[y] = 1;
+        merged++;
+    }
+
+    int removed = 0;
+    if (merged > 0)
+    {
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            IrInstr *instr = &fn->instrs[i];
+            if (instr->dst.kind == IR_VAL_TEMP)
+                instr->dst.value = rename[instr->dst.value];
+            int uses = ir_use_count(instr);
+            for (int j = 0; j < uses; j++)
+            {
+                IrValue *use = ir_use(fn, instr, j);
+                if (use->kind == IR_VAL_TEMP)
+                    use->value = rename[use->value];
+            }
+            if (instr->op == IR_COPY && instr->a.kind == IR_VAL_TEMP && instr->a.value == instr->dst.value)
+            {
+                instr->op = IR_NOP;
+                removed++;
+            }
+        }
+        ir_compact(fn);
+        pass_invalidate(ctx);
+        ctx->stats->counts[STAT_COPIES_COALESCED] += removed;
+    }
+
+    free(touched);
+    free(rename);
+    free(c.interferes);
+    free(c.partners);
+    free(c.partner_start);
+    return removed;
+}
+
+/**
+ * @brief Gives copy-related temporaries one name where their live ranges allow.
+ *
+ * Runs on a function outside SSA form, after phis have become copies.
+ *
+ * @param ctx The function to rewrite and its analyses.
+ * @return 1 if the function changed.
+ */
+int coalesce_run(PassContext *ctx)
+{
+    if (ctx->fn->instr_count == 0) return 0;
+    int changed = 0;
+    while (coalesce_once(ctx) > 0)
+        changed = 1;
+    return changed;
+}
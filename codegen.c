@@ -0,0 +1,1202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm.h"
+
+// --- Code Generation ---
+// Lowers plain (non-SSA) IR to x86-64 in three stages, in the style of the
+// rest of the compiler's passes over instruction arrays:
+//   1. codegen_program selects instructions by tiling expression trees with
+//      a cost table, leaving every IR temporary as a pseudo register operand.
+//   2. Above -O0 a register allocator maps pseudo registers to machine
+//      registers. At every level stack_share_slots then merges spilled
+//      ones whose live ranges are disjoint, and codegen_assign_stack gives
+//      each remaining one a 4-byte stack slot.
+//   3. codegen_fixup rewrites instructions with operand combinations that
+//      x86-64 cannot encode, such as two memory operands, going through the
+//      scratch registers %r10d and %r11d.
+// Calls follow the System V ABI: the first six arguments in registers, the
+// rest pushed right to left, and %rsp 16-byte aligned at the call. A call
+// whose result is returned straight away and whose arguments all fit in
+// registers becomes a tail call: the epilogue runs first and a jmp replaces
+// call and ret, so the callee returns directly to this function's caller.
+
+static const AsmReg arg_regs[6] = {REG_DI, REG_SI, REG_DX, REG_CX, REG_R8, REG_R9};
+
+// --- Instruction Arrays ---
+
+/**
+ * @brief Appends an instruction to an assembly function.
+ * @param fn The function.
+ * @param op The opcode.
+ * @param src The source operand, or asm_none().
+ * @param dst The destination operand, or asm_none().
+ * @return A pointer to the new instruction, valid until the next append.
+ */
+AsmInstr *asm_emit(AsmFunction *fn, AsmOpcode op, AsmOperand src, AsmOperand dst)
+{
+    if (fn->instr_count == fn->instr_capacity)
+    {
+        fn->instr_capacity = fn->instr_capacity ? fn->instr_capacity * 2 : 32;
+        fn->instrs = realloc(fn->instrs, fn->instr_capacity * sizeof(AsmInstr));
+    }
+    AsmInstr *instr = &fn->instrs[fn->instr_count++];
+    memset(instr, 0, sizeof(AsmInstr));
+    instr->op = op;
+    instr->src = src;
+    instr->dst = dst;
+    return instr;
+}
+
+/**
+ * @brief Frees an assembly program and every function in it.
+ * @param program The program, or NULL.
+ */
+void asm_program_free(AsmProgram *program)
+{
+    if (!program) return;
+    for (int i = 0; i < program->function_count; i++)
+    {
+        free(program->functions[i].name);
+        free(program->functions[i].instrs);
+    }
+    free(program->functions);
+    free(program->profile);
+    free(program);
+}
+
+/**
+ * @brief Checks whether two operands name the same location or value.
+ * @param x The first operand.
+ * @param y The second operand.
+ * @return 1 if they are identical.
+ */
+int asm_same_operand(AsmOperand x, AsmOperand y)
+{
+    if (x.kind != y.kind) return 0;
+    return x.kind == ASM_OPERAND_REG ? x.reg == y.reg : x.value == y.value;
+}
+
+/**
+ * @brief Checks whether the System V ABI requires a function to preserve a register.
+ * @param reg The register.
+ * @return 1 for %rbx, %rbp, %rsp and %r12 to %r15.
+ */
+int asm_is_callee_saved(AsmReg reg)
+{
+    return reg == REG_BX || reg == REG_BP || reg == REG_SP || (reg >= REG_R12 && reg <= REG_R15);
+}
+
+// --- Instruction Selection ---
+
+/**
+ * @brief Converts an IR operand to an assembly operand.
+ * @param value The IR operand; a constant or a temporary.
+ * @return An immediate or a pseudo register.
+ */
+static AsmOperand operand(IrValue value)
+{
+    if (value.kind == IR_VAL_CONST)
+        return asm_imm(value.value);
+    return asm_pseudo(value.value);
+}
+
+/**
+ * @brief Maps an IR comparison to the condition code that tests it after cmp.
+ * @param op The comparison opcode.
+ * @return The condition code.
+ */
+static AsmCond condition(IrOpcode op)
+{
+    switch (op)
+    {
+        case IR_EQ: return COND_E;
+        case IR_NE: return COND_NE;
+        case IR_LT: return COND_L;
+        case IR_LE: return COND_LE;
+        case IR_GT: return COND_G;
+        default: return COND_GE;
+    }
+}
+
+/**
+ * @brief Emits a call, passing arguments by the System V convention.
+ * @param fn The assembly function being built.
+ * @param ir The IR function containing the call.
+ * @param instr The call instruction.
+ */
+static void select_call(AsmFunction *fn, const IrFunction *ir, const IrInstr *instr)
+{
+    const IrValue *args = ir->args + instr->arg_start;
+    int stack_args = instr->arg_count > 6 ? instr->arg_count - 6 : 0;
+
+    // Pad so that %rsp is 16-byte aligned once the stack arguments are pushed.
+    int padding = stack_args % 2 ? 8 : 0;
+    if (padding)
+        asm_emit(fn, ASM_ALLOC_STACK, asm_none(), asm_none())->amount = padding;
+
+    for (int i = 0; i < instr->arg_count && i < 6; i++)
+        asm_emit(fn, ASM_MOV, operand(args[i]), asm_reg(arg_regs[i]));
+    for (int i = instr->arg_count - 1; i >= 6; i--)
+    {
+        AsmOperand arg = operand(args[i]);
+        if (arg.kind == ASM_OPERAND_IMM)
+            asm_emit(fn, ASM_PUSH, arg, asm_none());
+        else
+        {
+            // pushq reads 8 bytes, so go through a register.
+            asm_emit(fn, ASM_MOV, arg, asm_reg(REG_AX));
+            asm_emit(fn, ASM_PUSH, asm_reg(REG_AX), asm_none());
+        }
+    }
+
+    AsmInstr *call = asm_emit(fn, ASM_CALL, asm_none(), asm_none());
+    call->callee = instr->callee;
+    call->reg_args = instr->arg_count < 6 ? instr->arg_count : 6;
+    if (stack_args * 8 + padding > 0)
+        asm_emit(fn, ASM_DEALLOC_STACK, asm_none(), asm_none())->amount = stack_args * 8 + padding;
+    if (instr->dst.kind == IR_VAL_TEMP)
+        asm_emit(fn, ASM_MOV, asm_reg(REG_AX), operand(instr->dst));
+}
+
+/**
+ * @brief Checks whether a call's result is returned at once, with every argument passed in a register.
+ *
+ * Stack arguments would have to be stored where this function's own return
+ * address and incoming arguments are, so calls with more than six stay calls.
+ *
+ * @param ir The IR function.
+ * @param i The call instruction.
+ * @return The index of the return, or -1 if the call is not a tail call.
+ */
+static int tail_call_return(const IrFunction *ir, int i)
+{
+    if (ir->instrs[i].arg_count > 6)
+        return -1;
+    return ir_tail_return(ir, i);
+}
+
+/**
+ * @brief Emits a call in tail position as a jump to the callee once this function's frame is gone.
+ * @param fn The assembly function being built.
+ * @param ir The IR function containing the call.
+ * @param instr The call instruction, with at most six arguments.
+ */
+static void select_tail_call(AsmFunction *fn, const IrFunction *ir, const IrInstr *instr)
+{
+    const IrValue *args = ir->args + instr->arg_start;
+    for (int i = 0; i < instr->arg_count; i++)
+        asm_emit(fn, ASM_MOV, operand(args[i]), asm_reg(arg_regs[i]));
+    AsmInstr *jump = asm_emit(fn, ASM_TAIL_CALL, asm_none(), asm_none());
+    jump->callee = instr->callee;
+    jump->reg_args = instr->arg_count;
+}
+
+/**
+ * @brief Lowers one IR instruction.
+ * @param fn The assembly function being built.
+ * @param ir The IR function.
+ * @param instr The instruction.
+ */
+static void select_instr(AsmFunction *fn, const IrFunction *ir, const IrInstr *instr)
+{
+    AsmOperand dst = operand(instr->dst);
+    AsmOperand a = operand(instr->a);
+    AsmOperand b = operand(instr->b);
+
+    switch (instr->op)
+    {
+        case IR_NOP:
+            break;
+        case IR_RETURN:
+            asm_emit(fn, ASM_MOV, instr->a.kind == IR_VAL_NONE ? asm_imm(0) : a, asm_reg(REG_AX));
+            asm_emit(fn, ASM_RET, asm_none(), asm_none());
+            break;
+        case IR_COPY:
+            asm_emit(fn, ASM_MOV, a, dst);
+            break;
+        case IR_NEGATE:
+        case IR_COMPLEMENT:
+            asm_emit(fn, ASM_MOV, a, dst);
+            asm_emit(fn, instr->op == IR_NEGATE ? ASM_NEG : ASM_NOT, asm_none(), dst);
+            break;
+        case IR_NOT:
+            asm_emit(fn, ASM_CMP, asm_imm(0), a);
+            asm_emit(fn, ASM_MOV, asm_imm(0), dst);
+            asm_emit(fn, ASM_SETCC, asm_none(), dst)->cond = COND_E;
+            break;
+        case IR_SAR:
+        case IR_SHR:
+            // A variable shift count must be in %cl; the hardware masks it
+            // to five bits like the IR does, but an immediate must fit a byte.
+            if (b.kind == ASM_OPERAND_IMM)
+                b = asm_imm(b.value & 31);
+            else
+            {
+                asm_emit(fn, ASM_MOV, b, asm_reg(REG_CX));
+                b = asm_reg(REG_CX);
+            }
+            asm_emit(fn, ASM_MOV, a, dst);
+            asm_emit(fn, instr->op == IR_SAR ? ASM_SAR : ASM_SHR, b, dst);
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        {
+            static const AsmOpcode binary[] = {
+                [IR_ADD] = ASM_ADD, [IR_SUB] = ASM_SUB, [IR_MUL] = ASM_IMUL,
+            };
+            if (!asm_same_operand(b, dst) || asm_same_operand(a, dst))
+            {
+                asm_emit(fn, ASM_MOV, a, dst);
+                asm_emit(fn, binary[instr->op], b, dst);
+            }
+            else if (instr->op == IR_ADD || instr->op == IR_MUL)
+                asm_emit(fn, binary[instr->op], a, dst);
+            else
+            {
+                // dst = a - dst: copying a into dst first would lose b.
+                asm_emit(fn, ASM_MOV, a, asm_reg(REG_R11));
+                asm_emit(fn, binary[instr->op], b, asm_reg(REG_R11));
+                asm_emit(fn, ASM_MOV, asm_reg(REG_R11), dst);
+            }
+            break;
+        }
+        case IR_DIV:
+        case IR_REM:
+            asm_emit(fn, ASM_MOV, a, asm_reg(REG_AX));
+            asm_emit(fn, ASM_CDQ, asm_none(), asm_none());
+            asm_emit(fn, ASM_IDIV, b, asm_none());
+            asm_emit(fn, ASM_MOV, asm_reg(instr->op == IR_DIV ? REG_AX : REG_DX), dst);
+            break;
+        case IR_MUL_HIGH:
+            asm_emit(fn, ASM_MOV, a, asm_reg(REG_AX));
+            asm_emit(fn, ASM_IMUL_WIDE, b, asm_none());
+            asm_emit(fn, ASM_MOV, asm_reg(REG_DX), dst);
+            break;
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+        case IR_GT:
+        case IR_GE:
+            asm_emit(fn, ASM_CMP, b, a);
+            asm_emit(fn, ASM_MOV, asm_imm(0), dst);
+            asm_emit(fn, ASM_SETCC, asm_none(), dst)->cond = condition(instr->op);
+            break;
+        case IR_JUMP:
+            asm_emit(fn, ASM_JMP, asm_none(), asm_none())->label = instr->label;
+            break;
+        case IR_JUMP_IF_ZERO:
+        case IR_JUMP_IF_NOT_ZERO:
+        {
+            asm_emit(fn, ASM_CMP, asm_imm(0), a);
+            AsmInstr *jump = asm_emit(fn, ASM_JCC, asm_none(), asm_none());
+            jump->cond = instr->op == IR_JUMP_IF_ZERO ? COND_E : COND_NE;
+            jump->label = instr->label;
+            jump->branch = instr->branch;
+            break;
+        }
+        case IR_LABEL:
+            asm_emit(fn, ASM_LABEL, asm_none(), asm_none())->label = instr->label;
+            break;
+        case IR_CALL:
+            select_call(fn, ir, instr);
+            break;
+        default:
+            fprintf(stderr, "Error: cannot generate code for IR opcode '%s' in '%s'.\n",
+                    ir_opcode_name(instr->op), ir->name);
+            break;
+    }
+}
+
+// --- Tree Tiling ---
+// A temporary with one definition and one use in the same block, whose
+// operands are not redefined in between, is folded into its user, so each
+// root instruction heads an expression tree. Trees are labelled bottom-up
+// with the cheapest way to produce each nonterminal (in the style of BURS
+// and iburg) and then reduced top-down:
+//   VAL    any operand: a constant, a temporary, or a computed node
+//   REG    a value in a temporary
+//   INDEX  reg * scale, with scale 1, 2, 4 or 8
+//   ADDR   disp + reg + reg * scale, the operand of lea
+// Besides the table below, every node can be computed by select_instr
+// ("native"), and chain rules convert REG to INDEX (scale 1), INDEX to ADDR
+// (no base) and ADDR to REG (one lea). Costs count instructions.
+//
+// Comparisons and logical nots folded into a conditional jump are not
+// computed at all: the jump tests the flags of the comparison directly.
+
+#define TILE_INF 1000000
+#define TILE_WINDOW 32      // Longest distance between a definition and the use it folds into
+
+//--- Nonterminals ---
+typedef enum
+{
+    NT_VAL,
+    NT_REG,
+    NT_INDEX,
+    NT_ADDR,
+    NT_COUNT
+} Nonterm;
+
+//--- Child Patterns ---
+typedef enum
+{
+    KID_REG,
+    KID_INDEX,
+    KID_ADDR,
+    KID_CONST,          // Any constant
+    KID_SCALE,          // Constant 1, 2, 4 or 8
+    KID_SCALE_PLUS_1    // Constant 3, 5 or 9
+} KidPattern;
+
+//--- Tiling Rule ---
+typedef struct
+{
+    Nonterm lhs;
+    IrOpcode op;
+    KidPattern kids[2];
+    int cost;
+} TileRule;
+
+static const TileRule tile_rules[] = {
+    {NT_INDEX, IR_MUL, {KID_REG, KID_SCALE}, 0},            // b * s
+    {NT_INDEX, IR_MUL, {KID_SCALE, KID_REG}, 0},
+    {NT_ADDR, IR_ADD, {KID_REG, KID_INDEX}, 0},             // a + b * s
+    {NT_ADDR, IR_ADD, {KID_INDEX, KID_REG}, 0},
+    {NT_ADDR, IR_ADD, {KID_ADDR, KID_CONST}, 0},            // address + c
+    {NT_ADDR, IR_ADD, {KID_CONST, KID_ADDR}, 0},
+    {NT_ADDR, IR_SUB, {KID_ADDR, KID_CONST}, 0},            // address - c
+    {NT_ADDR, IR_MUL, {KID_REG, KID_SCALE_PLUS_1}, 0},      // b + b * (s - 1)
+    {NT_ADDR, IR_MUL, {KID_SCALE_PLUS_1, KID_REG}, 0},
+};
+
+#define TILE_RULE_COUNT ((int)(sizeof(tile_rules) / sizeof(tile_rules[0])))
+
+// Rule numbers past the table.
+enum
+{
+    RULE_NONE = -1,
+    RULE_NATIVE = TILE_RULE_COUNT,  // select_instr
+    RULE_CHAIN                      // REG -> INDEX -> ADDR -> REG
+};
+
+//--- Node Label ---
+typedef struct
+{
+    int cost[NT_COUNT];
+    int rule[NT_COUNT];
+} TileLabel;
+
+//--- Tiling State ---
+typedef struct
+{
+    AsmFunction *fn;
+    const IrFunction *ir;
+    int *kid;           // Two entries per instruction: the folded instruction defining a or b, or -1
+    char *folded;       // Instruction -> 1 if its user emits it
+    TileLabel *labels;  // Per instruction, for ADD, SUB and MUL
+    OptStats *stats;
+} Tiler;
+
+//--- Address Parts ---
+typedef struct
+{
+    AsmOperand base;
+    AsmOperand index;
+    int32_t scale;
+    uint32_t disp;      // Wraps like the 32-bit arithmetic it replaces
+} TileAddress;
+
+/**
+ * @brief Estimates the instructions select_instr emits for an IR instruction.
+ * @param instr The instruction.
+ * @return The cost.
+ */
+static int native_cost(const IrInstr *instr)
+{
+    int in_place = instr->a.kind == IR_VAL_TEMP && instr->a.kind == instr->dst.kind && instr->a.value == instr->dst.value;
+    switch (instr->op)
+    {
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+            return in_place ? 1 : 2;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Checks whether a temporary is written by any instruction in a range.
+ * @param ir The function.
+ * @param temp The temporary.
+ * @param from The first instruction to check.
+ * @param to One past the last.
+ * @return 1 if some instruction defines it.
+ */
+static int redefined_between(const IrFunction *ir, int temp, int from, int to)
+{
+    for (int i = from; i < to; i++)
+    {
+        const IrValue *dst = &ir->instrs[i].dst;
+        if (dst->kind == IR_VAL_TEMP && dst->value == temp)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks that no leaf of an expression tree is overwritten before the tree is emitted.
+ * @param t The tiling state.
+ * @param node The tree's root instruction.
+ * @param from The first instruction to check.
+ * @param to The instruction the tree will be emitted at.
+ * @return 1 if every temporary the tree reads still holds its value there.
+ */
+static int leaves_stable(const Tiler *t, int node, int from, int to)
+{
+    const IrInstr *instr = &t->ir->instrs[node];
+    const IrValue *ops[2] = {&instr->a, &instr->b};
+    for (int k = 0; k < 2; k++)
+    {
+        int kid = t->kid[2 * node + k];
+        if (kid >= 0)
+        {
+            if (!leaves_stable(t, kid, from, to))
+                return 0;
+        }
+        else if (ops[k]->kind == IR_VAL_TEMP && redefined_between(t->ir, ops[k]->value, from, to))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Decides which instructions fold into their single user.
+ * @param t The tiling state.
+ */
+static void find_trees(Tiler *t)
+{
+    const IrFunction *ir = t->ir;
+    int n = ir->instr_count;
+    int *def_count = calloc(ir->temp_count + 1, sizeof(int));
+    int *use_count = calloc(ir->temp_count + 1, sizeof(int));
+    int *def_at = malloc((ir->temp_count + 1) * sizeof(int));
+    int *block = malloc((n + 1) * sizeof(int));
+    int current = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const IrInstr *instr = &ir->instrs[i];
+        if (instr->op == IR_LABEL) current++;
+        block[i] = current;
+        if (instr->op == IR_JUMP || instr->op == IR_JUMP_IF_ZERO || instr->op == IR_JUMP_IF_NOT_ZERO || instr->op == IR_RETURN)
+            current++;
+        if (instr->dst.kind == IR_VAL_TEMP)
+        {
+            def_count[instr->dst.value]++;
+            def_at[instr->dst.value] = i;
+        }
+        if (instr->a.kind == IR_VAL_TEMP) use_count[instr->a.value]++;
+        if (instr->b.kind == IR_VAL_TEMP) use_count[instr->b.value]++;
+        if (instr->op == IR_CALL)
+        {
+            for (int j = 0; j < instr->arg_count; j++)
+            {
+                if (ir->args[instr->arg_start + j].kind == IR_VAL_TEMP)
+                    use_count[ir->args[instr->arg_start + j].value]++;
+            }
+        }
+    }
+
+    for (int u = 0; u < n; u++)
+    {
+        const IrInstr *user = &ir->instrs[u];
+        t->kid[2 * u] = t->kid[2 * u + 1] = -1;
+        int arithmetic = user->op == IR_ADD || user->op == IR_SUB || user->op == IR_MUL;
+        int branch = user->op == IR_JUMP_IF_ZERO || user->op == IR_JUMP_IF_NOT_ZERO;
+        if (!arithmetic && !branch) continue;
+
+        const IrValue *ops[2] = {&user->a, &user->b};
+        for (int k = 0; k < (branch ? 1 : 2); k++)
+        {
+            if (ops[k]->kind != IR_VAL_TEMP) continue;
+            int temp = ops[k]->value;
+            if (temp < ir->param_count || def_count[temp] != 1 || use_count[temp] != 1) continue;
+            int d = def_at[temp];
+            if (d >= u || u - d > TILE_WINDOW || block[d] != block[u] || t->folded[d]) continue;
+            IrOpcode op = ir->instrs[d].op;
+            int fits = arithmetic ? op == IR_ADD || op == IR_SUB || op == IR_MUL
+                                  : op == IR_NOT || (op >= IR_EQ && op <= IR_GE);
+            if (!fits || !leaves_stable(t, d, d + 1, u)) continue;
+            t->kid[2 * u + k] = d;
+            t->folded[d] = 1;
+        }
+    }
+
+    free(def_count);
+    free(use_count);
+    free(def_at);
+    free(block);
+}
+
+/**
+ * @brief Returns the cost of producing a nonterminal from one operand of a node.
+ * @param t The tiling state.
+ * @param node The instruction.
+ * @param k The operand: 0 for a, 1 for b.
+ * @param pattern The pattern the operand must match.
+ * @return The cost, or TILE_INF if it cannot match.
+ */
+static int kid_cost(const Tiler *t, int node, int k, KidPattern pattern)
+{
+    int kid = t->kid[2 * node + k];
+    const IrInstr *instr = &t->ir->instrs[node];
+    IrValue value = k == 0 ? instr->a : instr->b;
+    if (kid >= 0)
+    {
+        switch (pattern)
+        {
+            case KID_REG: return t->labels[kid].cost[NT_REG];
+            case KID_INDEX: return t->labels[kid].cost[NT_INDEX];
+            case KID_ADDR: return t->labels[kid].cost[NT_ADDR];
+            default: return TILE_INF;
+        }
+    }
+    switch (pattern)
+    {
+        case KID_REG:
+        case KID_INDEX:
+        case KID_ADDR:
+            return value.kind == IR_VAL_TEMP ? 0 : TILE_INF;
+        case KID_CONST:
+            return value.kind == IR_VAL_CONST ? 0 : TILE_INF;
+        case KID_SCALE:
+            return value.kind == IR_VAL_CONST && (value.value == 1 || value.value == 2 || value.value == 4 || value.value == 8) ? 0 : TILE_INF;
+        case KID_SCALE_PLUS_1:
+            return value.kind == IR_VAL_CONST && (value.value == 3 || value.value == 5 || value.value == 9) ? 0 : TILE_INF;
+    }
+    return TILE_INF;
+}
+
+/**
+ * @brief Returns the cost of an operand as a plain value.
+ * @param t The tiling state.
+ * @param node The instruction.
+ * @param k The operand.
+ * @return Zero for a leaf, or the folded node's REG cost.
+ */
+static int val_cost(const Tiler *t, int node, int k)
+{
+    int kid = t->kid[2 * node + k];
+    return kid >= 0 ? t->labels[kid].cost[NT_REG] : 0;
+}
+
+/**
+ * @brief Updates a label if a rule produces a nonterminal more cheaply.
+ * @param label The label.
+ * @param nt The nonterminal.
+ * @param cost The rule's total cost.
+ * @param rule The rule number.
+ */
+static void label_offer(TileLabel *label, Nonterm nt, int cost, int rule)
+{
+    if (cost < label->cost[nt])
+    {
+        label->cost[nt] = cost;
+        label->rule[nt] = rule;
+    }
+}
+
+/**
+ * @brief Labels an arithmetic instruction with the cheapest rule for each nonterminal.
+ * @param t The tiling state; the node's folded operands are already labelled.
+ * @param node The instruction.
+ */
+static void label_node(Tiler *t, int node)
+{
+    const IrInstr *instr = &t->ir->instrs[node];
+    TileLabel *label = &t->labels[node];
+    for (int nt = 0; nt < NT_COUNT; nt++)
+    {
+        label->cost[nt] = TILE_INF;
+        label->rule[nt] = RULE_NONE;
+    }
+
+    label_offer(label, NT_REG, native_cost(instr) + val_cost(t, node, 0) + val_cost(t, node, 1), RULE_NATIVE);
+    for (int r = 0; r < TILE_RULE_COUNT; r++)
+    {
+        const TileRule *rule = &tile_rules[r];
+        if (rule->op != instr->op) continue;
+        int cost = rule->cost + kid_cost(t, node, 0, rule->kids[0]);
+        if (cost >= TILE_INF) continue;
+        cost += kid_cost(t, node, 1, rule->kids[1]);
+        if (cost < TILE_INF)
+            label_offer(label, rule->lhs, cost, r);
+    }
+
+    // Chain rules, twice so that a cheaper REG can still reach INDEX and ADDR.
+    for (int round = 0; round < 2; round++)
+    {
+        label_offer(label, NT_INDEX, label->cost[NT_REG], RULE_CHAIN);
+        label_offer(label, NT_ADDR, label->cost[NT_INDEX], RULE_CHAIN);
+        label_offer(label, NT_REG, label->cost[NT_ADDR] + 1, RULE_CHAIN);
+    }
+    label->cost[NT_VAL] = label->cost[NT_REG];
+    label->rule[NT_VAL] = RULE_CHAIN;
+}
+
+static AsmOperand reduce_reg(Tiler *t, int node, IrValue value);
+
+/**
+ * @brief Emits an operand of a node and returns where its value is.
+ * @param t The tiling state.
+ * @param node The instruction.
+ * @param k The operand.
+ * @return The operand.
+ */
+static AsmOperand reduce_kid(Tiler *t, int node, int k)
+{
+    const IrInstr *instr = &t->ir->instrs[node];
+    return reduce_reg(t, t->kid[2 * node + k], k == 0 ? instr->a : instr->b);
+}
+
+/**
+ * @brief Emits a tree as reg * scale.
+ * @param t The tiling state.
+ * @param node The instruction, or -1 for a leaf.
+ * @param value The value the tree computes.
+ * @param index Receives the register.
+ * @param scale Receives the scale.
+ */
+static void reduce_index(Tiler *t, int node, IrValue value, AsmOperand *index, int32_t *scale)
+{
+    if (node < 0 || t->labels[node].rule[NT_INDEX] == RULE_CHAIN)
+    {
+        *index = reduce_reg(t, node, value);
+        *scale = 1;
+        return;
+    }
+    // b * s, with the scale on either side.
+    const IrInstr *instr = &t->ir->instrs[node];
+    int k = instr->a.kind == IR_VAL_CONST ? 1 : 0;
+    *index = reduce_kid(t, node, k);
+    *scale = (k == 0 ? instr->b : instr->a).value;
+}
+
+/**
+ * @brief Emits a tree as an address.
+ * @param t The tiling state.
+ * @param node The instruction, or -1 for a leaf.
+ * @param value The value the tree computes.
+ * @param address Receives the address.
+ */
+static void reduce_addr(Tiler *t, int node, IrValue value, TileAddress *address)
+{
+    int rule = node < 0 ? RULE_CHAIN : t->labels[node].rule[NT_ADDR];
+    if (rule == RULE_CHAIN)
+    {
+        address->base = asm_none();
+        address->disp = 0;
+        reduce_index(t, node, value, &address->index, &address->scale);
+        return;
+    }
+
+    const IrInstr *instr = &t->ir->instrs[node];
+    const TileRule *r = &tile_rules[rule];
+    int first = r->kids[0] == KID_CONST || r->kids[0] == KID_SCALE_PLUS_1 ? 1 : 0;
+    IrValue constant = first ? instr->a : instr->b;
+    switch (r->kids[first])
+    {
+        case KID_REG:
+            if (r->kids[1 - first] == KID_INDEX)
+            {
+                address->base = reduce_kid(t, node, first);
+                reduce_index(t, t->kid[2 * node + 1 - first], first ? instr->a : instr->b, &address->index, &address->scale);
+            }
+            else
+            {
+                address->base = reduce_kid(t, node, first);
+                address->index = address->base;
+                address->scale = constant.value - 1;
+            }
+            address->disp = 0;
+            break;
+        case KID_INDEX:
+            // a * s + b: the second operand is the base.
+            reduce_index(t, t->kid[2 * node], instr->a, &address->index, &address->scale);
+            address->base = reduce_kid(t, node, 1);
+            address->disp = 0;
+            break;
+        default:
+            reduce_addr(t, t->kid[2 * node + first], first ? instr->b : instr->a, address);
+            if (instr->op == IR_SUB)
+                address->disp -= (uint32_t)constant.value;
+            else
+                address->disp += (uint32_t)constant.value;
+            break;
+    }
+}
+
+/**
+ * @brief Emits a tree so that its value ends up in an operand.
+ * @param t The tiling state.
+ * @param node The instruction, or -1 for a leaf.
+ * @param value The value the tree computes; for a node, its destination.
+ * @return The operand holding the value.
+ */
+static AsmOperand reduce_reg(Tiler *t, int node, IrValue value)
+{
+    if (node < 0)
+        return operand(value);
+
+    const IrInstr *instr = &t->ir->instrs[node];
+    if (t->labels[node].rule[NT_REG] == RULE_NATIVE)
+    {
+        for (int k = 0; k < 2; k++)
+        {
+            if (t->kid[2 * node + k] >= 0)
+                reduce_kid(t, node, k);
+        }
+        select_instr(t->fn, t->ir, instr);
+        return operand(instr->dst);
+    }
+
+    TileAddress address;
+    reduce_addr(t, node, instr->dst, &address);
+    // Without a base the encoding needs a 32-bit displacement, so prefer b + b * 1 to b * 2.
+    if (address.base.kind == ASM_OPERAND_NONE && (address.scale == 1 || address.scale == 2))
+    {
+        address.base = address.index;
+        address.scale--;
+        if (address.scale == 0)
+            address.index = asm_none();
+    }
+    if (address.index.kind == ASM_OPERAND_NONE && address.disp == 0)
+    {
+        asm_emit(t->fn, ASM_MOV, address.base, operand(instr->dst));
+        return operand(instr->dst);
+    }
+    AsmInstr *lea = asm_emit(t->fn, ASM_LEA, address.base, operand(instr->dst));
+    lea->index = address.index;
+    lea->scale = address.scale;
+    lea->disp = (int32_t)address.disp;
+    t->stats->counts[STAT_SELECT_LEA]++;
+    return operand(instr->dst);
+}
+
+/**
+ * @brief Emits a conditional jump on a folded comparison or logical not, testing its flags directly.
+ * @param t The tiling state.
+ * @param node The jump instruction.
+ */
+static void reduce_branch(Tiler *t, int node)
+{
+    static const AsmCond inverse[] = {
+        [COND_E] = COND_NE, [COND_NE] = COND_E, [COND_L] = COND_GE,
+        [COND_LE] = COND_G, [COND_G] = COND_LE, [COND_GE] = COND_L,
+    };
+    const IrInstr *jump = &t->ir->instrs[node];
+    const IrInstr *test = &t->ir->instrs[t->kid[2 * node]];
+
+    // The jump is taken when the value is non-zero: cond for jnz, its inverse for jz.
+    AsmCond cond;
+    if (test->op == IR_NOT)
+    {
+        asm_emit(t->fn, ASM_CMP, asm_imm(0), operand(test->a));
+        cond = COND_E;
+    }
+    else
+    {
+        asm_emit(t->fn, ASM_CMP, operand(test->b), operand(test->a));
+        cond = condition(test->op);
+    }
+    AsmInstr *jcc = asm_emit(t->fn, ASM_JCC, asm_none(), asm_none());
+    jcc->cond = jump->op == IR_JUMP_IF_NOT_ZERO ? cond : inverse[cond];
+    jcc->label = jump->label;
+    jcc->branch = jump->branch;
+    t->stats->counts[STAT_SELECT_BRANCHES_FUSED]++;
+}
+
+/**
+ * @brief Lowers one function's body, starting with copying its parameters out of the ABI locations.
+ * @param fn The assembly function to fill.
+ * @param ir The IR function, outside SSA form.
+ * @param stats Receives tiling counts.
+ */
+static void select_function(AsmFunction *fn, const IrFunction *ir, OptStats *stats)
+{
+    for (int p = 0; p < ir->param_count; p++)
+    {
+        AsmOperand from = p < 6 ? asm_reg(arg_regs[p]) : asm_stack(16 + 8 * (p - 6));
+        asm_emit(fn, ASM_MOV, from, asm_pseudo(p));
+    }
+
+    Tiler t;
+    t.fn = fn;
+    t.ir = ir;
+    t.stats = stats;
+    t.kid = malloc((2 * ir->instr_count + 2) * sizeof(int));
+    t.folded = calloc(ir->instr_count + 1, 1);
+    t.labels = malloc((ir->instr_count + 1) * sizeof(TileLabel));
+    find_trees(&t);
+    for (int i = 0; i < ir->instr_count; i++)
+    {
+        IrOpcode op = ir->instrs[i].op;
+        if (op == IR_ADD || op == IR_SUB || op == IR_MUL)
+            label_node(&t, i);
+    }
+
+    for (int i = 0; i < ir->instr_count; i++)
+    {
+        const IrInstr *instr = &ir->instrs[i];
+        if (t.folded[i]) continue;
+        if ((instr->op == IR_JUMP_IF_ZERO || instr->op == IR_JUMP_IF_NOT_ZERO) && t.kid[2 * i] >= 0)
+            reduce_branch(&t, i);
+        else if (instr->op == IR_CALL && tail_call_return(ir, i) >= 0)
+        {
+            select_tail_call(fn, ir, instr);
+            stats->counts[STAT_SELECT_TAIL_CALLS]++;
+            i = tail_call_return(ir, i);
+        }
+        else if (instr->op == IR_ADD || instr->op == IR_SUB || instr->op == IR_MUL)
+            reduce_reg(&t, i, instr->dst);
+        else
+            select_instr(fn, ir, instr);
+    }
+    free(t.kid);
+    free(t.folded);
+    free(t.labels);
+
+    // Falling off the end of a function returns 0.
+    AsmOpcode last = fn->instr_count > 0 ? fn->instrs[fn->instr_count - 1].op : ASM_NOP;
+    if (last != ASM_RET && last != ASM_TAIL_CALL)
+    {
+        asm_emit(fn, ASM_MOV, asm_imm(0), asm_reg(REG_AX));
+        asm_emit(fn, ASM_RET, asm_none(), asm_none());
+    }
+    fn->pseudo_count = ir->temp_count;
+}
+
+/**
+ * @brief Selects x86-64 instructions for every function of a program.
+ * @param ir The program, outside SSA form.
+ * @param stats Receives tiling counts.
+ * @return The assembly program, with pseudo register operands; free with asm_program_free.
+ */
+AsmProgram *codegen_program(const IrProgram *ir, OptStats *stats)
+{
+    AsmProgram *program = calloc(1, sizeof(AsmProgram));
+    program->function_count = ir->function_count;
+    program->functions = calloc(ir->function_count + 1, sizeof(AsmFunction));
+    program->branch_count = ir->branch_count;
+    if (ir->profile)
+    {
+        size_t size = ((size_t)ir->function_count + 2 * (size_t)ir->branch_count) * sizeof(uint64_t);
+        program->profile = malloc(size + sizeof(uint64_t));
+        memcpy(program->profile, ir->profile, size);
+    }
+    for (int f = 0; f < ir->function_count; f++)
+    {
+        const IrFunction *source = &ir->functions[f];
+        AsmFunction *fn = &program->functions[f];
+        fn->name = strdup(source->name);
+        fn->defined = source->defined;
+        fn->entry_count = source->entry_count;
+        if (program->profile)
+            fn->branch_counts = program->profile + ir->function_count;
+        if (fn->defined)
+            select_function(fn, source, stats);
+    }
+    return program;
+}
+
+// --- Stack Slots ---
+
+/**
+ * @brief Counts the callee-saved registers a function pushes in its prologue.
+ * @param fn The function.
+ * @return The number of registers in fn->saved_regs.
+ */
+static int saved_count(const AsmFunction *fn)
+{
+    return __builtin_popcount(fn->saved_regs);
+}
+
+/**
+ * @brief Replaces a pseudo register operand by its stack slot, numbering slots on first use.
+ * @param fn The function.
+ * @param slot_of Pseudo register -> slot number, or -1 before its first use.
+ * @param slot_count The number of slots handed out so far.
+ * @param operand The operand to rewrite.
+ */
+static void assign_slot(const AsmFunction *fn, int *slot_of, int *slot_count, AsmOperand *operand)
+{
+    if (operand->kind != ASM_OPERAND_PSEUDO) return;
+    if (slot_of[operand->value] < 0)
+        slot_of[operand->value] = (*slot_count)++;
+    *operand = asm_stack(-8 * saved_count(fn) - 4 * (slot_of[operand->value] + 1));
+}
+
+/**
+ * @brief Gives every remaining pseudo register its own stack slot.
+ *
+ * Slots start below the callee-saved registers pushed by the prologue.
+ *
+ * @param program The program after instruction selection or register allocation.
+ */
+void codegen_assign_stack(AsmProgram *program)
+{
+    for (int f = 0; f < program->function_count; f++)
+    {
+        AsmFunction *fn = &program->functions[f];
+        if (!fn->defined) continue;
+        int *slot_of = malloc((fn->pseudo_count + 1) * sizeof(int));
+        for (int p = 0; p < fn->pseudo_count; p++)
+            slot_of[p] = -1;
+        int slot_count = 0;
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            assign_slot(fn, slot_of, &slot_count, &fn->instrs[i].src);
+            assign_slot(fn, slot_of, &slot_count, &fn->instrs[i].dst);
+            assign_slot(fn, slot_of, &slot_count, &fn->instrs[i].index);
+        }
+        fn->frame_size = 4 * slot_count;
+        free(slot_of);
+    }
+}
+
+// --- Operand Fix-Up ---
+
+/**
+ * @brief Copies an instruction into a rebuilt function.
+ * @param fn The function being rebuilt.
+ * @param instr The instruction; must not point into fn->instrs.
+ * @return The copy.
+ */
+static AsmInstr *append(AsmFunction *fn, const AsmInstr *instr)
+{
+    AsmInstr *copy = asm_emit(fn, instr->op, instr->src, instr->dst);
+    *copy = *instr;
+    return copy;
+}
+
+/**
+ * @brief Rewrites a lea whose address parts are not all registers.
+ *
+ * Rematerialization may have turned the base or index into a constant,
+ * which folds into the displacement; spilled parts are loaded into the
+ * scratch registers, and a memory destination is written through %r11d.
+ *
+ * @param fn The function being rebuilt.
+ * @param instr The lea.
+ */
+static void fixup_lea(AsmFunction *fn, const AsmInstr *instr)
+{
+    AsmInstr fixed = *instr;
+    uint32_t disp = (uint32_t)fixed.disp;
+    if (fixed.src.kind == ASM_OPERAND_IMM)
+    {
+        disp += (uint32_t)fixed.src.value;
+        fixed.src = asm_none();
+    }
+    if (fixed.index.kind == ASM_OPERAND_IMM)
+    {
+        disp += (uint32_t)fixed.index.value * (uint32_t)fixed.scale;
+        fixed.index = asm_none();
+    }
+    fixed.disp = (int32_t)disp;
+    if (fixed.src.kind == ASM_OPERAND_NONE && fixed.index.kind == ASM_OPERAND_NONE)
+    {
+        asm_emit(fn, ASM_MOV, asm_imm(fixed.disp), fixed.dst);
+        return;
+    }
+    if (asm_is_memory(fixed.src))
+    {
+        asm_emit(fn, ASM_MOV, fixed.src, asm_reg(REG_R10));
+        fixed.src = asm_reg(REG_R10);
+    }
+    if (asm_is_memory(fixed.index))
+    {
+        asm_emit(fn, ASM_MOV, fixed.index, asm_reg(REG_R11));
+        fixed.index = asm_reg(REG_R11);
+    }
+    if (asm_is_memory(fixed.dst))
+    {
+        fixed.dst = asm_reg(REG_R11);
+        append(fn, &fixed);
+        asm_emit(fn, ASM_MOV, asm_reg(REG_R11), instr->dst);
+    }
+    else
+        append(fn, &fixed);
+}
+
+/**
+ * @brief Rewrites one instruction into forms x86-64 can encode.
+ * @param fn The function being rebuilt.
+ * @param instr The instruction, with pseudo registers already replaced.
+ */
+static void fixup_instr(AsmFunction *fn, const AsmInstr *instr)
+{
+    AsmInstr fixed = *instr;
+    switch (instr->op)
+    {
+        case ASM_MOV:
+        case ASM_ADD:
+        case ASM_SUB:
+        case ASM_CMP:
+            // At most one memory operand.
+            if (asm_is_memory(fixed.src) && asm_is_memory(fixed.dst))
+            {
+                asm_emit(fn, ASM_MOV, fixed.src, asm_reg(REG_R10));
+                fixed.src = asm_reg(REG_R10);
+            }
+            // cmp cannot take an immediate as its second operand.
+            if (instr->op == ASM_CMP && fixed.dst.kind == ASM_OPERAND_IMM)
+            {
+                asm_emit(fn, ASM_MOV, fixed.dst, asm_reg(REG_R11));
+                fixed.dst = asm_reg(REG_R11);
+            }
+            append(fn, &fixed);
+            break;
+        case ASM_IMUL:
+            // imul cannot write to memory.
+            if (asm_is_memory(fixed.dst))
+            {
+                asm_emit(fn, ASM_MOV, fixed.dst, asm_reg(REG_R11));
+                fixed.dst = asm_reg(REG_R11);
+                append(fn, &fixed);
+                asm_emit(fn, ASM_MOV, asm_reg(REG_R11), instr->dst);
+            }
+            else
+                append(fn, &fixed);
+            break;
+        case ASM_LEA:
+            fixup_lea(fn, instr);
+            break;
+        case ASM_IDIV:
+        case ASM_IMUL_WIDE:
+            // The one-operand forms take no immediate.
+            if (fixed.src.kind == ASM_OPERAND_IMM)
+            {
+                asm_emit(fn, ASM_MOV, fixed.src, asm_reg(REG_R10));
+                fixed.src = asm_reg(REG_R10);
+            }
+            append(fn, &fixed);
+            break;
+        default:
+            append(fn, &fixed);
+            break;
+    }
+}
+
+/**
+ * @brief Checks whether a function calls anything.
+ * @param fn The function.
+ * @return 1 if it contains a call.
+ */
+static int makes_calls(const AsmFunction *fn)
+{
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (fn->instrs[i].op == ASM_CALL)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks whether a function addresses anything relative to %rbp.
+ *
+ * That covers its own stack slots and parameters passed on the stack.
+ *
+ * @param fn The function.
+ * @return 1 if any operand is a stack operand.
+ */
+static int uses_stack(const AsmFunction *fn)
+{
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        if (instr->src.kind == ASM_OPERAND_STACK || instr->dst.kind == ASM_OPERAND_STACK ||
+            instr->index.kind == ASM_OPERAND_STACK)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lays out each function's frame and makes every instruction encodable.
+ *
+ * Only functions with stack slots or stack parameters set up %rbp, since
+ * those are addressed from it. The frame is padded so that, with the return address, %rbp if
+ * any and the saved registers pushed above it, %rsp is 16-byte aligned at
+ * every call. A leaf function needs no alignment, so one without stack
+ * slots gets no frame at all, only pushes of the callee-saved registers it
+ * writes.
+ *
+ * @param program The program after stack assignment.
+ * @param stats Receives the frame sizes.
+ */
+void codegen_fixup(AsmProgram *program, OptStats *stats)
+{
+    for (int f = 0; f < program->function_count; f++)
+    {
+        AsmFunction *fn = &program->functions[f];
+        if (!fn->defined) continue;
+
+        int pushed = 8 * saved_count(fn);
+        fn->frame_pointer = fn->frame_size > 0 || uses_stack(fn);
+        if (fn->frame_pointer)
+            fn->frame_size = ((pushed + fn->frame_size + 15) & ~15) - pushed;
+        else if (makes_calls(fn))
+            fn->frame_size = (8 + pushed) % 16 ? 8 : 0;
+        else
+            fn->frame_size = 0;
+        stats->counts[STAT_FRAME_BYTES] += pushed + fn->frame_size + (fn->frame_pointer ? 8 : 0);
+
+        AsmInstr *old = fn->instrs;
+        int old_count = fn->instr_count;
+        fn->instrs = NULL;
+        fn->instr_count = 0;
+        fn->instr_capacity = 0;
+
+        if (fn->frame_size > 0)
+            asm_emit(fn, ASM_ALLOC_STACK, asm_none(), asm_none())->amount = fn->frame_size;
+        for (int i = 0; i < old_count; i++)
+        {
+            if (old[i].op != ASM_NOP)
+                fixup_instr(fn, &old[i]);
+        }
+        free(old);
+    }
+}
+
+/**
+ * @brief Runs the whole backend on optimized IR, leaving assembly ready to print.
+ *
+ * Register allocation and the peephole pass run above -O0. Stack slot
+ * sharing runs at every level: at -O0 every pseudo register is spilled, so
+ * that is where it saves the most.
+ *
+ * @param ir The program, out of SSA form.
+ * @param opt_level The optimization level, 0 to 2.
+ * @param stats Receives the backend's counts.
+ * @return The assembly program. Free it with asm_program_free.
+ */
+AsmProgram *codegen_compile(const IrProgram *ir, int opt_level, OptStats *stats)
+{
+    AsmProgram *program = codegen_program(ir, stats);
+    if (opt_level >= 2)
+        regalloc_graph_color(program, stats);
+    else if (opt_level == 1)
+        regalloc_linear_scan(program, stats);
+    stack_share_slots(program, stats);
+    codegen_assign_stack(program);
+    codegen_fixup(program, stats);
+    if (opt_level > 0)
+        peephole_program(program, stats);
+    return program;
+}
@@ -1,14 +1,42 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <libgen.h> 
 #include <sys/stat.h> 
+#include <unistd.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "ast_printer.h"
+#include "writer.h"
+#include "ir_gen.h"
+#include "interp.h"
+#include "optimizer.h"
+#include "asm.h"
+#include "profile.h"
 
 #define EXIT_SUCCESS 0 
 #define EXIT_FAILURE 1
 
 #define MAX_PATH 1024
 
+// --- Driver Options ---
+typedef struct
+{
+    const char *stage;      // --lex, --parse, --tacky, --interp, --codegen, or NULL for a full compile
+    int emit_assembly_only; // -S
+    AstFormat ast_format;   // --ast-format=sexpr|json, used by --parse
+    int opt_level;          // -O0, -O1, -O2
+    const char *print_after; // --print-after=<pass|all>
+    int jobs;               // --jobs=N, 0 for one thread per processor
+    int inline_budget;      // --inline-budget=N
+    int report_inlining;    // --report-inline
+    int print_stats;        // --stats
+    const char *profile_generate; // -fprofile-generate[=path]: file the instrumented program writes, or NULL
+    const char *profile_use;      // -fprofile-use[=path]: profile to optimize with, or NULL
+} DriverOptions;
+
 // --- Methods ---
 /**
  * @brief Checks if a file exists and is a regular file.
@@ -43,51 +71,195 @@ int delete_file(const char *filename)
 }
 
 /**
- * @brief A stub function for the actual compiler pass (Lexing, Parsing, Assembly Gen).
+ * @brief Prints a token list in the same layout the standalone lexer used.
+ * @param tokens The token list to print.
+ */
+void print_tokens(const TokenList *tokens)
+{
+    for (int i = 0; i < tokens->count; i++) 
+    {
+        const Token *token = &tokens->tokens[i];
+        printf("%s", token_to_debug_string(token->type));
+        if (token->type == TOKEN_IDENTIFIER || token->type == TOKEN_CONSTANT) 
+            printf(" (\"%s\")", token->lexeme);
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Runs the compiler pass (Lexing, Parsing, IR Gen, Assembly Gen).
  * @param input_file The preprocessed file (.i).
  * @param output_file The assembly file (.s).
- * @param option The special compiler option (--lex, --parse, --codegen, or NULL).
- * @return EXIT_SUCCESS or EXIT_FAILURE.
+ * @param options The driver options; options->stage selects --lex, --parse, --tacky, --interp, --codegen, or NULL.
+ * @return EXIT_SUCCESS or EXIT_FAILURE; for --interp, main's return value.
  */
-int run_compiler_pass(const char *input_file, const char *output_file, const char *option) 
+int run_compiler_pass(const char *input_file, const char *output_file, const DriverOptions *options) 
 {
-    if (option) 
+    const char *option = options->stage;
+
+    char *source_code = read_file(input_file);
+    if (!source_code) 
     {
-        // For now, we assume success for the stubbed out passes.
-        // The real compiler would return non-zero on error.
-        if (strcmp(option, "--lex") == 0) 
-        {
-        
-            fprintf(stderr, "Stub: Running lexer on %s.\n", input_file);
-        } else if (strcmp(option, "--parse") == 0) 
+        perror("Error reading preprocessed file");
+        return EXIT_FAILURE;
+    }
+
+    TokenList tokens;
+    int lex_errors = tokenize(source_code, &tokens);
+    free(source_code);
+
+    if (lex_errors > 0) 
+    {
+        fprintf(stderr, "Error: Lexing finished with %d errors.\n", lex_errors);
+        free_token_list(&tokens);
+        return EXIT_FAILURE;
+    }
+
+    if (option && strcmp(option, "--lex") == 0) 
+    {
+        print_tokens(&tokens);
+        free_token_list(&tokens);
+        return EXIT_SUCCESS;
+    }
+
+    AstNode *program = parse_program(&tokens);
+    free_token_list(&tokens);
+
+    if (!program) 
+        return EXIT_FAILURE;
+
+    if (option && strcmp(option, "--parse") == 0) 
+    {
+        Writer *out = malloc(sizeof(Writer));
+        if (!out) 
         {
-            fprintf(stderr, "Stub: Running lexer and parser on %s.\n", input_file);
-        } else if (strcmp(option, "--codegen") == 0) 
+            perror("Failed to allocate the AST writer");
+            ast_free(program);
+            return EXIT_FAILURE;
+        }
+        writer_init(out, STDOUT_FILENO);
+        ast_print(out, program, options->ast_format);
+        int status = writer_flush(out);
+        free(out);
+        ast_free(program);
+        if (status != 0) 
         {
+            perror("Failed to write AST dump");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    IrProgram *ir = ir_generate(program);
+    ast_free(program);
+
+    if (!ir) 
+        return EXIT_FAILURE;
+
+    // Branches are numbered before anything changes the IR, so that the
+    // instrumented build and the one using its profile agree.
+    uint64_t checksum = 0;
+    if (options->profile_generate || options->profile_use) 
+    {
+        profile_number_branches(ir);
+        checksum = profile_checksum(ir);
+    }
+    if (options->profile_use) 
+        profile_load(ir, options->profile_use);
+
+    // The backend adds its register allocation counts to the report, so
+    // the statistics are printed once the last stage has run.
+    OptReport report;
+    memset(&report, 0, sizeof(OptReport));
+    int ir_stage = option && (strcmp(option, "--tacky") == 0 || strcmp(option, "--interp") == 0);
+    if (options->opt_level > 0) 
+    {
+        OptOptions opt_options = {options->opt_level, options->print_after, options->jobs,
+                                  options->inline_budget, options->report_inlining};
+        optimize_program(ir, &opt_options, &report);
+        if (options->print_stats && ir_stage) 
+            opt_report_print(stderr, &report);
+    }
 
-            fprintf(stderr, "Stub: Running lexer, parser, and assembly generation on %s.\n", input_file);
+    if (option && strcmp(option, "--tacky") == 0) 
+    {
+        Writer *out = malloc(sizeof(Writer));
+        if (!out) 
+        {
+            perror("Failed to allocate the IR writer");
+            ir_program_free(ir);
+            return EXIT_FAILURE;
+        }
+        writer_init(out, STDOUT_FILENO);
+        ir_print_program(out, ir);
+        int status = writer_flush(out);
+        free(out);
+        ir_program_free(ir);
+        if (status != 0) 
+        {
+            perror("Failed to write IR dump");
+            return EXIT_FAILURE;
         }
         return EXIT_SUCCESS;
     }
 
-    // This is the full compilation path (no special option).
-    fprintf(stderr, "Stub: Compiling %s to assembly file %s.\n", input_file, output_file);
-    
-    // For the stub, we simulate the compiler pass by creating an empty assembly file,
-    // which `gcc` will assemble and link without issue.
-    FILE *fp = fopen(output_file, "w");
-    if (fp == NULL) 
+    if (option && strcmp(option, "--interp") == 0) 
     {
-        perror("Failed to create stub assembly file");
-        return EXIT_FAILURE;
+        int exit_code = 0;
+        int status = ir_interpret(ir, &exit_code);
+        ir_program_free(ir);
+        return status == 0 ? exit_code : EXIT_FAILURE;
     }
-    // Write a minimal, valid assembly stub (just a main label)
-    fprintf(fp, "\t.globl main\n");
-    fprintf(fp, "main:\n");
-    fprintf(fp, "\tret\n"); 
-    fclose(fp);
 
-    // In a real compiler, this is where a non-zero exit code would signify an error.
+    AsmProgram *assembly = codegen_compile(ir, options->opt_level, &report.stats);
+    ir_program_free(ir);
+    assembly->profile_path = options->profile_generate;
+    assembly->profile_checksum = checksum;
+    if (options->print_stats) 
+        opt_report_print(stderr, &report);
+
+    if (option && strcmp(option, "--codegen") == 0) 
+    {
+        asm_program_free(assembly);
+        return EXIT_SUCCESS;
+    }
+
+    int fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) 
+    {
+        perror("Failed to create assembly file");
+        asm_program_free(assembly);
+        return EXIT_FAILURE;
+    }
+    // The whole file is formatted in memory and written with one writev.
+    Writer *out = malloc(sizeof(Writer));
+    if (!out) 
+    {
+        perror("Failed to allocate the assembly writer");
+        close(fd);
+        remove(output_file);
+        asm_program_free(assembly);
+        return EXIT_FAILURE;
+    }
+    writer_init_collect(out, fd);
+    char name_copy[MAX_PATH];
+    strncpy(name_copy, input_file, MAX_PATH - 1);
+    name_copy[MAX_PATH - 1] = '\0';
+    double start = stats_now_seconds();
+    asm_print_program(out, assembly, basename(name_copy));
+    int status = writer_flush(out);
+    double seconds = stats_now_seconds() - start;
+    if (options->print_stats) 
+        fprintf(stderr, "Assembly emitted: %zu bytes in %.3f ms (%.1f MB/s)\n", out->total, seconds * 1e3,
+                seconds > 0 ? out->total / seconds / 1e6 : 0.0);
+    free(out);
+    asm_program_free(assembly);
+    if (close(fd) != 0 || status != 0) 
+    {
+        perror("Failed to write assembly file");
+        remove(output_file);
+        return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
 }
 
@@ -101,33 +273,96 @@ int run_compiler_pass(const char *input_file, const char *output_file, const cha
  */
 int main(int argc, char *argv[]) 
 {
-    if (argc < 2 || argc > 3) 
+    if (argc < 2) 
     {
-        fprintf(stderr, "Usage: %s <path/to/source.c> [--lex | --parse | --codegen | -S]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <path/to/source.c> [--lex | --parse | --tacky | --interp | --codegen | -S] [-O0 | -O1 | -O2] [--print-after=<pass|all>] [--jobs=N] [--inline-budget=N] [--report-inline] [--stats] [-fprofile-generate[=path] | -fprofile-use[=path]] [--ast-format=sexpr|json]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
     char *input_path =argv[1];
-    char *compiler_option = NULL;
-    int emit_assembly_only = 0;
+    DriverOptions options = {NULL, 0, AST_FORMAT_SEXPR, 0, NULL, 0, OPT_DEFAULT_INLINE_BUDGET, 0, 0, NULL, NULL};
 
-    if (argc ==  3)
+    for (int i = 2; i < argc; i++) 
     {
-        if (strcmp(argv[2], "--lex") == 0 || strcmp(argv[2], "--parse") == 0 || strcmp(argv[2], "--codegen") == 0) 
+        if (strcmp(argv[i], "--lex") == 0 || strcmp(argv[i], "--parse") == 0 || 
+            strcmp(argv[i], "--tacky") == 0 || strcmp(argv[i], "--interp") == 0 || 
+            strcmp(argv[i], "--codegen") == 0) 
         {
-            compiler_option = argv[2];
+            options.stage = argv[i];
         } 
-        else if (strcmp(argv[2], "-S") == 0) 
+        else if (strcmp(argv[i], "-S") == 0) 
         {
-            emit_assembly_only = 1;
+            options.emit_assembly_only = 1;
+        } 
+        else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0 || strcmp(argv[i], "-O2") == 0) 
+        {
+            options.opt_level = argv[i][2] - '0';
+        } 
+        else if (strncmp(argv[i], "--print-after=", 14) == 0) 
+        {
+            options.print_after = argv[i] + 14;
+            if (strcmp(options.print_after, "all") != 0 && optimizer_find_pass(options.print_after) < 0) 
+            {
+                fprintf(stderr, "Error: Unknown pass for --print-after: %s\n", options.print_after);
+                return EXIT_FAILURE;
+            }
+        } 
+        else if (strncmp(argv[i], "--jobs=", 7) == 0) 
+        {
+            char *end;
+            long jobs = strtol(argv[i] + 7, &end, 10);
+            if (*end != '\0' || end == argv[i] + 7 || jobs < 1 || jobs > 1024) 
+            {
+                fprintf(stderr, "Error: Invalid thread count: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            options.jobs = (int)jobs;
+        } 
+        else if (strncmp(argv[i], "--inline-budget=", 16) == 0) 
+        {
+            char *end;
+            long budget = strtol(argv[i] + 16, &end, 10);
+            if (*end != '\0' || end == argv[i] + 16 || budget < 0 || budget > 100000) 
+            {
+                fprintf(stderr, "Error: Invalid inline budget: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            options.inline_budget = (int)budget;
+        } 
+        else if (strcmp(argv[i], "--report-inline") == 0) 
+        {
+            options.report_inlining = 1;
+        } 
+        else if (strcmp(argv[i], "--stats") == 0) 
+        {
+            options.print_stats = 1;
+        } 
+        else if (strcmp(argv[i], "-fprofile-generate") == 0 || strncmp(argv[i], "-fprofile-generate=", 19) == 0) 
+        {
+            options.profile_generate = argv[i][18] == '=' ? argv[i] + 19 : PROFILE_DEFAULT_PATH;
+        } 
+        else if (strcmp(argv[i], "-fprofile-use") == 0 || strncmp(argv[i], "-fprofile-use=", 14) == 0) 
+        {
+            options.profile_use = argv[i][13] == '=' ? argv[i] + 14 : PROFILE_DEFAULT_PATH;
+        } 
+        else if (strcmp(argv[i], "--ast-format=sexpr") == 0) 
+        {
+            options.ast_format = AST_FORMAT_SEXPR;
+        } 
+        else if (strcmp(argv[i], "--ast-format=json") == 0) 
+        {
+            options.ast_format = AST_FORMAT_JSON;
         } 
         else 
         {
-            fprintf(stderr, "Error: Unknown compiler option: %s\n", argv[2]);
+            fprintf(stderr, "Error: Unknown compiler option: %s\n", argv[i]);
             return EXIT_FAILURE;
         }
     }
 
+    const char *compiler_option = options.stage;
+    int emit_assembly_only = options.emit_assembly_only;
+
     if (!file_exists(input_path))
     {
         fprintf(stderr, "Error: Input file does not exist or is not a regular file: %s\n", input_path);
@@ -174,20 +409,20 @@ int main(int argc, char *argv[])
 
     if (compiler_option) 
     {
-        int result = run_compiler_pass(preprocessed_file, NULL, compiler_option);
+        int result = run_compiler_pass(preprocessed_file, NULL, &options);
         delete_file(preprocessed_file); // Clean up
         return result;
     }
 
-    // --- 4. Compiler Pass (Step 2 - Stubbed) ---
-    fprintf(stderr, "Step 2: Compiling to Assembly (Stub)...\n");
-    int compiler_result = run_compiler_pass(preprocessed_file, assembly_file, NULL);
+    // --- 4. Compiler Pass (Step 2) ---
+    fprintf(stderr, "Step 2: Compiling to Assembly...\n");
+    int compiler_result = run_compiler_pass(preprocessed_file, assembly_file, &options);
     
     delete_file(preprocessed_file); // Delete the preprocessed file
 
     if (compiler_result != 0) 
     {
-        fprintf(stderr, "Error: Compiler stub failed.\n");
+        fprintf(stderr, "Error: Compilation failed.\n");
         // No need to delete assembly_file here, as run_compiler_pass is 
         // responsible for not creating it on failure.
         return EXIT_FAILURE;
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// --- Copy Propagation ---
+// In SSA form a copy's source is defined once, and that definition dominates
+// the copy and therefore every use of the copy's result. Each use of the result
+// can read the source directly, so copies are deleted and chains of them
+// collapse onto the value at the start of the chain.
+
+/**
+ * @brief Follows copies from a value back to the value they all carry.
+ * @param source Temporary -> copied value, or the temporary itself if not a copy.
+ * @param v The value to resolve.
+ * @return The original value.
+ */
+static IrValue resolve(IrValue *source, IrValue v)
+{
+    IrValue root = v;
+    while (root.kind == IR_VAL_TEMP && (source[root.value].kind != IR_VAL_TEMP || source[root.value].value != root.value))
+        root = source[root.value];
+
+    // Path compression, so long chains are walked once.
+    while (v.kind == IR_VAL_TEMP && (source[v.value].kind != IR_VAL_TEMP || source[v.value].value != v.value))
+    {
+        IrValue next = source[v.value];
+        source[v.value] = root;
+        v = next;
+    }
+    return root;
+}
+
+/**
+ * @brief Removes every copy from a function in SSA form.
+ * @param ctx The function to optimize and its analyses.
+ * @return 1 if the function changed.
+ */
+int copy_prop_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    int removed = 0;
+    IrValue *source = malloc((fn->temp_count + 1) * sizeof(IrValue));
+    for (int t = 0; t < fn->temp_count; t++)
+        source[t] = ir_temp(t);
+
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+        if (instr->op == IR_COPY && instr->dst.kind == IR_VAL_TEMP)
+        {
+            source[instr->dst.value] = instr->a;
+            instr->op = IR_NOP;
+            removed++;
+        }
+    }
+    ctx->stats->counts[STAT_COPIES_PROPAGATED] += removed;
+    if (removed == 0)
+    {
+        free(source);
+        return 0;
+    }
+
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+        int count = ir_use_count(instr);
+        for (int j = 0; j < count; j++)
+        {
+            IrValue *use = ir_use(fn, instr, j);
+            *use = resolve(source, *use);
+        }
+    }
+    ir_compact(fn);
+
+    free(source);
+    return 1;
+}
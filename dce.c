@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// --- Aggressive Dead Code Elimination ---
+// Everything is presumed dead until reached from an instruction that must stay:
+// returns, calls, jumps and labels. Liveness then flows backwards from each live
+// instruction to the definitions of its operands. Unlike deleting instructions
+// whose result is unused, this also removes dead cycles, such as a loop-carried
+// variable that is only ever used to compute itself.
+
+/**
+ * @brief Checks whether an instruction must be kept regardless of its result.
+ * @param op The opcode.
+ * @return 1 for instructions with effects beyond defining dst.
+ */
+static int is_root(IrOpcode op)
+{
+    return op == IR_RETURN || op == IR_CALL || op == IR_LABEL || ir_is_jump(op);
+}
+
+/**
+ * @brief Deletes every instruction that does not contribute to a root.
+ * @param ctx The function to optimize, in SSA form, and its analyses.
+ * @return 1 if the function changed.
+ */
+int dce_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    const SsaUses *uses = pass_uses(ctx);
+
+    unsigned char *live = calloc(fn->instr_count + 1, 1);
+    int *worklist = malloc((fn->instr_count + 1) * sizeof(int));
+    int count = 0;
+
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (is_root(fn->instrs[i].op))
+        {
+            live[i] = 1;
+            worklist[count++] = i;
+        }
+    }
+
+    while (count > 0)
+    {
+        IrInstr *instr = &fn->instrs[worklist[--count]];
+        int operands = ir_use_count(instr);
+        for (int j = 0; j < operands; j++)
+        {
+            IrValue *use = ir_use(fn, instr, j);
+            if (use->kind != IR_VAL_TEMP) continue;
+            int def = uses->def[use->value];
+            if (def >= 0 && !live[def])
+            {
+                live[def] = 1;
+                worklist[count++] = def;
+            }
+        }
+    }
+
+    int removed = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (!live[i] && fn->instrs[i].op != IR_NOP)
+        {
+            fn->instrs[i].op = IR_NOP;
+            removed++;
+        }
+    }
+    ctx->stats->counts[STAT_DCE_REMOVED] += removed;
+    if (removed > 0)
+        ir_compact(fn);
+
+    free(worklist);
+    free(live);
+    return removed > 0;
+}
@@ -0,0 +1,179 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// --- Division by Constants ---
+// Works on SSA form. Signed division and remainder by a constant divisor are
+// rewritten into multiply-high and shift sequences (Granlund and Montgomery,
+// as given in Hacker's Delight, chapter 10), which the backend can emit
+// without an idiv. Remainders reuse the quotient: n % d = n - (n / d) * d.
+//
+// Divisors 0 and -1 are left alone, since they can fault at run time. A
+// divisor of INT32_MIN only divides INT32_MIN itself, so it becomes a
+// comparison.
+
+//--- Magic Number ---
+typedef struct
+{
+    int32_t multiplier;
+    int shift;
+} DivMagic;
+
+/**
+ * @brief Computes the multiplier and shift for signed division by a constant.
+ *
+ * Finds the smallest p >= 32 for which 2^p / |d|, rounded up, approximates
+ * 1 / |d| closely enough that the truncated quotient is exact for every
+ * 32-bit dividend.
+ *
+ * @param d The divisor; |d| >= 2 and not INT32_MIN.
+ * @return The multiplier (as a wrapped 32-bit value) and the extra shift p - 32.
+ */
+static DivMagic div_magic(int32_t d)
+{
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? 0u - (uint32_t)d : (uint32_t)d;
+    uint32_t t = two31 + ((uint32_t)d >> 31);
+    uint32_t anc = t - 1 - t % ad;     // |nc|, the largest dividend with n % |d| = |d| - 1
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    int p = 31;
+    do
+    {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad)
+        {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    DivMagic magic;
+    magic.multiplier = (int32_t)(d < 0 ? 0u - (q2 + 1) : q2 + 1);
+    magic.shift = p - 32;
+    return magic;
+}
+
+/**
+ * @brief Emits an operation into a fresh temporary.
+ * @param fn The function being rebuilt.
+ * @param op The opcode.
+ * @param a The first operand.
+ * @param b The second operand.
+ * @return The temporary holding the result.
+ */
+static IrValue emit_temp(IrFunction *fn, IrOpcode op, IrValue a, IrValue b)
+{
+    IrValue dst = ir_temp(ir_new_temp(fn));
+    ir_emit(fn, op, dst, a, b);
+    return dst;
+}
+
+/**
+ * @brief Emits the truncated quotient of a value by a constant.
+ * @param fn The function being rebuilt.
+ * @param n The dividend.
+ * @param d The divisor; not 0, 1 or -1.
+ * @return The temporary holding n / d.
+ */
+static IrValue emit_quotient(IrFunction *fn, IrValue n, int32_t d)
+{
+    if (d == INT32_MIN)
+        return emit_temp(fn, IR_EQ, n, ir_const(INT32_MIN));
+
+    uint32_t ad = d < 0 ? 0u - (uint32_t)d : (uint32_t)d;
+    if ((ad & (ad - 1)) == 0)
+    {
+        // Shifting rounds towards minus infinity, so negative dividends are
+        // first biased by |d| - 1, taken from their sign bits.
+        int k = __builtin_ctz(ad);
+        IrValue sign = k == 1 ? n : emit_temp(fn, IR_SAR, n, ir_const(k - 1));
+        IrValue bias = emit_temp(fn, IR_SHR, sign, ir_const(32 - k));
+        IrValue q = emit_temp(fn, IR_SAR, emit_temp(fn, IR_ADD, n, bias), ir_const(k));
+        return d < 0 ? emit_temp(fn, IR_NEGATE, q, ir_none()) : q;
+    }
+
+    DivMagic magic = div_magic(d);
+    IrValue q = emit_temp(fn, IR_MUL_HIGH, n, ir_const(magic.multiplier));
+    if (d > 0 && magic.multiplier < 0)
+        q = emit_temp(fn, IR_ADD, q, n);
+    else if (d < 0 && magic.multiplier > 0)
+        q = emit_temp(fn, IR_SUB, q, n);
+    if (magic.shift > 0)
+        q = emit_temp(fn, IR_SAR, q, ir_const(magic.shift));
+    // Round towards zero: add one when the estimate is negative.
+    return emit_temp(fn, IR_ADD, q, emit_temp(fn, IR_SHR, q, ir_const(31)));
+}
+
+/**
+ * @brief Checks whether a division or remainder should be lowered.
+ * @param instr The instruction.
+ * @return 1 for a division or remainder of a temporary by a safe constant.
+ */
+static int is_lowerable(const IrInstr *instr)
+{
+    if (instr->op != IR_DIV && instr->op != IR_REM) return 0;
+    if (instr->dst.kind != IR_VAL_TEMP || instr->a.kind != IR_VAL_TEMP || instr->b.kind != IR_VAL_CONST) return 0;
+    return instr->b.value != 0 && instr->b.value != -1;
+}
+
+/**
+ * @brief Lowers division and remainder by constants to multiplications and shifts.
+ * @param ctx The function to optimize, in SSA form, and its analyses.
+ * @return 1 if the function changed.
+ */
+int div_const_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    int count = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+        count += is_lowerable(&fn->instrs[i]);
+    if (count == 0) return 0;
+
+    IrInstr *old = fn->instrs;
+    int old_count = fn->instr_count;
+    fn->instrs = NULL;
+    fn->instr_count = 0;
+    fn->instr_capacity = 0;
+    for (int i = 0; i < old_count; i++)
+    {
+        const IrInstr *instr = &old[i];
+        if (!is_lowerable(instr))
+        {
+            IrInstr *copy = ir_emit(fn, instr->op, instr->dst, instr->a, instr->b);
+            *copy = *instr;
+            continue;
+        }
+
+        IrValue n = instr->a;
+        int32_t d = instr->b.value;
+        if (d == 1)
+        {
+            ir_emit(fn, IR_COPY, instr->dst, instr->op == IR_DIV ? n : ir_const(0), ir_none());
+            continue;
+        }
+        IrValue q = emit_quotient(fn, n, d);
+        if (instr->op == IR_DIV)
+            ir_emit(fn, IR_COPY, instr->dst, q, ir_none());
+        else
+            ir_emit(fn, IR_SUB, instr->dst, n, emit_temp(fn, IR_MUL, q, ir_const(d)));
+    }
+    free(old);
+
+    ctx->stats->counts[STAT_DIVS_LOWERED] += count;
+    return 1;
+}
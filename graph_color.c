@@ -0,0 +1,930 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm.h"
+
+// --- Graph-Coloring Register Allocation ---
+// Iterated register coalescing (George and Appel, "Iterated Register
+// Coalescing", TOPLAS 1996), following the structure of Appel's Modern
+// Compiler Implementation: build, simplify, coalesce, freeze, potential
+// spill and select, with every node and move kept in exactly one worklist.
+// Coalescing uses Briggs' test for two pseudo registers and George's test
+// against a machine register, so coalescing never turns a colorable graph
+// into an uncolorable one.
+//
+// Machine registers that instruction selection names are precolored nodes.
+// %rsp, %rbp, %r10 and %r11 are never handed out, so they take no part in
+// the graph.
+//
+// Spill code is minimal by construction: x86-64 accepts a memory operand in
+// nearly every instruction and codegen_fixup patches the rest through the
+// scratch registers, so a spilled node simply keeps its stack slot and no
+// second round of building and coloring is needed. A spilled node whose only
+// definition loads a constant is rematerialized instead: its uses read the
+// immediate and the definition is deleted.
+//
+// Small functions record interference in a triangular bit matrix; above
+// MATRIX_LIMIT nodes the matrix would grow quadratically, so large functions
+// use a hash set of edges instead. Both keep adjacency lists for iteration.
+
+#define MATRIX_LIMIT 4096
+#define K ASM_ALLOCATABLE_COUNT     // Colors
+
+//--- Node Worklists ---
+typedef enum
+{
+    NODE_NONE,          // Pseudo register that never occurs
+    NODE_PRECOLORED,
+    NODE_SIMPLIFY,      // Low degree, not move-related
+    NODE_FREEZE,        // Low degree, move-related
+    NODE_SPILL,         // High degree
+    NODE_SPILLED,
+    NODE_COALESCED,
+    NODE_COLORED,
+    NODE_SELECT,        // On the select stack
+    NODE_SET_COUNT
+} NodeSet;
+
+//--- Move Worklists ---
+typedef enum
+{
+    MOVE_COALESCED,
+    MOVE_CONSTRAINED,   // Source and destination interfere
+    MOVE_FROZEN,        // No longer considered for coalescing
+    MOVE_WORKLIST,      // Possibly coalescable
+    MOVE_ACTIVE,        // Not yet ready for coalescing
+    MOVE_SET_COUNT
+} MoveSet;
+
+//--- Integer List ---
+typedef struct
+{
+    int *items;
+    int count;
+    int capacity;
+} IntList;
+
+//--- Allocator State ---
+typedef struct
+{
+    const AsmFunction *fn;
+    int pseudo_count;
+    int node_count;     // Pseudo registers, then one node per machine register
+
+    // Interference: exactly one of matrix and edges is used.
+    BitWord *matrix;
+    uint64_t *edges;
+    size_t edge_capacity;
+    size_t edge_count;
+    IntList *adj;       // Pseudo register -> neighbours
+    int *degree;
+
+    int *move_src;
+    int *move_dst;
+    int move_count;
+    int move_capacity;
+    IntList *move_list; // Node -> moves it takes part in
+
+    IntList node_sets[NODE_SET_COUNT];
+    int *node_where;
+    int *node_pos;
+    IntList move_sets[MOVE_SET_COUNT];
+    int *move_where;
+    int *move_pos;
+
+    int *alias;
+    int *color;
+    long *cost;
+    int *def_count;
+    int *remat;         // Node -> 1 if every definition loads the same constant
+    int32_t *remat_value;
+    int *stamp;         // Scratch marks for briggs_ok
+    int stamp_now;
+} GraphColor;
+
+// --- Lists and Worklists ---
+
+/**
+ * @brief Appends to an integer list.
+ * @param list The list.
+ * @param value The value.
+ */
+static void list_push(IntList *list, int value)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 4;
+        list->items = realloc(list->items, list->capacity * sizeof(int));
+    }
+    list->items[list->count++] = value;
+}
+
+/**
+ * @brief Moves a node to another worklist.
+ * @param gc The allocator state.
+ * @param node The node.
+ * @param set The new worklist; NODE_SELECT pushes onto the select stack.
+ */
+static void node_move_to(GraphColor *gc, int node, NodeSet set)
+{
+    IntList *from = &gc->node_sets[gc->node_where[node]];
+    int pos = gc->node_pos[node];
+    if (pos >= 0)
+    {
+        int last = from->items[--from->count];
+        from->items[pos] = last;
+        gc->node_pos[last] = pos;
+    }
+    gc->node_where[node] = set;
+    gc->node_pos[node] = gc->node_sets[set].count;
+    list_push(&gc->node_sets[set], node);
+}
+
+/**
+ * @brief Moves a move to another worklist.
+ * @param gc The allocator state.
+ * @param move The move.
+ * @param set The new worklist.
+ */
+static void move_move_to(GraphColor *gc, int move, MoveSet set)
+{
+    IntList *from = &gc->move_sets[gc->move_where[move]];
+    int pos = gc->move_pos[move];
+    int last = from->items[--from->count];
+    from->items[pos] = last;
+    gc->move_pos[last] = pos;
+    gc->move_where[move] = set;
+    gc->move_pos[move] = gc->move_sets[set].count;
+    list_push(&gc->move_sets[set], move);
+}
+
+// --- Interference Graph ---
+
+/**
+ * @brief Checks whether a node is a machine register.
+ * @param gc The allocator state.
+ * @param node The node.
+ * @return 1 for precolored nodes.
+ */
+static int precolored(const GraphColor *gc, int node)
+{
+    return node >= gc->pseudo_count;
+}
+
+/**
+ * @brief Checks whether a node may take part in the graph.
+ * @param gc The allocator state.
+ * @param node The node.
+ * @return 0 for the registers that are never allocated.
+ */
+static int in_graph(const GraphColor *gc, int node)
+{
+    if (!precolored(gc, node)) return 1;
+    AsmReg reg = (AsmReg)(node - gc->pseudo_count);
+    return reg != REG_SP && reg != REG_BP && reg != REG_R10 && reg != REG_R11;
+}
+
+/**
+ * @brief Finds an edge's slot in the hash set.
+ * @param gc The allocator state.
+ * @param key The edge key.
+ * @return The slot holding the key, or the empty slot where it belongs.
+ */
+static size_t edge_slot(const GraphColor *gc, uint64_t key)
+{
+    size_t mask = gc->edge_capacity - 1;
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 20) & mask;
+    while (gc->edges[slot] != 0 && gc->edges[slot] != key)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/**
+ * @brief Builds the key of an undirected edge.
+ * @param u One end.
+ * @param v The other end.
+ * @return A non-zero key, the same for (u, v) and (v, u).
+ */
+static uint64_t edge_key(int u, int v)
+{
+    if (u < v)
+    {
+        int t = u;
+        u = v;
+        v = t;
+    }
+    return ((uint64_t)u << 32 | (uint32_t)v) + 1;
+}
+
+/**
+ * @brief Checks whether two nodes interfere.
+ * @param gc The allocator state.
+ * @param u One node.
+ * @param v The other node.
+ * @return 1 if an edge joins them.
+ */
+static int interferes(const GraphColor *gc, int u, int v)
+{
+    if (gc->matrix)
+    {
+        if (u < v)
+        {
+            int t = u;
+            u = v;
+            v = t;
+        }
+        return bitset_test(gc->matrix, (int)((long)u * (u - 1) / 2 + v));
+    }
+    return gc->edges[edge_slot(gc, edge_key(u, v))] != 0;
+}
+
+/**
+ * @brief Records an edge in the membership structure.
+ * @param gc The allocator state.
+ * @param u One node.
+ * @param v The other node; u != v and the edge is new.
+ */
+static void record_edge(GraphColor *gc, int u, int v)
+{
+    if (gc->matrix)
+    {
+        int hi = u > v ? u : v, lo = u > v ? v : u;
+        bitset_set(gc->matrix, (int)((long)hi * (hi - 1) / 2 + lo));
+        return;
+    }
+    if (2 * (gc->edge_count + 1) > gc->edge_capacity)
+    {
+        uint64_t *old = gc->edges;
+        size_t old_capacity = gc->edge_capacity;
+        gc->edge_capacity *= 2;
+        gc->edges = calloc(gc->edge_capacity, sizeof(uint64_t));
+        for (size_t i = 0; i < old_capacity; i++)
+        {
+            if (old[i] != 0)
+                gc->edges[edge_slot(gc, old[i])] = old[i];
+        }
+        free(old);
+    }
+    uint64_t key = edge_key(u, v);
+    gc->edges[edge_slot(gc, key)] = key;
+    gc->edge_count++;
+}
+
+/**
+ * @brief Adds an interference edge; machine registers keep no adjacency list.
+ * @param gc The allocator state.
+ * @param u One node.
+ * @param v The other node.
+ */
+static void add_edge(GraphColor *gc, int u, int v)
+{
+    if (u == v || !in_graph(gc, u) || !in_graph(gc, v)) return;
+    if (precolored(gc, u) && precolored(gc, v)) return;
+    if (interferes(gc, u, v)) return;
+    record_edge(gc, u, v);
+    if (!precolored(gc, u))
+    {
+        list_push(&gc->adj[u], v);
+        gc->degree[u]++;
+    }
+    if (!precolored(gc, v))
+    {
+        list_push(&gc->adj[v], u);
+        gc->degree[v]++;
+    }
+}
+
+/**
+ * @brief Returns the liveness variable of a move operand, if it can be coalesced.
+ * @param gc The allocator state.
+ * @param operand The operand.
+ * @return The node, or -1.
+ */
+static int move_node(const GraphColor *gc, AsmOperand operand)
+{
+    int node = -1;
+    if (operand.kind == ASM_OPERAND_PSEUDO) node = operand.value;
+    if (operand.kind == ASM_OPERAND_REG) node = gc->pseudo_count + operand.reg;
+    return node >= 0 && in_graph(gc, node) ? node : -1;
+}
+
+/**
+ * @brief Builds the interference graph and the move worklist, and computes spill costs.
+ *
+ * The source of a move does not interfere with its destination, which is
+ * what makes the two candidates for coalescing.
+ *
+ * @param gc The allocator state.
+ * @param live The function's liveness.
+ */
+static void build(GraphColor *gc, const AsmLiveness *live)
+{
+    const AsmFunction *fn = gc->fn;
+    size_t words = live->words;
+    BitWord *current = bitset_new(live->var_count);
+
+    for (int b = 0; b < live->block_count; b++)
+    {
+        bitset_copy(current, live->live_out + b * words, words);
+        for (int i = live->block_start[b + 1] - 1; i >= live->block_start[b]; i--)
+        {
+            const AsmInstr *instr = &fn->instrs[i];
+            AsmUseDef ud;
+            asm_use_def(fn, instr, &ud);
+            long cost = live->frequency[i];
+            for (int u = 0; u < ud.use_count; u++)
+            {
+                if (ud.uses[u] < gc->pseudo_count)
+                    gc->cost[ud.uses[u]] += cost;
+            }
+            for (int d = 0; d < ud.def_count; d++)
+            {
+                if (ud.defs[d] < gc->pseudo_count)
+                {
+                    gc->cost[ud.defs[d]] += cost;
+                    gc->def_count[ud.defs[d]]++;
+                }
+            }
+
+            int src = move_node(gc, instr->src);
+            int dst = move_node(gc, instr->dst);
+            if (instr->op == ASM_MOV && src >= 0 && dst >= 0 && src != dst &&
+                !(precolored(gc, src) && precolored(gc, dst)))
+            {
+                bitset_clear(current, src);
+                if (gc->move_count == gc->move_capacity)
+                {
+                    gc->move_capacity = gc->move_capacity ? gc->move_capacity * 2 : 32;
+                    gc->move_src = realloc(gc->move_src, gc->move_capacity * sizeof(int));
+                    gc->move_dst = realloc(gc->move_dst, gc->move_capacity * sizeof(int));
+                }
+                int move = gc->move_count++;
+                gc->move_src[move] = src;
+                gc->move_dst[move] = dst;
+                list_push(&gc->move_list[src], move);
+                list_push(&gc->move_list[dst], move);
+            }
+
+            for (int d = 0; d < ud.def_count; d++)
+                bitset_set(current, ud.defs[d]);
+            for (int d = 0; d < ud.def_count; d++)
+            {
+                for (size_t w = 0; w < words; w++)
+                {
+                    for (BitWord bits = current[w]; bits; bits &= bits - 1)
+                        add_edge(gc, ud.defs[d], (int)(w * BITSET_WORD_BITS) + __builtin_ctzll(bits));
+                }
+            }
+            for (int d = 0; d < ud.def_count; d++)
+                bitset_clear(current, ud.defs[d]);
+            for (int u = 0; u < ud.use_count; u++)
+                bitset_set(current, ud.uses[u]);
+        }
+    }
+    free(current);
+
+    // Only a temporary whose single definition loads a constant can be rematerialized.
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        if (instr->op == ASM_MOV && instr->src.kind == ASM_OPERAND_IMM && instr->dst.kind == ASM_OPERAND_PSEUDO &&
+            gc->def_count[instr->dst.value] == 1)
+        {
+            gc->remat[instr->dst.value] = 1;
+            gc->remat_value[instr->dst.value] = instr->src.value;
+        }
+    }
+}
+
+// --- Simplify, Coalesce and Freeze ---
+
+/**
+ * @brief Checks whether a move can still be coalesced or is waiting to be.
+ * @param gc The allocator state.
+ * @param move The move.
+ * @return 1 for active and worklist moves.
+ */
+static int move_pending(const GraphColor *gc, int move)
+{
+    return gc->move_where[move] == MOVE_ACTIVE || gc->move_where[move] == MOVE_WORKLIST;
+}
+
+/**
+ * @brief Checks whether a node takes part in a pending move.
+ * @param gc The allocator state.
+ * @param node The node.
+ * @return 1 if it does.
+ */
+static int move_related(const GraphColor *gc, int node)
+{
+    const IntList *moves = &gc->move_list[node];
+    for (int i = 0; i < moves->count; i++)
+    {
+        if (move_pending(gc, moves->items[i]))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks whether a neighbour is still in the graph.
+ * @param gc The allocator state.
+ * @param node The neighbour.
+ * @return 0 once it is on the select stack or coalesced away.
+ */
+static int adjacent(const GraphColor *gc, int node)
+{
+    return gc->node_where[node] != NODE_SELECT && gc->node_where[node] != NODE_COALESCED;
+}
+
+/**
+ * @brief Puts a node's pending moves, and its neighbours', back on the move worklist.
+ * @param gc The allocator state.
+ * @param node The node.
+ */
+static void enable_moves(GraphColor *gc, int node)
+{
+    const IntList *moves = &gc->move_list[node];
+    for (int i = 0; i < moves->count; i++)
+    {
+        if (gc->move_where[moves->items[i]] == MOVE_ACTIVE)
+            move_move_to(gc, moves->items[i], MOVE_WORKLIST);
+    }
+}
+
+/**
+ * @brief Lowers a node's degree after a neighbour leaves the graph.
+ * @param gc The allocator state.
+ * @param node The node.
+ */
+static void decrement_degree(GraphColor *gc, int node)
+{
+    if (precolored(gc, node)) return;
+    if (gc->degree[node]-- != K || gc->node_where[node] != NODE_SPILL) return;
+    enable_moves(gc, node);
+    const IntList *adj = &gc->adj[node];
+    for (int i = 0; i < adj->count; i++)
+    {
+        if (adjacent(gc, adj->items[i]))
+            enable_moves(gc, adj->items[i]);
+    }
+    node_move_to(gc, node, move_related(gc, node) ? NODE_FREEZE : NODE_SIMPLIFY);
+}
+
+/**
+ * @brief Removes a low-degree, non-move-related node from the graph.
+ * @param gc The allocator state.
+ */
+static void simplify(GraphColor *gc)
+{
+    IntList *list = &gc->node_sets[NODE_SIMPLIFY];
+    int node = list->items[list->count - 1];
+    node_move_to(gc, node, NODE_SELECT);
+    const IntList *adj = &gc->adj[node];
+    for (int i = 0; i < adj->count; i++)
+    {
+        if (adjacent(gc, adj->items[i]))
+            decrement_degree(gc, adj->items[i]);
+    }
+}
+
+/**
+ * @brief Follows coalescing to the node that now represents another.
+ * @param gc The allocator state.
+ * @param node The node.
+ * @return The representative.
+ */
+static int get_alias(const GraphColor *gc, int node)
+{
+    while (gc->node_where[node] == NODE_COALESCED)
+        node = gc->alias[node];
+    return node;
+}
+
+/**
+ * @brief Moves a node that no longer takes part in moves to the simplify worklist.
+ * @param gc The allocator state.
+ * @param node The node.
+ */
+static void add_work_list(GraphColor *gc, int node)
+{
+    if (!precolored(gc, node) && !move_related(gc, node) && gc->degree[node] < K && gc->node_where[node] == NODE_FREEZE)
+        node_move_to(gc, node, NODE_SIMPLIFY);
+}
+
+/**
+ * @brief George's test for one neighbour of a node being merged into a register.
+ * @param gc The allocator state.
+ * @param t The neighbour.
+ * @param r The machine register's node.
+ * @return 1 if t cannot block the merge.
+ */
+static int george_ok(const GraphColor *gc, int t, int r)
+{
+    return gc->degree[t] < K || precolored(gc, t) || interferes(gc, t, r);
+}
+
+/**
+ * @brief Briggs' test: the merged node would have fewer than K neighbours of significant degree.
+ * @param gc The allocator state.
+ * @param u One node.
+ * @param v The other node.
+ * @return 1 if merging them is safe.
+ */
+static int briggs_ok(GraphColor *gc, int u, int v)
+{
+    int significant = 0;
+    gc->stamp_now++;
+    const int nodes[2] = {u, v};
+    for (int n = 0; n < 2; n++)
+    {
+        const IntList *adj = &gc->adj[nodes[n]];
+        for (int i = 0; i < adj->count; i++)
+        {
+            int t = adj->items[i];
+            if (!adjacent(gc, t) || gc->stamp[t] == gc->stamp_now) continue;
+            gc->stamp[t] = gc->stamp_now;
+            if (precolored(gc, t) || gc->degree[t] >= K)
+                significant++;
+        }
+    }
+    return significant < K;
+}
+
+/**
+ * @brief Merges node v into node u.
+ * @param gc The allocator state.
+ * @param u The surviving node.
+ * @param v The node coalesced away.
+ */
+static void combine(GraphColor *gc, int u, int v)
+{
+    node_move_to(gc, v, NODE_COALESCED);
+    gc->alias[v] = u;
+    for (int i = 0; i < gc->move_list[v].count; i++)
+        list_push(&gc->move_list[u], gc->move_list[v].items[i]);
+    enable_moves(gc, v);
+    if (!precolored(gc, u))
+    {
+        gc->cost[u] += gc->cost[v];
+        gc->remat[u] = gc->remat[u] && gc->remat[v] && gc->remat_value[u] == gc->remat_value[v];
+    }
+
+    const IntList *adj = &gc->adj[v];
+    for (int i = 0; i < adj->count; i++)
+    {
+        int t = adj->items[i];
+        if (!adjacent(gc, t)) continue;
+        add_edge(gc, t, u);
+        decrement_degree(gc, t);
+    }
+    if (!precolored(gc, u) && gc->degree[u] >= K && gc->node_where[u] == NODE_FREEZE)
+        node_move_to(gc, u, NODE_SPILL);
+}
+
+/**
+ * @brief Tries to coalesce one move from the worklist.
+ * @param gc The allocator state.
+ * @param stats Receives coalescing counts.
+ */
+static void coalesce(GraphColor *gc, OptStats *stats)
+{
+    IntList *list = &gc->move_sets[MOVE_WORKLIST];
+    int move = list->items[list->count - 1];
+    int x = get_alias(gc, gc->move_src[move]);
+    int y = get_alias(gc, gc->move_dst[move]);
+    int u = x, v = y;
+    if (precolored(gc, y))
+    {
+        u = y;
+        v = x;
+    }
+
+    if (u == v)
+    {
+        move_move_to(gc, move, MOVE_COALESCED);
+        add_work_list(gc, u);
+        return;
+    }
+    if (precolored(gc, v) || interferes(gc, u, v))
+    {
+        move_move_to(gc, move, MOVE_CONSTRAINED);
+        add_work_list(gc, u);
+        add_work_list(gc, v);
+        return;
+    }
+
+    int safe;
+    if (precolored(gc, u))
+    {
+        safe = 1;
+        const IntList *adj = &gc->adj[v];
+        for (int i = 0; i < adj->count && safe; i++)
+        {
+            if (adjacent(gc, adj->items[i]))
+                safe = george_ok(gc, adj->items[i], u);
+        }
+    }
+    else
+        safe = briggs_ok(gc, u, v);
+
+    if (safe)
+    {
+        move_move_to(gc, move, MOVE_COALESCED);
+        combine(gc, u, v);
+        add_work_list(gc, u);
+        stats->counts[STAT_RA_COALESCED]++;
+    }
+    else
+        move_move_to(gc, move, MOVE_ACTIVE);
+}
+
+/**
+ * @brief Gives up coalescing every pending move of a node.
+ * @param gc The allocator state.
+ * @param node The node.
+ */
+static void freeze_moves(GraphColor *gc, int node)
+{
+    const IntList *moves = &gc->move_list[node];
+    for (int i = 0; i < moves->count; i++)
+    {
+        int move = moves->items[i];
+        if (!move_pending(gc, move)) continue;
+        int x = get_alias(gc, gc->move_src[move]);
+        int y = get_alias(gc, gc->move_dst[move]);
+        int other = y == get_alias(gc, node) ? x : y;
+        move_move_to(gc, move, MOVE_FROZEN);
+        if (gc->node_where[other] == NODE_FREEZE && !move_related(gc, other) && gc->degree[other] < K)
+            node_move_to(gc, other, NODE_SIMPLIFY);
+    }
+}
+
+/**
+ * @brief Freezes a low-degree move-related node so it can be simplified.
+ * @param gc The allocator state.
+ */
+static void freeze(GraphColor *gc)
+{
+    IntList *list = &gc->node_sets[NODE_FREEZE];
+    int node = list->items[list->count - 1];
+    node_move_to(gc, node, NODE_SIMPLIFY);
+    freeze_moves(gc, node);
+}
+
+/**
+ * @brief Picks a high-degree node to simplify optimistically, the one with the lowest cost per neighbour.
+ * @param gc The allocator state.
+ */
+static void select_spill(GraphColor *gc)
+{
+    const IntList *list = &gc->node_sets[NODE_SPILL];
+    int best = list->items[0];
+    for (int i = 1; i < list->count; i++)
+    {
+        int node = list->items[i];
+        if ((long long)gc->cost[node] * gc->degree[best] < (long long)gc->cost[best] * gc->degree[node])
+            best = node;
+    }
+    node_move_to(gc, best, NODE_SIMPLIFY);
+    freeze_moves(gc, best);
+}
+
+/**
+ * @brief Pops the select stack, giving each node a color its neighbours do not have.
+ *
+ * Among the free colors, one already given to a move partner is preferred,
+ * so that frozen and constrained moves may still disappear.
+ *
+ * @param gc The allocator state.
+ */
+static void assign_colors(GraphColor *gc)
+{
+    IntList *stack = &gc->node_sets[NODE_SELECT];
+    while (stack->count > 0)
+    {
+        int node = stack->items[stack->count - 1];
+        unsigned ok = 0;
+        for (int r = 0; r < K; r++)
+            ok |= 1u << asm_allocatable[r];
+        const IntList *adj = &gc->adj[node];
+        for (int i = 0; i < adj->count; i++)
+        {
+            int t = get_alias(gc, adj->items[i]);
+            if (gc->node_where[t] == NODE_COLORED || precolored(gc, t))
+                ok &= ~(1u << gc->color[t]);
+        }
+        if (!ok)
+        {
+            node_move_to(gc, node, NODE_SPILLED);
+            continue;
+        }
+
+        int chosen = -1;
+        const IntList *moves = &gc->move_list[node];
+        for (int i = 0; i < moves->count && chosen < 0; i++)
+        {
+            int x = get_alias(gc, gc->move_src[moves->items[i]]);
+            int y = get_alias(gc, gc->move_dst[moves->items[i]]);
+            int other = x == node ? y : x;
+            if ((gc->node_where[other] == NODE_COLORED || precolored(gc, other)) && (ok & (1u << gc->color[other])))
+                chosen = gc->color[other];
+        }
+        for (int r = 0; r < K && chosen < 0; r++)
+        {
+            if (ok & (1u << asm_allocatable[r]))
+                chosen = asm_allocatable[r];
+        }
+        gc->color[node] = chosen;
+        node_move_to(gc, node, NODE_COLORED);
+    }
+}
+
+// --- Rewriting ---
+
+/**
+ * @brief Replaces a pseudo register operand by its color, representative or constant.
+ * @param gc The allocator state.
+ * @param operand The operand.
+ */
+static void rewrite_operand(const GraphColor *gc, AsmOperand *operand)
+{
+    if (operand->kind != ASM_OPERAND_PSEUDO) return;
+    int node = get_alias(gc, operand->value);
+    if (gc->node_where[node] == NODE_COLORED || precolored(gc, node))
+        *operand = asm_reg((AsmReg)gc->color[node]);
+    else if (gc->remat[node])
+        *operand = asm_imm(gc->remat_value[node]);
+    else
+        *operand = asm_pseudo(node);
+}
+
+/**
+ * @brief Allocates registers for one function.
+ * @param fn The function, with pseudo register operands.
+ * @param stats Receives allocation counts.
+ */
+static void allocate_function(AsmFunction *fn, OptStats *stats)
+{
+    AsmLiveness live;
+    asm_liveness_compute(&live, fn);
+
+    GraphColor gc = {0};
+    gc.fn = fn;
+    gc.pseudo_count = fn->pseudo_count;
+    gc.node_count = fn->pseudo_count + REG_COUNT;
+    int n = gc.node_count;
+    if (n <= MATRIX_LIMIT)
+        gc.matrix = bitset_new((int)((long)n * (n - 1) / 2));
+    else
+    {
+        gc.edge_capacity = 1024;
+        while (gc.edge_capacity < (size_t)n * 4)
+            gc.edge_capacity *= 2;
+        gc.edges = calloc(gc.edge_capacity, sizeof(uint64_t));
+    }
+    gc.adj = calloc(n, sizeof(IntList));
+    gc.move_list = calloc(n, sizeof(IntList));
+    gc.degree = calloc(n, sizeof(int));
+    gc.node_where = calloc(n, sizeof(int));
+    gc.node_pos = malloc(n * sizeof(int));
+    gc.alias = calloc(n, sizeof(int));
+    gc.color = calloc(n, sizeof(int));
+    gc.cost = calloc(n, sizeof(long));
+    gc.def_count = calloc(n, sizeof(int));
+    gc.remat = calloc(n, sizeof(int));
+    gc.remat_value = calloc(n, sizeof(int32_t));
+    gc.stamp = calloc(n, sizeof(int));
+    for (int i = 0; i < n; i++)
+        gc.node_pos[i] = -1;
+
+    build(&gc, &live);
+
+    // Constants are cheap to spill: their uses can read the immediate.
+    int *occurs = calloc(n, sizeof(int));
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (fn->instrs[i].src.kind == ASM_OPERAND_PSEUDO) occurs[fn->instrs[i].src.value] = 1;
+        if (fn->instrs[i].dst.kind == ASM_OPERAND_PSEUDO) occurs[fn->instrs[i].dst.value] = 1;
+        if (fn->instrs[i].index.kind == ASM_OPERAND_PSEUDO) occurs[fn->instrs[i].index.value] = 1;
+    }
+    gc.move_where = malloc((gc.move_count + 1) * sizeof(int));
+    gc.move_pos = malloc((gc.move_count + 1) * sizeof(int));
+    for (int m = 0; m < gc.move_count; m++)
+    {
+        gc.move_where[m] = MOVE_WORKLIST;
+        gc.move_pos[m] = gc.move_sets[MOVE_WORKLIST].count;
+        list_push(&gc.move_sets[MOVE_WORKLIST], m);
+    }
+    for (int r = 0; r < REG_COUNT; r++)
+    {
+        int node = gc.pseudo_count + r;
+        gc.node_where[node] = NODE_PRECOLORED;
+        gc.color[node] = r;
+        gc.degree[node] = 1 << 29;
+    }
+    for (int p = 0; p < gc.pseudo_count; p++)
+    {
+        if (gc.remat[p])
+            gc.cost[p] = 1;
+        if (!occurs[p]) continue;
+        node_move_to(&gc, p, gc.degree[p] >= K ? NODE_SPILL : move_related(&gc, p) ? NODE_FREEZE : NODE_SIMPLIFY);
+    }
+
+    for (;;)
+    {
+        if (gc.node_sets[NODE_SIMPLIFY].count > 0)
+            simplify(&gc);
+        else if (gc.move_sets[MOVE_WORKLIST].count > 0)
+            coalesce(&gc, stats);
+        else if (gc.node_sets[NODE_FREEZE].count > 0)
+            freeze(&gc);
+        else if (gc.node_sets[NODE_SPILL].count > 0)
+            select_spill(&gc);
+        else
+            break;
+    }
+    assign_colors(&gc);
+
+    for (int p = 0; p < gc.pseudo_count; p++)
+    {
+        if (!occurs[p] || gc.node_where[p] == NODE_COALESCED) continue;
+        if (gc.node_where[p] == NODE_COLORED)
+        {
+            stats->counts[STAT_RA_ALLOCATED]++;
+            if (asm_is_callee_saved((AsmReg)gc.color[p]))
+                fn->saved_regs |= 1u << gc.color[p];
+        }
+        else if (gc.remat[p])
+            stats->counts[STAT_RA_REMATERIALIZED]++;
+        else
+            stats->counts[STAT_RA_SPILLED]++;
+    }
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        AsmInstr *instr = &fn->instrs[i];
+        if (instr->op == ASM_MOV && instr->dst.kind == ASM_OPERAND_PSEUDO)
+        {
+            int node = get_alias(&gc, instr->dst.value);
+            if (gc.node_where[node] == NODE_SPILLED && gc.remat[node])
+            {
+                instr->op = ASM_NOP;
+                continue;
+            }
+        }
+        rewrite_operand(&gc, &instr->src);
+        rewrite_operand(&gc, &instr->dst);
+        rewrite_operand(&gc, &instr->index);
+        if (instr->op == ASM_MOV && asm_same_operand(instr->src, instr->dst))
+        {
+            instr->op = ASM_NOP;
+            stats->counts[STAT_RA_MOVES_REMOVED]++;
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        free(gc.adj[i].items);
+        free(gc.move_list[i].items);
+    }
+    for (int s = 0; s < NODE_SET_COUNT; s++)
+        free(gc.node_sets[s].items);
+    for (int s = 0; s < MOVE_SET_COUNT; s++)
+        free(gc.move_sets[s].items);
+    free(gc.matrix);
+    free(gc.edges);
+    free(gc.adj);
+    free(gc.move_list);
+    free(gc.degree);
+    free(gc.move_src);
+    free(gc.move_dst);
+    free(gc.node_where);
+    free(gc.node_pos);
+    free(gc.move_where);
+    free(gc.move_pos);
+    free(gc.alias);
+    free(gc.color);
+    free(gc.cost);
+    free(gc.def_count);
+    free(gc.remat);
+    free(gc.remat_value);
+    free(gc.stamp);
+    free(occurs);
+    asm_liveness_free(&live);
+}
+
+/**
+ * @brief Allocates registers for every function by iterated register coalescing.
+ * @param program The program after instruction selection.
+ * @param stats Receives allocation and coalescing counts.
+ */
+void regalloc_graph_color(AsmProgram *program, OptStats *stats)
+{
+    for (int f = 0; f < program->function_count; f++)
+    {
+        AsmFunction *fn = &program->functions[f];
+        if (fn->defined && fn->instr_count > 0)
+            allocate_function(fn, stats);
+    }
+}
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+#include "cfg.h"
+
+// --- Global Value Numbering ---
+// Dominator-scoped hashing: blocks are visited in a preorder walk of the
+// dominator tree, and every pure instruction is looked up in a table keyed by
+// its opcode and (already renumbered) operands. A hit means an identical value
+// was computed in a dominating block, so the instruction is deleted and its
+// result renamed to the earlier one. Table entries are popped when the walk
+// leaves the block that added them, so only dominating definitions are visible.
+//
+// Calls are never numbered since a callee may have effects. The IR has no
+// memory operations, so there are no loads to consider.
+
+//--- Expression Key ---
+typedef struct
+{
+    IrOpcode op;
+    IrValue a;
+    IrValue b;
+    IrValue result;     // Leader for the expression
+    int used;
+} GvnEntry;
+
+//--- Pass State ---
+typedef struct
+{
+    IrFunction *fn;
+    Cfg *cfg;
+    IrValue *leader;    // Temporary -> value replacing it, or the temporary itself
+    GvnEntry *table;
+    size_t table_mask;
+    int *undo;          // Table slots in insertion order
+    int undo_count;
+    int removed;
+} Gvn;
+
+/**
+ * @brief Checks whether swapping a binary operator's operands preserves its value.
+ * @param op The opcode.
+ * @return 1 for commutative operators.
+ */
+static int is_commutative(IrOpcode op)
+{
+    return op == IR_ADD || op == IR_MUL || op == IR_MUL_HIGH || op == IR_EQ || op == IR_NE;
+}
+
+/**
+ * @brief Orders two operands so that commutative expressions share one key.
+ * @param a The first operand.
+ * @param b The second operand.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compare_values(IrValue a, IrValue b)
+{
+    if (a.kind != b.kind) return (int)a.kind - (int)b.kind;
+    return a.value < b.value ? -1 : a.value > b.value;
+}
+
+/**
+ * @brief Hashes an expression key.
+ * @param op The opcode.
+ * @param a The first operand.
+ * @param b The second operand.
+ * @return The hash.
+ */
+static size_t hash_expr(IrOpcode op, IrValue a, IrValue b)
+{
+    uint64_t h = (uint64_t)op * 0x9E3779B97F4A7C15ULL;
+    h ^= ((uint64_t)a.kind << 32 | (uint32_t)a.value) + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+    h ^= ((uint64_t)b.kind << 32 | (uint32_t)b.value) + 0x85EBCA77C2B2AE63ULL + (h << 6) + (h >> 2);
+    return (size_t)(h ^ (h >> 29));
+}
+
+/**
+ * @brief Finds an expression's slot: either its entry or the empty slot it would use.
+ * @param g The pass state.
+ * @param op The opcode.
+ * @param a The first operand.
+ * @param b The second operand.
+ * @return The slot index.
+ */
+static size_t find_slot(const Gvn *g, IrOpcode op, IrValue a, IrValue b)
+{
+    size_t slot = hash_expr(op, a, b) & g->table_mask;
+    while (g->table[slot].used)
+    {
+        const GvnEntry *e = &g->table[slot];
+        if (e->op == op && compare_values(e->a, a) == 0 && compare_values(e->b, b) == 0)
+            break;
+        slot = (slot + 1) & g->table_mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Replaces an operand by its leader.
+ * @param g The pass state.
+ * @param v The operand to rewrite.
+ */
+static void renumber(const Gvn *g, IrValue *v)
+{
+    if (v->kind == IR_VAL_TEMP)
+        *v = g->leader[v->value];
+}
+
+/**
+ * @brief Records that a deleted instruction's result is another value.
+ * @param g The pass state.
+ * @param instr The instruction being deleted.
+ * @param value The value replacing its result.
+ */
+static void replace(Gvn *g, IrInstr *instr, IrValue value)
+{
+    g->leader[instr->dst.value] = value;
+    instr->op = IR_NOP;
+    g->removed++;
+}
+
+/**
+ * @brief Numbers one block's instructions against the dominating expressions.
+ * @param g The pass state.
+ * @param b The block.
+ * @param stats Counters to update.
+ */
+static void visit_block(Gvn *g, int b, OptStats *stats)
+{
+    IrFunction *fn = g->fn;
+    const BasicBlock *block = &g->cfg->blocks[b];
+
+    for (int i = block->start; i < block->end; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+
+        // A phi whose incoming values all agree (ignoring itself) is that value.
+        // Arguments from blocks not visited yet are compared by name.
+        if (instr->op == IR_PHI)
+        {
+            IrValue same = ir_none();
+            int trivial = 1;
+            for (int j = 0; j < instr->arg_count && trivial; j++)
+            {
+                IrValue arg = fn->args[instr->arg_start + j];
+                renumber(g, &arg);
+                if (arg.kind == IR_VAL_TEMP && arg.value == instr->dst.value) continue;
+                if (same.kind == IR_VAL_NONE)
+                    same = arg;
+                else if (compare_values(same, arg) != 0)
+                    trivial = 0;
+            }
+            if (trivial && same.kind != IR_VAL_NONE)
+            {
+                replace(g, instr, same);
+                stats->counts[STAT_GVN_PHIS_REMOVED]++;
+            }
+            continue;
+        }
+
+        int count = ir_use_count(instr);
+        for (int j = 0; j < count; j++)
+            renumber(g, ir_use(fn, instr, j));
+
+        if (!ir_is_unary(instr->op) && !ir_is_binary(instr->op))
+            continue;
+
+        IrOpcode op = instr->op;
+        IrValue a = instr->a;
+        IrValue b2 = ir_is_binary(op) ? instr->b : ir_none();
+
+        int32_t folded;
+        if (a.kind == IR_VAL_CONST && (b2.kind == IR_VAL_CONST || b2.kind == IR_VAL_NONE) &&
+            ir_fold(op, a.value, b2.value, &folded))
+        {
+            replace(g, instr, ir_const(folded));
+            stats->counts[STAT_GVN_REDUNDANT]++;
+            continue;
+        }
+
+        // Canonical form: a > b is b < a, and commutative operands are sorted.
+        if (op == IR_GT || op == IR_GE)
+        {
+            op = op == IR_GT ? IR_LT : IR_LE;
+            IrValue t = a; a = b2; b2 = t;
+        }
+        else if (is_commutative(op) && compare_values(a, b2) > 0)
+        {
+            IrValue t = a; a = b2; b2 = t;
+        }
+
+        size_t slot = find_slot(g, op, a, b2);
+        if (g->table[slot].used)
+        {
+            replace(g, instr, g->table[slot].result);
+            stats->counts[STAT_GVN_REDUNDANT]++;
+            continue;
+        }
+
+        GvnEntry *e = &g->table[slot];
+        e->op = op;
+        e->a = a;
+        e->b = b2;
+        e->result = instr->dst;
+        e->used = 1;
+        g->undo[g->undo_count++] = (int)slot;
+    }
+}
+
+/**
+ * @brief Eliminates redundant computations from a function in SSA form.
+ * @param ctx The function to optimize and its analyses.
+ * @return 1 if the function changed.
+ */
+int gvn_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    if (fn->instr_count == 0) return 0;
+
+    Gvn g;
+    memset(&g, 0, sizeof(Gvn));
+    g.fn = fn;
+    g.cfg = pass_dominators(ctx);
+
+    g.leader = malloc((fn->temp_count + 1) * sizeof(IrValue));
+    for (int t = 0; t < fn->temp_count; t++)
+        g.leader[t] = ir_temp(t);
+
+    // Entries are only ever popped in reverse insertion order, so clearing a
+    // slot cannot break the probe sequence of an entry still in the table.
+    size_t size = 16;
+    while (size < 2 * (size_t)fn->instr_count)
+        size *= 2;
+    g.table = calloc(size, sizeof(GvnEntry));
+    g.table_mask = size - 1;
+    g.undo = malloc((fn->instr_count + 1) * sizeof(int));
+
+    // Iterative dominator tree walk; a negative entry marks leaving block ~b.
+    int n = g.cfg->block_count;
+    int *stack = malloc((2 * (size_t)n + 1) * sizeof(int));
+    int *scope = malloc((n + 1) * sizeof(int));
+    int depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0)
+    {
+        int b = stack[--depth];
+        if (b < 0)
+        {
+            b = ~b;
+            while (g.undo_count > scope[b])
+                g.table[g.undo[--g.undo_count]].used = 0;
+            continue;
+        }
+
+        scope[b] = g.undo_count;
+        visit_block(&g, b, ctx->stats);
+        stack[depth++] = ~b;
+        for (int c = g.cfg->dom_child_start[b + 1] - 1; c >= g.cfg->dom_child_start[b]; c--)
+            stack[depth++] = g.cfg->dom_children[c];
+    }
+
+    // Phi arguments flow in from predecessors, some of which were visited after
+    // the phi's block, so they are renamed once every leader is known.
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+        if (instr->op != IR_PHI) continue;
+        for (int j = 0; j < instr->arg_count; j++)
+        {
+            IrValue *arg = &fn->args[instr->arg_start + j];
+            while (arg->kind == IR_VAL_TEMP && compare_values(g.leader[arg->value], *arg) != 0)
+                *arg = g.leader[arg->value];
+        }
+    }
+    if (g.removed > 0)
+        ir_compact(fn);
+
+    free(scope);
+    free(stack);
+    free(g.undo);
+    free(g.table);
+    free(g.leader);
+    return g.removed > 0;
+}
@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// --- Inliner ---
+// Runs on the whole program before the per-function pipeline, while functions
+// are still in plain (non-SSA) form. Strongly connected components of the call
+// graph are found with Tarjan's algorithm, which emits them callees first, so
+// by the time a function is considered its callees have already received
+// their own inlining and their size is final. Calls inside one component are
+// recursive and never inlined. The constant propagation that follows in the
+// pipeline then specializes each inlined body to its arguments.
+//
+// Under -fprofile-use, callers the training run never entered are left alone,
+// and callees entered at least 1/INLINE_HOT_FRACTION as often as the hottest
+// function get INLINE_HOT_BUDGET_SCALE times the budget.
+
+// A caller stops growing once it reaches this many instructions.
+#define INLINE_MAX_CALLER_SIZE 20000
+
+#define INLINE_HOT_FRACTION 10
+#define INLINE_HOT_BUDGET_SCALE 4
+
+//--- Call Graph ---
+typedef struct
+{
+    const IrProgram *program;
+    int *edge_start;    // Callees of f: edges[edge_start[f] .. edge_start[f + 1])
+    int *edges;
+    int *scc;           // Function -> component number, in completion order
+    int scc_count;
+} CallGraph;
+
+/**
+ * @brief Builds the call graph's adjacency lists from the call instructions.
+ * @param g The call graph to fill.
+ */
+static void build_edges(CallGraph *g)
+{
+    const IrProgram *program = g->program;
+    int n = program->function_count;
+    g->edge_start = calloc(n + 2, sizeof(int));
+    for (int f = 0; f < n; f++)
+    {
+        const IrFunction *fn = &program->functions[f];
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            if (fn->instrs[i].op == IR_CALL)
+                g->edge_start[f + 1]++;
+        }
+    }
+    for (int f = 0; f < n; f++)
+        g->edge_start[f + 1] += g->edge_start[f];
+
+    g->edges = malloc((g->edge_start[n] + 1) * sizeof(int));
+    int count = 0;
+    for (int f = 0; f < n; f++)
+    {
+        const IrFunction *fn = &program->functions[f];
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            if (fn->instrs[i].op == IR_CALL)
+                g->edges[count++] = fn->instrs[i].callee;
+        }
+    }
+}
+
+/**
+ * @brief Numbers the call graph's strongly connected components with Tarjan's algorithm.
+ *
+ * Iterative, so deep call chains cannot overflow the C stack. Components are
+ * numbered in the order they complete, which puts every callee's component
+ * at or before its callers'.
+ *
+ * @param g The call graph with edges built.
+ */
+static void find_sccs(CallGraph *g)
+{
+    int n = g->program->function_count;
+    int *index = malloc((n + 1) * sizeof(int));
+    int *lowlink = malloc((n + 1) * sizeof(int));
+    unsigned char *on_stack = calloc(n + 1, 1);
+    int *stack = malloc((n + 1) * sizeof(int));
+    int *call_stack = malloc((n + 1) * sizeof(int));
+    int *next_edge = malloc((n + 1) * sizeof(int));
+    g->scc = malloc((n + 1) * sizeof(int));
+    for (int f = 0; f < n; f++)
+        index[f] = -1;
+
+    int counter = 0, depth = 0;
+    for (int root = 0; root < n; root++)
+    {
+        if (index[root] >= 0) continue;
+        int calls = 0;
+        call_stack[calls++] = root;
+        index[root] = lowlink[root] = counter++;
+        next_edge[root] = g->edge_start[root];
+        stack[depth++] = root;
+        on_stack[root] = 1;
+
+        while (calls > 0)
+        {
+            int f = call_stack[calls - 1];
+            if (next_edge[f] < g->edge_start[f + 1])
+            {
+                int callee = g->edges[next_edge[f]++];
+                if (index[callee] < 0)
+                {
+                    index[callee] = lowlink[callee] = counter++;
+                    next_edge[callee] = g->edge_start[callee];
+                    stack[depth++] = callee;
+                    on_stack[callee] = 1;
+                    call_stack[calls++] = callee;
+                }
+                else if (on_stack[callee] && index[callee] < lowlink[f])
+                    lowlink[f] = index[callee];
+                continue;
+            }
+
+            calls--;
+            if (calls > 0 && lowlink[f] < lowlink[call_stack[calls - 1]])
+                lowlink[call_stack[calls - 1]] = lowlink[f];
+            if (lowlink[f] == index[f])
+            {
+                int member;
+                do
+                {
+                    member = stack[--depth];
+                    on_stack[member] = 0;
+                    g->scc[member] = g->scc_count;
+                } while (member != f);
+                g->scc_count++;
+            }
+        }
+    }
+
+    free(next_edge);
+    free(call_stack);
+    free(stack);
+    free(on_stack);
+    free(lowlink);
+    free(index);
+}
+
+/**
+ * @brief Estimates the cost of inlining a function as the size of its body.
+ * @param fn The callee.
+ * @return The number of instructions other than labels.
+ */
+static int inline_cost(const IrFunction *fn)
+{
+    int cost = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (fn->instrs[i].op != IR_LABEL && fn->instrs[i].op != IR_NOP)
+            cost++;
+    }
+    return cost;
+}
+
+/**
+ * @brief Appends a copy of a callee's body in place of a call.
+ *
+ * Callee temporaries and labels are shifted past the caller's own, parameters
+ * are initialized from the arguments, and every return becomes a copy into
+ * the call's result followed by a jump past the inlined body.
+ *
+ * @param fn The caller, whose instruction array is being rebuilt.
+ * @param call The call instruction (a copy, since fn->instrs may move).
+ * @param call_args The call's arguments (a copy, since fn->args may move).
+ * @param callee The function being inlined.
+ */
+static void expand_call(IrFunction *fn, const IrInstr *call, const IrValue *call_args, const IrFunction *callee)
+{
+    int temp_base = fn->temp_count;
+    int label_base = fn->label_count;
+    fn->temp_count += callee->temp_count;
+    fn->label_count += callee->label_count;
+    int done = ir_new_label(fn);
+    IrValue result = call->dst;
+
+    for (int p = 0; p < callee->param_count; p++)
+        ir_emit(fn, IR_COPY, ir_temp(temp_base + p), call_args[p], ir_none());
+
+    for (int i = 0; i < callee->instr_count; i++)
+    {
+        IrInstr instr = callee->instrs[i];
+        if (instr.op == IR_NOP) continue;
+
+        if (instr.dst.kind == IR_VAL_TEMP) instr.dst.value += temp_base;
+        if (instr.a.kind == IR_VAL_TEMP) instr.a.value += temp_base;
+        if (instr.b.kind == IR_VAL_TEMP) instr.b.value += temp_base;
+
+        if (instr.op == IR_RETURN)
+        {
+            IrValue value = instr.a.kind == IR_VAL_NONE ? ir_const(0) : instr.a;
+            if (result.kind == IR_VAL_TEMP)
+                ir_emit(fn, IR_COPY, result, value, ir_none());
+            ir_emit_jump(fn, IR_JUMP, ir_none(), done);
+            continue;
+        }
+        if (instr.op == IR_LABEL || ir_is_jump(instr.op))
+            instr.label += label_base;
+        if (instr.op == IR_CALL)
+        {
+            int start = ir_alloc_args(fn, instr.arg_count);
+            for (int j = 0; j < instr.arg_count; j++)
+            {
+                IrValue arg = callee->args[instr.arg_start + j];
+                if (arg.kind == IR_VAL_TEMP) arg.value += temp_base;
+                fn->args[start + j] = arg;
+            }
+            instr.arg_start = start;
+        }
+
+        IrInstr *copy = ir_emit(fn, instr.op, instr.dst, instr.a, instr.b);
+        *copy = instr;
+    }
+
+    // Falling off the end of the callee returns 0.
+    int last = callee->instr_count - 1;
+    while (last >= 0 && callee->instrs[last].op == IR_NOP)
+        last--;
+    if (last < 0 || !ir_is_terminator(callee->instrs[last].op))
+    {
+        if (result.kind == IR_VAL_TEMP)
+            ir_emit(fn, IR_COPY, result, ir_const(0), ir_none());
+    }
+    ir_emit_label(fn, done);
+}
+
+/**
+ * @brief Inlines the eligible calls of one function.
+ * @param program The program.
+ * @param g The call graph.
+ * @param f The caller's index.
+ * @param budget The largest callee cost that is inlined.
+ * @param hottest The highest function entry count in the profile, or 0 without one.
+ * @param remarks Where to report decisions, or NULL.
+ * @param stats Counters to update.
+ */
+static void inline_calls(IrProgram *program, const CallGraph *g, int f, int budget, uint64_t hottest, FILE *remarks,
+                         OptStats *stats)
+{
+    IrFunction *fn = &program->functions[f];
+    IrInstr *old = fn->instrs;
+    int old_count = fn->instr_count;
+    fn->instrs = NULL;
+    fn->instr_count = 0;
+    fn->instr_capacity = 0;
+
+    for (int i = 0; i < old_count; i++)
+    {
+        const IrInstr *instr = &old[i];
+        if (instr->op != IR_CALL)
+        {
+            IrInstr *copy = ir_emit(fn, instr->op, instr->dst, instr->a, instr->b);
+            *copy = *instr;
+            continue;
+        }
+
+        const IrFunction *callee = &program->functions[instr->callee];
+        int cost = callee->defined ? inline_cost(callee) : 0;
+        int limit = budget;
+        if (hottest > 0 && callee->entry_count * INLINE_HOT_FRACTION >= hottest)
+            limit = budget * INLINE_HOT_BUDGET_SCALE;
+        const char *reason = NULL;
+        if (!callee->defined)
+            reason = "no definition";
+        else if (g->scc[instr->callee] == g->scc[f])
+            reason = "recursive";
+        else if (hottest > 0 && fn->entry_count == 0)
+            reason = "caller never ran";
+        else if (cost > limit)
+            reason = "too large";
+        else if (fn->instr_count + (old_count - i) + cost > INLINE_MAX_CALLER_SIZE)
+            reason = "caller too large";
+
+        if (reason)
+        {
+            IrInstr *copy = ir_emit(fn, instr->op, instr->dst, instr->a, instr->b);
+            *copy = *instr;
+            stats->counts[STAT_INLINE_REJECTED]++;
+            if (remarks)
+                fprintf(remarks, "inline: not inlining %s into %s (cost %d, budget %d): %s\n",
+                        callee->name, fn->name, cost, limit, reason);
+            continue;
+        }
+
+        IrValue *args = malloc((instr->arg_count + 1) * sizeof(IrValue));
+        if (instr->arg_count > 0)
+            memcpy(args, fn->args + instr->arg_start, instr->arg_count * sizeof(IrValue));
+        expand_call(fn, instr, args, callee);
+        free(args);
+        stats->counts[STAT_INLINED]++;
+        if (remarks)
+            fprintf(remarks, "inline: inlined %s into %s (cost %d, budget %d)\n", callee->name, fn->name, cost, limit);
+    }
+    free(old);
+}
+
+/**
+ * @brief Inlines small callees into their callers across the whole program.
+ * @param program The program, outside SSA form.
+ * @param budget The largest callee size, in instructions, that is inlined.
+ * @param remarks Where to report each decision, or NULL.
+ * @param stats Counters to update.
+ */
+void inline_program(IrProgram *program, int budget, FILE *remarks, OptStats *stats)
+{
+    CallGraph g;
+    memset(&g, 0, sizeof(CallGraph));
+    g.program = program;
+    build_edges(&g);
+    find_sccs(&g);
+
+    // Visit functions component by component, callees first.
+    int n = program->function_count;
+    int *order = malloc((n + 1) * sizeof(int));
+    int *fill = calloc(g.scc_count + 1, sizeof(int));
+    for (int f = 0; f < n; f++)
+        fill[g.scc[f] + 1]++;
+    for (int c = 0; c < g.scc_count; c++)
+        fill[c + 1] += fill[c];
+    for (int f = 0; f < n; f++)
+        order[fill[g.scc[f]]++] = f;
+
+    uint64_t hottest = 0;
+    for (int f = 0; f < n && program->profile; f++)
+    {
+        if (program->functions[f].entry_count > hottest)
+            hottest = program->functions[f].entry_count;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (program->functions[order[i]].defined)
+            inline_calls(program, &g, order[i], budget, hottest, remarks, stats);
+    }
+
+    free(fill);
+    free(order);
+    free(g.scc);
+    free(g.edges);
+    free(g.edge_start);
+}
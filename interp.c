@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interp.h"
+
+#define MAX_CALL_DEPTH (1 << 20)
+
+// --- Decoded Form ---
+// Before running, every function is decoded into a compact array where each
+// operand is an index into the frame's register file. The file holds the
+// function's temporaries followed by one slot per constant operand, so no
+// instruction handler ever has to test whether an operand is a constant.
+// Labels and nops disappear and jump targets become instruction indices.
+
+//--- Decoded Instruction ---
+typedef struct
+{
+    int32_t op;
+    int32_t dst;
+    int32_t a;      // IR_CALL: first argument in arg_regs
+    int32_t b;      // IR_CALL: argument count
+    int32_t target; // Jumps: instruction index; IR_CALL: callee index
+} InterpInsn;
+
+//--- Decoded Function ---
+typedef struct
+{
+    InterpInsn *code;
+    int code_count;
+    int32_t *arg_regs;   // Register indices of call arguments
+    int32_t *constants;  // Initial values of the constant slots
+    int constant_count;
+    int temp_count;
+    int frame_size;      // temp_count + constant_count
+    int param_count;
+    int defined;
+    const char *name;
+} InterpFunction;
+
+//--- Call Frame ---
+typedef struct
+{
+    int function;
+    size_t base;          // Offset of the frame's registers in the register stack
+    const InterpInsn *return_pc;
+    int32_t return_dst;   // Caller register receiving the result
+} InterpFrame;
+
+/**
+ * @brief Maps an IR operand to a register index, allocating a constant slot if needed.
+ * @param df The function being decoded.
+ * @param value The operand.
+ * @return The register index.
+ */
+static int32_t decode_operand(InterpFunction *df, IrValue value)
+{
+    if (value.kind == IR_VAL_TEMP)
+        return value.value;
+    if (value.kind == IR_VAL_CONST)
+    {
+        df->constants[df->constant_count] = value.value;
+        return df->temp_count + df->constant_count++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes one IR function into register-file form.
+ * @param df The decoded function to fill.
+ * @param fn The IR function.
+ */
+static void decode_function(InterpFunction *df, const IrFunction *fn)
+{
+    memset(df, 0, sizeof(InterpFunction));
+    df->name = fn->name;
+    df->defined = fn->defined;
+    df->param_count = fn->param_count;
+    df->temp_count = fn->temp_count;
+    if (!fn->defined) return;
+
+    // Every instruction has at most two source operands, plus call arguments,
+    // plus the implicit `return 0` that may be appended below. A call without
+    // a result uses one of its two unused slots as a scratch register.
+    df->constants = malloc((2 * (size_t)fn->instr_count + fn->arg_count + 1) * sizeof(int32_t));
+    df->code = malloc(((size_t)fn->instr_count + 1) * sizeof(InterpInsn));
+    df->arg_regs = malloc(((size_t)fn->arg_count + 1) * sizeof(int32_t));
+
+    int *label_pc = malloc(((size_t)fn->label_count + 1) * sizeof(int));
+    int pc = 0;
+    int label_at_end = 0;   // Some label has no instruction after it
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (fn->instrs[i].op == IR_LABEL)
+        {
+            label_pc[fn->instrs[i].label] = pc;
+            label_at_end = 1;
+        }
+        else if (fn->instrs[i].op != IR_NOP)
+        {
+            pc++;
+            label_at_end = 0;
+        }
+    }
+
+    int arg_count = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        const IrInstr *instr = &fn->instrs[i];
+        if (instr->op == IR_LABEL || instr->op == IR_NOP) continue;
+
+        InterpInsn *insn = &df->code[df->code_count++];
+        insn->op = instr->op;
+        insn->dst = instr->dst.kind == IR_VAL_TEMP ? instr->dst.value : 0;
+
+        if (instr->op == IR_CALL)
+        {
+            insn->a = arg_count;
+            insn->b = instr->arg_count;
+            insn->target = instr->callee;
+            if (instr->dst.kind != IR_VAL_TEMP)
+                insn->dst = decode_operand(df, ir_const(0));
+            for (int j = 0; j < instr->arg_count; j++)
+                df->arg_regs[arg_count++] = decode_operand(df, fn->args[instr->arg_start + j]);
+            continue;
+        }
+
+        insn->a = decode_operand(df, instr->a);
+        insn->b = decode_operand(df, instr->b);
+        if (ir_is_jump(instr->op))
+            insn->target = label_pc[instr->label];
+    }
+    free(label_pc);
+
+    // Falling off the end of a function, or jumping to a label at its end, returns 0.
+    if (df->code_count == 0 || label_at_end || !ir_is_terminator(df->code[df->code_count - 1].op))
+    {
+        InterpInsn *insn = &df->code[df->code_count++];
+        memset(insn, 0, sizeof(InterpInsn));
+        insn->op = IR_RETURN;
+        insn->a = decode_operand(df, ir_const(0));
+    }
+
+    df->frame_size = df->temp_count + df->constant_count;
+}
+
+/**
+ * @brief Executes a program's IR directly, starting at main.
+ *
+ * The program must be out of SSA form (no IR_PHI). Dispatch is threaded through a table of label addresses when the compiler
+ * supports computed goto (GCC, Clang) and falls back to a switch otherwise.
+ * Arithmetic wraps like the two's-complement code the backend emits.
+ *
+ * @param program The program to run.
+ * @param exit_code Receives main's return value.
+ * @return 0 on success, -1 on a runtime error (reported on stderr).
+ */
+int ir_interpret(const IrProgram *program, int *exit_code)
+{
+    int main_index = ir_find_function(program, "main");
+    if (main_index < 0 || !program->functions[main_index].defined)
+    {
+        fprintf(stderr, "Runtime error: no definition of main\n");
+        return -1;
+    }
+
+    InterpFunction *functions = malloc(program->function_count * sizeof(InterpFunction));
+    for (int i = 0; i < program->function_count; i++)
+        decode_function(&functions[i], &program->functions[i]);
+
+    size_t reg_capacity = 1024;
+    int32_t *reg_stack = malloc(reg_capacity * sizeof(int32_t));
+    int frame_capacity = 64;
+    InterpFrame *frames = malloc(frame_capacity * sizeof(InterpFrame));
+    int frame_count = 0;
+    int status = 0;
+
+    const InterpFunction *df = &functions[main_index];
+    frames[frame_count++] = (InterpFrame){main_index, 0, NULL, 0};
+    while ((size_t)df->frame_size > reg_capacity)
+        reg_capacity *= 2;
+    reg_stack = realloc(reg_stack, reg_capacity * sizeof(int32_t));
+    memcpy(reg_stack + df->temp_count, df->constants, df->constant_count * sizeof(int32_t));
+
+    int32_t *regs = reg_stack;
+    const InterpInsn *pc = df->code;
+    int32_t result = 0;
+
+#if defined(__GNUC__)
+#define TARGET(op) L_##op:
+#define DISPATCH() goto *dispatch_table[pc->op]
+    static void *dispatch_table[IR_OPCODE_COUNT] = {
+        [IR_NOP] = &&L_bad_opcode,
+        [IR_RETURN] = &&L_IR_RETURN,
+        [IR_COPY] = &&L_IR_COPY,
+        [IR_NEGATE] = &&L_IR_NEGATE,
+        [IR_COMPLEMENT] = &&L_IR_COMPLEMENT,
+        [IR_NOT] = &&L_IR_NOT,
+        [IR_ADD] = &&L_IR_ADD,
+        [IR_SUB] = &&L_IR_SUB,
+        [IR_MUL] = &&L_IR_MUL,
+        [IR_DIV] = &&L_IR_DIV,
+        [IR_REM] = &&L_IR_REM,
+        [IR_MUL_HIGH] = &&L_IR_MUL_HIGH,
+        [IR_SAR] = &&L_IR_SAR,
+        [IR_SHR] = &&L_IR_SHR,
+        [IR_EQ] = &&L_IR_EQ,
+        [IR_NE] = &&L_IR_NE,
+        [IR_LT] = &&L_IR_LT,
+        [IR_LE] = &&L_IR_LE,
+        [IR_GT] = &&L_IR_GT,
+        [IR_GE] = &&L_IR_GE,
+        [IR_JUMP] = &&L_IR_JUMP,
+        [IR_JUMP_IF_ZERO] = &&L_IR_JUMP_IF_ZERO,
+        [IR_JUMP_IF_NOT_ZERO] = &&L_IR_JUMP_IF_NOT_ZERO,
+        [IR_LABEL] = &&L_bad_opcode,
+        [IR_CALL] = &&L_IR_CALL,
+        [IR_PHI] = &&L_bad_opcode,
+    };
+    DISPATCH();
+#else
+#define TARGET(op) case op:
+#define DISPATCH() goto dispatch
+dispatch:
+    switch (pc->op)
+    {
+#endif
+
+    TARGET(IR_COPY)
+        regs[pc->dst] = regs[pc->a];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_NEGATE)
+        regs[pc->dst] = (int32_t)(0u - (uint32_t)regs[pc->a]);
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_COMPLEMENT)
+        regs[pc->dst] = ~regs[pc->a];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_NOT)
+        regs[pc->dst] = !regs[pc->a];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_ADD)
+        regs[pc->dst] = (int32_t)((uint32_t)regs[pc->a] + (uint32_t)regs[pc->b]);
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_SUB)
+        regs[pc->dst] = (int32_t)((uint32_t)regs[pc->a] - (uint32_t)regs[pc->b]);
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_MUL)
+        regs[pc->dst] = (int32_t)((uint32_t)regs[pc->a] * (uint32_t)regs[pc->b]);
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_DIV)
+        if (regs[pc->b] == 0 || (regs[pc->a] == INT32_MIN && regs[pc->b] == -1))
+            goto L_arith_error;
+        regs[pc->dst] = regs[pc->a] / regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_REM)
+        if (regs[pc->b] == 0 || (regs[pc->a] == INT32_MIN && regs[pc->b] == -1))
+            goto L_arith_error;
+        regs[pc->dst] = regs[pc->a] % regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_MUL_HIGH)
+        regs[pc->dst] = (int32_t)(((int64_t)regs[pc->a] * regs[pc->b]) >> 32);
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_SAR)
+        regs[pc->dst] = regs[pc->a] >> (regs[pc->b] & 31);
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_SHR)
+        regs[pc->dst] = (int32_t)((uint32_t)regs[pc->a] >> (regs[pc->b] & 31));
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_EQ)
+        regs[pc->dst] = regs[pc->a] == regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_NE)
+        regs[pc->dst] = regs[pc->a] != regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_LT)
+        regs[pc->dst] = regs[pc->a] < regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_LE)
+        regs[pc->dst] = regs[pc->a] <= regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_GT)
+        regs[pc->dst] = regs[pc->a] > regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_GE)
+        regs[pc->dst] = regs[pc->a] >= regs[pc->b];
+        pc++;
+        DISPATCH();
+
+    TARGET(IR_JUMP)
+        pc = df->code + pc->target;
+        DISPATCH();
+
+    TARGET(IR_JUMP_IF_ZERO)
+        pc = regs[pc->a] == 0 ? df->code + pc->target : pc + 1;
+        DISPATCH();
+
+    TARGET(IR_JUMP_IF_NOT_ZERO)
+        pc = regs[pc->a] != 0 ? df->code + pc->target : pc + 1;
+        DISPATCH();
+
+    TARGET(IR_CALL)
+    {
+        const InterpFunction *callee = &functions[pc->target];
+        if (!callee->defined)
+        {
+            fprintf(stderr, "Runtime error: call to undefined function '%s'\n", callee->name);
+            status = -1;
+            goto L_done;
+        }
+        if (frame_count == MAX_CALL_DEPTH)
+        {
+            fprintf(stderr, "Runtime error: call stack overflow in '%s'\n", callee->name);
+            status = -1;
+            goto L_done;
+        }
+        if (frame_count == frame_capacity)
+        {
+            frame_capacity *= 2;
+            frames = realloc(frames, frame_capacity * sizeof(InterpFrame));
+        }
+
+        size_t base = frames[frame_count - 1].base + df->frame_size;
+        if (base + callee->frame_size > reg_capacity)
+        {
+            size_t caller_base = frames[frame_count - 1].base;
+            while (base + callee->frame_size > reg_capacity)
+                reg_capacity *= 2;
+            reg_stack = realloc(reg_stack, reg_capacity * sizeof(int32_t));
+            regs = reg_stack + caller_base;
+        }
+
+        int32_t *callee_regs = reg_stack + base;
+        for (int i = 0; i < pc->b && i < callee->param_count; i++)
+            callee_regs[i] = regs[df->arg_regs[pc->a + i]];
+        memcpy(callee_regs + callee->temp_count, callee->constants, callee->constant_count * sizeof(int32_t));
+
+        frames[frame_count++] = (InterpFrame){pc->target, base, pc + 1, pc->dst};
+        df = callee;
+        regs = callee_regs;
+        pc = callee->code;
+        DISPATCH();
+    }
+
+    TARGET(IR_RETURN)
+    {
+        result = regs[pc->a];
+        InterpFrame *frame = &frames[--frame_count];
+        if (frame_count == 0)
+            goto L_done;
+
+        InterpFrame *caller = &frames[frame_count - 1];
+        df = &functions[caller->function];
+        regs = reg_stack + caller->base;
+        regs[frame->return_dst] = result;
+        pc = frame->return_pc;
+        DISPATCH();
+    }
+
+#if !defined(__GNUC__)
+    default:
+        goto L_bad_opcode;
+    }
+#endif
+
+L_bad_opcode:
+    fprintf(stderr, "Runtime error: invalid opcode %s in '%s'\n", ir_opcode_name(pc->op), df->name);
+    status = -1;
+    goto L_done;
+
+L_arith_error:
+    fprintf(stderr, "Runtime error: integer division overflow or division by zero in '%s'\n", df->name);
+    status = -1;
+
+L_done:
+#undef TARGET
+#undef DISPATCH
+    if (status == 0)
+        *exit_code = result;
+
+    for (int i = 0; i < program->function_count; i++)
+    {
+        free(functions[i].code);
+        free(functions[i].arg_regs);
+        free(functions[i].constants);
+    }
+    free(functions);
+    free(frames);
+    free(reg_stack);
+    return status;
+}
@@ -0,0 +1,8 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+#include "ir.h"
+
+int ir_interpret(const IrProgram *program, int *exit_code);
+
+#endif
@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir.h"
+
+// --- Opcode Properties ---
+
+/**
+ * @brief Turns an opcode into the mnemonic used by the IR dump.
+ * @param op The opcode to convert.
+ * @return A pointer to the mnemonic.
+ */
+const char *ir_opcode_name(IrOpcode op)
+{
+    switch (op)
+    {
+        case IR_NOP: return "nop";
+        case IR_RETURN: return "return";
+        case IR_COPY: return "copy";
+        case IR_NEGATE: return "neg";
+        case IR_COMPLEMENT: return "not";
+        case IR_NOT: return "lnot";
+        case IR_ADD: return "add";
+        case IR_SUB: return "sub";
+        case IR_MUL: return "mul";
+        case IR_DIV: return "div";
+        case IR_REM: return "rem";
+        case IR_MUL_HIGH: return "mulh";
+        case IR_SAR: return "sar";
+        case IR_SHR: return "shr";
+        case IR_EQ: return "eq";
+        case IR_NE: return "ne";
+        case IR_LT: return "lt";
+        case IR_LE: return "le";
+        case IR_GT: return "gt";
+        case IR_GE: return "ge";
+        case IR_JUMP: return "jump";
+        case IR_JUMP_IF_ZERO: return "jz";
+        case IR_JUMP_IF_NOT_ZERO: return "jnz";
+        case IR_LABEL: return "label";
+        case IR_CALL: return "call";
+        case IR_PHI: return "phi";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Checks whether an opcode computes dst from the single operand a.
+ * @param op The opcode to check.
+ * @return 1 for unary operations, 0 otherwise.
+ */
+int ir_is_unary(IrOpcode op)
+{
+    return op == IR_NEGATE || op == IR_COMPLEMENT || op == IR_NOT;
+}
+
+/**
+ * @brief Checks whether an opcode computes dst from operands a and b.
+ * @param op The opcode to check.
+ * @return 1 for binary operations, 0 otherwise.
+ */
+int ir_is_binary(IrOpcode op)
+{
+    return op >= IR_ADD && op <= IR_GE;
+}
+
+/**
+ * @brief Checks whether an opcode transfers control to a label.
+ * @param op The opcode to check.
+ * @return 1 for conditional and unconditional jumps, 0 otherwise.
+ */
+int ir_is_jump(IrOpcode op)
+{
+    return op == IR_JUMP || op == IR_JUMP_IF_ZERO || op == IR_JUMP_IF_NOT_ZERO;
+}
+
+/**
+ * @brief Checks whether control never falls through to the next instruction.
+ * @param op The opcode to check.
+ * @return 1 for IR_JUMP and IR_RETURN, 0 otherwise.
+ */
+int ir_is_terminator(IrOpcode op)
+{
+    return op == IR_JUMP || op == IR_RETURN;
+}
+
+/**
+ * @brief Checks whether a call is in tail position: the next instruction other than a nop returns its result.
+ *
+ * Tail recursion elimination and the backend's tail calls both use this, so
+ * they agree on what tail position means.
+ *
+ * @param fn The function.
+ * @param i The instruction.
+ * @return The index of the return, or -1 if the instruction is not a call in tail position.
+ */
+int ir_tail_return(const IrFunction *fn, int i)
+{
+    const IrInstr *call = &fn->instrs[i];
+    if (call->op != IR_CALL || call->dst.kind != IR_VAL_TEMP)
+        return -1;
+    int j = i + 1;
+    while (j < fn->instr_count && fn->instrs[j].op == IR_NOP)
+        j++;
+    if (j == fn->instr_count) return -1;
+    const IrInstr *ret = &fn->instrs[j];
+    if (ret->op != IR_RETURN || ret->a.kind != IR_VAL_TEMP || ret->a.value != call->dst.value)
+        return -1;
+    return j;
+}
+
+/**
+ * @brief Counts the source operands of an instruction, for use with ir_use.
+ * @param instr The instruction.
+ * @return The number of operand slots the instruction reads.
+ */
+int ir_use_count(const IrInstr *instr)
+{
+    if (instr->op == IR_CALL || instr->op == IR_PHI)
+        return instr->arg_count;
+    if (ir_is_binary(instr->op))
+        return 2;
+    if (ir_is_unary(instr->op) || instr->op == IR_COPY || instr->op == IR_RETURN || 
+        instr->op == IR_JUMP_IF_ZERO || instr->op == IR_JUMP_IF_NOT_ZERO)
+        return 1;
+    return 0;
+}
+
+/**
+ * @brief Returns a source operand slot of an instruction, so passes can read or rewrite it.
+ * @param fn The function owning the instruction (and its argument pool).
+ * @param instr The instruction.
+ * @param index The operand index, below ir_use_count(instr).
+ * @return A pointer to the operand slot.
+ */
+IrValue *ir_use(IrFunction *fn, IrInstr *instr, int index)
+{
+    if (instr->op == IR_CALL || instr->op == IR_PHI)
+        return &fn->args[instr->arg_start + index];
+    return index == 0 ? &instr->a : &instr->b;
+}
+
+/**
+ * @brief Evaluates a unary, binary or copy operation on constants.
+ *
+ * Arithmetic wraps in two's complement, matching the interpreter and the code
+ * the backend emits. Division and remainder by zero, or of INT32_MIN by -1,
+ * are left unfolded so the fault still happens at run time.
+ *
+ * @param op The opcode.
+ * @param a The first operand.
+ * @param b The second operand (ignored by unary operations and IR_COPY).
+ * @param result Receives the value.
+ * @return 1 if the operation was folded, 0 otherwise.
+ */
+int ir_fold(IrOpcode op, int32_t a, int32_t b, int32_t *result)
+{
+    uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+    switch (op)
+    {
+        case IR_COPY: *result = a; return 1;
+        case IR_NEGATE: *result = (int32_t)(0u - ua); return 1;
+        case IR_COMPLEMENT: *result = ~a; return 1;
+        case IR_NOT: *result = !a; return 1;
+        case IR_ADD: *result = (int32_t)(ua + ub); return 1;
+        case IR_SUB: *result = (int32_t)(ua - ub); return 1;
+        case IR_MUL: *result = (int32_t)(ua * ub); return 1;
+        case IR_DIV:
+        case IR_REM:
+            if (b == 0 || (a == INT32_MIN && b == -1))
+                return 0;
+            *result = op == IR_DIV ? a / b : a % b;
+            return 1;
+        case IR_MUL_HIGH: *result = (int32_t)(((int64_t)a * b) >> 32); return 1;
+        case IR_SAR: *result = a >> (ub & 31); return 1;
+        case IR_SHR: *result = (int32_t)(ua >> (ub & 31)); return 1;
+        case IR_EQ: *result = a == b; return 1;
+        case IR_NE: *result = a != b; return 1;
+        case IR_LT: *result = a < b; return 1;
+        case IR_LE: *result = a <= b; return 1;
+        case IR_GT: *result = a > b; return 1;
+        case IR_GE: *result = a >= b; return 1;
+        default: return 0;
+    }
+}
+
+// --- Construction ---
+
+/**
+ * @brief Allocates an empty IR program.
+ * @return A pointer to the new program.
+ */
+IrProgram *ir_program_new(void)
+{
+    return calloc(1, sizeof(IrProgram));
+}
+
+/**
+ * @brief Frees an IR program and every function in it.
+ * @param program The program to free. May be NULL.
+ */
+void ir_program_free(IrProgram *program)
+{
+    if (!program) return;
+    for (int i = 0; i < program->function_count; i++)
+    {
+        free(program->functions[i].name);
+        free(program->functions[i].instrs);
+        free(program->functions[i].args);
+        free(program->functions[i].arg_labels);
+    }
+    free(program->functions);
+    free(program->profile);
+    free(program);
+}
+
+/**
+ * @brief Appends a new, empty function to a program.
+ *
+ * Growing the function array may move it, so pointers returned by earlier calls
+ * must be re-fetched through program->functions afterwards.
+ *
+ * @param program The program to extend.
+ * @param name The function name. The string is copied.
+ * @param param_count The number of parameters; they occupy the first temporaries.
+ * @return A pointer to the new function.
+ */
+IrFunction *ir_add_function(IrProgram *program, const char *name, int param_count)
+{
+    if (program->function_count == program->function_capacity)
+    {
+        program->function_capacity = program->function_capacity ? program->function_capacity * 2 : 8;
+        program->functions = realloc(program->functions, program->function_capacity * sizeof(IrFunction));
+    }
+
+    IrFunction *fn = &program->functions[program->function_count++];
+    memset(fn, 0, sizeof(IrFunction));
+    fn->name = strdup(name);
+    fn->param_count = param_count;
+    fn->temp_count = param_count;
+    return fn;
+}
+
+/**
+ * @brief Looks up a function by name.
+ * @param program The program to search.
+ * @param name The function name.
+ * @return The function's index, or -1 if there is none.
+ */
+int ir_find_function(const IrProgram *program, const char *name)
+{
+    for (int i = 0; i < program->function_count; i++)
+    {
+        if (strcmp(program->functions[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Allocates the next dense temporary number.
+ * @param fn The function owning the temporary.
+ * @return The temporary number.
+ */
+int ir_new_temp(IrFunction *fn)
+{
+    return fn->temp_count++;
+}
+
+/**
+ * @brief Allocates the next dense label number.
+ * @param fn The function owning the label.
+ * @return The label number.
+ */
+int ir_new_label(IrFunction *fn)
+{
+    return fn->label_count++;
+}
+
+/**
+ * @brief Reserves consecutive slots in the function's argument pool.
+ * @param fn The function owning the pool.
+ * @param count The number of slots.
+ * @return The index of the first slot. Labels of the new slots are zeroed.
+ */
+int ir_alloc_args(IrFunction *fn, int count)
+{
+    if (fn->arg_count + count > fn->arg_capacity)
+    {
+        while (fn->arg_count + count > fn->arg_capacity)
+            fn->arg_capacity = fn->arg_capacity ? fn->arg_capacity * 2 : 16;
+        fn->args = realloc(fn->args, fn->arg_capacity * sizeof(IrValue));
+        fn->arg_labels = realloc(fn->arg_labels, fn->arg_capacity * sizeof(int32_t));
+    }
+
+    int start = fn->arg_count;
+    if (count > 0)
+        memset(fn->arg_labels + start, 0, count * sizeof(int32_t));
+    fn->arg_count += count;
+    return start;
+}
+
+/**
+ * @brief Removes IR_NOP instructions, preserving the order of everything else.
+ * @param fn The function to compact.
+ */
+void ir_compact(IrFunction *fn)
+{
+    int count = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (fn->instrs[i].op != IR_NOP)
+            fn->instrs[count++] = fn->instrs[i];
+    }
+    fn->instr_count = count;
+}
+
+/**
+ * @brief Appends an instruction to a function.
+ * @param fn The function to append to.
+ * @param op The opcode.
+ * @param dst The destination operand, or ir_none().
+ * @param a The first source operand, or ir_none().
+ * @param b The second source operand, or ir_none().
+ * @return A pointer to the new instruction, valid until the next append.
+ */
+IrInstr *ir_emit(IrFunction *fn, IrOpcode op, IrValue dst, IrValue a, IrValue b)
+{
+    if (fn->instr_count == fn->instr_capacity)
+    {
+        fn->instr_capacity = fn->instr_capacity ? fn->instr_capacity * 2 : 16;
+        fn->instrs = realloc(fn->instrs, fn->instr_capacity * sizeof(IrInstr));
+    }
+
+    IrInstr *instr = &fn->instrs[fn->instr_count++];
+    memset(instr, 0, sizeof(IrInstr));
+    instr->op = op;
+    instr->dst = dst;
+    instr->a = a;
+    instr->b = b;
+    return instr;
+}
+
+/**
+ * @brief Appends a label definition.
+ * @param fn The function to append to.
+ * @param label The label number.
+ */
+void ir_emit_label(IrFunction *fn, int label)
+{
+    ir_emit(fn, IR_LABEL, ir_none(), ir_none(), ir_none())->label = label;
+}
+
+/**
+ * @brief Appends a conditional or unconditional jump.
+ * @param fn The function to append to.
+ * @param op IR_JUMP, IR_JUMP_IF_ZERO or IR_JUMP_IF_NOT_ZERO.
+ * @param cond The tested operand, or ir_none() for IR_JUMP.
+ * @param label The target label number.
+ */
+void ir_emit_jump(IrFunction *fn, IrOpcode op, IrValue cond, int label)
+{
+    ir_emit(fn, op, ir_none(), cond, ir_none())->label = label;
+}
+
+/**
+ * @brief Appends a call, copying its arguments into the function's argument pool.
+ * @param fn The function to append to.
+ * @param dst The temporary receiving the result.
+ * @param callee The callee's index in the program.
+ * @param args The argument operands.
+ * @param arg_count The number of arguments.
+ */
+void ir_emit_call(IrFunction *fn, IrValue dst, int callee, const IrValue *args, int arg_count)
+{
+    int arg_start = ir_alloc_args(fn, arg_count);
+    if (arg_count > 0)
+        memcpy(fn->args + arg_start, args, arg_count * sizeof(IrValue));
+
+    IrInstr *instr = ir_emit(fn, IR_CALL, dst, ir_none(), ir_none());
+    instr->callee = callee;
+    instr->arg_start = arg_start;
+    instr->arg_count = arg_count;
+}
+
+// --- Printing ---
+
+/**
+ * @brief Writes one operand: constants as decimal, temporaries as %N.
+ * @param w The writer.
+ * @param value The operand to write.
+ */
+static void print_value(Writer *w, IrValue value)
+{
+    if (value.kind == IR_VAL_TEMP)
+        writer_putc(w, '%');
+    writer_put_long(w, value.value);
+}
+
+/**
+ * @brief Writes a label reference as .LN.
+ * @param w The writer.
+ * @param label The label number.
+ */
+static void print_label(Writer *w, int label)
+{
+    writer_puts(w, ".L");
+    writer_put_long(w, label);
+}
+
+/**
+ * @brief Dumps one function in a readable three-address form.
+ * @param w The writer to print to. The caller flushes it.
+ * @param program The program, used to resolve callee names.
+ * @param fn The function to print.
+ */
+void ir_print_function(Writer *w, const IrProgram *program, const IrFunction *fn)
+{
+    writer_puts(w, "function ");
+    writer_puts(w, fn->name);
+    writer_putc(w, '(');
+    for (int i = 0; i < fn->param_count; i++)
+    {
+        if (i > 0) writer_puts(w, ", ");
+        print_value(w, ir_temp(i));
+    }
+    writer_puts(w, ") {\n");
+
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        const IrInstr *instr = &fn->instrs[i];
+        if (instr->op == IR_NOP) continue;
+
+        if (instr->op == IR_LABEL)
+        {
+            print_label(w, instr->label);
+            writer_puts(w, ":\n");
+            continue;
+        }
+
+        writer_puts(w, "    ");
+        if (instr->dst.kind != IR_VAL_NONE)
+        {
+            print_value(w, instr->dst);
+            writer_puts(w, " = ");
+        }
+        writer_puts(w, ir_opcode_name(instr->op));
+
+        if (instr->op == IR_CALL)
+        {
+            writer_putc(w, ' ');
+            writer_puts(w, program->functions[instr->callee].name);
+            writer_putc(w, '(');
+            for (int j = 0; j < instr->arg_count; j++)
+            {
+                if (j > 0) writer_puts(w, ", ");
+                print_value(w, fn->args[instr->arg_start + j]);
+            }
+            writer_putc(w, ')');
+        }
+        else if (instr->op == IR_PHI)
+        {
+            for (int j = 0; j < instr->arg_count; j++)
+            {
+                writer_puts(w, j > 0 ? ", [" : " [");
+                print_label(w, fn->arg_labels[instr->arg_start + j]);
+                writer_puts(w, ": ");
+                print_value(w, fn->args[instr->arg_start + j]);
+                writer_putc(w, ']');
+            }
+        }
+        else
+        {
+            if (instr->a.kind != IR_VAL_NONE)
+            {
+                writer_putc(w, ' ');
+                print_value(w, instr->a);
+            }
+            if (instr->b.kind != IR_VAL_NONE)
+            {
+                writer_puts(w, ", ");
+                print_value(w, instr->b);
+            }
+            if (ir_is_jump(instr->op))
+            {
+                writer_puts(w, instr->a.kind != IR_VAL_NONE ? ", " : " ");
+                print_label(w, instr->label);
+            }
+        }
+        writer_putc(w, '\n');
+    }
+
+    writer_puts(w, "}\n");
+}
+
+/**
+ * @brief Dumps every defined function of a program.
+ * @param w The writer to print to. The caller flushes it.
+ * @param program The program to print.
+ */
+void ir_print_program(Writer *w, const IrProgram *program)
+{
+    int first = 1;
+    for (int i = 0; i < program->function_count; i++)
+    {
+        if (!program->functions[i].defined) continue;
+        if (!first) writer_putc(w, '\n');
+        ir_print_function(w, program, &program->functions[i]);
+        first = 0;
+    }
+}
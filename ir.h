@@ -0,0 +1,143 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdint.h>
+
+#include "writer.h"
+
+// --- Three-Address IR ---
+// Each function owns one contiguous instruction array. Operands are typed slots
+// (constant or temporary) and temporaries are numbered densely from 0, so passes
+// can walk instructions linearly and index per-temporary tables or bitsets directly.
+
+//--- Operand Kinds ---
+typedef enum
+{
+    IR_VAL_NONE,  // Unused slot
+    IR_VAL_CONST, // value is an int constant
+    IR_VAL_TEMP   // value is a temporary number in [0, temp_count)
+} IrValueKind;
+
+//--- Operand Structure ---
+typedef struct
+{
+    IrValueKind kind;
+    int32_t value;
+} IrValue;
+
+//--- Opcodes ---
+typedef enum
+{
+    IR_NOP,              // Deleted instruction, skipped by every pass
+    IR_RETURN,           // return a
+    IR_COPY,             // dst = a
+    IR_NEGATE,           // dst = -a
+    IR_COMPLEMENT,       // dst = ~a
+    IR_NOT,              // dst = !a
+    IR_ADD,              // dst = a + b
+    IR_SUB,              // dst = a - b
+    IR_MUL,              // dst = a * b
+    IR_DIV,              // dst = a / b
+    IR_REM,              // dst = a % b
+    IR_MUL_HIGH,         // dst = high 32 bits of the signed 64-bit product a * b
+    IR_SAR,              // dst = a >> (b & 31), arithmetic
+    IR_SHR,              // dst = (uint32_t)a >> (b & 31), logical
+    IR_EQ,               // dst = a == b
+    IR_NE,               // dst = a != b
+    IR_LT,               // dst = a < b
+    IR_LE,               // dst = a <= b
+    IR_GT,               // dst = a > b
+    IR_GE,               // dst = a >= b
+    IR_JUMP,             // goto label
+    IR_JUMP_IF_ZERO,     // if (a == 0) goto label
+    IR_JUMP_IF_NOT_ZERO, // if (a != 0) goto label
+    IR_LABEL,            // label:
+    IR_CALL,             // dst = callee(args[arg_start .. arg_start + arg_count))
+    IR_PHI,              // dst = args[i] when entered from the block labelled arg_labels[i] (SSA only)
+    IR_OPCODE_COUNT
+} IrOpcode;
+
+//--- Instruction Structure ---
+typedef struct
+{
+    IrOpcode op;
+    IrValue dst;
+    IrValue a;
+    IrValue b;
+    union
+    {
+        int32_t label;  // Jumps and IR_LABEL: label number in [0, label_count)
+        int32_t callee; // IR_CALL: index into IrProgram.functions
+    };
+    int32_t arg_start;  // IR_CALL, IR_PHI: first argument in IrFunction.args
+    int32_t arg_count;  // IR_CALL, IR_PHI: number of arguments
+    int32_t branch;     // IR_JUMP_IF_*: profile branch id (see profile.h), negated once inverted; 0 for none
+} IrInstr;
+
+//--- Function Structure ---
+typedef struct
+{
+    char *name;
+    int param_count;    // Parameters arrive in temporaries 0 .. param_count - 1
+    int defined;        // 0 for a declaration without a body
+
+    IrInstr *instrs;
+    int instr_count;
+    int instr_capacity;
+
+    IrValue *args;      // Pool of call and phi arguments
+    int32_t *arg_labels; // Phi arguments: label of the incoming block
+    int arg_count;
+    int arg_capacity;
+
+    int temp_count;
+    int label_count;
+
+    uint64_t entry_count;           // -fprofile-use: times the function was entered
+    const uint64_t *branch_counts;  // -fprofile-use: the program's branch counters, or NULL
+} IrFunction;
+
+//--- Program Structure ---
+typedef struct
+{
+    IrFunction *functions;
+    int function_count;
+    int function_capacity;
+
+    int branch_count;   // Conditional jumps numbered by profile_number_branches
+    uint64_t *profile;  // -fprofile-use: counters loaded by profile_load, or NULL
+} IrProgram;
+
+// --- Operand Constructors ---
+static inline IrValue ir_none(void) { IrValue v = {IR_VAL_NONE, 0}; return v; }
+static inline IrValue ir_const(int32_t value) { IrValue v = {IR_VAL_CONST, value}; return v; }
+static inline IrValue ir_temp(int32_t temp) { IrValue v = {IR_VAL_TEMP, temp}; return v; }
+
+const char *ir_opcode_name(IrOpcode op);
+int ir_is_unary(IrOpcode op);
+int ir_is_binary(IrOpcode op);
+int ir_is_jump(IrOpcode op);
+int ir_is_terminator(IrOpcode op);
+int ir_tail_return(const IrFunction *fn, int i);
+int ir_use_count(const IrInstr *instr);
+IrValue *ir_use(IrFunction *fn, IrInstr *instr, int index);
+int ir_fold(IrOpcode op, int32_t a, int32_t b, int32_t *result);
+
+IrProgram *ir_program_new(void);
+void ir_program_free(IrProgram *program);
+IrFunction *ir_add_function(IrProgram *program, const char *name, int param_count);
+int ir_find_function(const IrProgram *program, const char *name);
+
+int ir_new_temp(IrFunction *fn);
+int ir_new_label(IrFunction *fn);
+int ir_alloc_args(IrFunction *fn, int count);
+void ir_compact(IrFunction *fn);
+IrInstr *ir_emit(IrFunction *fn, IrOpcode op, IrValue dst, IrValue a, IrValue b);
+void ir_emit_label(IrFunction *fn, int label);
+void ir_emit_jump(IrFunction *fn, IrOpcode op, IrValue cond, int label);
+void ir_emit_call(IrFunction *fn, IrValue dst, int callee, const IrValue *args, int arg_count);
+
+void ir_print_function(Writer *w, const IrProgram *program, const IrFunction *fn);
+void ir_print_program(Writer *w, const IrProgram *program);
+
+#endif
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir_gen.h"
+
+/**
+ * @brief Lowers an expression to an operand.
+ *
+ * Constants are the only expressions so far, and they need no instructions.
+ *
+ * @param exp The expression node.
+ * @return The operand holding the expression's value.
+ */
+static IrValue gen_exp(const AstNode *exp)
+{
+    switch (exp->kind)
+    {
+        case AST_CONSTANT:
+            return ir_const((int32_t)exp->value);
+        default:
+            fprintf(stderr, "IR generation error: unexpected %s in expression\n", ast_kind_to_string(exp->kind));
+            exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Lowers a statement.
+ * @param fn The function being generated.
+ * @param stmt The statement node.
+ */
+static void gen_statement(IrFunction *fn, const AstNode *stmt)
+{
+    switch (stmt->kind)
+    {
+        case AST_RETURN:
+        {
+            IrValue value = gen_exp(stmt->children[0]);
+            ir_emit(fn, IR_RETURN, ir_none(), value, ir_none());
+            break;
+        }
+        default:
+            fprintf(stderr, "IR generation error: unexpected %s in statement\n", ast_kind_to_string(stmt->kind));
+            exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Lowers a parsed program to three-address IR.
+ *
+ * Every function gets a trailing `return 0` unless its body already ends in a
+ * return, matching C's rule for falling off the end of main.
+ *
+ * @param program The AST_PROGRAM root.
+ * @return The IR program, or NULL if a function is defined twice. Free it with ir_program_free.
+ */
+IrProgram *ir_generate(const AstNode *program)
+{
+    IrProgram *ir = ir_program_new();
+
+    // Declare every function first so calls can refer to later definitions.
+    for (int i = 0; i < program->child_count; i++)
+    {
+        const char *name = program->children[i]->name;
+        if (ir_find_function(ir, name) >= 0)
+        {
+            fprintf(stderr, "Error: redefinition of function '%s'\n", name);
+            ir_program_free(ir);
+            return NULL;
+        }
+        ir_add_function(ir, name, 0);
+    }
+
+    for (int i = 0; i < program->child_count; i++)
+    {
+        const AstNode *function = program->children[i];
+        IrFunction *fn = &ir->functions[i];
+        fn->defined = 1;
+
+        for (int j = 0; j < function->child_count; j++)
+            gen_statement(fn, function->children[j]);
+
+        if (fn->instr_count == 0 || fn->instrs[fn->instr_count - 1].op != IR_RETURN)
+            ir_emit(fn, IR_RETURN, ir_none(), ir_const(0), ir_none());
+    }
+
+    return ir;
+}
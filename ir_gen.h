@@ -0,0 +1,9 @@
+#ifndef IR_GEN_H
+#define IR_GEN_H
+
+#include "ast.h"
+#include "ir.h"
+
+IrProgram *ir_generate(const AstNode *program);
+
+#endif
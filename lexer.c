@@ -5,31 +5,7 @@
 #include <ctype.h>
 #include <sys/stat.h>
 
-#define MAX_SIZE 100 //Max length for input buffer
-
-//--- Token Types ---
-typedef enum 
-{
-    TOKEN_INT,
-    TOKEN_VOID,
-    TOKEN_RETURN,
-    TOKEN_IDENTIFIER,
-    TOKEN_CONSTANT,
-    TOKEN_OPEN_PAREN,  // (
-    TOKEN_CLOSE_PAREN, // )
-    TOKEN_OPEN_BRACE,  // {
-    TOKEN_CLOSE_BRACE, // }
-    TOKEN_SEMICOLON,   // ;
-    TOKEN_EOF,         // End of file
-    TOKEN_ERROR        // Error state
-} TokenType;
-
-//--- Token Structure ---
-typedef struct 
-{
-    TokenType type;
-    char *lexeme;
-} Token;
+#include "lexer.h"
 
 /**
  * @brief Turns a token type into a debug string.
@@ -147,7 +123,7 @@ Token get_next_token(char **current_pos)
     }
 
     //--- Simple Single-Character Tokens ---
-    Token simple_token = {TOKEN_ERROR, strdup("")};
+    Token simple_token = {TOKEN_ERROR, NULL};
 
     switch (*input)
     {
@@ -249,79 +225,57 @@ char *read_file(const char *filename)
     fread(string, fsize, 1, f);
     fclose(f);
     string[fsize] = 0;
-    
+    return string;
 }
 
 /**
- * @brief The main function for the compiler driver.
- * @param argc The argument count.
- * @param argv The argument vector.
- * @return EXIT_SUCCESS or EXIT_FAILURE.
+ * @brief Lexes an entire source string into a token list terminated by TOKEN_EOF.
+ * @param source The source code to lex.
+ * @param list The token list to fill. Must be freed with free_token_list.
+ * @return The number of lexer errors encountered.
  */
-int main(int argc, char *argv[])
+int tokenize(char *source, TokenList *list)
 {
-    char input_buffer[MAX_SIZE];
-
-    while (fgets(input_buffer, MAX_SIZE, stdin) != NULL) 
-    {
-        char *token = strtok(input_buffer, " \t\n");
-        int index = 0;
-        while (token != NULL) 
-        {
-            
-        }
-
-    }if (argc < 2) {
-        fprintf(stderr, "Usage: %s <source_file>\n", argv[0]);
-        return 1;
-    }
-
-    char *source_code = read_file(argv[1]);
-    if (!source_code) {
-        perror("Error reading file");
-        return 1;
-    }
-
-    printf("--- Source Code ---\n%s\n-------------------\n", source_code);
-    printf("--- Token List ---\n");
-
-    char *current_pos = source_code;
+    char *current_pos = source;
     Token current_token;
     int error_count = 0;
 
+    list->tokens = NULL;
+    list->count = 0;
+    list->capacity = 0;
+
     // Loop through the input until EOF
     do {
         current_token = get_next_token(&current_pos);
-        
-        // Print the token
-        printf("%s", token_type_to_string(current_token.type));
 
-        if (current_token.type == TOKEN_IDENTIFIER || current_token.type == TOKEN_CONSTANT || 
-            current_token.type == TOKEN_KEYWORD_INT || current_token.type == TOKEN_KEYWORD_VOID || 
-            current_token.type == TOKEN_KEYWORD_RETURN) 
+        if (current_token.type == TOKEN_ERROR) 
         {
-            printf(" (\"%s\")\n", current_token.lexeme);
-        } else {
-            printf("\n");
-        }
-
-        if (current_token.type == TOKEN_ERROR) {
             fprintf(stderr, "LEXER ERROR: Unrecognized token near '%s'\n", current_token.lexeme);
             error_count++;
         }
-        
-        // Free the dynamically allocated lexeme string
-        free(current_token.lexeme);
+
+        if (list->count == list->capacity) 
+        {
+            list->capacity = list->capacity ? list->capacity * 2 : 64;
+            list->tokens = realloc(list->tokens, list->capacity * sizeof(Token));
+        }
+        list->tokens[list->count++] = current_token;
 
     } while (current_token.type != TOKEN_EOF);
 
-    printf("-------------------\n");
-    if (error_count > 0) {
-        printf("Lexing finished with %d errors.\n", error_count);
-        free(source_code);
-        return 1;
-    }
+    return error_count;
+}
 
-    free(source_code);
-    return 0;
+/**
+ * @brief Frees every lexeme in a token list and the list storage itself.
+ * @param list The token list to free.
+ */
+void free_token_list(TokenList *list)
+{
+    for (int i = 0; i < list->count; i++) 
+        free(list->tokens[i].lexeme);
+    free(list->tokens);
+    list->tokens = NULL;
+    list->count = 0;
+    list->capacity = 0;
 }
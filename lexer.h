@@ -0,0 +1,42 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+//--- Token Types ---
+typedef enum
+{
+    TOKEN_INT,
+    TOKEN_VOID,
+    TOKEN_RETURN,
+    TOKEN_IDENTIFIER,
+    TOKEN_CONSTANT,
+    TOKEN_OPEN_PAREN,  // (
+    TOKEN_CLOSE_PAREN, // )
+    TOKEN_OPEN_BRACE,  // {
+    TOKEN_CLOSE_BRACE, // }
+    TOKEN_SEMICOLON,   // ;
+    TOKEN_EOF,         // End of file
+    TOKEN_ERROR        // Error state
+} TokenType;
+
+//--- Token Structure ---
+typedef struct
+{
+    TokenType type;
+    char *lexeme;
+} Token;
+
+//--- Token List ---
+typedef struct
+{
+    Token *tokens;
+    int count;
+    int capacity;
+} TokenList;
+
+const char *token_to_debug_string(TokenType type);
+Token get_next_token(char **current_pos);
+char *read_file(const char *filename);
+int tokenize(char *source, TokenList *list);
+void free_token_list(TokenList *list);
+
+#endif
@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// --- Loop-Invariant Code Motion ---
+// Works on SSA form. First every loop is given a preheader: a block outside
+// the loop whose only successor is the header and which is the header's only
+// predecessor from outside. Then, innermost loops first, each pure
+// instruction whose operands are all defined outside the loop is moved to the
+// end of the loop's preheader. Since the preheader of an inner loop lies in the
+// enclosing loop, values hoisted out of an inner loop are considered again
+// for the loops around it.
+//
+// Moved instructions run even when the loop body would not have, so only
+// operations that cannot trap are hoisted.
+
+//--- Preheader Phi ---
+// A phi that merges the header's outside arguments in a new preheader.
+typedef struct
+{
+    int header;
+    IrInstr phi;
+} PreheaderPhi;
+
+/**
+ * @brief Checks whether an instruction may be executed speculatively.
+ * @param instr The instruction.
+ * @return 1 for pure operations that cannot fault.
+ */
+static int is_hoistable(const IrInstr *instr)
+{
+    if (instr->op == IR_DIV || instr->op == IR_REM)
+        return instr->b.kind == IR_VAL_CONST && instr->b.value != 0 && instr->b.value != -1;
+    return instr->op == IR_COPY || ir_is_unary(instr->op) || ir_is_binary(instr->op);
+}
+
+/**
+ * @brief Appends a copy of an existing instruction.
+ * @param fn The function being rebuilt.
+ * @param instr The instruction to copy; must not point into fn->instrs.
+ */
+static void append(IrFunction *fn, const IrInstr *instr)
+{
+    IrInstr *copy = ir_emit(fn, instr->op, instr->dst, instr->a, instr->b);
+    *copy = *instr;
+}
+
+/**
+ * @brief Finds the last non-nop instruction of a block in an instruction array.
+ * @param instrs The instructions.
+ * @param block The block.
+ * @return The instruction index, or -1 if the block is empty.
+ */
+static int last_instr(const IrInstr *instrs, const BasicBlock *block)
+{
+    for (int i = block->end - 1; i >= block->start; i--)
+    {
+        if (instrs[i].op != IR_NOP)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Gives every loop without one a preheader block.
+ *
+ * The new block is placed directly before the header. Jumps from outside
+ * predecessors are retargeted to it, and a latch that used to fall through
+ * into the header gets an explicit jump. Header phi arguments from outside
+ * move to a phi in the preheader, or are simply relabelled if there is only
+ * one outside predecessor.
+ *
+ * @param ctx The pass context.
+ * @return The number of preheaders created.
+ */
+static int insert_preheaders(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    const Cfg *cfg = pass_dominators(ctx);
+    const LoopForest *forest = pass_loops(ctx);
+    int n = cfg->block_count;
+
+    int *preheader_label = malloc((n + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+        preheader_label[b] = -1;
+    int created = 0;
+    for (int l = 0; l < forest->loop_count; l++)
+    {
+        int h = forest->loops[l].header;
+        if (forest->loops[l].preheader >= 0 || cfg->blocks[h].label < 0) continue;
+        preheader_label[h] = ir_new_label(fn);
+        created++;
+    }
+    if (created == 0)
+    {
+        free(preheader_label);
+        return 0;
+    }
+
+    PreheaderPhi *phis = NULL;
+    int phi_count = 0, phi_capacity = 0;
+    unsigned char *outside = calloc(n + 1, 1);
+
+    for (int h = 0; h < n; h++)
+    {
+        if (preheader_label[h] < 0) continue;
+        const BasicBlock *header = &cfg->blocks[h];
+        int label = preheader_label[h];
+
+        int outside_count = 0;
+        for (int p = 0; p < header->pred_count; p++)
+        {
+            int pred = cfg->preds[header->pred_start + p];
+            outside[pred] = !loop_is_back_edge(cfg, pred, h);
+            outside_count += outside[pred];
+        }
+
+        for (int i = header->start; i < header->end; i++)
+        {
+            IrInstr *instr = &fn->instrs[i];
+            if (instr->op != IR_PHI) continue;
+
+            if (outside_count == 1)
+            {
+                for (int j = 0; j < instr->arg_count; j++)
+                {
+                    int pred = cfg->label_block[fn->arg_labels[instr->arg_start + j]];
+                    if (pred >= 0 && outside[pred])
+                        fn->arg_labels[instr->arg_start + j] = label;
+                }
+                continue;
+            }
+
+            // Split the arguments: outside ones feed a new phi in the preheader.
+            int moved = 0;
+            for (int j = 0; j < instr->arg_count; j++)
+            {
+                int pred = cfg->label_block[fn->arg_labels[instr->arg_start + j]];
+                moved += pred >= 0 && outside[pred];
+            }
+            int kept = instr->arg_count - moved;
+            int old_start = instr->arg_start;
+            int header_start = ir_alloc_args(fn, kept + 1);
+            int preheader_start = ir_alloc_args(fn, moved);
+            int k = 0, m = 0;
+            for (int j = 0; j < instr->arg_count; j++)
+            {
+                int pred = cfg->label_block[fn->arg_labels[old_start + j]];
+                int dst = pred >= 0 && outside[pred] ? preheader_start + m++ : header_start + k++;
+                fn->args[dst] = fn->args[old_start + j];
+                fn->arg_labels[dst] = fn->arg_labels[old_start + j];
+            }
+            int merged = ir_new_temp(fn);
+            fn->args[header_start + kept] = ir_temp(merged);
+            fn->arg_labels[header_start + kept] = label;
+            instr->arg_start = header_start;
+            instr->arg_count = kept + 1;
+
+            if (phi_count == phi_capacity)
+            {
+                phi_capacity = phi_capacity ? phi_capacity * 2 : 8;
+                phis = realloc(phis, phi_capacity * sizeof(PreheaderPhi));
+            }
+            PreheaderPhi *phi = &phis[phi_count++];
+            memset(phi, 0, sizeof(PreheaderPhi));
+            phi->header = h;
+            phi->phi.op = IR_PHI;
+            phi->phi.dst = ir_temp(merged);
+            phi->phi.arg_start = preheader_start;
+            phi->phi.arg_count = moved;
+        }
+
+        for (int p = 0; p < header->pred_count; p++)
+        {
+            int pred = cfg->preds[header->pred_start + p];
+            if (!outside[pred]) continue;
+            int last = cfg_last_instr(fn, &cfg->blocks[pred]);
+            if (last >= 0 && ir_is_jump(fn->instrs[last].op) && fn->instrs[last].label == header->label)
+                fn->instrs[last].label = label;
+        }
+    }
+
+    // Rebuild the instruction array with the preheaders in place.
+    IrInstr *old = fn->instrs;
+    fn->instrs = NULL;
+    fn->instr_count = 0;
+    fn->instr_capacity = 0;
+    for (int b = 0; b < n; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        if (preheader_label[b] >= 0)
+        {
+            if (b > 0 && cfg->rpo_index[b - 1] >= 0 && loop_is_back_edge(cfg, b - 1, b))
+            {
+                int last = last_instr(old, &cfg->blocks[b - 1]);
+                const IrInstr *end = last >= 0 ? &old[last] : NULL;
+                if (!end || (end->op != IR_JUMP && end->op != IR_RETURN))
+                    ir_emit_jump(fn, IR_JUMP, ir_none(), block->label);
+            }
+            ir_emit_label(fn, preheader_label[b]);
+            for (int p = 0; p < phi_count; p++)
+            {
+                if (phis[p].header == b)
+                    append(fn, &phis[p].phi);
+            }
+        }
+        for (int i = block->start; i < block->end; i++)
+            append(fn, &old[i]);
+    }
+    free(old);
+
+    ctx->stats->counts[STAT_LICM_PREHEADERS] += created;
+    free(outside);
+    free(phis);
+    free(preheader_label);
+    return created;
+}
+
+/**
+ * @brief Moves loop-invariant instructions into their loops' preheaders.
+ * @param ctx The pass context; every loop should have a preheader.
+ * @return The number of instructions moved.
+ */
+static int hoist_invariants(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    const Cfg *cfg = pass_dominators(ctx);
+    const LoopForest *forest = pass_loops(ctx);
+    int n = cfg->block_count;
+
+    // Where each instruction will be emitted, and where each temporary is
+    // defined; both change as instructions move.
+    int *dest = malloc((fn->instr_count + 1) * sizeof(int));
+    int *def_block = malloc((fn->temp_count + 1) * sizeof(int));
+    for (int t = 0; t < fn->temp_count; t++)
+        def_block[t] = -1;
+    for (int b = 0; b < n; b++)
+    {
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            dest[i] = b;
+            if (fn->instrs[i].dst.kind == IR_VAL_TEMP)
+                def_block[fn->instrs[i].dst.value] = b;
+        }
+    }
+
+    // Instructions moved into each block, in order, as linked lists of nodes.
+    // An instruction can move again, out of an enclosing loop, so it may be
+    // listed under several blocks; only the list matching dest[] counts.
+    int *head = malloc((n + 1) * sizeof(int));
+    int *tail = malloc((n + 1) * sizeof(int));
+    int node_capacity = 64, node_count = 0;
+    int *node_instr = malloc(node_capacity * sizeof(int));
+    int *node_next = malloc(node_capacity * sizeof(int));
+    for (int b = 0; b < n; b++)
+        head[b] = tail[b] = -1;
+
+    int hoisted = 0;
+    for (int l = 0; l < forest->loop_count; l++)
+    {
+        int preheader = forest->loops[l].preheader;
+        if (preheader < 0) continue;
+
+        for (int r = 0; r < cfg->rpo_count; r++)
+        {
+            int b = cfg->rpo[r];
+            if (!loop_contains(forest, l, b)) continue;
+
+            // The block's own instructions, then whatever was moved into it.
+            int i = cfg->blocks[b].start;
+            int moved = head[b];
+            for (;;)
+            {
+                int candidate;
+                if (i < cfg->blocks[b].end)
+                    candidate = i++;
+                else if (moved >= 0)
+                {
+                    candidate = node_instr[moved];
+                    moved = node_next[moved];
+                }
+                else
+                    break;
+
+                IrInstr *instr = &fn->instrs[candidate];
+                if (dest[candidate] != b || !is_hoistable(instr) || instr->dst.kind != IR_VAL_TEMP) continue;
+
+                int invariant = 1;
+                int count = ir_use_count(instr);
+                for (int j = 0; j < count && invariant; j++)
+                {
+                    IrValue *use = ir_use(fn, instr, j);
+                    if (use->kind == IR_VAL_TEMP && def_block[use->value] >= 0)
+                        invariant = !loop_contains(forest, l, def_block[use->value]);
+                }
+                if (!invariant) continue;
+
+                dest[candidate] = preheader;
+                def_block[instr->dst.value] = preheader;
+                if (node_count == node_capacity)
+                {
+                    node_capacity *= 2;
+                    node_instr = realloc(node_instr, node_capacity * sizeof(int));
+                    node_next = realloc(node_next, node_capacity * sizeof(int));
+                }
+                int node = node_count++;
+                node_instr[node] = candidate;
+                node_next[node] = -1;
+                if (tail[preheader] >= 0)
+                    node_next[tail[preheader]] = node;
+                else
+                    head[preheader] = node;
+                tail[preheader] = node;
+                hoisted++;
+            }
+        }
+    }
+
+    if (hoisted > 0)
+    {
+        // Moved instructions go before the block's final jump, if it has one.
+        IrInstr *old = fn->instrs;
+        fn->instrs = NULL;
+        fn->instr_count = 0;
+        fn->instr_capacity = 0;
+        for (int b = 0; b < n; b++)
+        {
+            const BasicBlock *block = &cfg->blocks[b];
+            int last = last_instr(old, block);
+            int split = last >= 0 && ir_is_jump(old[last].op) ? last : block->end;
+
+            for (int i = block->start; i < split; i++)
+            {
+                if (dest[i] == b)
+                    append(fn, &old[i]);
+            }
+            for (int node = head[b]; node >= 0; node = node_next[node])
+            {
+                if (dest[node_instr[node]] == b)
+                    append(fn, &old[node_instr[node]]);
+            }
+            for (int i = split; i < block->end; i++)
+            {
+                if (dest[i] == b)
+                    append(fn, &old[i]);
+            }
+        }
+        free(old);
+        ctx->stats->counts[STAT_LICM_HOISTED] += hoisted;
+    }
+
+    free(node_next);
+    free(node_instr);
+    free(tail);
+    free(head);
+    free(def_block);
+    free(dest);
+    return hoisted;
+}
+
+/**
+ * @brief Hoists loop-invariant computations out of a function's loops.
+ * @param ctx The function to optimize, in SSA form, and its analyses.
+ * @return 1 if the function changed.
+ */
+int licm_run(PassContext *ctx)
+{
+    if (ctx->fn->instr_count == 0) return 0;
+    const LoopForest *forest = pass_loops(ctx);
+    if (forest->loop_count == 0) return 0;
+    ctx->stats->counts[STAT_LOOPS_FOUND] += forest->loop_count;
+
+    int changed = 0;
+    if (insert_preheaders(ctx) > 0)
+    {
+        pass_invalidate(ctx);
+        changed = 1;
+    }
+    if (hoist_invariants(ctx) > 0)
+        changed = 1;
+    return changed;
+}
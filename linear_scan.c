@@ -0,0 +1,321 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm.h"
+
+// --- Linear-Scan Register Allocation ---
+// Poletto and Sarkar's linear scan over the selected instructions. Each
+// pseudo register gets one live interval, the span of positions from its
+// first to its last live point; intervals are visited by start point and
+// take a free register, keeping an active list of the ones that hold a
+// register. Machine registers that instruction selection already names
+// (arguments, %eax/%edx around idivl, everything a call clobbers) are
+// precolored: an interval can only take a register with no live point of its
+// own inside the interval. So a pseudo live across a call ends up in a
+// callee-saved register or on the stack.
+//
+// When no register is free, the interval with the lowest spill cost per
+// position loses, either the new one or one of the active ones whose
+// register would fit. The cost of an occurrence is how often it runs,
+// estimated by asm_liveness_compute.
+
+//--- Live Interval ---
+typedef struct
+{
+    int pseudo;
+    int start;          // First position, see AsmLiveness
+    int end;            // Last position
+    long weight;        // Spill cost
+    int reg;            // Assigned AsmReg, or -1 when spilled
+} LiveInterval;
+
+//--- Allocator State ---
+typedef struct
+{
+    const AsmFunction *fn;
+    LiveInterval *intervals;    // Indexed by pseudo register
+    BitWord *busy[REG_COUNT];   // Positions where each machine register is live or written
+} LinearScan;
+
+/**
+ * @brief Records that every variable in a set is live at a position.
+ * @param ls The allocator state.
+ * @param set The live variables.
+ * @param words The set's word count.
+ * @param pos The position.
+ */
+static void mark_live(LinearScan *ls, const BitWord *set, size_t words, int pos)
+{
+    int pseudo_count = ls->fn->pseudo_count;
+    for (size_t w = 0; w < words; w++)
+    {
+        for (BitWord bits = set[w]; bits; bits &= bits - 1)
+        {
+            int var = (int)(w * BITSET_WORD_BITS) + __builtin_ctzll(bits);
+            if (var < pseudo_count)
+            {
+                LiveInterval *interval = &ls->intervals[var];
+                if (pos < interval->start) interval->start = pos;
+                if (pos > interval->end) interval->end = pos;
+            }
+            else
+                bitset_set(ls->busy[var - pseudo_count], pos);
+        }
+    }
+}
+
+/**
+ * @brief Computes every pseudo register's interval and spill cost, and where each machine register is busy.
+ *
+ * Walks each block backwards from its live-out set. Uses of instruction i
+ * are at position 2i and definitions at 2i + 1, so a value may take the
+ * register of one that dies in the same instruction.
+ *
+ * @param ls The allocator state.
+ * @param live The function's liveness.
+ */
+static void build_intervals(LinearScan *ls, const AsmLiveness *live)
+{
+    const AsmFunction *fn = ls->fn;
+    size_t words = live->words;
+    BitWord *current = bitset_new(live->var_count);
+    BitWord *defs = bitset_new(live->var_count);
+
+    for (int b = 0; b < live->block_count; b++)
+    {
+        bitset_copy(current, live->live_out + b * words, words);
+        for (int i = live->block_start[b + 1] - 1; i >= live->block_start[b]; i--)
+        {
+            AsmUseDef ud;
+            asm_use_def(fn, &fn->instrs[i], &ud);
+            long cost = live->frequency[i];
+
+            bitset_zero(defs, words);
+            for (int d = 0; d < ud.def_count; d++)
+            {
+                bitset_set(defs, ud.defs[d]);
+                if (ud.defs[d] < fn->pseudo_count)
+                    ls->intervals[ud.defs[d]].weight += cost;
+            }
+            mark_live(ls, current, words, 2 * i + 1);
+            mark_live(ls, defs, words, 2 * i + 1);
+
+            for (size_t w = 0; w < words; w++)
+                current[w] &= ~defs[w];
+            for (int u = 0; u < ud.use_count; u++)
+            {
+                bitset_set(current, ud.uses[u]);
+                if (ud.uses[u] < fn->pseudo_count)
+                    ls->intervals[ud.uses[u]].weight += cost;
+            }
+            mark_live(ls, current, words, 2 * i);
+        }
+    }
+
+    free(current);
+    free(defs);
+}
+
+/**
+ * @brief Checks whether a machine register is idle over a whole interval.
+ * @param busy The register's busy positions.
+ * @param interval The interval.
+ * @return 1 if no position from start to end is busy.
+ */
+static int register_fits(const BitWord *busy, const LiveInterval *interval)
+{
+    int first = interval->start / BITSET_WORD_BITS;
+    int last = interval->end / BITSET_WORD_BITS;
+    for (int w = first; w <= last; w++)
+    {
+        BitWord mask = ~(BitWord)0;
+        if (w == first)
+            mask &= ~(BitWord)0 << (interval->start % BITSET_WORD_BITS);
+        if (w == last && interval->end % BITSET_WORD_BITS != BITSET_WORD_BITS - 1)
+            mask &= ((BitWord)1 << (interval->end % BITSET_WORD_BITS + 1)) - 1;
+        if (busy[w] & mask)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Orders intervals by start position, then by pseudo register number.
+ * @param a The first interval.
+ * @param b The second interval.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compare_start(const void *a, const void *b)
+{
+    const LiveInterval *x = *(const LiveInterval *const *)a;
+    const LiveInterval *y = *(const LiveInterval *const *)b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    return x->pseudo - y->pseudo;
+}
+
+/**
+ * @brief Checks whether one interval is cheaper to spill than another, by cost per position.
+ * @param x The first interval.
+ * @param y The second interval.
+ * @return 1 if x is strictly cheaper.
+ */
+static int cheaper_to_spill(const LiveInterval *x, const LiveInterval *y)
+{
+    long long x_length = x->end - x->start + 1;
+    long long y_length = y->end - y->start + 1;
+    return (long long)x->weight * y_length < (long long)y->weight * x_length;
+}
+
+/**
+ * @brief Assigns registers to the intervals in order of their start positions.
+ * @param ls The allocator state.
+ * @param sorted The live intervals, sorted by start.
+ * @param count The number of intervals.
+ */
+static void scan(LinearScan *ls, LiveInterval **sorted, int count)
+{
+    LiveInterval *active[ASM_ALLOCATABLE_COUNT];
+    int active_count = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        LiveInterval *current = sorted[i];
+
+        // Expire intervals that ended before this one starts.
+        unsigned taken = 0;
+        int kept = 0;
+        for (int a = 0; a < active_count; a++)
+        {
+            if (active[a]->end >= current->start)
+            {
+                active[kept++] = active[a];
+                taken |= 1u << active[a]->reg;
+            }
+        }
+        active_count = kept;
+
+        current->reg = -1;
+        for (int r = 0; r < ASM_ALLOCATABLE_COUNT; r++)
+        {
+            AsmReg reg = asm_allocatable[r];
+            if (!(taken & (1u << reg)) && register_fits(ls->busy[reg], current))
+            {
+                current->reg = reg;
+                break;
+            }
+        }
+        if (current->reg >= 0)
+        {
+            active[active_count++] = current;
+            continue;
+        }
+
+        // Take the register of the cheapest active interval that can give one up.
+        int victim = -1;
+        for (int a = 0; a < active_count; a++)
+        {
+            if (!register_fits(ls->busy[active[a]->reg], current)) continue;
+            if (victim < 0 || cheaper_to_spill(active[a], active[victim]))
+                victim = a;
+        }
+        if (victim >= 0 && cheaper_to_spill(active[victim], current))
+        {
+            current->reg = active[victim]->reg;
+            active[victim]->reg = -1;
+            active[victim] = current;
+        }
+    }
+}
+
+/**
+ * @brief Replaces a pseudo register operand by its allocated register, if it has one.
+ * @param ls The allocator state.
+ * @param operand The operand.
+ */
+static void rewrite_operand(const LinearScan *ls, AsmOperand *operand)
+{
+    if (operand->kind == ASM_OPERAND_PSEUDO && ls->intervals[operand->value].reg >= 0)
+        *operand = asm_reg((AsmReg)ls->intervals[operand->value].reg);
+}
+
+/**
+ * @brief Allocates registers for one function.
+ * @param fn The function, with pseudo register operands.
+ * @param stats Receives allocation counts.
+ */
+static void allocate_function(AsmFunction *fn, OptStats *stats)
+{
+    AsmLiveness live;
+    asm_liveness_compute(&live, fn);
+
+    LinearScan ls;
+    ls.fn = fn;
+    ls.intervals = malloc((fn->pseudo_count + 1) * sizeof(LiveInterval));
+    for (int p = 0; p < fn->pseudo_count; p++)
+    {
+        ls.intervals[p].pseudo = p;
+        ls.intervals[p].start = INT_MAX;
+        ls.intervals[p].end = -1;
+        ls.intervals[p].weight = 0;
+        ls.intervals[p].reg = -1;
+    }
+    for (int r = 0; r < REG_COUNT; r++)
+        ls.busy[r] = bitset_new(2 * fn->instr_count + 2);
+    build_intervals(&ls, &live);
+
+    LiveInterval **sorted = malloc((fn->pseudo_count + 1) * sizeof(LiveInterval *));
+    int count = 0;
+    for (int p = 0; p < fn->pseudo_count; p++)
+    {
+        if (ls.intervals[p].end >= 0)
+            sorted[count++] = &ls.intervals[p];
+    }
+    qsort(sorted, count, sizeof(LiveInterval *), compare_start);
+    scan(&ls, sorted, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (sorted[i]->reg < 0)
+        {
+            stats->counts[STAT_RA_SPILLED]++;
+            continue;
+        }
+        stats->counts[STAT_RA_ALLOCATED]++;
+        if (asm_is_callee_saved((AsmReg)sorted[i]->reg))
+            fn->saved_regs |= 1u << sorted[i]->reg;
+    }
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        AsmInstr *instr = &fn->instrs[i];
+        rewrite_operand(&ls, &instr->src);
+        rewrite_operand(&ls, &instr->dst);
+        rewrite_operand(&ls, &instr->index);
+        if (instr->op == ASM_MOV && asm_same_operand(instr->src, instr->dst))
+        {
+            instr->op = ASM_NOP;
+            stats->counts[STAT_RA_MOVES_REMOVED]++;
+        }
+    }
+
+    free(sorted);
+    for (int r = 0; r < REG_COUNT; r++)
+        free(ls.busy[r]);
+    free(ls.intervals);
+    asm_liveness_free(&live);
+}
+
+/**
+ * @brief Allocates registers for every function with linear scan.
+ * @param program The program after instruction selection.
+ * @param stats Receives allocation counts.
+ */
+void regalloc_linear_scan(AsmProgram *program, OptStats *stats)
+{
+    for (int f = 0; f < program->function_count; f++)
+    {
+        AsmFunction *fn = &program->functions[f];
+        if (fn->defined && fn->instr_count > 0)
+            allocate_function(fn, stats);
+    }
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "loops.h"
+
+/**
+ * @brief Checks whether a CFG edge is a back edge. Requires cfg_compute_dominators.
+ * @param cfg The CFG.
+ * @param from The edge's source block.
+ * @param to The edge's target block.
+ * @return 1 if the target dominates the source.
+ */
+int loop_is_back_edge(const Cfg *cfg, int from, int to)
+{
+    return cfg_dominates(cfg, to, from);
+}
+
+/**
+ * @brief Follows parent links to the outermost loop discovered so far.
+ * @param forest The forest under construction.
+ * @param loop A loop.
+ * @return The loop's outermost known ancestor.
+ */
+static int outermost(const LoopForest *forest, int loop)
+{
+    while (forest->loops[loop].parent >= 0)
+        loop = forest->loops[loop].parent;
+    return loop;
+}
+
+/**
+ * @brief Finds the natural loops of a CFG and how they nest. Requires cfg_compute_dominators.
+ *
+ * Headers are visited deepest in the dominator tree first, so inner loops are
+ * built before the loops around them. Each loop's body is collected by
+ * walking predecessors backwards from its latches; reaching a block already
+ * claimed by an inner loop makes that loop's outermost ancestor a child of
+ * the current one and continues from its header.
+ *
+ * @param cfg The CFG.
+ * @return The forest; free with loops_free.
+ */
+LoopForest *loops_find(const Cfg *cfg)
+{
+    int n = cfg->block_count;
+    LoopForest *forest = calloc(1, sizeof(LoopForest));
+    forest->loops = malloc((n + 1) * sizeof(Loop));
+    forest->block_loop = malloc((n + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+        forest->block_loop[b] = -1;
+
+    // Reachable blocks by descending dominator preorder number.
+    int *by_pre = malloc((n + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+    {
+        if (cfg->dom_pre[b] >= 0)
+            by_pre[cfg->dom_pre[b]] = b;
+    }
+
+    // A block may be queued once per edge leaving it before it is claimed.
+    int edges = 0;
+    for (int b = 0; b < n; b++)
+        edges += cfg->blocks[b].pred_count;
+    int *work = malloc((edges + n + 1) * sizeof(int));
+    for (int k = cfg->rpo_count - 1; k >= 0; k--)
+    {
+        int h = by_pre[k];
+        const BasicBlock *header = &cfg->blocks[h];
+        int count = 0;
+        for (int p = 0; p < header->pred_count; p++)
+        {
+            int pred = cfg->preds[header->pred_start + p];
+            if (loop_is_back_edge(cfg, pred, h))
+                work[count++] = pred;
+        }
+        if (count == 0) continue;
+
+        int id = forest->loop_count++;
+        Loop *loop = &forest->loops[id];
+        loop->header = h;
+        loop->parent = -1;
+        loop->depth = 0;
+        loop->preheader = -1;
+        loop->block_count = 0;
+        forest->block_loop[h] = id;
+
+        while (count > 0)
+        {
+            int b = work[--count];
+            int next;
+            if (forest->block_loop[b] < 0)
+            {
+                forest->block_loop[b] = id;
+                next = b;
+            }
+            else
+            {
+                int inner = outermost(forest, forest->block_loop[b]);
+                if (inner == id) continue;
+                forest->loops[inner].parent = id;
+                next = forest->loops[inner].header;
+            }
+
+            const BasicBlock *block = &cfg->blocks[next];
+            for (int p = 0; p < block->pred_count; p++)
+            {
+                int pred = cfg->preds[block->pred_start + p];
+                if (cfg->rpo_index[pred] < 0) continue;
+                if (forest->block_loop[pred] < 0 || outermost(forest, forest->block_loop[pred]) != id)
+                    work[count++] = pred;
+            }
+        }
+
+        // Every block now in the loop is dominated by the header, so a
+        // predecessor outside the loop is exactly a non-back edge.
+        int outside = -1, outside_count = 0;
+        for (int p = 0; p < header->pred_count; p++)
+        {
+            int pred = cfg->preds[header->pred_start + p];
+            if (!loop_is_back_edge(cfg, pred, h))
+            {
+                outside = pred;
+                outside_count++;
+            }
+        }
+        if (outside_count == 1 && cfg->blocks[outside].succ_count == 1)
+            loop->preheader = outside;
+    }
+
+    // Parents come later in the array, so depths are filled from the end.
+    for (int l = forest->loop_count - 1; l >= 0; l--)
+    {
+        Loop *loop = &forest->loops[l];
+        loop->depth = loop->parent >= 0 ? forest->loops[loop->parent].depth + 1 : 1;
+    }
+    for (int b = 0; b < n; b++)
+    {
+        for (int l = forest->block_loop[b]; l >= 0; l = forest->loops[l].parent)
+            forest->loops[l].block_count++;
+    }
+
+    free(work);
+    free(by_pre);
+    return forest;
+}
+
+/**
+ * @brief Checks whether a block lies in a loop, including its nested loops.
+ * @param forest The forest.
+ * @param loop The loop.
+ * @param block The block.
+ * @return 1 if the block is in the loop.
+ */
+int loop_contains(const LoopForest *forest, int loop, int block)
+{
+    for (int l = forest->block_loop[block]; l >= 0; l = forest->loops[l].parent)
+    {
+        if (l == loop)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Frees a loop forest.
+ * @param forest The forest, or NULL.
+ */
+void loops_free(LoopForest *forest)
+{
+    if (!forest) return;
+    free(forest->block_loop);
+    free(forest->loops);
+    free(forest);
+}
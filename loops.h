@@ -0,0 +1,35 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include "cfg.h"
+
+// --- Loop Nesting Forest ---
+// Natural loops found from back edges, i.e. edges whose target dominates their
+// source. Loops sharing a header are merged, and each loop records the
+// innermost loop enclosing it. Irreducible cycles have no dominating header
+// and are not reported.
+
+//--- Loop ---
+typedef struct
+{
+    int header;
+    int parent;         // Enclosing loop, or -1 for an outermost loop
+    int depth;          // 1 for an outermost loop
+    int preheader;      // Sole outside predecessor, if it has the header as its only successor; else -1
+    int block_count;    // Blocks in the loop, nested loops included
+} Loop;
+
+//--- Forest ---
+typedef struct
+{
+    Loop *loops;        // Inner loops come before the loops enclosing them
+    int loop_count;
+    int *block_loop;    // Block -> innermost loop containing it, or -1
+} LoopForest;
+
+LoopForest *loops_find(const Cfg *cfg);
+int loop_contains(const LoopForest *forest, int loop, int block);
+int loop_is_back_edge(const Cfg *cfg, int from, int to);
+void loops_free(LoopForest *forest);
+
+#endif
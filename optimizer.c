@@ -0,0 +1,474 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "optimizer.h"
+#include "passes.h"
+#include "ssa.h"
+#include "thread_pool.h"
+#include "writer.h"
+
+// --- Analysis Cache ---
+
+/**
+ * @brief Returns the function's CFG, building it if the cached one is stale.
+ * @param ctx The pass context.
+ * @return The CFG, owned by the context.
+ */
+Cfg *pass_cfg(PassContext *ctx)
+{
+    if (ctx->valid & ANALYSIS_CFG)
+    {
+        ctx->analyses_reused++;
+        return ctx->cfg;
+    }
+    ctx->cfg = cfg_build(ctx->fn);
+    ctx->valid |= ANALYSIS_CFG;
+    ctx->analyses_built++;
+    return ctx->cfg;
+}
+
+/**
+ * @brief Returns the function's CFG with dominators computed.
+ * @param ctx The pass context.
+ * @return The CFG, owned by the context.
+ */
+Cfg *pass_dominators(PassContext *ctx)
+{
+    Cfg *cfg = pass_cfg(ctx);
+    if (ctx->valid & ANALYSIS_DOMINATORS)
+    {
+        ctx->analyses_reused++;
+        return cfg;
+    }
+    cfg_compute_dominators(cfg);
+    ctx->valid |= ANALYSIS_DOMINATORS;
+    ctx->analyses_built++;
+    return cfg;
+}
+
+/**
+ * @brief Returns the function's CFG with live-in and live-out sets computed.
+ * @param ctx The pass context.
+ * @return The CFG, owned by the context.
+ */
+Cfg *pass_liveness(PassContext *ctx)
+{
+    Cfg *cfg = pass_cfg(ctx);
+    if (ctx->valid & ANALYSIS_LIVENESS)
+    {
+        ctx->analyses_reused++;
+        return cfg;
+    }
+    cfg_compute_liveness(cfg, ctx->fn);
+    ctx->valid |= ANALYSIS_LIVENESS;
+    ctx->analyses_built++;
+    return cfg;
+}
+
+/**
+ * @brief Returns the def-use chains of a function in SSA form.
+ * @param ctx The pass context.
+ * @return The chains, owned by the context.
+ */
+SsaUses *pass_uses(PassContext *ctx)
+{
+    if (ctx->valid & ANALYSIS_USES)
+    {
+        ctx->analyses_reused++;
+        return &ctx->uses;
+    }
+    ssa_uses_build(&ctx->uses, ctx->fn);
+    ctx->valid |= ANALYSIS_USES;
+    ctx->analyses_built++;
+    return &ctx->uses;
+}
+
+/**
+ * @brief Returns the function's loop nesting forest.
+ * @param ctx The pass context.
+ * @return The forest, owned by the context.
+ */
+LoopForest *pass_loops(PassContext *ctx)
+{
+    Cfg *cfg = pass_dominators(ctx);
+    if (ctx->valid & ANALYSIS_LOOPS)
+    {
+        ctx->analyses_reused++;
+        return ctx->loops;
+    }
+    ctx->loops = loops_find(cfg);
+    ctx->valid |= ANALYSIS_LOOPS;
+    ctx->analyses_built++;
+    return ctx->loops;
+}
+
+/**
+ * @brief Discards every cached analysis after the function was rewritten.
+ * @param ctx The pass context.
+ */
+void pass_invalidate(PassContext *ctx)
+{
+    if (ctx->valid & ANALYSIS_CFG)
+        cfg_free(ctx->cfg);
+    if (ctx->valid & ANALYSIS_USES)
+        ssa_uses_free(&ctx->uses);
+    if (ctx->valid & ANALYSIS_LOOPS)
+        loops_free(ctx->loops);
+    ctx->cfg = NULL;
+    ctx->loops = NULL;
+    ctx->valid = 0;
+}
+
+// --- Pass Registry ---
+
+/**
+ * @brief Converts a function into SSA form.
+ * @param ctx The pass context.
+ * @return 1, since renaming always rewrites the function.
+ */
+static int ssa_build_pass(PassContext *ctx)
+{
+    ssa_build(ctx->fn);
+    return 1;
+}
+
+/**
+ * @brief Converts a function out of SSA form.
+ * @param ctx The pass context.
+ * @return 1, since phis are always replaced.
+ */
+static int ssa_destroy_pass(PassContext *ctx)
+{
+    ssa_destroy(ctx->fn);
+    return 1;
+}
+
+//--- Pass Table ---
+static const struct
+{
+    const char *name;
+    int (*run)(PassContext *ctx);  // NULL for interprocedural passes
+} pass_info[PASS_COUNT] = {
+    [PASS_INLINE] = {"inline", NULL},   // Whole program; run by optimize_program
+    [PASS_TAIL_RECURSION] = {"tailrec", tail_recursion_run},
+    [PASS_SSA_BUILD] = {"ssa", ssa_build_pass},
+    [PASS_SCCP] = {"sccp", sccp_run},
+    [PASS_COPY_PROP] = {"copyprop", copy_prop_run},
+    [PASS_GVN] = {"gvn", gvn_run},
+    [PASS_LICM] = {"licm", licm_run},
+    [PASS_STRENGTH_REDUCE] = {"strength-reduce", strength_reduce_run},
+    [PASS_DIV_CONST] = {"divconst", div_const_run},
+    [PASS_DCE] = {"dce", dce_run},
+    [PASS_SSA_DESTROY] = {"out-of-ssa", ssa_destroy_pass},
+    [PASS_COALESCE] = {"coalesce", coalesce_run},
+    [PASS_SIMPLIFY_CFG] = {"simplify-cfg", simplify_cfg_run},
+    [PASS_BLOCK_LAYOUT] = {"layout", block_layout_run},
+};
+
+//--- Pipelines ---
+// Every pipeline leaves SSA before it ends, so later stages see plain IR.
+static const PassId pipeline_o1[] = {
+    PASS_TAIL_RECURSION, PASS_SSA_BUILD, PASS_SCCP, PASS_DIV_CONST, PASS_COPY_PROP,
+    PASS_DCE, PASS_SSA_DESTROY, PASS_COALESCE, PASS_SIMPLIFY_CFG, PASS_BLOCK_LAYOUT,
+};
+
+static const PassId pipeline_o2[] = {
+    PASS_TAIL_RECURSION, PASS_SSA_BUILD, PASS_SCCP, PASS_COPY_PROP, PASS_GVN, PASS_SCCP,
+    PASS_LICM, PASS_STRENGTH_REDUCE, PASS_DIV_CONST, PASS_COPY_PROP, PASS_DCE,
+    PASS_SSA_DESTROY, PASS_COALESCE, PASS_SIMPLIFY_CFG, PASS_BLOCK_LAYOUT,
+};
+
+/**
+ * @brief Looks up a pass by the name used in --print-after.
+ * @param name The pass name.
+ * @return The PassId, or -1 if no pass has that name.
+ */
+int optimizer_find_pass(const char *name)
+{
+    for (int i = 0; i < PASS_COUNT; i++)
+    {
+        if (strcmp(pass_info[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Dumps a function's IR to stderr after a pass.
+ * @param program The program owning the function.
+ * @param fn The function.
+ * @param pass The pass that just ran.
+ */
+static void print_after(const IrProgram *program, const IrFunction *fn, PassId pass)
+{
+    Writer *w = malloc(sizeof(Writer));
+    if (!w)
+    {
+        perror("Failed to allocate the IR dump writer");
+        return;
+    }
+    writer_init(w, STDERR_FILENO);
+    writer_puts(w, "; *** IR Dump After ");
+    writer_puts(w, pass_info[pass].name);
+    writer_puts(w, " (");
+    writer_puts(w, fn->name);
+    writer_puts(w, ") ***\n");
+    ir_print_function(w, program, fn);
+    writer_flush(w);
+    free(w);
+}
+
+/**
+ * @brief Checks whether --print-after asks for a dump after a pass.
+ * @param options The optimizer options.
+ * @param pass The pass that just ran.
+ * @return 1 if the function should be dumped.
+ */
+static int wants_dump(const OptOptions *options, PassId pass)
+{
+    return options->print_after &&
+           (strcmp(options->print_after, "all") == 0 || strcmp(options->print_after, pass_info[pass].name) == 0);
+}
+
+/**
+ * @brief Runs the interprocedural passes over the whole program.
+ * @param program The program to optimize.
+ * @param options The optimizer options.
+ * @param report The report to add statistics and timings to.
+ */
+static void optimize_interprocedural(IrProgram *program, const OptOptions *options, OptReport *report)
+{
+    PassTiming *timing = &report->timing[PASS_INLINE];
+    long inlined = report->stats.counts[STAT_INLINED];
+    long before = 0, after = 0;
+    for (int i = 0; i < program->function_count; i++)
+        before += program->functions[i].instr_count;
+    double start = stats_now_seconds();
+
+    inline_program(program, options->inline_budget, options->report_inlining ? stderr : NULL, &report->stats);
+
+    timing->seconds += stats_now_seconds() - start;
+    for (int i = 0; i < program->function_count; i++)
+        after += program->functions[i].instr_count;
+    timing->runs++;
+    timing->changed += report->stats.counts[STAT_INLINED] != inlined;
+    timing->instr_delta += after - before;
+
+    if (wants_dump(options, PASS_INLINE))
+    {
+        for (int i = 0; i < program->function_count; i++)
+        {
+            if (program->functions[i].defined)
+                print_after(program, &program->functions[i], PASS_INLINE);
+        }
+    }
+}
+
+/**
+ * @brief Runs a pipeline on one function, timing each pass.
+ * @param program The program owning the function.
+ * @param fn The function to optimize.
+ * @param pipeline The passes to run, in order.
+ * @param count The number of passes.
+ * @param options The optimizer options.
+ * @param report The report to add statistics and timings to.
+ */
+static void optimize_function(const IrProgram *program, IrFunction *fn, const PassId *pipeline, int count,
+                              const OptOptions *options, OptReport *report)
+{
+    PassContext ctx;
+    memset(&ctx, 0, sizeof(PassContext));
+    ctx.fn = fn;
+    ctx.index = (int)(fn - program->functions);
+    ctx.stats = &report->stats;
+
+    for (int i = 0; i < count; i++)
+    {
+        PassId pass = pipeline[i];
+        PassTiming *timing = &report->timing[pass];
+        int before = fn->instr_count;
+        double start = stats_now_seconds();
+
+        int changed = pass_info[pass].run(&ctx);
+        if (changed)
+            pass_invalidate(&ctx);
+
+        timing->seconds += stats_now_seconds() - start;
+        timing->runs++;
+        timing->changed += changed != 0;
+        timing->instr_delta += fn->instr_count - before;
+
+        if (wants_dump(options, pass))
+            print_after(program, fn, pass);
+    }
+
+    pass_invalidate(&ctx);
+    report->analyses_built += ctx.analyses_built;
+    report->analyses_reused += ctx.analyses_reused;
+}
+
+//--- Parallel Job ---
+// Functions are optimized independently: a pass only touches the function it
+// runs on, and reads of the program (callee names in dumps) never race with
+// writes. Each worker adds to its own report, so nothing is shared but the
+// work queues.
+typedef struct
+{
+    IrProgram *program;
+    const PassId *pipeline;
+    int count;
+    const OptOptions *options;
+    OptReport *reports;     // One per worker
+} OptJob;
+
+/**
+ * @brief Thread pool task: runs the pipeline on one function.
+ * @param context The OptJob.
+ * @param task The function's index in the program.
+ * @param worker The worker running the task.
+ */
+static void optimize_task(void *context, int task, int worker)
+{
+    OptJob *job = context;
+    optimize_function(job->program, &job->program->functions[task], job->pipeline, job->count,
+                      job->options, &job->reports[worker]);
+}
+
+//--- Function Size Ordering ---
+typedef struct
+{
+    int index;
+    int size;
+} FunctionSize;
+
+/**
+ * @brief qsort comparator: larger functions first, then program order.
+ * @param a The first FunctionSize.
+ * @param b The second FunctionSize.
+ * @return The comparison result.
+ */
+static int compare_sizes(const void *a, const void *b)
+{
+    const FunctionSize *x = a, *y = b;
+    if (x->size != y->size) return y->size - x->size;
+    return x->index - y->index;
+}
+
+/**
+ * @brief Optimizes every defined function of a program in place.
+ *
+ * Functions run in parallel on a work-stealing pool, largest first so the
+ * long tasks start early. The result does not depend on the number of
+ * workers or on scheduling, since every function is rewritten in isolation.
+ * Dumps from --print-after force a single worker so they appear in program
+ * order.
+ *
+ * @param program The program to optimize.
+ * @param options The optimization level, dump, thread and inlining options; -O0 runs no passes.
+ * @param report Counters and per-pass timings to update.
+ */
+void optimize_program(IrProgram *program, const OptOptions *options, OptReport *report)
+{
+    const PassId *pipeline = NULL;
+    int count = 0;
+    if (options->level == 1)
+    {
+        pipeline = pipeline_o1;
+        count = sizeof(pipeline_o1) / sizeof(pipeline_o1[0]);
+    }
+    else if (options->level >= 2)
+    {
+        pipeline = pipeline_o2;
+        count = sizeof(pipeline_o2) / sizeof(pipeline_o2[0]);
+    }
+    if (count == 0) return;
+
+    // Interprocedural passes see every function, so they run before the
+    // functions are handed out to workers.
+    if (options->level >= 2)
+        optimize_interprocedural(program, options, report);
+
+    FunctionSize *sizes = malloc((program->function_count + 1) * sizeof(FunctionSize));
+    int defined = 0;
+    for (int i = 0; i < program->function_count; i++)
+    {
+        if (!program->functions[i].defined) continue;
+        sizes[defined].index = i;
+        sizes[defined].size = program->functions[i].instr_count;
+        defined++;
+    }
+    qsort(sizes, defined, sizeof(FunctionSize), compare_sizes);
+    int *order = malloc((defined + 1) * sizeof(int));
+    for (int i = 0; i < defined; i++)
+        order[i] = sizes[i].index;
+
+    int workers = options->jobs > 0 ? options->jobs : thread_pool_default_workers();
+    if (options->print_after)
+        workers = 1;
+    if (workers > defined)
+        workers = defined > 0 ? defined : 1;
+
+    OptJob job = {program, pipeline, count, options, calloc(workers, sizeof(OptReport))};
+    int used = thread_pool_run(defined, order, workers, optimize_task, &job);
+    for (int w = 0; w < workers; w++)
+        opt_report_merge(report, &job.reports[w]);
+    report->workers = used;
+
+    free(job.reports);
+    free(order);
+    free(sizes);
+}
+
+/**
+ * @brief Adds one report's counters and timings to another.
+ * @param into The report receiving the sums.
+ * @param from The report to add.
+ */
+void opt_report_merge(OptReport *into, const OptReport *from)
+{
+    stats_merge(&into->stats, &from->stats);
+    for (int i = 0; i < PASS_COUNT; i++)
+    {
+        into->timing[i].runs += from->timing[i].runs;
+        into->timing[i].changed += from->timing[i].changed;
+        into->timing[i].instr_delta += from->timing[i].instr_delta;
+        into->timing[i].seconds += from->timing[i].seconds;
+    }
+    into->analyses_built += from->analyses_built;
+    into->analyses_reused += from->analyses_reused;
+}
+
+/**
+ * @brief Prints the optimization counters followed by per-pass timings.
+ *
+ * The timing table is left out when no pass ran, as at -O0.
+ *
+ * @param out The stream to print to.
+ * @param report The report.
+ */
+void opt_report_print(FILE *out, const OptReport *report)
+{
+    stats_print(out, &report->stats);
+
+    int ran = 0;
+    for (int i = 0; i < PASS_COUNT; i++)
+        ran |= report->timing[i].runs != 0;
+    if (!ran) return;
+
+    fprintf(out, "=== Pass Execution Timing ===\n");
+    fprintf(out, "%10s %6s %8s %8s  %s\n", "Time (ms)", "Runs", "Changed", "Instrs", "Pass");
+    double total = 0;
+    for (int i = 0; i < PASS_COUNT; i++)
+    {
+        const PassTiming *t = &report->timing[i];
+        if (t->runs == 0) continue;
+        fprintf(out, "%10.3f %6ld %8ld %+8ld  %s\n", t->seconds * 1000, t->runs, t->changed, t->instr_delta, pass_info[i].name);
+        total += t->seconds;
+    }
+    fprintf(out, "%10.3f %6s %8s %8s  %s\n", total * 1000, "", "", "", "Total");
+    fprintf(out, "Analyses: %ld computed, %ld reused from cache\n", report->analyses_built, report->analyses_reused);
+    if (report->workers > 1)
+        fprintf(out, "Pass times are summed over %d worker threads\n", report->workers);
+}
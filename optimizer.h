@@ -0,0 +1,65 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stdio.h>
+
+#include "ir.h"
+#include "stats.h"
+
+//--- Pass Identifiers ---
+typedef enum
+{
+    PASS_INLINE,
+    PASS_TAIL_RECURSION,
+    PASS_SSA_BUILD,
+    PASS_SCCP,
+    PASS_COPY_PROP,
+    PASS_GVN,
+    PASS_LICM,
+    PASS_STRENGTH_REDUCE,
+    PASS_DIV_CONST,
+    PASS_DCE,
+    PASS_SSA_DESTROY,
+    PASS_COALESCE,
+    PASS_SIMPLIFY_CFG,
+    PASS_BLOCK_LAYOUT,
+    PASS_COUNT
+} PassId;
+
+//--- Optimizer Options ---
+typedef struct
+{
+    int level;                  // -O0, -O1 or -O2
+    const char *print_after;    // Pass whose output is dumped to stderr, "all", or NULL
+    int jobs;                   // Worker threads; 0 for one per processor
+    int inline_budget;          // Largest callee, in instructions, inlined at -O2
+    int report_inlining;        // Print each inlining decision to stderr
+} OptOptions;
+
+#define OPT_DEFAULT_INLINE_BUDGET 40
+
+//--- Per-Pass Instrumentation ---
+typedef struct
+{
+    long runs;
+    long changed;           // Runs that reported a change
+    long instr_delta;       // Sum of (instructions after - instructions before)
+    double seconds;
+} PassTiming;
+
+//--- Optimization Report ---
+typedef struct
+{
+    OptStats stats;
+    PassTiming timing[PASS_COUNT];
+    long analyses_built;
+    long analyses_reused;
+    int workers;            // Threads used by the last optimize_program
+} OptReport;
+
+int optimizer_find_pass(const char *name);
+void optimize_program(IrProgram *program, const OptOptions *options, OptReport *report);
+void opt_report_merge(OptReport *into, const OptReport *from);
+void opt_report_print(FILE *out, const OptReport *report);
+
+#endif
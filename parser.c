@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "parser.h"
+
+// --- Grammar ---
+// <program>   ::= { <function> }
+// <function>  ::= "int" <identifier> "(" "void" ")" "{" <statement> "}"
+// <statement> ::= "return" <exp> ";"
+// <exp>       ::= <int>
+
+//--- Parser State ---
+typedef struct
+{
+    const TokenList *tokens;
+    int pos;
+} Parser;
+
+/**
+ * @brief Returns the current token without consuming it.
+ * @param parser The parser state.
+ * @return A pointer to the current token.
+ */
+static const Token *peek(const Parser *parser)
+{
+    return &parser->tokens->tokens[parser->pos];
+}
+
+/**
+ * @brief Consumes the current token if it has the expected type.
+ * @param parser The parser state.
+ * @param type The expected token type.
+ * @return A pointer to the consumed token, or NULL (after reporting an error) on mismatch.
+ */
+static const Token *expect(Parser *parser, TokenType type)
+{
+    const Token *token = peek(parser);
+    if (token->type != type) 
+    {
+        fprintf(stderr, "Parse error: expected %s but found %s", 
+                token_to_debug_string(type), token_to_debug_string(token->type));
+        if (token->lexeme) 
+            fprintf(stderr, " (\"%s\")", token->lexeme);
+        fprintf(stderr, "\n");
+        return NULL;
+    }
+    if (token->type != TOKEN_EOF) 
+        parser->pos++;
+    return token;
+}
+
+/**
+ * @brief Parses an expression.
+ * @param parser The parser state.
+ * @return The expression node, or NULL on error.
+ */
+static AstNode *parse_exp(Parser *parser)
+{
+    const Token *token = expect(parser, TOKEN_CONSTANT);
+    if (!token) return NULL;
+
+    errno = 0;
+    long value = strtol(token->lexeme, NULL, 10);
+    if (errno == ERANGE || value > INT_MAX) 
+    {
+        fprintf(stderr, "Parse error: integer constant %s is out of range for int\n", token->lexeme);
+        return NULL;
+    }
+
+    AstNode *node = ast_new(AST_CONSTANT);
+    node->value = value;
+    return node;
+}
+
+/**
+ * @brief Parses a statement.
+ * @param parser The parser state.
+ * @return The statement node, or NULL on error.
+ */
+static AstNode *parse_statement(Parser *parser)
+{
+    if (!expect(parser, TOKEN_RETURN)) return NULL;
+
+    AstNode *exp = parse_exp(parser);
+    if (!exp) return NULL;
+
+    if (!expect(parser, TOKEN_SEMICOLON)) 
+    {
+        ast_free(exp);
+        return NULL;
+    }
+
+    AstNode *node = ast_new(AST_RETURN);
+    ast_add_child(node, exp);
+    return node;
+}
+
+/**
+ * @brief Parses a function definition.
+ * @param parser The parser state.
+ * @return The function node, or NULL on error.
+ */
+static AstNode *parse_function(Parser *parser)
+{
+    if (!expect(parser, TOKEN_INT)) return NULL;
+
+    const Token *name = expect(parser, TOKEN_IDENTIFIER);
+    if (!name) return NULL;
+
+    if (!expect(parser, TOKEN_OPEN_PAREN) || !expect(parser, TOKEN_VOID) || 
+        !expect(parser, TOKEN_CLOSE_PAREN) || !expect(parser, TOKEN_OPEN_BRACE)) 
+        return NULL;
+
+    AstNode *node = ast_new(AST_FUNCTION);
+    node->name = strdup(name->lexeme);
+
+    AstNode *body = parse_statement(parser);
+    if (!body || !expect(parser, TOKEN_CLOSE_BRACE)) 
+    {
+        ast_free(body);
+        ast_free(node);
+        return NULL;
+    }
+    ast_add_child(node, body);
+    return node;
+}
+
+/**
+ * @brief Parses a whole translation unit.
+ * @param tokens The token list produced by tokenize, terminated by TOKEN_EOF.
+ * @return The AST_PROGRAM root, or NULL if the input has a syntax error.
+ */
+AstNode *parse_program(const TokenList *tokens)
+{
+    Parser parser = {tokens, 0};
+    AstNode *program = ast_new(AST_PROGRAM);
+
+    do {
+        AstNode *function = parse_function(&parser);
+        if (!function) 
+        {
+            ast_free(program);
+            return NULL;
+        }
+        ast_add_child(program, function);
+    } while (peek(&parser)->type != TOKEN_EOF);
+
+    return program;
+}
@@ -0,0 +1,9 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "ast.h"
+#include "lexer.h"
+
+AstNode *parse_program(const TokenList *tokens);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef PASSES_H
+#define PASSES_H
+
+#include "ir.h"
+#include "cfg.h"
+#include "loops.h"
+#include "ssa.h"
+#include "stats.h"
+
+//--- Cached Analyses ---
+typedef enum
+{
+    ANALYSIS_CFG = 1 << 0,
+    ANALYSIS_DOMINATORS = 1 << 1,
+    ANALYSIS_LIVENESS = 1 << 2,
+    ANALYSIS_USES = 1 << 3,
+    ANALYSIS_LOOPS = 1 << 4
+} AnalysisKind;
+
+//--- Pass Context ---
+// What a pass sees of the function it runs on. Analyses are computed on first
+// request and kept until the function changes: the pass manager drops them
+// after any pass that reports a change, and a pass that rewrites the function
+// and then wants a fresh analysis calls pass_invalidate itself.
+typedef struct
+{
+    IrFunction *fn;
+    int index;              // fn's position in IrProgram.functions, as IR_CALL names callees
+    OptStats *stats;
+    Cfg *cfg;
+    SsaUses uses;
+    LoopForest *loops;
+    unsigned valid;         // AnalysisKind bits
+    long analyses_built;
+    long analyses_reused;
+} PassContext;
+
+Cfg *pass_cfg(PassContext *ctx);
+Cfg *pass_dominators(PassContext *ctx);
+Cfg *pass_liveness(PassContext *ctx);
+SsaUses *pass_uses(PassContext *ctx);
+LoopForest *pass_loops(PassContext *ctx);
+void pass_invalidate(PassContext *ctx);
+
+// --- Interprocedural Passes ---
+
+void inline_program(IrProgram *program, int budget, FILE *remarks, OptStats *stats);
+
+// --- SSA Passes ---
+// Each pass rewrites ctx->fn in place, adds to ctx->stats, and returns 1 if it
+// changed the function.
+
+int sccp_run(PassContext *ctx);
+int copy_prop_run(PassContext *ctx);
+int gvn_run(PassContext *ctx);
+int licm_run(PassContext *ctx);
+int strength_reduce_run(PassContext *ctx);
+int div_const_run(PassContext *ctx);
+int dce_run(PassContext *ctx);
+
+// --- Non-SSA Passes ---
+
+int tail_recursion_run(PassContext *ctx);
+int coalesce_run(PassContext *ctx);
+int simplify_cfg_run(PassContext *ctx);
+int block_layout_run(PassContext *ctx);
+
+#endif
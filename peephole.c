@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm.h"
+
+// --- Peephole Optimization ---
+// Runs over the final instruction list, after fix-up and before emission,
+// when every operand is a machine register, a stack slot or an immediate.
+// Each rule looks at a window of consecutive instructions (deleted ones,
+// ASM_NOP, are skipped) and rewrites it in place; the table is applied at
+// every position and the pass repeats while rules keep firing, since one
+// rewrite can expose another.
+//
+// Flags are never live across a label, jump, return or call: instruction
+// selection always compares in the same block as the jcc or setcc that
+// reads the result.
+
+#define PEEPHOLE_MAX_WINDOW 3
+#define PEEPHOLE_MAX_ROUNDS 8
+
+//--- Rule ---
+typedef struct
+{
+    StatId stat;        // Hit counter
+    int window;         // Instructions the rule looks at
+    int (*apply)(AsmFunction *fn, const int *at);
+} PeepholeRule;
+
+// --- Flags ---
+
+/**
+ * @brief Checks whether an instruction overwrites all the arithmetic flags.
+ * @param op The opcode.
+ * @return 1 for compares and arithmetic; shifts by %cl may leave the flags alone.
+ */
+static int writes_flags(AsmOpcode op)
+{
+    switch (op)
+    {
+        case ASM_ADD:
+        case ASM_SUB:
+        case ASM_IMUL:
+        case ASM_NEG:
+        case ASM_CMP:
+        case ASM_TEST:
+        case ASM_XOR:
+        case ASM_IDIV:
+        case ASM_IMUL_WIDE:
+        case ASM_ALLOC_STACK:
+        case ASM_DEALLOC_STACK:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Checks whether an instruction ends the region where flags can be live.
+ * @param op The opcode.
+ * @return 1 for labels, jumps, calls and returns.
+ */
+static int flags_boundary(AsmOpcode op)
+{
+    return op == ASM_LABEL || op == ASM_JMP || op == ASM_CALL || op == ASM_RET || op == ASM_TAIL_CALL;
+}
+
+/**
+ * @brief Checks whether every reader of the flags set before an instruction only tests for zero.
+ * @param fn The function.
+ * @param i The instruction after which to look.
+ * @param zero_only 1 to allow readers testing e and ne, 0 to allow none.
+ * @return 1 if no other reader can see the flags.
+ */
+static int flags_readers_allowed(const AsmFunction *fn, int i, int zero_only)
+{
+    for (int j = i + 1; j < fn->instr_count; j++)
+    {
+        const AsmInstr *instr = &fn->instrs[j];
+        if (instr->op == ASM_SETCC || instr->op == ASM_JCC)
+        {
+            if (!zero_only || (instr->cond != COND_E && instr->cond != COND_NE))
+                return 0;
+            if (instr->op == ASM_SETCC) continue;
+        }
+        if (writes_flags(instr->op) || flags_boundary(instr->op))
+            return 1;
+    }
+    return 1;
+}
+
+// --- Rules ---
+
+/**
+ * @brief mov a, a
+ */
+static int rule_self_move(AsmFunction *fn, const int *at)
+{
+    AsmInstr *mov = &fn->instrs[at[0]];
+    if (mov->op != ASM_MOV || !asm_same_operand(mov->src, mov->dst)) return 0;
+    mov->op = ASM_NOP;
+    return 1;
+}
+
+/**
+ * @brief mov a, b; mov a, b or mov a, b; mov b, a: the second changes nothing.
+ */
+static int rule_redundant_move(AsmFunction *fn, const int *at)
+{
+    AsmInstr *first = &fn->instrs[at[0]];
+    AsmInstr *second = &fn->instrs[at[1]];
+    if (first->op != ASM_MOV || second->op != ASM_MOV) return 0;
+    int repeat = asm_same_operand(first->src, second->src) && asm_same_operand(first->dst, second->dst);
+    int undo = asm_same_operand(first->src, second->dst) && asm_same_operand(first->dst, second->src);
+    if (!repeat && !undo) return 0;
+    second->op = ASM_NOP;
+    return 1;
+}
+
+/**
+ * @brief Checks whether a label follows an instruction, with only labels in between.
+ * @param fn The function.
+ * @param i The instruction.
+ * @param label The label.
+ * @return 1 if falling through from i reaches the label directly.
+ */
+static int label_follows(const AsmFunction *fn, int i, int label)
+{
+    for (int j = i + 1; j < fn->instr_count; j++)
+    {
+        const AsmInstr *instr = &fn->instrs[j];
+        if (instr->op == ASM_NOP) continue;
+        if (instr->op != ASM_LABEL) return 0;
+        if (instr->label == label) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief jmp L or jcc L; L:
+ */
+static int rule_jump_next(AsmFunction *fn, const int *at)
+{
+    AsmInstr *jump = &fn->instrs[at[0]];
+    if ((jump->op != ASM_JMP && jump->op != ASM_JCC) || !label_follows(fn, at[0], jump->label)) return 0;
+    jump->op = ASM_NOP;
+    return 1;
+}
+
+/**
+ * @brief jcc L1; jmp L2; L1: becomes jncc L2; L1:
+ */
+static int rule_branch_over_jump(AsmFunction *fn, const int *at)
+{
+    static const AsmCond inverse[] = {
+        [COND_E] = COND_NE, [COND_NE] = COND_E, [COND_L] = COND_GE,
+        [COND_LE] = COND_G, [COND_G] = COND_LE, [COND_GE] = COND_L,
+    };
+    AsmInstr *branch = &fn->instrs[at[0]];
+    AsmInstr *jump = &fn->instrs[at[1]];
+    if (branch->op != ASM_JCC || jump->op != ASM_JMP || !label_follows(fn, at[1], branch->label)) return 0;
+    branch->cond = inverse[branch->cond];
+    branch->label = jump->label;
+    branch->branch = -branch->branch;
+    jump->op = ASM_NOP;
+    return 1;
+}
+
+/**
+ * @brief op x; cmp $0, x (or test x, x) where only e and ne are read: op already set ZF.
+ */
+static int rule_known_flags(AsmFunction *fn, const int *at)
+{
+    const AsmInstr *op = &fn->instrs[at[0]];
+    AsmInstr *cmp = &fn->instrs[at[1]];
+    if (op->op != ASM_ADD && op->op != ASM_SUB && op->op != ASM_NEG && op->op != ASM_XOR) return 0;
+    int zero_test = (cmp->op == ASM_CMP && cmp->src.kind == ASM_OPERAND_IMM && cmp->src.value == 0) ||
+                    (cmp->op == ASM_TEST && asm_same_operand(cmp->src, cmp->dst));
+    if (!zero_test || !asm_same_operand(op->dst, cmp->dst) || !flags_readers_allowed(fn, at[1], 1)) return 0;
+    cmp->op = ASM_NOP;
+    return 1;
+}
+
+/**
+ * @brief cmp a, b; jcc L; cmp a, b: the flags are unchanged on the fall-through path.
+ */
+static int rule_repeated_compare(AsmFunction *fn, const int *at)
+{
+    const AsmInstr *first = &fn->instrs[at[0]];
+    const AsmInstr *jump = &fn->instrs[at[1]];
+    AsmInstr *second = &fn->instrs[at[2]];
+    if ((first->op != ASM_CMP && first->op != ASM_TEST) || jump->op != ASM_JCC || second->op != first->op) return 0;
+    if (!asm_same_operand(first->src, second->src) || !asm_same_operand(first->dst, second->dst)) return 0;
+    second->op = ASM_NOP;
+    return 1;
+}
+
+/**
+ * @brief Checks whether an operand reads a register.
+ * @param operand The operand.
+ * @param reg The register.
+ * @return 1 if the operand is that register.
+ */
+static int uses_reg(AsmOperand operand, AsmReg reg)
+{
+    return operand.kind == ASM_OPERAND_REG && operand.reg == reg;
+}
+
+/**
+ * @brief cmp a, b; mov $0, r; setcc r becomes xor r, r; cmp a, b; setcc r.
+ */
+static int rule_zero_hoisted(AsmFunction *fn, const int *at)
+{
+    AsmInstr cmp = fn->instrs[at[0]];
+    const AsmInstr *mov = &fn->instrs[at[1]];
+    const AsmInstr *set = &fn->instrs[at[2]];
+    if ((cmp.op != ASM_CMP && cmp.op != ASM_TEST) || mov->op != ASM_MOV || set->op != ASM_SETCC) return 0;
+    if (mov->src.kind != ASM_OPERAND_IMM || mov->src.value != 0 || mov->dst.kind != ASM_OPERAND_REG) return 0;
+    AsmReg reg = mov->dst.reg;
+    if (!uses_reg(set->dst, reg) || uses_reg(cmp.src, reg) || uses_reg(cmp.dst, reg)) return 0;
+
+    AsmInstr *xor = &fn->instrs[at[0]];
+    xor->op = ASM_XOR;
+    xor->src = xor->dst = asm_reg(reg);
+    fn->instrs[at[1]] = cmp;
+    return 1;
+}
+
+/**
+ * @brief mov $0, r becomes xor r, r when the flags are dead.
+ */
+static int rule_zero_xor(AsmFunction *fn, const int *at)
+{
+    AsmInstr *mov = &fn->instrs[at[0]];
+    if (mov->op != ASM_MOV || mov->src.kind != ASM_OPERAND_IMM || mov->src.value != 0 || mov->dst.kind != ASM_OPERAND_REG) return 0;
+    if (!flags_readers_allowed(fn, at[0], 0)) return 0;
+    mov->op = ASM_XOR;
+    mov->src = mov->dst;
+    return 1;
+}
+
+/**
+ * @brief cmp $0, r becomes test r, r.
+ */
+static int rule_test(AsmFunction *fn, const int *at)
+{
+    AsmInstr *cmp = &fn->instrs[at[0]];
+    if (cmp->op != ASM_CMP || cmp->src.kind != ASM_OPERAND_IMM || cmp->src.value != 0 || cmp->dst.kind != ASM_OPERAND_REG) return 0;
+    cmp->op = ASM_TEST;
+    cmp->src = cmp->dst;
+    return 1;
+}
+
+static const PeepholeRule peephole_rules[] = {
+    {STAT_PEEP_SELF_MOVE, 1, rule_self_move},
+    {STAT_PEEP_REDUNDANT_MOVE, 2, rule_redundant_move},
+    {STAT_PEEP_JUMP_NEXT, 1, rule_jump_next},
+    {STAT_PEEP_BRANCH_INVERTED, 2, rule_branch_over_jump},
+    {STAT_PEEP_KNOWN_FLAGS, 2, rule_known_flags},
+    {STAT_PEEP_KNOWN_FLAGS, 3, rule_repeated_compare},
+    {STAT_PEEP_ZERO_HOISTED, 3, rule_zero_hoisted},
+    {STAT_PEEP_ZERO_XOR, 1, rule_zero_xor},
+    {STAT_PEEP_TEST, 1, rule_test},
+};
+
+// --- Driver ---
+
+/**
+ * @brief Collects an instruction and the live instructions after it.
+ * @param fn The function.
+ * @param i The first instruction.
+ * @param at Receives up to PEEPHOLE_MAX_WINDOW indices.
+ * @return The number of indices.
+ */
+static int fill_window(const AsmFunction *fn, int i, int *at)
+{
+    int size = 0;
+    for (int j = i; j < fn->instr_count && size < PEEPHOLE_MAX_WINDOW; j++)
+    {
+        if (fn->instrs[j].op != ASM_NOP)
+            at[size++] = j;
+    }
+    return size;
+}
+
+/**
+ * @brief Slides the rule table over one function until no rule fires.
+ * @param fn The function.
+ * @param stats Receives a hit count per rule.
+ */
+static void peephole_function(AsmFunction *fn, OptStats *stats)
+{
+    int changed = 1;
+    for (int round = 0; changed && round < PEEPHOLE_MAX_ROUNDS; round++)
+    {
+        changed = 0;
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            int at[PEEPHOLE_MAX_WINDOW];
+            int size = fill_window(fn, i, at);
+            for (size_t r = 0; r < sizeof(peephole_rules) / sizeof(peephole_rules[0]); r++)
+            {
+                const PeepholeRule *rule = &peephole_rules[r];
+                if (fn->instrs[i].op == ASM_NOP) break;
+                if (rule->window > size || !rule->apply(fn, at)) continue;
+                stats->counts[rule->stat]++;
+                changed = 1;
+                size = fill_window(fn, i, at);
+            }
+        }
+    }
+
+    // Drop the deleted instructions.
+    int kept = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (fn->instrs[i].op != ASM_NOP)
+            fn->instrs[kept++] = fn->instrs[i];
+    }
+    fn->instr_count = kept;
+}
+
+/**
+ * @brief Applies the peephole rules to every function.
+ * @param program The program after fix-up.
+ * @param stats Receives a hit count per rule.
+ */
+void peephole_program(AsmProgram *program, OptStats *stats)
+{
+    for (int f = 0; f < program->function_count; f++)
+    {
+        if (program->functions[f].defined)
+            peephole_function(&program->functions[f], stats);
+    }
+}
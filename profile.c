@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+// Block counts are refined this many times at most; a round visits the
+// blocks in layout order, so forward paths settle in one round and only
+// cycles without measured branches take more.
+#define PROFILE_MAX_ROUNDS 16
+
+/**
+ * @brief Gives every conditional jump a program-wide branch id, in program order.
+ *
+ * Runs on the unoptimized IR, so a build with -fprofile-generate and one with
+ * -fprofile-use of the same source agree on the ids.
+ *
+ * @param program The program, straight from IR generation.
+ */
+void profile_number_branches(IrProgram *program)
+{
+    int count = 0;
+    for (int f = 0; f < program->function_count; f++)
+    {
+        IrFunction *fn = &program->functions[f];
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            IrInstr *instr = &fn->instrs[i];
+            if (instr->op == IR_JUMP_IF_ZERO || instr->op == IR_JUMP_IF_NOT_ZERO)
+                instr->branch = ++count;
+        }
+    }
+    program->branch_count = count;
+}
+
+/**
+ * @brief Mixes bytes into a 64-bit FNV-1a hash.
+ * @param hash The hash so far.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return The updated hash.
+ */
+static uint64_t fnv_mix(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hashes the shape of the unoptimized IR: function names, parameter counts and opcodes.
+ * @param program The program, before optimization.
+ * @return The checksum recorded in the profile.
+ */
+uint64_t profile_checksum(const IrProgram *program)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int f = 0; f < program->function_count; f++)
+    {
+        const IrFunction *fn = &program->functions[f];
+        hash = fnv_mix(hash, fn->name, strlen(fn->name) + 1);
+        hash = fnv_mix(hash, &fn->param_count, sizeof(int));
+        hash = fnv_mix(hash, &fn->instr_count, sizeof(int));
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            unsigned char op = (unsigned char)fn->instrs[i].op;
+            hash = fnv_mix(hash, &op, 1);
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief Loads a profile written by a -fprofile-generate build and attaches it to the program.
+ *
+ * A missing, truncated or mismatched file only earns a warning, and the
+ * program is then compiled without a profile.
+ *
+ * @param program The program, with branches numbered and not yet optimized.
+ * @param path The profile file.
+ * @return 0 on success, -1 if the profile was not used.
+ */
+int profile_load(IrProgram *program, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Warning: Cannot open profile %s; compiling without it.\n", path);
+        return -1;
+    }
+
+    ProfileHeader header;
+    size_t total = (size_t)program->function_count + 2 * (size_t)program->branch_count;
+    uint64_t *counts = malloc((total + 1) * sizeof(uint64_t));
+    const char *problem = NULL;
+    if (fread(&header, sizeof(ProfileHeader), 1, file) != 1 ||
+        memcmp(header.magic, PROFILE_MAGIC, sizeof(header.magic)) != 0)
+        problem = "not a profile";
+    else if (header.checksum != profile_checksum(program) ||
+             header.function_count != (uint64_t)program->function_count ||
+             header.branch_count != (uint64_t)program->branch_count)
+        problem = "recorded for a different program";
+    else if (fread(counts, sizeof(uint64_t), total, file) != total)
+        problem = "truncated";
+    fclose(file);
+
+    if (problem)
+    {
+        fprintf(stderr, "Warning: Profile %s is %s; compiling without it.\n", path, problem);
+        free(counts);
+        return -1;
+    }
+
+    free(program->profile);
+    program->profile = counts;
+    for (int f = 0; f < program->function_count; f++)
+    {
+        program->functions[f].entry_count = counts[f];
+        program->functions[f].branch_counts = counts + program->function_count;
+    }
+    return 0;
+}
+
+/**
+ * @brief Estimates how often each block runs from the measured branch counts.
+ *
+ * A block runs as often as control enters it: from the function's entry and
+ * along each incoming edge. Edges out of a measured conditional jump carry
+ * their recorded counts; an edge that is the only way out carries its
+ * block's count, and an unmeasured split divides it evenly.
+ *
+ * @param succs Two successors per block, -1 when unused.
+ * @param edge_counts Two per block, matching succs: a measured count, or -1
+ *                    when unknown; unknown entries receive their estimates.
+ * @param block_count The number of blocks; block 0 is the entry.
+ * @param entry_count How often the function was entered.
+ * @param counts Receives each block's estimated count.
+ */
+void profile_block_counts(const int *succs, long *edge_counts, int block_count, long entry_count, long *counts)
+{
+    int n = block_count;
+    int *pred_start = calloc(n + 2, sizeof(int));   // Edges into b: pred_edges[pred_start[b] .. pred_start[b + 1])
+    for (int e = 0; e < 2 * n; e++)
+    {
+        if (succs[e] >= 0)
+            pred_start[succs[e] + 1]++;
+    }
+    for (int b = 0; b < n; b++)
+        pred_start[b + 1] += pred_start[b];
+    int *pred_edges = malloc((pred_start[n] + 1) * sizeof(int));
+    int *fill = malloc((n + 1) * sizeof(int));
+    memcpy(fill, pred_start, n * sizeof(int));
+    for (int e = 0; e < 2 * n; e++)
+    {
+        if (succs[e] >= 0)
+            pred_edges[fill[succs[e]]++] = e;
+    }
+
+    unsigned char *measured = malloc(2 * n + 1);
+    for (int e = 0; e < 2 * n; e++)
+    {
+        measured[e] = edge_counts[e] >= 0;
+        if (!measured[e])
+            edge_counts[e] = 0;
+    }
+    for (int b = 0; b < n; b++)
+        counts[b] = 0;
+
+    for (int round = 0; round < PROFILE_MAX_ROUNDS; round++)
+    {
+        int changed = 0;
+        for (int b = 0; b < n; b++)
+        {
+            long count = b == 0 ? entry_count : 0;
+            for (int p = pred_start[b]; p < pred_start[b + 1]; p++)
+                count += edge_counts[pred_edges[p]];
+            if (count != counts[b])
+            {
+                counts[b] = count;
+                changed = 1;
+            }
+
+            long *out = &edge_counts[2 * b];
+            int used0 = succs[2 * b] >= 0, used1 = succs[2 * b + 1] >= 0;
+            if (!measured[2 * b] && !measured[2 * b + 1])
+            {
+                out[0] = used0 ? (used1 ? count / 2 : count) : 0;
+                out[1] = used1 ? count - out[0] : 0;
+            }
+            else if (!measured[2 * b])
+                out[0] = count > out[1] ? count - out[1] : 0;
+            else if (!measured[2 * b + 1])
+                out[1] = count > out[0] ? count - out[0] : 0;
+        }
+        if (!changed) break;
+    }
+
+    free(measured);
+    free(fill);
+    free(pred_edges);
+    free(pred_start);
+}
@@ -0,0 +1,59 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#include "ir.h"
+
+// --- Profile-Guided Optimization ---
+// -fprofile-generate numbers every conditional jump right after IR generation
+// and has the assembly printer count, per function, how often it is entered
+// and, per branch, how often it is taken and not taken. The instrumented
+// program writes the counters out when it exits, adding them to the file's
+// existing counts when it holds a profile of the same program.
+//
+// -fprofile-use numbers the branches of the same source the same way and
+// loads the counters; a checksum over the unoptimized IR rejects a profile
+// from a different program. Passes that rebuild or invert a conditional jump
+// carry its branch id along, negating it on inversion, so the counts still
+// apply after optimization.
+//
+// The file is a ProfileHeader followed by function_count entry counters (in
+// IrProgram.functions order) and then branch_count (taken, not taken) pairs,
+// all 64-bit and in the host's byte order.
+
+#define PROFILE_MAGIC "CCPROF1"             // Eight bytes with the terminator
+#define PROFILE_DEFAULT_PATH "default.prof"
+
+//--- File Header ---
+typedef struct
+{
+    char magic[8];
+    uint64_t checksum;
+    uint64_t function_count;
+    uint64_t branch_count;
+} ProfileHeader;
+
+/**
+ * @brief Reads the counts recorded for a conditional jump.
+ * @param counts The program's branch counters (IrFunction.branch_counts), or NULL.
+ * @param branch The jump's branch id, negative if it was inverted.
+ * @param taken Receives how often the jump was taken.
+ * @param not_taken Receives how often it fell through.
+ * @return 1 if counts were recorded for the jump.
+ */
+static inline int profile_branch(const uint64_t *counts, int32_t branch, uint64_t *taken, uint64_t *not_taken)
+{
+    if (!counts || branch == 0) return 0;
+    int slot = branch > 0 ? branch - 1 : -branch - 1;
+    *taken = counts[2 * slot + (branch < 0)];
+    *not_taken = counts[2 * slot + (branch > 0)];
+    return 1;
+}
+
+void profile_number_branches(IrProgram *program);
+uint64_t profile_checksum(const IrProgram *program);
+int profile_load(IrProgram *program, const char *path);
+void profile_block_counts(const int *succs, long *edge_counts, int block_count, long entry_count, long *counts);
+
+#endif
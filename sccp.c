@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+#include "cfg.h"
+#include "ssa.h"
+
+// --- Sparse Conditional Constant Propagation ---
+// Wegman and Zadeck's algorithm: every temporary starts at TOP (no value seen
+// yet) and only moves down the lattice TOP -> CONST -> BOTTOM. Blocks are only
+// evaluated once an edge into them is found executable, so constants flowing
+// into branches prune whole regions that would otherwise pollute phis.
+
+//--- Lattice ---
+typedef enum
+{
+    LATTICE_TOP,
+    LATTICE_CONST,
+    LATTICE_BOTTOM
+} LatticeState;
+
+//--- Pass State ---
+typedef struct
+{
+    IrFunction *fn;
+    Cfg *cfg;
+    SsaUses *uses;
+    int *instr_block;       // Instruction -> block
+    unsigned char *state;   // Temporary -> LatticeState
+    int32_t *value;         // Temporary -> constant when state is LATTICE_CONST
+    unsigned char *edge_executable; // Block b's succs[s] at 2 * b + s
+    unsigned char *block_executable;
+
+    int *flow_work;         // Pending CFG edges as 2 * block + slot, or -1 for the entry
+    int flow_count;
+    int flow_capacity;
+    int *ssa_work;          // Pending instructions whose operands changed
+    int ssa_count;
+    int ssa_capacity;
+} Sccp;
+
+/**
+ * @brief Queues a CFG edge for the flow worklist.
+ * @param s The pass state.
+ * @param edge 2 * block + successor slot, or -1 for the entry.
+ */
+static void push_edge(Sccp *s, int edge)
+{
+    if (s->flow_count == s->flow_capacity)
+    {
+        s->flow_capacity *= 2;
+        s->flow_work = realloc(s->flow_work, s->flow_capacity * sizeof(int));
+    }
+    s->flow_work[s->flow_count++] = edge;
+}
+
+/**
+ * @brief Lowers a temporary's lattice value and queues its uses if it changed.
+ * @param s The pass state.
+ * @param temp The temporary.
+ * @param state The new state.
+ * @param value The constant, when state is LATTICE_CONST.
+ */
+static void set_lattice(Sccp *s, int temp, LatticeState state, int32_t value)
+{
+    if (s->state[temp] == state && (state != LATTICE_CONST || s->value[temp] == value))
+        return;
+
+    // Two different constants meet at BOTTOM.
+    if (s->state[temp] == LATTICE_CONST && state == LATTICE_CONST)
+        state = LATTICE_BOTTOM;
+    if (s->state[temp] == LATTICE_BOTTOM)
+        return;
+
+    s->state[temp] = state;
+    s->value[temp] = value;
+
+    for (int u = s->uses->use_start[temp]; u < s->uses->use_start[temp + 1]; u++)
+    {
+        if (s->ssa_count == s->ssa_capacity)
+        {
+            s->ssa_capacity *= 2;
+            s->ssa_work = realloc(s->ssa_work, s->ssa_capacity * sizeof(int));
+        }
+        s->ssa_work[s->ssa_count++] = s->uses->uses[u];
+    }
+}
+
+/**
+ * @brief Reads an operand's lattice state.
+ * @param s The pass state.
+ * @param v The operand.
+ * @param value Receives the constant when the result is LATTICE_CONST.
+ * @return The operand's state.
+ */
+static LatticeState operand_state(const Sccp *s, IrValue v, int32_t *value)
+{
+    if (v.kind == IR_VAL_CONST)
+    {
+        *value = v.value;
+        return LATTICE_CONST;
+    }
+    if (v.kind != IR_VAL_TEMP)
+        return LATTICE_BOTTOM;
+    *value = s->value[v.value];
+    return (LatticeState)s->state[v.value];
+}
+
+/**
+ * @brief Checks whether the edge from a phi argument's block into block b is executable.
+ * @param s The pass state.
+ * @param label The label of the incoming block.
+ * @param b The phi's block.
+ * @return 1 if the edge is executable, 0 otherwise.
+ */
+static int phi_edge_executable(const Sccp *s, int label, int b)
+{
+    int pred = label < s->cfg->label_count ? s->cfg->label_block[label] : -1;
+    if (pred < 0) return 0;
+    const BasicBlock *block = &s->cfg->blocks[pred];
+    for (int k = 0; k < block->succ_count; k++)
+    {
+        if (block->succs[k] == b && s->edge_executable[2 * pred + k])
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Queues the outgoing edges a block's last instruction can take.
+ * @param s The pass state.
+ * @param b The block.
+ * @param instr Its last instruction, or NULL if it has none.
+ */
+static void visit_branch(Sccp *s, int b, const IrInstr *instr)
+{
+    const BasicBlock *block = &s->cfg->blocks[b];
+    if (instr && (instr->op == IR_JUMP_IF_ZERO || instr->op == IR_JUMP_IF_NOT_ZERO) && block->succ_count == 2)
+    {
+        int32_t cond;
+        LatticeState state = operand_state(s, instr->a, &cond);
+        if (state == LATTICE_TOP)
+            return;
+        if (state == LATTICE_BOTTOM)
+        {
+            push_edge(s, 2 * b);
+            push_edge(s, 2 * b + 1);
+            return;
+        }
+        int taken = instr->op == IR_JUMP_IF_ZERO ? cond == 0 : cond != 0;
+        push_edge(s, 2 * b + (taken ? 0 : 1));
+        return;
+    }
+
+    for (int k = 0; k < block->succ_count; k++)
+        push_edge(s, 2 * b + k);
+}
+
+/**
+ * @brief Evaluates one instruction over the lattice.
+ * @param s The pass state.
+ * @param i The instruction index. Its block must be executable.
+ */
+static void visit_instr(Sccp *s, int i)
+{
+    IrFunction *fn = s->fn;
+    const IrInstr *instr = &fn->instrs[i];
+    int b = s->instr_block[i];
+
+    if (instr->op == IR_PHI)
+    {
+        LatticeState result = LATTICE_TOP;
+        int32_t result_value = 0;
+        for (int j = 0; j < instr->arg_count && result != LATTICE_BOTTOM; j++)
+        {
+            if (!phi_edge_executable(s, fn->arg_labels[instr->arg_start + j], b))
+                continue;
+            int32_t value;
+            LatticeState state = operand_state(s, fn->args[instr->arg_start + j], &value);
+            if (state == LATTICE_TOP)
+                continue;
+            if (state == LATTICE_BOTTOM || (result == LATTICE_CONST && result_value != value))
+                result = LATTICE_BOTTOM;
+            else
+            {
+                result = LATTICE_CONST;
+                result_value = value;
+            }
+        }
+        if (result != LATTICE_TOP)
+            set_lattice(s, instr->dst.value, result, result_value);
+        return;
+    }
+
+    if (ir_is_unary(instr->op) || ir_is_binary(instr->op) || instr->op == IR_COPY)
+    {
+        int32_t a = 0, b_value = 0, folded;
+        LatticeState sa = operand_state(s, instr->a, &a);
+        LatticeState sb = ir_is_binary(instr->op) ? operand_state(s, instr->b, &b_value) : LATTICE_CONST;
+
+        // x * 0 is 0 whatever x turns out to be.
+        if (instr->op == IR_MUL && ((sa == LATTICE_CONST && a == 0) || (sb == LATTICE_CONST && b_value == 0)))
+            set_lattice(s, instr->dst.value, LATTICE_CONST, 0);
+        else if (sa == LATTICE_BOTTOM || sb == LATTICE_BOTTOM)
+            set_lattice(s, instr->dst.value, LATTICE_BOTTOM, 0);
+        else if (sa == LATTICE_CONST && sb == LATTICE_CONST)
+        {
+            if (ir_fold(instr->op, a, b_value, &folded))
+                set_lattice(s, instr->dst.value, LATTICE_CONST, folded);
+            else
+                set_lattice(s, instr->dst.value, LATTICE_BOTTOM, 0);
+        }
+        return;
+    }
+
+    if (instr->dst.kind == IR_VAL_TEMP)
+        set_lattice(s, instr->dst.value, LATTICE_BOTTOM, 0);
+
+    if (ir_is_jump(instr->op))
+        visit_branch(s, b, instr);
+}
+
+/**
+ * @brief Marks a CFG edge executable and evaluates what it newly reaches.
+ * @param s The pass state.
+ * @param edge 2 * block + successor slot, or -1 for the entry.
+ */
+static void visit_edge(Sccp *s, int edge)
+{
+    int b;
+    if (edge < 0)
+        b = 0;
+    else
+    {
+        if (s->edge_executable[edge]) return;
+        s->edge_executable[edge] = 1;
+        b = s->cfg->blocks[edge / 2].succs[edge % 2];
+    }
+
+    const BasicBlock *block = &s->cfg->blocks[b];
+    if (s->block_executable[b])
+    {
+        // Only the phis can see a new incoming edge.
+        for (int i = block->start; i < block->end; i++)
+        {
+            if (s->fn->instrs[i].op == IR_PHI)
+                visit_instr(s, i);
+        }
+        return;
+    }
+
+    s->block_executable[b] = 1;
+    for (int i = block->start; i < block->end; i++)
+    {
+        if (s->fn->instrs[i].op != IR_NOP && s->fn->instrs[i].op != IR_LABEL)
+            visit_instr(s, i);
+    }
+
+    // Blocks ending without a jump fall through.
+    int last = cfg_last_instr(s->fn, block);
+    if (last < 0 || (!ir_is_jump(s->fn->instrs[last].op) && s->fn->instrs[last].op != IR_RETURN))
+        visit_branch(s, b, NULL);
+}
+
+/**
+ * @brief Rewrites the function using the solved lattice.
+ *
+ * Temporaries proven constant are substituted into their uses and their
+ * definitions deleted, conditional jumps on constants become unconditional
+ * jumps or disappear, unreachable blocks are deleted, and phi arguments coming
+ * over non-executable edges are dropped.
+ *
+ * @param s The solved pass state.
+ * @param stats Counters to update.
+ * @return 1 if any instruction changed.
+ */
+static int rewrite(Sccp *s, OptStats *stats)
+{
+    IrFunction *fn = s->fn;
+    const Cfg *cfg = s->cfg;
+    int changed = 0;
+
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        if (!s->block_executable[b])
+        {
+            for (int i = block->start; i < block->end; i++)
+                fn->instrs[i].op = IR_NOP;
+            stats->counts[STAT_SCCP_BLOCKS_REMOVED]++;
+            changed = 1;
+            continue;
+        }
+
+        for (int i = block->start; i < block->end; i++)
+        {
+            IrInstr *instr = &fn->instrs[i];
+
+            if (instr->op == IR_PHI)
+            {
+                int kept = 0;
+                for (int j = 0; j < instr->arg_count; j++)
+                {
+                    int k = instr->arg_start + j;
+                    if (!phi_edge_executable(s, fn->arg_labels[k], b)) continue;
+                    fn->args[instr->arg_start + kept] = fn->args[k];
+                    fn->arg_labels[instr->arg_start + kept] = fn->arg_labels[k];
+                    kept++;
+                }
+                changed |= kept != instr->arg_count;
+                instr->arg_count = kept;
+            }
+
+            int count = ir_use_count(instr);
+            for (int j = 0; j < count; j++)
+            {
+                IrValue *use = ir_use(fn, instr, j);
+                if (use->kind == IR_VAL_TEMP && s->state[use->value] == LATTICE_CONST)
+                {
+                    *use = ir_const(s->value[use->value]);
+                    changed = 1;
+                }
+            }
+
+            if (instr->dst.kind == IR_VAL_TEMP && s->state[instr->dst.value] == LATTICE_CONST && instr->op != IR_CALL)
+            {
+                instr->op = IR_NOP;
+                stats->counts[STAT_SCCP_FOLDED]++;
+                changed = 1;
+                continue;
+            }
+
+            if ((instr->op == IR_JUMP_IF_ZERO || instr->op == IR_JUMP_IF_NOT_ZERO) && instr->a.kind == IR_VAL_CONST)
+            {
+                int taken = instr->op == IR_JUMP_IF_ZERO ? instr->a.value == 0 : instr->a.value != 0;
+                instr->op = taken ? IR_JUMP : IR_NOP;
+                instr->a = ir_none();
+                stats->counts[STAT_SCCP_BRANCHES_FOLDED]++;
+                changed = 1;
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief Runs sparse conditional constant propagation on a function in SSA form.
+ * @param ctx The function to optimize and its analyses.
+ * @return 1 if the function changed.
+ */
+int sccp_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    if (fn->instr_count == 0) return 0;
+
+    Sccp s;
+    memset(&s, 0, sizeof(Sccp));
+    s.fn = fn;
+    s.cfg = pass_cfg(ctx);
+    s.uses = pass_uses(ctx);
+
+    int n = s.cfg->block_count;
+    s.instr_block = malloc((fn->instr_count + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+    {
+        for (int i = s.cfg->blocks[b].start; i < s.cfg->blocks[b].end; i++)
+            s.instr_block[i] = b;
+    }
+    s.state = calloc(fn->temp_count + 1, 1);
+    s.value = calloc(fn->temp_count + 1, sizeof(int32_t));
+    s.edge_executable = calloc(2 * (size_t)n + 1, 1);
+    s.block_executable = calloc(n + 1, 1);
+    s.flow_capacity = 64;
+    s.flow_work = malloc(s.flow_capacity * sizeof(int));
+    s.ssa_capacity = 64;
+    s.ssa_work = malloc(s.ssa_capacity * sizeof(int));
+
+    for (int p = 0; p < fn->param_count; p++)
+        s.state[p] = LATTICE_BOTTOM;
+
+    push_edge(&s, -1);
+    while (s.flow_count > 0 || s.ssa_count > 0)
+    {
+        if (s.flow_count > 0)
+        {
+            visit_edge(&s, s.flow_work[--s.flow_count]);
+            continue;
+        }
+        int i = s.ssa_work[--s.ssa_count];
+        if (s.block_executable[s.instr_block[i]])
+            visit_instr(&s, i);
+    }
+
+    int changed = rewrite(&s, ctx->stats);
+    if (changed)
+        ir_compact(fn);
+
+    free(s.ssa_work);
+    free(s.flow_work);
+    free(s.block_executable);
+    free(s.edge_executable);
+    free(s.value);
+    free(s.state);
+    free(s.instr_block);
+    return changed;
+}
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+#include "cfg.h"
+
+#define MAX_SIMPLIFY_ROUNDS 8
+
+// --- CFG Simplification ---
+// Works on the linear IR outside SSA form. Each round reads the block graph,
+// threads jumps through empty forwarding blocks, drops blocks that become
+// unreachable, and lays the remaining blocks out again so that a block with a
+// single predecessor follows it directly. Emitting that layout turns jumps to
+// the next block into fall-throughs, and a final sweep deletes labels nothing
+// jumps to, which is what merges straight-line blocks in the linear form.
+// Rounds repeat while the function changes, up to MAX_SIMPLIFY_ROUNDS.
+
+//--- Pass State ---
+typedef struct
+{
+    IrFunction *fn;
+    Cfg *cfg;
+    BlockExit *exits;
+    int *forward;       // Memoized forwarding target, -2 while being resolved, -3 unresolved
+    int threaded;
+} Simplify;
+
+/**
+ * @brief Follows a chain of empty blocks that only jump onward.
+ * @param s The pass state.
+ * @param b The block to resolve, or -1.
+ * @return The first block on the chain that does real work (or closes a cycle).
+ */
+static int resolve(Simplify *s, int b)
+{
+    if (b < 0) return b;
+
+    int start = b;
+    while (s->forward[b] == -3 && s->exits[b].kind == EXIT_JUMP && s->exits[b].body_size == 0 &&
+           s->exits[b].target >= 0 && b != 0)
+    {
+        s->forward[b] = -2;
+        b = s->exits[b].target;
+    }
+
+    int result;
+    if (s->forward[b] >= 0)
+        result = s->forward[b];
+    else
+        result = b;
+
+    // Path compression; a cycle of empty blocks resolves to the block that closes it.
+    for (int c = start; s->forward[c] == -2; c = s->exits[c].target)
+        s->forward[c] = result;
+    if (s->forward[result] < 0)
+        s->forward[result] = result;
+    return result;
+}
+
+/**
+ * @brief Runs one round of threading, layout and re-emission.
+ * @param ctx The function to simplify and its analyses.
+ * @return 1 if the function changed, 0 otherwise.
+ */
+static int simplify_once(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    OptStats *stats = ctx->stats;
+    Simplify s;
+    memset(&s, 0, sizeof(Simplify));
+    s.fn = fn;
+    s.cfg = pass_cfg(ctx);
+    int n = s.cfg->block_count;
+    s.exits = malloc((n + 1) * sizeof(BlockExit));
+    s.forward = malloc((n + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+        s.forward[b] = -3;
+    cfg_summarize_exits(fn, s.cfg, s.exits);
+
+    // Thread every edge through forwarding blocks; equal conditional targets fold.
+    for (int b = 0; b < n; b++)
+    {
+        BlockExit *exit = &s.exits[b];
+        if (exit->kind == EXIT_JUMP || exit->kind == EXIT_COND)
+        {
+            int target = resolve(&s, exit->target);
+            if (target != exit->target)
+                s.threaded++;
+            exit->target = target;
+        }
+        if (exit->kind == EXIT_COND)
+        {
+            exit->fall = resolve(&s, exit->fall);
+            if (exit->fall == exit->target)
+                exit->kind = EXIT_JUMP;
+        }
+    }
+
+    // Reachability and predecessor counts over the threaded edges.
+    int *preds = calloc(n + 1, sizeof(int));
+    unsigned char *reachable = calloc(n + 1, 1);
+    int *stack = malloc((n + 1) * sizeof(int));
+    int depth = 0;
+    if (n > 0)
+    {
+        reachable[0] = 1;
+        stack[depth++] = 0;
+    }
+    while (depth > 0)
+    {
+        const BlockExit *exit = &s.exits[stack[--depth]];
+        int succs[2] = {-1, -1};
+        if (exit->kind == EXIT_JUMP || exit->kind == EXIT_COND)
+            succs[0] = exit->target;
+        if (exit->kind == EXIT_COND)
+            succs[1] = exit->fall;
+        for (int k = 0; k < 2; k++)
+        {
+            if (succs[k] < 0) continue;
+            preds[succs[k]]++;
+            if (!reachable[succs[k]])
+            {
+                reachable[succs[k]] = 1;
+                stack[depth++] = succs[k];
+            }
+        }
+    }
+
+    // Lay blocks out in chains: keep fall-through successors adjacent and pull a
+    // single-predecessor jump target up behind its only predecessor.
+    int *order = malloc((n + 1) * sizeof(int));
+    unsigned char *placed = calloc(n + 1, 1);
+    int placed_count = 0;
+    for (int b = 0; b < n; b++)
+    {
+        if (!reachable[b] || placed[b]) continue;
+        int cur = b;
+        while (cur >= 0)
+        {
+            placed[cur] = 1;
+            order[placed_count++] = cur;
+            const BlockExit *exit = &s.exits[cur];
+            int next = -1;
+            if (exit->kind == EXIT_JUMP && exit->target >= 0 && !placed[exit->target] &&
+                (preds[exit->target] == 1 || exit->target == cur + 1))
+                next = exit->target;
+            else if (exit->kind == EXIT_COND && exit->fall >= 0 && !placed[exit->fall])
+                next = exit->fall;
+            else if (exit->kind == EXIT_COND && exit->target >= 0 && !placed[exit->target] && preds[exit->target] == 1)
+                next = exit->target;
+            cur = next;
+        }
+    }
+
+    int *label_of = malloc((n + 1) * sizeof(int));
+    for (int i = 0; i < placed_count; i++)
+    {
+        int b = order[i];
+        label_of[b] = s.cfg->blocks[b].label >= 0 ? s.cfg->blocks[b].label : ir_new_label(fn);
+    }
+
+    int capacity = fn->instr_count + 5 * n + 1;
+    BlockEmitter e = {fn, s.exits, label_of, malloc(capacity * sizeof(IrInstr)), 0, 1};
+    for (int i = 0; i < placed_count; i++)
+        cfg_emit_block(&e, order[i], i + 1 < placed_count ? order[i + 1] : -1);
+
+    // Drop labels no jump refers to; this merges blocks that now fall through.
+    unsigned char *referenced = calloc(fn->label_count + 1, 1);
+    for (int i = 0; i < e.count; i++)
+    {
+        if (ir_is_jump(e.out[i].op))
+            referenced[e.out[i].label] = 1;
+    }
+    int count = 0;
+    for (int i = 0; i < e.count; i++)
+    {
+        if (e.out[i].op == IR_LABEL && !referenced[e.out[i].label])
+            continue;
+        e.out[count++] = e.out[i];
+    }
+
+    int changed = count != fn->instr_count || memcmp(e.out, fn->instrs, count * sizeof(IrInstr)) != 0;
+    stats->counts[STAT_CFG_JUMPS_THREADED] += s.threaded;
+
+    free(fn->instrs);
+    fn->instrs = e.out;
+    fn->instr_count = count;
+    fn->instr_capacity = capacity;
+
+    // The new CFG is counted here and then reused by the next round.
+    pass_invalidate(ctx);
+    stats->counts[STAT_CFG_BLOCKS_REMOVED] += n - pass_cfg(ctx)->block_count;
+
+    free(referenced);
+    free(label_of);
+    free(placed);
+    free(order);
+    free(stack);
+    free(reachable);
+    free(preds);
+    free(s.forward);
+    free(s.exits);
+    return changed;
+}
+
+/**
+ * @brief Simplifies a function's control flow, for at most MAX_SIMPLIFY_ROUNDS rounds.
+ *
+ * Removes unreachable and empty blocks, threads jumps to jumps, folds
+ * conditional jumps whose targets coincide, replaces jumps to a bare return
+ * with the return itself, and merges straight-line blocks. Rounds repeat
+ * while the function changes. Every round rebuilds the CFG and re-emits the
+ * whole function, so the rounds are capped: a function whose last allowed
+ * round still changed it is counted in STAT_CFG_ROUND_LIMIT and left as it
+ * is, which is correct, only less simplified. The function must be out of
+ * SSA form; functions containing phis are left alone.
+ *
+ * @param ctx The function to simplify and its analyses.
+ * @return 1 if the function changed.
+ */
+int simplify_cfg_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    if (fn->instr_count == 0) return 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (fn->instrs[i].op == IR_PHI)
+            return 0;
+    }
+
+    int changed = 0;
+    int round = 0;
+    while (simplify_once(ctx))
+    {
+        changed = 1;
+        if (++round == MAX_SIMPLIFY_ROUNDS)
+        {
+            ctx->stats->counts[STAT_CFG_ROUND_LIMIT]++;
+            break;
+        }
+    }
+    return changed;
+}
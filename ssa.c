@@ -0,0 +1,791 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ssa.h"
+#include "cfg.h"
+
+// --- SSA Construction ---
+
+/**
+ * @brief Checks whether instruction i starts a basic block (same rule as cfg_build).
+ * @param fn The function.
+ * @param i The instruction index.
+ * @return 1 if the instruction is a block leader, 0 otherwise.
+ */
+static int is_leader(const IrFunction *fn, int i)
+{
+    return i == 0 || fn->instrs[i].op == IR_LABEL || ir_is_jump(fn->instrs[i - 1].op) ||
+           fn->instrs[i - 1].op == IR_RETURN;
+}
+
+/**
+ * @brief Replaces every instruction of the unreachable blocks with a nop.
+ * @param fn The function to clean up. The caller compacts it.
+ */
+static void remove_unreachable_blocks(IrFunction *fn)
+{
+    Cfg *cfg = cfg_build(fn);
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        if (cfg->rpo_index[b] >= 0) continue;
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            fn->instrs[i].op = IR_NOP;
+    }
+    cfg_free(cfg);
+}
+
+/**
+ * @brief Gives every block a label and guarantees the entry block has no predecessors.
+ *
+ * Phi arguments name their incoming block by label, so each block needs one.
+ * A fresh label is put in front of the entry when something jumps back to it.
+ *
+ * @param fn The function to relabel.
+ */
+static void label_all_blocks(IrFunction *fn)
+{
+    int entry_has_preds = 0;
+    if (fn->instr_count > 0 && fn->instrs[0].op == IR_LABEL)
+    {
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            if (ir_is_jump(fn->instrs[i].op) && fn->instrs[i].label == fn->instrs[0].label)
+                entry_has_preds = 1;
+        }
+    }
+
+    int extra = entry_has_preds;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (is_leader(fn, i) && fn->instrs[i].op != IR_LABEL)
+            extra++;
+    }
+    if (extra == 0) return;
+
+    IrInstr *instrs = malloc((fn->instr_count + extra) * sizeof(IrInstr));
+    int count = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        if (is_leader(fn, i) && (fn->instrs[i].op != IR_LABEL || (i == 0 && entry_has_preds)))
+        {
+            memset(&instrs[count], 0, sizeof(IrInstr));
+            instrs[count].op = IR_LABEL;
+            instrs[count].label = ir_new_label(fn);
+            count++;
+        }
+        instrs[count++] = fn->instrs[i];
+    }
+
+    free(fn->instrs);
+    fn->instrs = instrs;
+    fn->instr_count = count;
+    fn->instr_capacity = fn->instr_count + extra;
+}
+
+/**
+ * @brief Decides where phis go with the iterated dominance frontier, pruned by liveness.
+ *
+ * A phi for v is placed at a frontier block only if v is live into that block,
+ * so no dead phis are created.
+ *
+ * @param fn The function.
+ * @param cfg The CFG with dominance frontiers and liveness.
+ * @param phi_start Receives, per block, the offset of its phi variables in *phi_vars (block_count + 1 entries).
+ * @param phi_vars Receives the variables needing a phi, grouped by block.
+ */
+static void place_phis(IrFunction *fn, const Cfg *cfg, int **phi_start, int **phi_vars)
+{
+    int n = cfg->block_count;
+    int temps = fn->temp_count;
+
+    // Definition sites per temporary in one array: count, prefix-sum, fill.
+    int *def_start = calloc(temps + 2, sizeof(int));
+    int *last_block = malloc((temps + 1) * sizeof(int));
+    for (int v = 0; v < temps; v++)
+        last_block[v] = v < fn->param_count ? 0 : -1;
+    for (int v = 0; v < fn->param_count; v++)
+        def_start[v + 1]++;
+    for (int b = 0; b < n; b++)
+    {
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            IrValue dst = fn->instrs[i].dst;
+            if (dst.kind == IR_VAL_TEMP && last_block[dst.value] != b)
+            {
+                last_block[dst.value] = b;
+                def_start[dst.value + 1]++;
+            }
+        }
+    }
+    for (int v = 0; v < temps; v++)
+        def_start[v + 1] += def_start[v];
+
+    int *def_blocks = malloc((def_start[temps] + 1) * sizeof(int));
+    int *fill = malloc((temps + 1) * sizeof(int));
+    memcpy(fill, def_start, (temps + 1) * sizeof(int));
+    for (int v = 0; v < temps; v++)
+        last_block[v] = -1;
+    for (int v = 0; v < fn->param_count; v++)
+    {
+        def_blocks[fill[v]++] = 0;
+        last_block[v] = 0;
+    }
+    for (int b = 0; b < n; b++)
+    {
+        for (int i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        {
+            IrValue dst = fn->instrs[i].dst;
+            if (dst.kind == IR_VAL_TEMP && last_block[dst.value] != b)
+            {
+                last_block[dst.value] = b;
+                def_blocks[fill[dst.value]++] = b;
+            }
+        }
+    }
+
+    int *has_phi = malloc((n + 1) * sizeof(int));
+    int *queued = malloc((n + 1) * sizeof(int));
+    int *worklist = malloc((n + 1) * sizeof(int));
+    for (int b = 0; b < n; b++)
+    {
+        has_phi[b] = -1;
+        queued[b] = -1;
+    }
+
+    int placed_count = 0, placed_capacity = 64;
+    int *placed_block = malloc(placed_capacity * sizeof(int));
+    int *placed_var = malloc(placed_capacity * sizeof(int));
+
+    for (int v = 0; v < temps; v++)
+    {
+        // A temporary defined in one block with an empty frontier never needs a phi.
+        if (def_start[v + 1] - def_start[v] < 2 && v >= fn->param_count)
+        {
+            int only = def_start[v + 1] > def_start[v] ? def_blocks[def_start[v]] : -1;
+            if (only < 0 || cfg->df_start[only + 1] == cfg->df_start[only]) continue;
+        }
+
+        int count = 0;
+        for (int d = def_start[v]; d < def_start[v + 1]; d++)
+        {
+            worklist[count++] = def_blocks[d];
+            queued[def_blocks[d]] = v;
+        }
+
+        while (count > 0)
+        {
+            int x = worklist[--count];
+            for (int f = cfg->df_start[x]; f < cfg->df_start[x + 1]; f++)
+            {
+                int d = cfg->df[f];
+                if (has_phi[d] == v) continue;
+                if (!bitset_test(cfg->live_in + d * cfg->live_words, v)) continue;
+
+                has_phi[d] = v;
+                if (placed_count == placed_capacity)
+                {
+                    placed_capacity *= 2;
+                    placed_block = realloc(placed_block, placed_capacity * sizeof(int));
+                    placed_var = realloc(placed_var, placed_capacity * sizeof(int));
+                }
+                placed_block[placed_count] = d;
+                placed_var[placed_count++] = v;
+
+                if (queued[d] != v)
+                {
+                    queued[d] = v;
+                    worklist[count++] = d;
+                }
+            }
+        }
+    }
+
+    // Group the placed phis by block.
+    *phi_start = calloc(n + 2, sizeof(int));
+    *phi_vars = malloc((placed_count + 1) * sizeof(int));
+    for (int i = 0; i < placed_count; i++)
+        (*phi_start)[placed_block[i] + 1]++;
+    for (int b = 0; b < n; b++)
+        (*phi_start)[b + 1] += (*phi_start)[b];
+    int *block_fill = malloc((n + 1) * sizeof(int));
+    memcpy(block_fill, *phi_start, (n + 1) * sizeof(int));
+    for (int i = 0; i < placed_count; i++)
+        (*phi_vars)[block_fill[placed_block[i]]++] = placed_var[i];
+    free(block_fill);
+
+    free(placed_var);
+    free(placed_block);
+    free(worklist);
+    free(queued);
+    free(has_phi);
+    free(fill);
+    free(def_blocks);
+    free(last_block);
+    free(def_start);
+}
+
+/**
+ * @brief Rebuilds the instruction array with the placed phis after each block's label.
+ *
+ * Phi results start out as the original variable and every argument slot is
+ * labelled with its predecessor; renaming fills in the values. Block ranges in
+ * the CFG are updated to the new array.
+ *
+ * @param fn The function to rewrite.
+ * @param cfg The function's CFG.
+ * @param phi_start Per-block offsets into phi_vars.
+ * @param phi_vars The variables needing a phi, grouped by block.
+ * @return For each new instruction index, the variable of the phi there (or -1).
+ */
+static int *insert_phis(IrFunction *fn, Cfg *cfg, const int *phi_start, const int *phi_vars)
+{
+    int total = fn->instr_count + phi_start[cfg->block_count];
+    IrInstr *instrs = malloc((total + 1) * sizeof(IrInstr));
+    int *phi_var = malloc((total + 1) * sizeof(int));
+    int count = 0;
+
+    for (int b = 0; b < cfg->block_count; b++)
+    {
+        BasicBlock *block = &cfg->blocks[b];
+        int start = block->start;
+        int new_start = count;
+
+        // Every block starts with its label (label_all_blocks).
+        phi_var[count] = -1;
+        instrs[count++] = fn->instrs[start];
+
+        for (int p = phi_start[b]; p < phi_start[b + 1]; p++)
+        {
+            IrInstr *phi = &instrs[count];
+            memset(phi, 0, sizeof(IrInstr));
+            phi->op = IR_PHI;
+            phi->dst = ir_temp(phi_vars[p]);
+            phi->arg_count = block->pred_count;
+            phi->arg_start = ir_alloc_args(fn, block->pred_count);
+            for (int j = 0; j < block->pred_count; j++)
+            {
+                int pred = cfg->preds[block->pred_start + j];
+                fn->args[phi->arg_start + j] = ir_none();
+                fn->arg_labels[phi->arg_start + j] = cfg->blocks[pred].label;
+            }
+            phi_var[count++] = phi_vars[p];
+        }
+
+        for (int i = start + 1; i < block->end; i++)
+        {
+            phi_var[count] = -1;
+            instrs[count++] = fn->instrs[i];
+        }
+
+        block->start = new_start;
+        block->end = count;
+    }
+
+    free(fn->instrs);
+    fn->instrs = instrs;
+    fn->instr_count = count;
+    fn->instr_capacity = total + 1;
+    return phi_var;
+}
+
+/**
+ * @brief Returns the current SSA name of a variable as an operand.
+ * @param current Current name per original variable, -1 if none reaches here.
+ * @param var The original variable.
+ * @return The renamed temporary, or constant 0 for a use with no reaching definition.
+ */
+static IrValue current_name(const int *current, int var)
+{
+    return current[var] >= 0 ? ir_temp(current[var]) : ir_const(0);
+}
+
+/**
+ * @brief Renames every definition to a fresh temporary, walking the dominator tree.
+ *
+ * The walk is iterative. Instead of one stack per variable it keeps a single
+ * `current` array plus an undo log that is unwound when a block's dominator
+ * subtree is finished. Parameters keep their numbers as their first version.
+ *
+ * @param fn The function with phis inserted.
+ * @param cfg The CFG with dominators, block ranges matching fn.
+ * @param phi_var The variable of each phi instruction, from insert_phis.
+ */
+static void rename_variables(IrFunction *fn, const Cfg *cfg, const int *phi_var)
+{
+    int vars = fn->temp_count;
+    int next = fn->param_count;
+    int *current = malloc((vars + 1) * sizeof(int));
+    for (int v = 0; v < vars; v++)
+        current[v] = v < fn->param_count ? v : -1;
+
+    int log_count = 0, log_capacity = 256;
+    int *log_var = malloc(log_capacity * sizeof(int));
+    int *log_old = malloc(log_capacity * sizeof(int));
+
+    int n = cfg->block_count;
+    int *stack = malloc((n + 1) * sizeof(int));
+    int *next_child = malloc((n + 1) * sizeof(int));
+    int *log_mark = malloc((n + 1) * sizeof(int));
+    int depth = 0;
+
+    int entry = cfg->rpo[0];
+    stack[depth++] = entry;
+    next_child[entry] = -1;
+
+    while (depth > 0)
+    {
+        int b = stack[depth - 1];
+        const BasicBlock *block = &cfg->blocks[b];
+
+        if (next_child[b] < 0)
+        {
+            // First visit: rename the block and fill successor phi arguments.
+            log_mark[b] = log_count;
+            next_child[b] = cfg->dom_child_start[b];
+
+            for (int i = block->start; i < block->end; i++)
+            {
+                IrInstr *instr = &fn->instrs[i];
+                if (instr->op != IR_PHI)
+                {
+                    int uses = ir_use_count(instr);
+                    for (int j = 0; j < uses; j++)
+                    {
+                        IrValue *use = ir_use(fn, instr, j);
+                        if (use->kind == IR_VAL_TEMP)
+                            *use = current_name(current, use->value);
+                    }
+                }
+
+                if (instr->dst.kind == IR_VAL_TEMP)
+                {
+                    int var = instr->op == IR_PHI ? phi_var[i] : instr->dst.value;
+                    if (log_count == log_capacity)
+                    {
+                        log_capacity *= 2;
+                        log_var = realloc(log_var, log_capacity * sizeof(int));
+                        log_old = realloc(log_old, log_capacity * sizeof(int));
+                    }
+                    log_var[log_count] = var;
+                    log_old[log_count++] = current[var];
+                    current[var] = next;
+                    instr->dst = ir_temp(next++);
+                }
+            }
+
+            for (int s = 0; s < block->succ_count; s++)
+            {
+                const BasicBlock *succ = &cfg->blocks[block->succs[s]];
+                for (int i = succ->start + 1; i < succ->end && fn->instrs[i].op == IR_PHI; i++)
+                {
+                    const IrInstr *phi = &fn->instrs[i];
+                    for (int j = 0; j < phi->arg_count; j++)
+                    {
+                        if (fn->arg_labels[phi->arg_start + j] == block->label)
+                            fn->args[phi->arg_start + j] = current_name(current, phi_var[i]);
+                    }
+                }
+            }
+        }
+
+        if (next_child[b] < cfg->dom_child_start[b + 1])
+        {
+            int c = cfg->dom_children[next_child[b]++];
+            next_child[c] = -1;
+            stack[depth++] = c;
+            continue;
+        }
+
+        // Leaving the subtree: restore the names that were live on entry.
+        while (log_count > log_mark[b])
+        {
+            log_count--;
+            current[log_var[log_count]] = log_old[log_count];
+        }
+        depth--;
+    }
+
+    fn->temp_count = next;
+
+    free(log_mark);
+    free(next_child);
+    free(stack);
+    free(log_old);
+    free(log_var);
+    free(current);
+}
+
+/**
+ * @brief Converts a function to pruned SSA form.
+ *
+ * Unreachable blocks are dropped and every block gets a label. Then the CFG,
+ * dominator tree, dominance frontiers and liveness are computed, phis are
+ * placed on the iterated dominance frontier of each variable's definitions
+ * wherever the variable is live, and every definition is renamed to a fresh,
+ * densely numbered temporary.
+ *
+ * @param fn The function to convert. It must not already be in SSA form.
+ */
+void ssa_build(IrFunction *fn)
+{
+    if (fn->instr_count == 0) return;
+
+    remove_unreachable_blocks(fn);
+    ir_compact(fn);
+    label_all_blocks(fn);
+
+    Cfg *cfg = cfg_build(fn);
+    cfg_compute_dominators(cfg);
+    cfg_compute_frontiers(cfg);
+    cfg_compute_liveness(cfg, fn);
+
+    int *phi_start, *phi_vars;
+    place_phis(fn, cfg, &phi_start, &phi_vars);
+    int *phi_var = insert_phis(fn, cfg, phi_start, phi_vars);
+    rename_variables(fn, cfg, phi_var);
+
+    free(phi_var);
+    free(phi_vars);
+    free(phi_start);
+    cfg_free(cfg);
+}
+
+/**
+ * @brief Builds def-use chains for a function in SSA form.
+ * @param uses The chains to fill. Free them with ssa_uses_free.
+ * @param fn The function.
+ */
+void ssa_uses_build(SsaUses *uses, IrFunction *fn)
+{
+    int temps = fn->temp_count;
+    uses->temp_count = temps;
+    uses->def = malloc((temps + 1) * sizeof(int));
+    uses->use_start = calloc(temps + 2, sizeof(int));
+    int *last = malloc((temps + 1) * sizeof(int));
+    for (int t = 0; t < temps; t++)
+    {
+        uses->def[t] = -1;
+        last[t] = -1;
+    }
+
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+        if (instr->dst.kind == IR_VAL_TEMP)
+            uses->def[instr->dst.value] = i;
+        int count = ir_use_count(instr);
+        for (int j = 0; j < count; j++)
+        {
+            IrValue *use = ir_use(fn, instr, j);
+            if (use->kind == IR_VAL_TEMP && last[use->value] != i)
+            {
+                last[use->value] = i;
+                uses->use_start[use->value + 1]++;
+            }
+        }
+    }
+    for (int t = 0; t < temps; t++)
+        uses->use_start[t + 1] += uses->use_start[t];
+
+    uses->uses = malloc((uses->use_start[temps] + 1) * sizeof(int));
+    int *fill = malloc((temps + 1) * sizeof(int));
+    memcpy(fill, uses->use_start, (temps + 1) * sizeof(int));
+    for (int t = 0; t < temps; t++)
+        last[t] = -1;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+        int count = ir_use_count(instr);
+        for (int j = 0; j < count; j++)
+        {
+            IrValue *use = ir_use(fn, instr, j);
+            if (use->kind == IR_VAL_TEMP && last[use->value] != i)
+            {
+                last[use->value] = i;
+                uses->uses[fill[use->value]++] = i;
+            }
+        }
+    }
+
+    free(fill);
+    free(last);
+}
+
+/**
+ * @brief Frees def-use chains.
+ * @param uses The chains to free.
+ */
+void ssa_uses_free(SsaUses *uses)
+{
+    free(uses->def);
+    free(uses->use_start);
+    free(uses->uses);
+}
+
+// --- SSA Destruction ---
+
+//--- Edge Copy List ---
+typedef struct
+{
+    IrValue *dsts;
+    IrValue *srcs;
+    int count;
+    int capacity;
+} CopyList;
+
+/**
+ * @brief Appends one copy to a parallel copy list.
+ * @param list The list.
+ * @param dst The destination temporary.
+ * @param src The source operand.
+ */
+static void copy_list_add(CopyList *list, IrValue dst, IrValue src)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 4;
+        list->dsts = realloc(list->dsts, list->capacity * sizeof(IrValue));
+        list->srcs = realloc(list->srcs, list->capacity * sizeof(IrValue));
+    }
+    list->dsts[list->count] = dst;
+    list->srcs[list->count++] = src;
+}
+
+//--- Output Instruction Buffer ---
+typedef struct
+{
+    IrInstr *instrs;
+    int count;
+    int capacity;
+} InstrBuffer;
+
+/**
+ * @brief Appends an instruction to the output buffer.
+ * @param out The buffer.
+ * @param instr The instruction to copy in.
+ */
+static void buffer_push(InstrBuffer *out, const IrInstr *instr)
+{
+    if (out->count == out->capacity)
+    {
+        out->capacity = out->capacity ? out->capacity * 2 : 64;
+        out->instrs = realloc(out->instrs, out->capacity * sizeof(IrInstr));
+    }
+    out->instrs[out->count++] = *instr;
+}
+
+/**
+ * @brief Appends a copy instruction to the output buffer.
+ * @param out The buffer.
+ * @param dst The destination.
+ * @param src The source.
+ */
+static void buffer_push_copy(InstrBuffer *out, IrValue dst, IrValue src)
+{
+    IrInstr copy;
+    memset(&copy, 0, sizeof(IrInstr));
+    copy.op = IR_COPY;
+    copy.dst = dst;
+    copy.a = src;
+    buffer_push(out, &copy);
+}
+
+/**
+ * @brief Appends a label definition to the output buffer.
+ * @param out The buffer.
+ * @param label The label number.
+ */
+static void buffer_push_label(InstrBuffer *out, int label)
+{
+    IrInstr instr;
+    memset(&instr, 0, sizeof(IrInstr));
+    instr.op = IR_LABEL;
+    instr.label = label;
+    buffer_push(out, &instr);
+}
+
+/**
+ * @brief Emits a parallel copy as a sequence of ordinary copies.
+ *
+ * A copy is safe to emit once no other pending copy still reads its
+ * destination. When only cycles remain (the "swap problem"), one destination is
+ * saved to a fresh temporary and the copies reading it are redirected there.
+ *
+ * @param fn The function, for allocating the cycle-breaking temporary.
+ * @param list The parallel copy. It is consumed.
+ * @param out The buffer receiving the sequential copies.
+ */
+static void sequentialize_copies(IrFunction *fn, CopyList *list, InstrBuffer *out)
+{
+    // Self-copies are no-ops.
+    int count = 0;
+    for (int i = 0; i < list->count; i++)
+    {
+        if (list->srcs[i].kind == IR_VAL_TEMP && list->srcs[i].value == list->dsts[i].value)
+            continue;
+        list->dsts[count] = list->dsts[i];
+        list->srcs[count++] = list->srcs[i];
+    }
+    list->count = count;
+
+    while (list->count > 0)
+    {
+        int ready = -1;
+        for (int i = 0; i < list->count && ready < 0; i++)
+        {
+            int blocked = 0;
+            for (int j = 0; j < list->count && !blocked; j++)
+            {
+                if (j != i && list->srcs[j].kind == IR_VAL_TEMP && list->srcs[j].value == list->dsts[i].value)
+                    blocked = 1;
+            }
+            if (!blocked)
+                ready = i;
+        }
+
+        if (ready < 0)
+        {
+            IrValue saved = ir_temp(ir_new_temp(fn));
+            IrValue dst = list->dsts[0];
+            buffer_push_copy(out, saved, dst);
+            for (int j = 0; j < list->count; j++)
+            {
+                if (list->srcs[j].kind == IR_VAL_TEMP && list->srcs[j].value == dst.value)
+                    list->srcs[j] = saved;
+            }
+            ready = 0;
+        }
+
+        buffer_push_copy(out, list->dsts[ready], list->srcs[ready]);
+        list->count--;
+        list->dsts[ready] = list->dsts[list->count];
+        list->srcs[ready] = list->srcs[list->count];
+    }
+}
+
+/**
+ * @brief Converts a function out of SSA form by replacing phis with copies.
+ *
+ * The copies for a phi argument go at the end of the incoming block when that
+ * block has a single successor. Edges leaving a block with two successors are
+ * split first, which avoids the "lost copy" problem: no copy ever executes on a
+ * path that does not enter the phi's block. Copies on one edge happen in
+ * parallel and are sequentialized by sequentialize_copies.
+ *
+ * @param fn The function to convert.
+ */
+void ssa_destroy(IrFunction *fn)
+{
+    if (fn->instr_count == 0) return;
+
+    Cfg *cfg = cfg_build(fn);
+    int n = cfg->block_count;
+    CopyList *edges = calloc(2 * (size_t)n + 1, sizeof(CopyList));
+    int has_phis = 0;
+
+    for (int b = 0; b < n; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        for (int i = block->start; i < block->end; i++)
+        {
+            const IrInstr *phi = &fn->instrs[i];
+            if (phi->op != IR_PHI) continue;
+            has_phis = 1;
+
+            for (int j = 0; j < phi->arg_count; j++)
+            {
+                int label = fn->arg_labels[phi->arg_start + j];
+                int pred = label < cfg->label_count ? cfg->label_block[label] : -1;
+                if (pred < 0) continue;
+                for (int s = 0; s < cfg->blocks[pred].succ_count; s++)
+                {
+                    if (cfg->blocks[pred].succs[s] == b)
+                        copy_list_add(&edges[2 * pred + s], phi->dst, fn->args[phi->arg_start + j]);
+                }
+            }
+        }
+    }
+
+    if (!has_phis)
+    {
+        free(edges);
+        cfg_free(cfg);
+        return;
+    }
+
+    InstrBuffer out = {NULL, 0, 0};
+    InstrBuffer split = {NULL, 0, 0};
+
+    for (int b = 0; b < n; b++)
+    {
+        const BasicBlock *block = &cfg->blocks[b];
+        int last = cfg_last_instr(fn, block);
+        int ends_in_jump = last >= 0 && ir_is_jump(fn->instrs[last].op);
+
+        for (int i = block->start; i < block->end; i++)
+        {
+            IrInstr instr = fn->instrs[i];
+            if (instr.op == IR_PHI || instr.op == IR_NOP) continue;
+
+            if (i == last && ends_in_jump)
+            {
+                if (block->succ_count == 1 && edges[2 * b].count > 0)
+                    sequentialize_copies(fn, &edges[2 * b], &out);
+
+                // A conditional jump on a critical edge is redirected to a new block
+                // holding the copies, which then jumps on to the real target.
+                if (block->succ_count == 2 && edges[2 * b].count > 0)
+                {
+                    int label = ir_new_label(fn);
+                    int target = instr.label;
+                    instr.label = label;
+                    buffer_push_label(&split, label);
+                    sequentialize_copies(fn, &edges[2 * b], &split);
+                    IrInstr jump;
+                    memset(&jump, 0, sizeof(IrInstr));
+                    jump.op = IR_JUMP;
+                    jump.label = target;
+                    buffer_push(&split, &jump);
+                }
+            }
+            buffer_push(&out, &instr);
+        }
+
+        // Copies for the fall-through edge go after the block; with a conditional
+        // jump they form a new block that only the fall-through path enters.
+        if (!ends_in_jump && block->succ_count == 1 && edges[2 * b].count > 0)
+            sequentialize_copies(fn, &edges[2 * b], &out);
+        if (block->succ_count == 2 && edges[2 * b + 1].count > 0)
+        {
+            buffer_push_label(&out, ir_new_label(fn));
+            sequentialize_copies(fn, &edges[2 * b + 1], &out);
+        }
+    }
+
+    // Split blocks go after the last block, which must not fall into them.
+    if (split.count > 0 && (out.count == 0 || !ir_is_terminator(out.instrs[out.count - 1].op)))
+    {
+        IrInstr ret;
+        memset(&ret, 0, sizeof(IrInstr));
+        ret.op = IR_RETURN;
+        ret.a = ir_const(0);
+        buffer_push(&out, &ret);
+    }
+    for (int i = 0; i < split.count; i++)
+        buffer_push(&out, &split.instrs[i]);
+
+    for (int e = 0; e < 2 * n; e++)
+    {
+        free(edges[e].dsts);
+        free(edges[e].srcs);
+    }
+    free(edges);
+    free(split.instrs);
+    cfg_free(cfg);
+
+    free(fn->instrs);
+    fn->instrs = out.instrs;
+    fn->instr_count = out.count;
+    fn->instr_capacity = out.capacity;
+}
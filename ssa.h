@@ -0,0 +1,22 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include "ir.h"
+
+//--- Def-Use Chains ---
+// In SSA form each temporary has one definition, so def-use information is just
+// the defining instruction and the list of instructions reading the temporary.
+typedef struct
+{
+    int *def;           // Temporary -> defining instruction, -1 for parameters
+    int *use_start;     // Uses of t: uses[use_start[t] .. use_start[t + 1])
+    int *uses;          // Instruction indices; an instruction reading t twice appears once
+    int temp_count;
+} SsaUses;
+
+void ssa_build(IrFunction *fn);
+void ssa_destroy(IrFunction *fn);
+void ssa_uses_build(SsaUses *uses, IrFunction *fn);
+void ssa_uses_free(SsaUses *uses);
+
+#endif
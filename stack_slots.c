@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm.h"
+
+// --- Stack Slot Sharing ---
+// Runs between register allocation and codegen_assign_stack, which gives
+// every pseudo register still in the code its own slot. Spilled pseudo
+// registers whose live ranges never overlap can live in the same slot, so
+// this pass colors an interference graph of just the spilled ones, with
+// slots as colors, and renames each pseudo register to the first one of its
+// color. Every value is a 4-byte int, so all slots have one size and
+// alignment and pack densely below the saved registers.
+//
+// Heavier pseudo registers (by occurrences weighted by frequency) pick
+// first, and a pseudo register prefers the slot of a move partner, which
+// turns the move into a self-move that is deleted. Functions with more than
+// SLOT_MATRIX_LIMIT spilled values keep one slot each rather than pay for a
+// quadratic matrix.
+
+#define SLOT_MATRIX_LIMIT 4096
+
+//--- Slot Coloring State ---
+typedef struct
+{
+    const AsmFunction *fn;
+    int count;          // Spilled pseudo registers
+    int *node_of;       // Pseudo register -> node, or -1 if it does not occur
+    int *pseudo_of;     // Node -> pseudo register
+    long *weight;       // Node -> occurrences weighted by frequency
+    int *partner;       // Node -> a node it is moved to or from, or -1
+    BitWord *matrix;    // Lower triangle of the interference matrix
+} SlotColoring;
+
+/**
+ * @brief Finds the bit for a pair of distinct nodes in the triangular matrix.
+ * @param u One node.
+ * @param v The other node.
+ * @return The bit index.
+ */
+static size_t pair_bit(int u, int v)
+{
+    if (u < v)
+    {
+        int t = u;
+        u = v;
+        v = t;
+    }
+    return (size_t)u * (u - 1) / 2 + v;
+}
+
+/**
+ * @brief Records that two nodes may not share a slot.
+ * @param sc The coloring state.
+ * @param u One node.
+ * @param v The other node.
+ */
+static void add_edge(SlotColoring *sc, int u, int v)
+{
+    if (u == v) return;
+    size_t bit = pair_bit(u, v);
+    sc->matrix[bit / BITSET_WORD_BITS] |= (BitWord)1 << (bit % BITSET_WORD_BITS);
+}
+
+/**
+ * @brief Checks whether two distinct nodes interfere.
+ * @param sc The coloring state.
+ * @param u One node.
+ * @param v The other node.
+ * @return 1 if they interfere.
+ */
+static int interferes(const SlotColoring *sc, int u, int v)
+{
+    size_t bit = pair_bit(u, v);
+    return (int)((sc->matrix[bit / BITSET_WORD_BITS] >> (bit % BITSET_WORD_BITS)) & 1);
+}
+
+/**
+ * @brief Numbers the pseudo registers that occur in a function and weighs them.
+ * @param sc The coloring state.
+ * @param live The function's liveness, for instruction frequencies.
+ */
+static void collect_nodes(SlotColoring *sc, const AsmLiveness *live)
+{
+    const AsmFunction *fn = sc->fn;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        const AsmOperand *operands[3] = {&instr->src, &instr->dst, &instr->index};
+        long cost = live->frequency[i];
+        for (int o = 0; o < 3; o++)
+        {
+            if (operands[o]->kind != ASM_OPERAND_PSEUDO) continue;
+            int p = operands[o]->value;
+            if (sc->node_of[p] < 0)
+            {
+                sc->node_of[p] = sc->count;
+                sc->pseudo_of[sc->count] = p;
+                sc->weight[sc->count] = 0;
+                sc->partner[sc->count] = -1;
+                sc->count++;
+            }
+            sc->weight[sc->node_of[p]] += cost;
+        }
+    }
+}
+
+/**
+ * @brief Records interference between every spilled value defined and every one live past the definition.
+ *
+ * The source of a move does not interfere with its destination, since both
+ * hold the same value.
+ *
+ * @param sc The coloring state.
+ * @param live The function's liveness.
+ */
+static void build_interference(SlotColoring *sc, const AsmLiveness *live)
+{
+    const AsmFunction *fn = sc->fn;
+    size_t words = live->words;
+    size_t pseudo_words = bitset_words(fn->pseudo_count);
+    BitWord *current = bitset_new(live->var_count);
+
+    for (int b = 0; b < live->block_count; b++)
+    {
+        bitset_copy(current, live->live_out + b * words, words);
+        for (int i = live->block_start[b + 1] - 1; i >= live->block_start[b]; i--)
+        {
+            const AsmInstr *instr = &fn->instrs[i];
+            AsmUseDef ud;
+            asm_use_def(fn, instr, &ud);
+
+            int move_src = -1;
+            if (instr->op == ASM_MOV && instr->src.kind == ASM_OPERAND_PSEUDO)
+                move_src = sc->node_of[instr->src.value];
+
+            for (int d = 0; d < ud.def_count; d++)
+            {
+                if (ud.defs[d] >= fn->pseudo_count) continue;
+                int node = sc->node_of[ud.defs[d]];
+                for (size_t w = 0; w < pseudo_words; w++)
+                {
+                    for (BitWord bits = current[w]; bits; bits &= bits - 1)
+                    {
+                        int var = (int)(w * BITSET_WORD_BITS) + __builtin_ctzll(bits);
+                        if (var >= fn->pseudo_count) break;
+                        int other = sc->node_of[var];
+                        if (other >= 0 && other != move_src)
+                            add_edge(sc, node, other);
+                    }
+                }
+                if (move_src >= 0 && sc->partner[node] < 0)
+                {
+                    sc->partner[node] = move_src;
+                    if (sc->partner[move_src] < 0)
+                        sc->partner[move_src] = node;
+                }
+            }
+
+            for (int d = 0; d < ud.def_count; d++)
+                bitset_clear(current, ud.defs[d]);
+            for (int u = 0; u < ud.use_count; u++)
+                bitset_set(current, ud.uses[u]);
+        }
+    }
+
+    free(current);
+}
+
+// qsort has no context argument, so compare_weight reads the weights from here.
+static const long *sort_weight;
+
+/**
+ * @brief Orders nodes by decreasing weight, then by number.
+ * @param a The first node.
+ * @param b The second node.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compare_weight(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    if (sort_weight[x] != sort_weight[y])
+        return sort_weight[x] > sort_weight[y] ? -1 : 1;
+    return x - y;
+}
+
+/**
+ * @brief Shares stack slots among one function's spilled pseudo registers.
+ * @param fn The function, after register allocation.
+ * @param stats Receives slot counts.
+ */
+static void share_function(AsmFunction *fn, OptStats *stats)
+{
+    AsmLiveness live;
+    asm_liveness_compute(&live, fn);
+
+    SlotColoring sc;
+    sc.fn = fn;
+    sc.count = 0;
+    sc.node_of = malloc((fn->pseudo_count + 1) * sizeof(int));
+    sc.pseudo_of = malloc((fn->pseudo_count + 1) * sizeof(int));
+    sc.weight = malloc((fn->pseudo_count + 1) * sizeof(long));
+    sc.partner = malloc((fn->pseudo_count + 1) * sizeof(int));
+    for (int p = 0; p < fn->pseudo_count; p++)
+        sc.node_of[p] = -1;
+    collect_nodes(&sc, &live);
+
+    if (sc.count < 2 || sc.count > SLOT_MATRIX_LIMIT)
+    {
+        stats->counts[STAT_STACK_SLOTS] += sc.count;
+        free(sc.node_of);
+        free(sc.pseudo_of);
+        free(sc.weight);
+        free(sc.partner);
+        asm_liveness_free(&live);
+        return;
+    }
+
+    sc.matrix = calloc(bitset_words((int)((size_t)sc.count * (sc.count - 1) / 2 + 1)), sizeof(BitWord));
+    build_interference(&sc, &live);
+
+    int *order = malloc(sc.count * sizeof(int));
+    int *slot_of = malloc(sc.count * sizeof(int));
+    int *owner = malloc(sc.count * sizeof(int));  // Slot -> pseudo register that names it
+    for (int n = 0; n < sc.count; n++)
+    {
+        order[n] = n;
+        slot_of[n] = -1;
+    }
+    sort_weight = sc.weight;
+    qsort(order, sc.count, sizeof(int), compare_weight);
+
+    // Slots taken by the neighbours of the node being colored.
+    BitWord *taken = bitset_new(sc.count);
+    int slot_count = 0;
+    for (int k = 0; k < sc.count; k++)
+    {
+        int node = order[k];
+        bitset_zero(taken, bitset_words(sc.count));
+        for (int other = 0; other < sc.count; other++)
+        {
+            if (other != node && slot_of[other] >= 0 && interferes(&sc, node, other))
+                bitset_set(taken, slot_of[other]);
+        }
+
+        int partner = sc.partner[node];
+        int slot = 0;
+        if (partner >= 0 && slot_of[partner] >= 0 && !bitset_test(taken, slot_of[partner]))
+            slot = slot_of[partner];
+        else
+        {
+            while (slot < slot_count && bitset_test(taken, slot))
+                slot++;
+            if (slot == slot_count)
+                owner[slot_count++] = sc.pseudo_of[node];
+        }
+        slot_of[node] = slot;
+    }
+    free(taken);
+
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        AsmInstr *instr = &fn->instrs[i];
+        AsmOperand *operands[3] = {&instr->src, &instr->dst, &instr->index};
+        for (int o = 0; o < 3; o++)
+        {
+            if (operands[o]->kind == ASM_OPERAND_PSEUDO)
+                operands[o]->value = owner[slot_of[sc.node_of[operands[o]->value]]];
+        }
+        if (instr->op == ASM_MOV && asm_same_operand(instr->src, instr->dst))
+            instr->op = ASM_NOP;
+    }
+
+    stats->counts[STAT_STACK_SLOTS] += slot_count;
+    stats->counts[STAT_STACK_SLOTS_SHARED] += sc.count - slot_count;
+
+    free(order);
+    free(slot_of);
+    free(owner);
+    free(sc.matrix);
+    free(sc.node_of);
+    free(sc.pseudo_of);
+    free(sc.weight);
+    free(sc.partner);
+    asm_liveness_free(&live);
+}
+
+/**
+ * @brief Checks whether any pseudo register is left in a function.
+ * @param fn The function.
+ * @return 1 if some operand is a pseudo register.
+ */
+static int has_pseudos(const AsmFunction *fn)
+{
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        const AsmInstr *instr = &fn->instrs[i];
+        if (instr->src.kind == ASM_OPERAND_PSEUDO || instr->dst.kind == ASM_OPERAND_PSEUDO ||
+            instr->index.kind == ASM_OPERAND_PSEUDO)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lets spilled pseudo registers with disjoint live ranges share stack slots.
+ * @param program The program after register allocation.
+ * @param stats Receives slot counts.
+ */
+void stack_share_slots(AsmProgram *program, OptStats *stats)
+{
+    for (int f = 0; f < program->function_count; f++)
+    {
+        AsmFunction *fn = &program->functions[f];
+        if (fn->defined && has_pseudos(fn))
+            share_function(fn, stats);
+    }
+}
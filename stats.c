@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "stats.h"
+
+//--- Counter Descriptions ---
+static const struct
+{
+    const char *pass;
+    const char *description;
+} stat_info[STAT_COUNT] = {
+    [STAT_INLINED] = {"inline", "Call sites inlined"},
+    [STAT_INLINE_REJECTED] = {"inline", "Call sites not inlined"},
+    [STAT_TAIL_RECURSION] = {"tailrec", "Tail recursions turned into loops"},
+    [STAT_SCCP_FOLDED] = {"sccp", "Instructions folded to constants"},
+    [STAT_SCCP_BRANCHES_FOLDED] = {"sccp", "Conditional branches folded"},
+    [STAT_SCCP_BLOCKS_REMOVED] = {"sccp", "Unreachable blocks removed"},
+    [STAT_COPIES_PROPAGATED] = {"copyprop", "Copies propagated"},
+    [STAT_GVN_REDUNDANT] = {"gvn", "Redundant computations eliminated"},
+    [STAT_GVN_PHIS_REMOVED] = {"gvn", "Trivial phis eliminated"},
+    [STAT_LOOPS_FOUND] = {"licm", "Natural loops found"},
+    [STAT_LICM_PREHEADERS] = {"licm", "Loop preheaders inserted"},
+    [STAT_LICM_HOISTED] = {"licm", "Invariant instructions hoisted"},
+    [STAT_IV_FOUND] = {"iv", "Induction variables found"},
+    [STAT_IV_REDUCED] = {"iv", "Multiplications strength-reduced"},
+    [STAT_IV_TESTS_REPLACED] = {"iv", "Loop tests replaced"},
+    [STAT_DIVS_LOWERED] = {"divconst", "Divisions by constants lowered"},
+    [STAT_DCE_REMOVED] = {"dce", "Dead instructions removed"},
+    [STAT_CFG_JUMPS_THREADED] = {"simplify", "Jumps threaded through empty blocks"},
+    [STAT_CFG_BLOCKS_REMOVED] = {"simplify", "Blocks removed or merged"},
+    [STAT_CFG_ROUND_LIMIT] = {"simplify", "Functions stopped at the round limit"},
+    [STAT_COPIES_COALESCED] = {"coalesce", "Copies coalesced"},
+    [STAT_LAYOUT_INVERTED] = {"layout", "Branches inverted for a likely fall-through"},
+    [STAT_SELECT_LEA] = {"select", "lea instructions formed"},
+    [STAT_SELECT_BRANCHES_FUSED] = {"select", "Compares fused into branches"},
+    [STAT_SELECT_TAIL_CALLS] = {"select", "Tail calls turned into jumps"},
+    [STAT_RA_ALLOCATED] = {"regalloc", "Values assigned to registers"},
+    [STAT_RA_SPILLED] = {"regalloc", "Values spilled to the stack"},
+    [STAT_RA_MOVES_REMOVED] = {"regalloc", "Moves removed"},
+    [STAT_RA_COALESCED] = {"regalloc", "Moves coalesced"},
+    [STAT_RA_REMATERIALIZED] = {"regalloc", "Constants rematerialized"},
+    [STAT_STACK_SLOTS] = {"stack", "Stack slots used"},
+    [STAT_STACK_SLOTS_SHARED] = {"stack", "Spilled values sharing a slot"},
+    [STAT_FRAME_BYTES] = {"frame", "Stack frame bytes"},
+    [STAT_PEEP_SELF_MOVE] = {"peephole", "Self moves removed"},
+    [STAT_PEEP_REDUNDANT_MOVE] = {"peephole", "Redundant moves removed"},
+    [STAT_PEEP_ZERO_XOR] = {"peephole", "Zeroing moves turned into xor"},
+    [STAT_PEEP_ZERO_HOISTED] = {"peephole", "Zeroing moves hoisted above compares"},
+    [STAT_PEEP_TEST] = {"peephole", "Compares with zero turned into test"},
+    [STAT_PEEP_KNOWN_FLAGS] = {"peephole", "Compares removed, flags already known"},
+    [STAT_PEEP_JUMP_NEXT] = {"peephole", "Jumps to the next instruction removed"},
+    [STAT_PEEP_BRANCH_INVERTED] = {"peephole", "Branches over jumps inverted"},
+};
+
+/**
+ * @brief Adds every counter of one set to another.
+ * @param into The set receiving the sums.
+ * @param from The set to add.
+ */
+void stats_merge(OptStats *into, const OptStats *from)
+{
+    for (int i = 0; i < STAT_COUNT; i++)
+        into->counts[i] += from->counts[i];
+}
+
+/**
+ * @brief Prints the non-zero counters, one per line, as "count pass - description".
+ *
+ * Nothing is printed, not even the header, when every counter is zero.
+ *
+ * @param out The stream to print to.
+ * @param stats The counters.
+ */
+void stats_print(FILE *out, const OptStats *stats)
+{
+    int printed = 0;
+    for (int i = 0; i < STAT_COUNT; i++)
+    {
+        if (stats->counts[i] == 0) continue;
+        if (!printed++)
+            fprintf(out, "=== Optimization Statistics ===\n");
+        fprintf(out, "%8ld %-8s - %s\n", stats->counts[i], stat_info[i].pass, stat_info[i].description);
+    }
+}
+
+/**
+ * @brief Returns the current time in seconds from a monotonic clock, for timing passes and output.
+ * @return The time.
+ */
+double stats_now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,63 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+//--- Optimization Counters ---
+typedef enum
+{
+    STAT_INLINED,               // Call sites replaced by the callee's body
+    STAT_INLINE_REJECTED,       // Call sites left alone
+    STAT_TAIL_RECURSION,        // Self-recursive tail calls turned into jumps back to the entry
+    STAT_SCCP_FOLDED,           // Instructions replaced by a constant
+    STAT_SCCP_BRANCHES_FOLDED,  // Conditional jumps with a constant condition
+    STAT_SCCP_BLOCKS_REMOVED,   // Blocks found unreachable
+    STAT_COPIES_PROPAGATED,     // Copies whose uses now read the source
+    STAT_GVN_REDUNDANT,         // Instructions replaced by an earlier equal value
+    STAT_GVN_PHIS_REMOVED,      // Phis whose arguments all agree
+    STAT_LOOPS_FOUND,           // Natural loops seen by LICM
+    STAT_LICM_PREHEADERS,       // Preheader blocks created
+    STAT_LICM_HOISTED,          // Instructions moved out of loops
+    STAT_IV_FOUND,              // Basic induction variables recognized
+    STAT_IV_REDUCED,            // Multiplications replaced by an induction variable
+    STAT_IV_TESTS_REPLACED,     // Comparisons moved onto a reduced induction variable
+    STAT_DIVS_LOWERED,          // Divisions and remainders by constants turned into multiplications
+    STAT_DCE_REMOVED,           // Instructions that fed no root
+    STAT_CFG_JUMPS_THREADED,    // Edges redirected past empty blocks
+    STAT_CFG_BLOCKS_REMOVED,    // Blocks deleted or merged into a neighbour
+    STAT_CFG_ROUND_LIMIT,       // Functions whose last allowed simplify-cfg round still changed them
+    STAT_COPIES_COALESCED,      // Copies whose two sides now share a temporary
+    STAT_LAYOUT_INVERTED,       // Conditional jumps inverted so the likely successor falls through
+    STAT_SELECT_LEA,            // Additions, scaled indexes and small multiplications done by one lea
+    STAT_SELECT_BRANCHES_FUSED, // Comparisons tested by a conditional jump without materializing them
+    STAT_SELECT_TAIL_CALLS,     // Calls in tail position made with a jump after the epilogue
+    STAT_RA_ALLOCATED,          // Pseudo registers given a machine register
+    STAT_RA_SPILLED,            // Pseudo registers left in stack slots
+    STAT_RA_MOVES_REMOVED,      // Moves whose two sides got the same register
+    STAT_RA_COALESCED,          // Moves whose two sides were merged into one node
+    STAT_RA_REMATERIALIZED,     // Spilled constants whose uses read the immediate instead
+    STAT_STACK_SLOTS,           // Stack slots for spilled values, after sharing
+    STAT_STACK_SLOTS_SHARED,    // Spilled values that took another one's slot
+    STAT_FRAME_BYTES,           // Stack bytes below the return address, summed over functions
+    STAT_PEEP_SELF_MOVE,        // mov a, a deleted
+    STAT_PEEP_REDUNDANT_MOVE,   // mov repeating or undoing the previous one deleted
+    STAT_PEEP_ZERO_XOR,         // mov $0, reg turned into xor reg, reg
+    STAT_PEEP_ZERO_HOISTED,     // cmp; mov $0, reg; setcc reg turned into xor; cmp; setcc
+    STAT_PEEP_TEST,             // cmp $0, reg turned into test reg, reg
+    STAT_PEEP_KNOWN_FLAGS,      // Compares whose flags the previous instruction already set
+    STAT_PEEP_JUMP_NEXT,        // Jumps to the next instruction deleted
+    STAT_PEEP_BRANCH_INVERTED,  // jcc over a jmp turned into one inverted jcc
+    STAT_COUNT
+} StatId;
+
+//--- Counter Set ---
+typedef struct
+{
+    long counts[STAT_COUNT];
+} OptStats;
+
+void stats_merge(OptStats *into, const OptStats *from);
+void stats_print(FILE *out, const OptStats *stats);
+double stats_now_seconds(void);
+
+#endif
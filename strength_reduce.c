@@ -0,0 +1,538 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// --- Induction Variable Strength Reduction ---
+// Works on SSA form, after LICM has given every loop a preheader. A basic
+// induction variable is a header phi i = phi(init from the preheader, next
+// from the single latch) where next = i + c for a constant c. Each product
+// i * k inside the loop, with k a constant or a loop-invariant temporary,
+// is replaced by a new induction variable s = phi(init * k, s + c * k), so
+// the multiplication becomes one addition per iteration. Products are shared
+// per (i, k) pair.
+//
+// Linear function test replacement then rewrites comparisons of i against a
+// constant into comparisons of s, so that i is often left feeding only its
+// own increment and DCE removes it. Arithmetic wraps, so a comparison is only
+// rewritten when the translation is exact: equality with an odd k, whose
+// multiplication is a bijection, or the loop's exit test when the range of
+// values i takes at the header can be bounded and none of them overflow.
+
+//--- Induction Variable ---
+typedef struct
+{
+    int loop;
+    int temp;           // The phi's result
+    IrValue init;       // Value on entry from the preheader
+    int32_t step;
+    int next;           // Instruction computing i + step
+    int preheader_label;
+    int latch_label;
+} InductionVar;
+
+//--- Reduced Product ---
+typedef struct
+{
+    int iv;
+    IrValue factor;
+    int temp;           // The new induction variable, equal to i * factor
+} Reduction;
+
+//--- Insertion ---
+// A new instruction emitted just before an existing one when the array is rebuilt.
+typedef struct
+{
+    int before;
+    IrInstr instr;
+} Insertion;
+
+//--- Pass State ---
+typedef struct
+{
+    IrFunction *fn;
+    const Cfg *cfg;
+    const LoopForest *forest;
+    const SsaUses *uses;
+    int *instr_block;
+    InductionVar *ivs;
+    int iv_count;
+    int *iv_of;         // Temporary -> induction variable, or -1
+    Reduction *reductions;
+    int reduction_count, reduction_capacity;
+    Insertion *inserts;
+    int insert_count, insert_capacity;
+} StrengthReduce;
+
+/**
+ * @brief Queues an instruction to be inserted before an existing one.
+ * @param sr The pass state.
+ * @param before The index of the instruction that will follow it.
+ * @param op The opcode.
+ * @param dst The destination.
+ * @param a The first operand.
+ * @param b The second operand.
+ * @return The queued instruction, valid until the next insertion.
+ */
+static IrInstr *insert(StrengthReduce *sr, int before, IrOpcode op, IrValue dst, IrValue a, IrValue b)
+{
+    if (sr->insert_count == sr->insert_capacity)
+    {
+        sr->insert_capacity = sr->insert_capacity ? sr->insert_capacity * 2 : 16;
+        sr->inserts = realloc(sr->inserts, sr->insert_capacity * sizeof(Insertion));
+    }
+    Insertion *ins = &sr->inserts[sr->insert_count++];
+    memset(ins, 0, sizeof(Insertion));
+    ins->before = before;
+    ins->instr.op = op;
+    ins->instr.dst = dst;
+    ins->instr.a = a;
+    ins->instr.b = b;
+    return &ins->instr;
+}
+
+/**
+ * @brief Checks whether a value is the same on every iteration of a loop.
+ * @param sr The pass state.
+ * @param loop The loop.
+ * @param value The value.
+ * @return 1 for constants and temporaries defined outside the loop.
+ */
+static int is_invariant(const StrengthReduce *sr, int loop, IrValue value)
+{
+    if (value.kind != IR_VAL_TEMP) return 1;
+    if (value.value >= sr->uses->temp_count) return 0;
+    int def = sr->uses->def[value.value];
+    return def < 0 || !loop_contains(sr->forest, loop, sr->instr_block[def]);
+}
+
+/**
+ * @brief Recognizes the basic induction variables among the loop header phis.
+ * @param sr The pass state.
+ */
+static void find_induction_vars(StrengthReduce *sr)
+{
+    IrFunction *fn = sr->fn;
+    const Cfg *cfg = sr->cfg;
+    sr->ivs = malloc((fn->instr_count + 1) * sizeof(InductionVar));
+    sr->iv_of = malloc((fn->temp_count + 1) * sizeof(int));
+    for (int t = 0; t < fn->temp_count; t++)
+        sr->iv_of[t] = -1;
+
+    for (int l = 0; l < sr->forest->loop_count; l++)
+    {
+        const Loop *loop = &sr->forest->loops[l];
+        const BasicBlock *header = &cfg->blocks[loop->header];
+        if (loop->preheader < 0 || header->label < 0) continue;
+        int preheader_label = cfg->blocks[loop->preheader].label;
+        if (preheader_label < 0) continue;
+
+        for (int i = header->start; i < header->end; i++)
+        {
+            const IrInstr *phi = &fn->instrs[i];
+            if (phi->op != IR_PHI || phi->arg_count != 2) continue;
+
+            int outside = fn->arg_labels[phi->arg_start] == preheader_label ? 0 : 1;
+            if (fn->arg_labels[phi->arg_start + outside] != preheader_label) continue;
+            int latch_label = fn->arg_labels[phi->arg_start + 1 - outside];
+            int latch = cfg->label_block[latch_label];
+            IrValue next = fn->args[phi->arg_start + 1 - outside];
+            if (latch < 0 || !loop_contains(sr->forest, l, latch) || next.kind != IR_VAL_TEMP) continue;
+
+            int def = sr->uses->def[next.value];
+            if (def < 0 || !loop_contains(sr->forest, l, sr->instr_block[def])) continue;
+            const IrInstr *inc = &fn->instrs[def];
+            int32_t step;
+            if (inc->op == IR_ADD && inc->a.kind == IR_VAL_TEMP && inc->a.value == phi->dst.value && inc->b.kind == IR_VAL_CONST)
+                step = inc->b.value;
+            else if (inc->op == IR_ADD && inc->b.kind == IR_VAL_TEMP && inc->b.value == phi->dst.value && inc->a.kind == IR_VAL_CONST)
+                step = inc->a.value;
+            else if (inc->op == IR_SUB && inc->a.kind == IR_VAL_TEMP && inc->a.value == phi->dst.value && inc->b.kind == IR_VAL_CONST)
+                step = (int32_t)(0u - (uint32_t)inc->b.value);
+            else
+                continue;
+            if (step == 0) continue;
+
+            InductionVar *iv = &sr->ivs[sr->iv_count];
+            iv->loop = l;
+            iv->temp = phi->dst.value;
+            iv->init = fn->args[phi->arg_start + outside];
+            iv->step = step;
+            iv->next = def;
+            iv->preheader_label = preheader_label;
+            iv->latch_label = latch_label;
+            sr->iv_of[iv->temp] = sr->iv_count++;
+        }
+    }
+}
+
+/**
+ * @brief Finds or creates the induction variable equal to i * factor.
+ *
+ * A new variable needs its initial value and, for an invariant temporary
+ * factor, its step computed at the end of the preheader, a phi in the header,
+ * and its increment right after the increment of i.
+ *
+ * @param sr The pass state.
+ * @param iv The basic induction variable.
+ * @param factor A constant or a temporary invariant in the loop.
+ * @return The temporary holding the product.
+ */
+static int reduce(StrengthReduce *sr, int iv, IrValue factor)
+{
+    for (int r = 0; r < sr->reduction_count; r++)
+    {
+        const Reduction *red = &sr->reductions[r];
+        if (red->iv == iv && red->factor.kind == factor.kind && red->factor.value == factor.value)
+            return red->temp;
+    }
+
+    IrFunction *fn = sr->fn;
+    const InductionVar *var = &sr->ivs[iv];
+    const Loop *loop = &sr->forest->loops[var->loop];
+    int preheader_end = cfg_last_instr(fn, &sr->cfg->blocks[loop->preheader]);
+    if (preheader_end < 0 || !ir_is_jump(fn->instrs[preheader_end].op))
+        preheader_end = sr->cfg->blocks[loop->preheader].end;
+
+    IrValue init, step;
+    int32_t folded;
+    if (var->init.kind == IR_VAL_CONST && factor.kind == IR_VAL_CONST)
+    {
+        ir_fold(IR_MUL, var->init.value, factor.value, &folded);
+        init = ir_const(folded);
+    }
+    else
+    {
+        init = ir_temp(ir_new_temp(fn));
+        insert(sr, preheader_end, IR_MUL, init, var->init, factor);
+    }
+    if (factor.kind == IR_VAL_CONST)
+    {
+        ir_fold(IR_MUL, var->step, factor.value, &folded);
+        step = ir_const(folded);
+    }
+    else if (var->step == 1)
+        step = factor;
+    else
+    {
+        step = ir_temp(ir_new_temp(fn));
+        insert(sr, preheader_end, IR_MUL, step, factor, ir_const(var->step));
+    }
+
+    int temp = ir_new_temp(fn);
+    int next = ir_new_temp(fn);
+    int start = ir_alloc_args(fn, 2);
+    fn->args[start] = init;
+    fn->arg_labels[start] = var->preheader_label;
+    fn->args[start + 1] = ir_temp(next);
+    fn->arg_labels[start + 1] = var->latch_label;
+    IrInstr *phi = insert(sr, sr->cfg->blocks[loop->header].start + 1, IR_PHI, ir_temp(temp), ir_none(), ir_none());
+    phi->arg_start = start;
+    phi->arg_count = 2;
+    insert(sr, var->next + 1, IR_ADD, ir_temp(next), ir_temp(temp), step);
+
+    if (sr->reduction_count == sr->reduction_capacity)
+    {
+        sr->reduction_capacity = sr->reduction_capacity ? sr->reduction_capacity * 2 : 8;
+        sr->reductions = realloc(sr->reductions, sr->reduction_capacity * sizeof(Reduction));
+    }
+    Reduction *red = &sr->reductions[sr->reduction_count++];
+    red->iv = iv;
+    red->factor = factor;
+    red->temp = temp;
+    return temp;
+}
+
+/**
+ * @brief Replaces multiplications of induction variables inside their loops.
+ * @param sr The pass state.
+ * @return The number of multiplications replaced.
+ */
+static int reduce_products(StrengthReduce *sr)
+{
+    IrFunction *fn = sr->fn;
+    int reduced = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+        if (instr->op != IR_MUL || instr->dst.kind != IR_VAL_TEMP || sr->instr_block[i] < 0) continue;
+
+        IrValue operands[2] = {instr->a, instr->b};
+        for (int side = 0; side < 2; side++)
+        {
+            IrValue var = operands[side], factor = operands[1 - side];
+            if (var.kind != IR_VAL_TEMP || var.value >= sr->uses->temp_count || sr->iv_of[var.value] < 0) continue;
+            int iv = sr->iv_of[var.value];
+            int loop = sr->ivs[iv].loop;
+            if (!loop_contains(sr->forest, loop, sr->instr_block[i]) || !is_invariant(sr, loop, factor)) continue;
+            if (factor.kind == IR_VAL_CONST && (factor.value == 0 || factor.value == 1)) continue;
+
+            int temp = reduce(sr, iv, factor);
+            instr = &fn->instrs[i];
+            instr->op = IR_COPY;
+            instr->a = ir_temp(temp);
+            instr->b = ir_none();
+            reduced++;
+            break;
+        }
+    }
+    return reduced;
+}
+
+/**
+ * @brief Mirrors a comparison so that its operands can be swapped.
+ * @param op A comparison opcode.
+ * @return The opcode with a and b exchanged.
+ */
+static IrOpcode swap_compare(IrOpcode op)
+{
+    switch (op)
+    {
+        case IR_LT: return IR_GT;
+        case IR_LE: return IR_GE;
+        case IR_GT: return IR_LT;
+        case IR_GE: return IR_LE;
+        default: return op;
+    }
+}
+
+/**
+ * @brief Negates an ordered comparison.
+ * @param op A comparison opcode.
+ * @return The opcode that is true exactly when op is false.
+ */
+static IrOpcode negate_compare(IrOpcode op)
+{
+    switch (op)
+    {
+        case IR_LT: return IR_GE;
+        case IR_LE: return IR_GT;
+        case IR_GT: return IR_LE;
+        case IR_GE: return IR_LT;
+        case IR_EQ: return IR_NE;
+        case IR_NE: return IR_EQ;
+        default: return op;
+    }
+}
+
+/**
+ * @brief Checks whether a comparison is the exit test of an induction variable's loop.
+ * @param sr The pass state.
+ * @param var The induction variable.
+ * @param compare The index of the comparison.
+ * @param stays Set to 1 if the loop continues when the comparison is true, 0 if when false.
+ * @return 1 if the header ends by branching out of the loop on the comparison's result.
+ */
+static int is_exit_test(const StrengthReduce *sr, const InductionVar *var, int compare, int *stays)
+{
+    const Cfg *cfg = sr->cfg;
+    int header = sr->forest->loops[var->loop].header;
+    if (sr->instr_block[compare] != header) return 0;
+
+    int last = cfg_last_instr(sr->fn, &cfg->blocks[header]);
+    if (last < 0) return 0;
+    const IrInstr *branch = &sr->fn->instrs[last];
+    if (branch->op != IR_JUMP_IF_ZERO && branch->op != IR_JUMP_IF_NOT_ZERO) return 0;
+    if (branch->a.kind != IR_VAL_TEMP || branch->a.value != sr->fn->instrs[compare].dst.value) return 0;
+    int target = cfg->label_block[branch->label];
+    if (target < 0 || loop_contains(sr->forest, var->loop, target)) return 0;
+
+    *stays = branch->op == IR_JUMP_IF_ZERO;
+    return 1;
+}
+
+/**
+ * @brief Bounds the values an induction variable takes at its loop header.
+ *
+ * The loop only goes around again when i op bound holds, so with a positive
+ * step i never exceeds the last value passing the test plus the step, and
+ * symmetrically for a negative step.
+ *
+ * @param var The induction variable, with a constant initial value.
+ * @param op The comparison, as i op bound, that keeps the loop running.
+ * @param bound The constant bound.
+ * @param lo Set to the smallest value.
+ * @param hi Set to the largest value.
+ * @return 1 if the range could be bounded without overflow.
+ */
+static int header_range(const InductionVar *var, IrOpcode op, int32_t bound, int64_t *lo, int64_t *hi)
+{
+    int64_t init = var->init.value;
+    if (var->step > 0)
+    {
+        if (op != IR_LT && op != IR_LE) return 0;
+        int64_t last = (op == IR_LT ? (int64_t)bound - 1 : bound) + var->step;
+        if (last > INT32_MAX) return 0;
+        *lo = init;
+        *hi = last > init ? last : init;
+    }
+    else
+    {
+        if (op != IR_GT && op != IR_GE) return 0;
+        int64_t last = (op == IR_GT ? (int64_t)bound + 1 : bound) + var->step;
+        if (last < INT32_MIN) return 0;
+        *hi = init;
+        *lo = last < init ? last : init;
+    }
+    return 1;
+}
+
+/**
+ * @brief Rewrites comparisons of induction variables against constants to use their products.
+ * @param sr The pass state, after reduce_products.
+ * @return The number of comparisons rewritten.
+ */
+static int replace_tests(StrengthReduce *sr)
+{
+    IrFunction *fn = sr->fn;
+    int replaced = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        IrInstr *instr = &fn->instrs[i];
+        if (instr->op < IR_EQ || instr->op > IR_GE || sr->instr_block[i] < 0) continue;
+
+        // Normalize to i op bound.
+        IrOpcode op = instr->op;
+        IrValue var = instr->a, bound = instr->b;
+        if (var.kind != IR_VAL_TEMP)
+        {
+            var = instr->b;
+            bound = instr->a;
+            op = swap_compare(op);
+        }
+        if (var.kind != IR_VAL_TEMP || bound.kind != IR_VAL_CONST) continue;
+        if (var.value >= sr->uses->temp_count || sr->iv_of[var.value] < 0) continue;
+        int iv = sr->iv_of[var.value];
+        const InductionVar *ind = &sr->ivs[iv];
+        if (!loop_contains(sr->forest, ind->loop, sr->instr_block[i])) continue;
+
+        int stays = 0;
+        int64_t lo = 0, hi = 0;
+        int ordered = op != IR_EQ && op != IR_NE;
+        if (ordered)
+        {
+            if (ind->init.kind != IR_VAL_CONST || !is_exit_test(sr, ind, i, &stays)) continue;
+            if (!header_range(ind, stays ? op : negate_compare(op), bound.value, &lo, &hi)) continue;
+        }
+
+        for (int r = 0; r < sr->reduction_count; r++)
+        {
+            const Reduction *red = &sr->reductions[r];
+            if (red->iv != iv || red->factor.kind != IR_VAL_CONST) continue;
+            int64_t k = red->factor.value;
+            if (!ordered && (k & 1) == 0) continue;
+            if (ordered)
+            {
+                int64_t a = lo * k, b = hi * k, c = bound.value * k;
+                if (a < INT32_MIN || a > INT32_MAX || b < INT32_MIN || b > INT32_MAX || c < INT32_MIN || c > INT32_MAX)
+                    continue;
+            }
+
+            int32_t scaled;
+            ir_fold(IR_MUL, bound.value, red->factor.value, &scaled);
+            instr->op = k < 0 ? swap_compare(op) : op;
+            instr->a = ir_temp(red->temp);
+            instr->b = ir_const(scaled);
+            replaced++;
+            break;
+        }
+    }
+    return replaced;
+}
+
+/**
+ * @brief Emits the queued instructions into the instruction array.
+ * @param sr The pass state.
+ */
+static void apply_insertions(StrengthReduce *sr)
+{
+    IrFunction *fn = sr->fn;
+    int count = fn->instr_count;
+
+    // Stable bucket sort by position, so instructions queued for the same
+    // spot keep the order they were created in.
+    int *start = calloc(count + 2, sizeof(int));
+    int *order = malloc((sr->insert_count + 1) * sizeof(int));
+    for (int k = 0; k < sr->insert_count; k++)
+        start[sr->inserts[k].before + 1]++;
+    for (int i = 0; i <= count; i++)
+        start[i + 1] += start[i];
+    int *fill = malloc((count + 2) * sizeof(int));
+    memcpy(fill, start, (count + 2) * sizeof(int));
+    for (int k = 0; k < sr->insert_count; k++)
+        order[fill[sr->inserts[k].before]++] = k;
+
+    IrInstr *old = fn->instrs;
+    fn->instrs = NULL;
+    fn->instr_count = 0;
+    fn->instr_capacity = 0;
+    for (int i = 0; i <= count; i++)
+    {
+        for (int k = start[i]; k < start[i + 1]; k++)
+        {
+            const IrInstr *instr = &sr->inserts[order[k]].instr;
+            IrInstr *copy = ir_emit(fn, instr->op, instr->dst, instr->a, instr->b);
+            *copy = *instr;
+        }
+        if (i < count)
+        {
+            IrInstr *copy = ir_emit(fn, old[i].op, old[i].dst, old[i].a, old[i].b);
+            *copy = old[i];
+        }
+    }
+    free(old);
+    free(fill);
+    free(order);
+    free(start);
+}
+
+/**
+ * @brief Strength-reduces induction variable products and replaces loop tests.
+ * @param ctx The function to optimize, in SSA form, and its analyses.
+ * @return 1 if the function changed.
+ */
+int strength_reduce_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    if (fn->instr_count == 0) return 0;
+    const LoopForest *forest = pass_loops(ctx);
+    if (forest->loop_count == 0) return 0;
+
+    StrengthReduce sr;
+    memset(&sr, 0, sizeof(StrengthReduce));
+    sr.fn = fn;
+    sr.cfg = pass_dominators(ctx);
+    sr.forest = forest;
+    sr.uses = pass_uses(ctx);
+    sr.instr_block = malloc((fn->instr_count + 1) * sizeof(int));
+    for (int i = 0; i < fn->instr_count; i++)
+        sr.instr_block[i] = -1;
+    for (int b = 0; b < sr.cfg->block_count; b++)
+    {
+        if (sr.cfg->rpo_index[b] < 0) continue;
+        for (int i = sr.cfg->blocks[b].start; i < sr.cfg->blocks[b].end; i++)
+            sr.instr_block[i] = b;
+    }
+
+    find_induction_vars(&sr);
+    int reduced = 0, replaced = 0;
+    if (sr.iv_count > 0)
+    {
+        reduced = reduce_products(&sr);
+        replaced = replace_tests(&sr);
+        if (sr.insert_count > 0)
+            apply_insertions(&sr);
+    }
+    ctx->stats->counts[STAT_IV_FOUND] += sr.iv_count;
+    ctx->stats->counts[STAT_IV_REDUCED] += reduced;
+    ctx->stats->counts[STAT_IV_TESTS_REPLACED] += replaced;
+
+    free(sr.inserts);
+    free(sr.reductions);
+    free(sr.iv_of);
+    free(sr.ivs);
+    free(sr.instr_block);
+    return reduced > 0 || replaced > 0;
+}
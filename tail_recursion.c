@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// --- Tail Recursion Elimination ---
+// A function that returns the result of calling itself has nothing left to
+// do after the call, so the call can reuse the current activation: the
+// arguments are assigned to the parameter temporaries and control jumps back
+// to the start of the body. The recursion becomes a loop that runs in
+// constant stack space, and the passes after it treat it like any other
+// loop (induction variables, invariant code motion).
+//
+// Arguments may read the parameters they replace (f(b, a)), so they are
+// first copied to fresh temporaries and only then to the parameters; copy
+// propagation and coalescing remove the copies that turn out unnecessary.
+// The body gets a label of its own behind a jump from the entry, since SSA
+// construction needs an entry block that nothing jumps back to.
+//
+// Runs first in each pipeline, on IR outside SSA form. Calls to other
+// functions in tail position are left to the backend, which makes them with
+// a jump.
+
+/**
+ * @brief Checks whether an instruction is a call of the function itself whose result is returned at once.
+ * @param fn The function.
+ * @param self The function's index in the program.
+ * @param i The instruction.
+ * @return 1 for a self-recursive tail call.
+ */
+static int is_tail_recursion(const IrFunction *fn, int self, int i)
+{
+    const IrInstr *call = &fn->instrs[i];
+    if (call->op != IR_CALL || call->callee != self || call->arg_count != fn->param_count)
+        return 0;
+    return ir_tail_return(fn, i) >= 0;
+}
+
+/**
+ * @brief Turns self-recursive tail calls into jumps back to the start of the function.
+ * @param ctx The function and its analyses; the function must be out of SSA form.
+ * @return 1 if the function changed.
+ */
+int tail_recursion_run(PassContext *ctx)
+{
+    IrFunction *fn = ctx->fn;
+    unsigned char *tail = calloc(fn->instr_count + 1, 1);
+    int found = 0;
+    for (int i = 0; i < fn->instr_count; i++)
+    {
+        tail[i] = (unsigned char)is_tail_recursion(fn, ctx->index, i);
+        found += tail[i];
+    }
+    if (!found)
+    {
+        free(tail);
+        return 0;
+    }
+
+    IrInstr *old = fn->instrs;
+    int old_count = fn->instr_count;
+    fn->instrs = NULL;
+    fn->instr_count = 0;
+    fn->instr_capacity = 0;
+
+    int body = ir_new_label(fn);
+    ir_emit_jump(fn, IR_JUMP, ir_none(), body);
+    ir_emit_label(fn, body);
+
+    int *incoming = malloc((fn->param_count + 1) * sizeof(int));
+    for (int i = 0; i < old_count; i++)
+    {
+        if (!tail[i])
+        {
+            IrInstr *copy = ir_emit(fn, old[i].op, old[i].dst, old[i].a, old[i].b);
+            *copy = old[i];
+            continue;
+        }
+
+        const IrValue *args = fn->args + old[i].arg_start;
+        for (int p = 0; p < fn->param_count; p++)
+        {
+            incoming[p] = -1;
+            if (args[p].kind == IR_VAL_TEMP && args[p].value == p) continue;
+            incoming[p] = ir_new_temp(fn);
+            ir_emit(fn, IR_COPY, ir_temp(incoming[p]), args[p], ir_none());
+        }
+        for (int p = 0; p < fn->param_count; p++)
+        {
+            if (incoming[p] >= 0)
+                ir_emit(fn, IR_COPY, ir_temp(p), ir_temp(incoming[p]), ir_none());
+        }
+        ir_emit_jump(fn, IR_JUMP, ir_none(), body);
+        ctx->stats->counts[STAT_TAIL_RECURSION]++;
+
+        // Skip the return of the call's result.
+        i++;
+        while (old[i].op == IR_NOP)
+            i++;
+    }
+
+    free(incoming);
+    free(tail);
+    free(old);
+    return 1;
+}
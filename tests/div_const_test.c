@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interp.h"
+#include "passes.h"
+
+// --- Division by Constants Test ---
+// Checks the sequences div_const_run emits for n / d and n % d against
+// plain division. For each divisor a loop in IR walks a range of dividends
+// and counts the ones where the lowered quotient or remainder differs from
+// an IR_DIV or IR_REM by the same divisor held in a temporary. Those are
+// left alone by the pass, and the interpreter evaluates them with C's / and
+// %. The loop runs in the interpreter, so the rewritten IR is exactly what
+// the pass produced.
+//
+// By default the test takes a few seconds. It covers 33 chosen divisors,
+// every divisor in [-70000, 70000], and 200000 random divisors. Each
+// divisor is checked on the dividends at both ends of the range, around
+// zero, and on a strided sample of all 2^32. With --exhaustive, the 33
+// chosen divisors are checked on every 32-bit dividend instead, which
+// takes hours.
+
+#define SWEEP_LIMIT 70000
+#define RANDOM_DIVISORS 200000
+#define EDGE_DIVIDENDS 64
+#define SAMPLED_DIVIDENDS 256
+
+// Small, large, negative, power-of-two and INT32_MIN divisors, and ones
+// whose magic multiplier needs the add or subtract fix-up.
+static const int32_t chosen_divisors[] = {
+    2, 3, 5, 6, 7, 9, 10, 11, 13, 25, 125, 641, 1000, 6700417, 1 << 30, INT32_MAX, INT32_MIN,
+    -2, -3, -5, -6, -7, -9, -10, -11, -13, -25, -125, -641, -1000, -(1 << 30), -INT32_MAX, 1,
+};
+
+/**
+ * @brief Counts the dividends in an arithmetic progression whose lowered quotient or remainder is wrong.
+ * @param d The divisor; not 0 or -1.
+ * @param first The first dividend.
+ * @param step The difference between dividends; the progression wraps around.
+ * @param count The number of dividends; 0 for all 2^32 steps.
+ * @return The number of wrong dividends, or -1 if the interpreter failed.
+ */
+static long check_divisor(int32_t d, int32_t first, int32_t step, uint32_t count)
+{
+    IrProgram *program = ir_program_new();
+    IrFunction *fn = ir_add_function(program, "main", 0);
+    fn->defined = 1;
+
+    int n = ir_new_temp(fn), i = ir_new_temp(fn), wrong = ir_new_temp(fn), divisor = ir_new_temp(fn);
+    int quotient = ir_new_temp(fn), remainder = ir_new_temp(fn);
+    int expected_quotient = ir_new_temp(fn), expected_remainder = ir_new_temp(fn);
+    int differs = ir_new_temp(fn);
+    int top = ir_new_label(fn);
+
+    ir_emit(fn, IR_COPY, ir_temp(n), ir_const(first), ir_none());
+    ir_emit(fn, IR_COPY, ir_temp(i), ir_const(0), ir_none());
+    ir_emit(fn, IR_COPY, ir_temp(wrong), ir_const(0), ir_none());
+    ir_emit(fn, IR_COPY, ir_temp(divisor), ir_const(d), ir_none());
+    ir_emit_label(fn, top);
+    ir_emit(fn, IR_DIV, ir_temp(quotient), ir_temp(n), ir_const(d));
+    ir_emit(fn, IR_REM, ir_temp(remainder), ir_temp(n), ir_const(d));
+    ir_emit(fn, IR_DIV, ir_temp(expected_quotient), ir_temp(n), ir_temp(divisor));
+    ir_emit(fn, IR_REM, ir_temp(expected_remainder), ir_temp(n), ir_temp(divisor));
+    ir_emit(fn, IR_NE, ir_temp(differs), ir_temp(quotient), ir_temp(expected_quotient));
+    ir_emit(fn, IR_ADD, ir_temp(wrong), ir_temp(wrong), ir_temp(differs));
+    ir_emit(fn, IR_NE, ir_temp(differs), ir_temp(remainder), ir_temp(expected_remainder));
+    ir_emit(fn, IR_ADD, ir_temp(wrong), ir_temp(wrong), ir_temp(differs));
+    ir_emit(fn, IR_ADD, ir_temp(n), ir_temp(n), ir_const(step));
+    ir_emit(fn, IR_ADD, ir_temp(i), ir_temp(i), ir_const(1));
+    ir_emit(fn, IR_NE, ir_temp(differs), ir_temp(i), ir_const((int32_t)count));
+    ir_emit_jump(fn, IR_JUMP_IF_NOT_ZERO, ir_temp(differs), top);
+    ir_emit(fn, IR_RETURN, ir_none(), ir_temp(wrong), ir_none());
+
+    OptStats stats;
+    memset(&stats, 0, sizeof(OptStats));
+    PassContext ctx;
+    memset(&ctx, 0, sizeof(PassContext));
+    ctx.fn = fn;
+    ctx.stats = &stats;
+    div_const_run(&ctx);
+
+    int result = 0;
+    int status = ir_interpret(program, &result);
+    ir_program_free(program);
+    // Every dividend adds at most 2, so a full sweep can wrap the counter;
+    // it still reads non-zero unless exactly 2^31 dividends are wrong.
+    return status == 0 ? (long)(uint32_t)result : -1;
+}
+
+/**
+ * @brief Checks one divisor on the sampled dividends and reports any that are wrong.
+ * @param d The divisor.
+ * @param state The random number state.
+ * @return 1 if the divisor passed.
+ */
+static int check_sampled(int32_t d, uint64_t *state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    int32_t start = (int32_t)(uint32_t)(*state >> 32);
+    // An odd step of about 2^32 / SAMPLED_DIVIDENDS spreads the sample over the whole range.
+    int32_t stride = (int32_t)((UINT32_MAX / SAMPLED_DIVIDENDS) | 1);
+
+    long wrong = check_divisor(d, INT32_MIN, 1, EDGE_DIVIDENDS);
+    long more;
+    if (wrong >= 0 && (more = check_divisor(d, INT32_MAX - EDGE_DIVIDENDS + 1, 1, EDGE_DIVIDENDS)) >= 0)
+        wrong += more;
+    else
+        wrong = -1;
+    if (wrong >= 0 && (more = check_divisor(d, -EDGE_DIVIDENDS / 2, 1, EDGE_DIVIDENDS)) >= 0)
+        wrong += more;
+    else
+        wrong = -1;
+    if (wrong >= 0 && (more = check_divisor(d, start, stride, SAMPLED_DIVIDENDS)) >= 0)
+        wrong += more;
+    else
+        wrong = -1;
+
+    if (wrong != 0)
+        fprintf(stderr, "divisor %d: %ld wrong results\n", d, wrong);
+    return wrong == 0;
+}
+
+/**
+ * @brief Entry point: runs the sampled checks, or the exhaustive ones with --exhaustive.
+ * @param argc The argument count.
+ * @param argv The argument vector.
+ * @return EXIT_SUCCESS if every lowered division matched.
+ */
+int main(int argc, char *argv[])
+{
+    int exhaustive = argc > 1 && strcmp(argv[1], "--exhaustive") == 0;
+    int chosen_count = (int)(sizeof(chosen_divisors) / sizeof(chosen_divisors[0]));
+    long failures = 0;
+
+    if (exhaustive)
+    {
+        for (int i = 0; i < chosen_count; i++)
+        {
+            long wrong = check_divisor(chosen_divisors[i], INT32_MIN, 1, 0);
+            printf("divisor %d: %s\n", chosen_divisors[i], wrong == 0 ? "all 2^32 dividends correct" : "FAILED");
+            fflush(stdout);
+            failures += wrong != 0;
+        }
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    uint64_t state = 1;
+    long checked = 0;
+    for (int i = 0; i < chosen_count; i++, checked++)
+        failures += !check_sampled(chosen_divisors[i], &state);
+    for (int32_t d = -SWEEP_LIMIT; d <= SWEEP_LIMIT; d++)
+    {
+        if (d == 0 || d == -1) continue;
+        failures += !check_sampled(d, &state);
+        checked++;
+    }
+    for (int i = 0; i < RANDOM_DIVISORS; i++)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        int32_t d = (int32_t)(uint32_t)(state >> 32);
+        if (d == 0 || d == -1) continue;
+        failures += !check_sampled(d, &state);
+        checked++;
+    }
+    printf("%ld divisors checked, %ld failed\n", checked, failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,476 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "asm.h"
+#include "interp.h"
+#include "optimizer.h"
+#include "profile.h"
+#include "random_program.h"
+
+// --- Differential Fuzzer ---
+// Generates random IR programs and checks that optimizing them keeps the
+// value main returns. The interpreter runs each program as generated, which
+// gives the expected value, and again after the optimizer, which must agree.
+//
+// With --native=DIR the optimized programs also go through the backend:
+// DIR/fuzz.s receives the assembly of every program, with each function
+// renamed after its seed, and DIR/fuzz_main.c a main that calls them and
+// reports any that return something other than the expected value. Build
+// and run them with the system compiler, as tests/run.sh does. Adding
+// --stats also reports how fast the assembly was printed, which is the
+// benchmark for asm_print_program and the collecting writer.
+//
+// --wide=N replaces the generated programs with ones whose helper keeps
+// thousands of values live (random_wide_program), for the large-function
+// paths of the register allocator and stack slot sharing.
+//
+// --jobs=N checks that parallel optimization is deterministic instead. The
+// programs of JOBS_BATCH seeds are merged into one, so the work-stealing
+// pool has enough functions to share out, and the batch is optimized once
+// with a single worker and once with N. The IR and the counters of both runs
+// must be identical.
+//
+// --profile-generate instruments the native programs instead: each goes to a
+// DIR/s<seed>.s of its own, since the profile runtime's labels are local to
+// a file, and records its profile in DIR/s<seed>.prof. --profile-use=DIR
+// optimizes every program with the profile recorded there, and
+// --profile-check=REF compares that profile with one recorded at -O0: a
+// branch the optimizer inverted must still have its directions counted the
+// right way round. --profile-runs=N says how many times more often the
+// checked profile's programs were run than the reference's.
+
+#define MAX_NAME 64
+#define JOBS_BATCH 16
+
+/**
+ * @brief Prints how to run the fuzzer.
+ * @param program argv[0].
+ */
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [-O0 | -O1 | -O2] [--first=N] [--count=N] [--native=DIR] [--stats] [--wide=N]\n"
+                    "       %*s [--profile-generate | --profile-use=DIR [--profile-check=REF] [--profile-runs=N]]\n"
+                    "       %s [-O0 | -O1 | -O2] [--first=N] [--count=N] --jobs=N\n",
+            program, (int)strlen(program), "", program);
+}
+
+/**
+ * @brief Opens DIR/name for writing.
+ * @param dir The directory.
+ * @param name The file name.
+ * @return The file descriptor, or -1 after reporting the error.
+ */
+static int create_in(const char *dir, const char *name)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        perror(path);
+    return fd;
+}
+
+/**
+ * @brief Moves every function of one program to the end of another, renamed after its seed.
+ * @param into The program receiving the functions.
+ * @param from The program to empty; it is freed.
+ * @param seed The seed from was generated with.
+ */
+static void append_program(IrProgram *into, IrProgram *from, unsigned seed)
+{
+    int offset = into->function_count;
+    char name[MAX_NAME];
+    for (int f = 0; f < from->function_count; f++)
+    {
+        IrFunction *source = &from->functions[f];
+        snprintf(name, sizeof(name), "s%u_%s", seed, source->name);
+        IrFunction *fn = ir_add_function(into, name, source->param_count);
+        char *own_name = fn->name;
+        *fn = *source;
+        fn->name = own_name;
+        for (int i = 0; i < fn->instr_count; i++)
+        {
+            if (fn->instrs[i].op == IR_CALL)
+                fn->instrs[i].callee += offset;
+        }
+        source->instrs = NULL;
+        source->args = NULL;
+        source->arg_labels = NULL;
+    }
+    ir_program_free(from);
+}
+
+/**
+ * @brief Prints a program's IR into memory.
+ * @param program The program.
+ * @param size Receives the length of the text.
+ * @return The text, or NULL after reporting an error; free it with free().
+ */
+static char *dump_program(const IrProgram *program, size_t *size)
+{
+    FILE *file = tmpfile();
+    Writer *w = malloc(sizeof(Writer));
+    if (!file || !w)
+    {
+        perror("Failed to set up an IR dump");
+        if (file) fclose(file);
+        free(w);
+        return NULL;
+    }
+    writer_init(w, fileno(file));
+    ir_print_program(w, program);
+    int status = writer_flush(w);
+    free(w);
+
+    off_t length = lseek(fileno(file), 0, SEEK_END);
+    char *text = status == 0 && length >= 0 ? malloc(length + 1) : NULL;
+    if (text && pread(fileno(file), text, length, 0) != length)
+    {
+        free(text);
+        text = NULL;
+    }
+    if (!text)
+        perror("Failed to read back an IR dump");
+    fclose(file);
+    *size = text ? (size_t)length : 0;
+    return text;
+}
+
+/**
+ * @brief Checks whether two optimization runs counted the same work, ignoring times.
+ * @param a The first report.
+ * @param b The second report.
+ * @return 1 if every counter and pass run count matches.
+ */
+static int same_counts(const OptReport *a, const OptReport *b)
+{
+    if (memcmp(a->stats.counts, b->stats.counts, sizeof(a->stats.counts)) != 0)
+        return 0;
+    for (int i = 0; i < PASS_COUNT; i++)
+    {
+        const PassTiming *x = &a->timing[i], *y = &b->timing[i];
+        if (x->runs != y->runs || x->changed != y->changed || x->instr_delta != y->instr_delta)
+            return 0;
+    }
+    return a->analyses_built == b->analyses_built && a->analyses_reused == b->analyses_reused;
+}
+
+/**
+ * @brief Optimizes batches of programs with one worker and with several, and compares the results.
+ * @param level The optimization level.
+ * @param first The first seed.
+ * @param count The number of seeds.
+ * @param jobs The number of workers compared with one.
+ * @return The number of batches that differed.
+ */
+static int check_jobs(int level, unsigned first, int count, int jobs)
+{
+    int batches = 0, failures = 0, most_workers = 0;
+    for (unsigned start = first; start < first + (unsigned)count; start += JOBS_BATCH)
+    {
+        unsigned end = start + JOBS_BATCH < first + (unsigned)count ? start + JOBS_BATCH : first + (unsigned)count;
+        char *dumps[2];
+        size_t sizes[2];
+        OptReport reports[2];
+        for (int run = 0; run < 2; run++)
+        {
+            IrProgram *batch = ir_program_new();
+            for (unsigned seed = start; seed < end; seed++)
+                append_program(batch, random_program(seed), seed);
+            memset(&reports[run], 0, sizeof(OptReport));
+            OptOptions options = {level, NULL, run == 0 ? 1 : jobs, OPT_DEFAULT_INLINE_BUDGET, 0};
+            optimize_program(batch, &options, &reports[run]);
+            dumps[run] = dump_program(batch, &sizes[run]);
+            ir_program_free(batch);
+        }
+
+        if (reports[1].workers > most_workers)
+            most_workers = reports[1].workers;
+        if (!dumps[0] || !dumps[1] || sizes[0] != sizes[1] || memcmp(dumps[0], dumps[1], sizes[0]) != 0 ||
+            !same_counts(&reports[0], &reports[1]))
+        {
+            fprintf(stderr, "seeds %u-%u: -O%d with %d workers differs from 1 worker\n", start, end - 1, level, jobs);
+            failures++;
+        }
+        free(dumps[0]);
+        free(dumps[1]);
+        batches++;
+    }
+    printf("%d batches optimized at -O%d with 1 and %d workers (up to %d used), %d differed\n", batches, level,
+           jobs, most_workers, failures);
+    return failures;
+}
+
+/**
+ * @brief Writes one program's assembly to DIR/s<seed>.s.
+ * @param dir The directory.
+ * @param seed The seed the program was generated with.
+ * @param program The program.
+ * @return 0 on success, -1 after reporting an error.
+ */
+static int write_own_assembly(const char *dir, unsigned seed, const AsmProgram *program)
+{
+    char name[MAX_NAME];
+    snprintf(name, sizeof(name), "s%u.s", seed);
+    int fd = create_in(dir, name);
+    if (fd < 0)
+        return -1;
+    Writer *w = malloc(sizeof(Writer));
+    if (!w)
+    {
+        perror("Failed to allocate the assembly writer");
+        close(fd);
+        return -1;
+    }
+    writer_init(w, fd);
+    asm_print_program(w, program, "fuzz");
+    int status = writer_flush(w);
+    free(w);
+    if (close(fd) != 0 || status != 0)
+    {
+        perror(name);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks a program's profile against the one recorded for the same seed at -O0.
+ *
+ * Every run enters main once, so main must have been entered runs times as
+ * often as in the reference. A branch that ran runs times as often must
+ * also have been taken runs times as often; had the optimizer inverted it
+ * without negating its branch id, the two directions would be swapped.
+ * Branches whose totals differ, because the optimizer copied or removed
+ * them, are not compared.
+ * @param program The program, with its profile loaded.
+ * @param seed The seed it was generated with.
+ * @param wide The helper width, or 0 for random_program.
+ * @param reference_dir The directory holding the -O0 profiles.
+ * @param runs How many times more often the program was run.
+ * @return 1 if the profiles agree.
+ */
+static int check_profile(const IrProgram *program, unsigned seed, int wide, const char *reference_dir, int runs)
+{
+    IrProgram *reference = wide ? random_wide_program(seed, wide) : random_program(seed);
+    profile_number_branches(reference);
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/s%u.prof", reference_dir, seed);
+    int main_index = ir_find_function(reference, "main");
+    int ok = profile_load(reference, path) == 0;
+    if (ok && (reference->profile[main_index] == 0 ||
+               program->profile[main_index] != (uint64_t)runs * reference->profile[main_index]))
+    {
+        fprintf(stderr, "seed %u: main entered %llu times, %llu in %s\n", seed,
+                (unsigned long long)program->profile[main_index],
+                (unsigned long long)reference->profile[main_index], path);
+        ok = 0;
+    }
+
+    const uint64_t *counts = program->profile + program->function_count;
+    const uint64_t *expected = ok ? reference->profile + reference->function_count : NULL;
+    for (int b = 0; ok && b < program->branch_count; b++)
+    {
+        uint64_t total = counts[2 * b] + counts[2 * b + 1];
+        if (total == (uint64_t)runs * (expected[2 * b] + expected[2 * b + 1]) &&
+            counts[2 * b] != (uint64_t)runs * expected[2 * b])
+        {
+            fprintf(stderr, "seed %u: branch %d taken %llu of %llu times, %llu of %llu in %s\n", seed, b + 1,
+                    (unsigned long long)counts[2 * b], (unsigned long long)total,
+                    (unsigned long long)expected[2 * b],
+                    (unsigned long long)(expected[2 * b] + expected[2 * b + 1]), path);
+            ok = 0;
+        }
+    }
+    ir_program_free(reference);
+    return ok;
+}
+
+/**
+ * @brief Entry point: checks a range of seeds at one optimization level.
+ * @param argc The argument count.
+ * @param argv The argument vector.
+ * @return EXIT_SUCCESS if every program kept its value.
+ */
+int main(int argc, char *argv[])
+{
+    int level = 0;
+    unsigned first = 1;
+    int count = 1500;
+    const char *native_dir = NULL;
+    int print_stats = 0;
+    int wide = 0;
+    int jobs = 0;
+    int profile_generate = 0;
+    const char *profile_use = NULL;
+    const char *profile_check = NULL;
+    int profile_runs = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0 || strcmp(argv[i], "-O2") == 0)
+            level = argv[i][2] - '0';
+        else if (strncmp(argv[i], "--first=", 8) == 0)
+            first = (unsigned)strtoul(argv[i] + 8, NULL, 10);
+        else if (strncmp(argv[i], "--count=", 8) == 0)
+            count = atoi(argv[i] + 8);
+        else if (strncmp(argv[i], "--native=", 9) == 0)
+            native_dir = argv[i] + 9;
+        else if (strcmp(argv[i], "--stats") == 0)
+            print_stats = 1;
+        else if (strncmp(argv[i], "--wide=", 7) == 0 && atoi(argv[i] + 7) >= 2)
+            wide = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--jobs=", 7) == 0 && atoi(argv[i] + 7) >= 1)
+            jobs = atoi(argv[i] + 7);
+        else if (strcmp(argv[i], "--profile-generate") == 0)
+            profile_generate = 1;
+        else if (strncmp(argv[i], "--profile-use=", 14) == 0)
+            profile_use = argv[i] + 14;
+        else if (strncmp(argv[i], "--profile-check=", 16) == 0)
+            profile_check = argv[i] + 16;
+        else if (strncmp(argv[i], "--profile-runs=", 15) == 0 && atoi(argv[i] + 15) >= 1)
+            profile_runs = atoi(argv[i] + 15);
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((profile_generate && (!native_dir || profile_use)) || (profile_check && !profile_use))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (jobs > 0)
+        return check_jobs(level, first, count, jobs) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    Writer *assembly = NULL;
+    FILE *checker = NULL;
+    if (native_dir)
+    {
+        int fd = profile_generate ? 0 : create_in(native_dir, "fuzz.s");
+        int checker_fd = fd < 0 ? -1 : create_in(native_dir, "fuzz_main.c");
+        if (checker_fd < 0)
+            return EXIT_FAILURE;
+        if (!profile_generate)
+        {
+            assembly = malloc(sizeof(Writer));
+            if (!assembly)
+            {
+                perror("Failed to allocate the assembly writer");
+                return EXIT_FAILURE;
+            }
+            writer_init_collect(assembly, fd);
+        }
+        checker = fdopen(checker_fd, "w");
+        fprintf(checker, "#include <stdio.h>\n\nint main(void)\n{\n    int failures = 0;\n");
+    }
+
+    OptReport report;
+    memset(&report, 0, sizeof(OptReport));
+    OptOptions options = {level, NULL, 1, OPT_DEFAULT_INLINE_BUDGET, 0};
+    int checked = 0, failures = 0;
+    double print_seconds = 0;
+    for (unsigned seed = first; seed < first + (unsigned)count; seed++)
+    {
+        IrProgram *program = wide ? random_wide_program(seed, wide) : random_program(seed);
+        int expected = 0, actual = 0;
+        if (ir_interpret(program, &expected) != 0)
+        {
+            ir_program_free(program);
+            continue;
+        }
+        checked++;
+
+        // Branches are numbered and the checksum taken on the IR as
+        // generated, before optimization and renaming, as the driver does.
+        uint64_t checksum = 0;
+        if (profile_generate || profile_use)
+        {
+            profile_number_branches(program);
+            checksum = profile_checksum(program);
+        }
+        if (profile_use)
+        {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/s%u.prof", profile_use, seed);
+            if (profile_load(program, path) != 0 ||
+                (profile_check && !check_profile(program, seed, wide, profile_check, profile_runs)))
+                failures++;
+        }
+
+        if (level > 0)
+            optimize_program(program, &options, &report);
+        if (ir_interpret(program, &actual) != 0 || actual != expected)
+        {
+            fprintf(stderr, "seed %u: -O%d returns %d, expected %d\n", seed, level, actual, expected);
+            failures++;
+        }
+
+        if (checker)
+        {
+            char name[MAX_NAME];
+            for (int f = 0; f < program->function_count; f++)
+            {
+                IrFunction *fn = &program->functions[f];
+                snprintf(name, sizeof(name), "s%u_%s", seed, fn->name);
+                free(fn->name);
+                fn->name = strdup(name);
+            }
+            AsmProgram *asm_program = codegen_compile(program, level, &report.stats);
+            if (profile_generate)
+            {
+                char path[4096];
+                snprintf(path, sizeof(path), "%s/s%u.prof", native_dir, seed);
+                asm_program->profile_path = path;
+                asm_program->profile_checksum = checksum;
+                if (write_own_assembly(native_dir, seed, asm_program) != 0)
+                    failures++;
+            }
+            else
+            {
+                double start = stats_now_seconds();
+                asm_print_program(assembly, asm_program, "fuzz");
+                print_seconds += stats_now_seconds() - start;
+            }
+            asm_program_free(asm_program);
+            fprintf(checker, "    extern int s%u_main(void);\n", seed);
+            fprintf(checker, "    if (s%u_main() != %d)\n", seed, expected);
+            fprintf(checker, "    {\n        printf(\"seed %u: native code returns %%d, expected %d\\n\", s%u_main());\n",
+                    seed, expected, seed);
+            fprintf(checker, "        failures++;\n    }\n");
+        }
+        ir_program_free(program);
+    }
+
+    if (checker)
+    {
+        int status = 0;
+        if (assembly)
+        {
+            double start = stats_now_seconds();
+            status = writer_flush(assembly);
+            if (close(assembly->fd) != 0)
+                status = -1;
+            print_seconds += stats_now_seconds() - start;
+            if (print_stats)
+                fprintf(stderr, "Assembly emitted: %zu bytes in %.3f ms (%.1f MB/s)\n", assembly->total,
+                        print_seconds * 1e3, print_seconds > 0 ? assembly->total / print_seconds / 1e6 : 0.0);
+            free(assembly);
+        }
+        fprintf(checker, "    printf(\"%d programs run natively, %%d failed\\n\", failures);\n", checked);
+        fprintf(checker, "    return failures != 0;\n}\n");
+        if (status != 0 || fclose(checker) != 0)
+        {
+            perror("Failed to write the native test");
+            return EXIT_FAILURE;
+        }
+    }
+    if (print_stats)
+        opt_report_print(stderr, &report);
+    printf("%d programs checked at -O%d through the interpreter, %d failed\n", checked, level, failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
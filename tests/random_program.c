@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "random_program.h"
+
+#define MAX_VARS 64
+#define MAX_LOOP_VARS 8
+#define MAX_DEPTH 3
+#define WIDE_REACH 64
+
+//--- Generator State ---
+typedef struct
+{
+    IrProgram *program;
+    IrFunction *fn;
+    int index;                      // fn's position in the program; it may call functions before it
+    int vars[MAX_VARS];             // Temporaries statements read and write
+    int var_count;
+    int loop_vars[MAX_LOOP_VARS];   // Counters of the enclosing loops
+    int loop_var_count;
+    int depth;                      // Nesting of if/else and loops
+    int recursion_temp;             // Remaining recursion depth if fn ends in a call to itself, else -1
+    int budget;                     // Statements left before only straight-line code is generated
+    unsigned state;
+} Generator;
+
+/**
+ * @brief Draws the next pseudo-random number.
+ * @param g The generator.
+ * @param n The number of outcomes.
+ * @return A number in [0, n).
+ */
+static int roll(Generator *g, int n)
+{
+    g->state = g->state * 1103515245u + 12345u;
+    return (int)((g->state >> 8) % (unsigned)n);
+}
+
+/**
+ * @brief Picks a variable to assign.
+ * @param g The generator.
+ * @return A temporary.
+ */
+static int pick_var(Generator *g)
+{
+    return g->vars[roll(g, g->var_count)];
+}
+
+/**
+ * @brief Picks an operand: a variable, a loop counter, or a small or large constant.
+ * @param g The generator.
+ * @return The operand.
+ */
+static IrValue pick(Generator *g)
+{
+    if (g->loop_var_count > 0 && roll(g, 4) == 0)
+        return ir_temp(g->loop_vars[roll(g, g->loop_var_count)]);
+    if (roll(g, 4) == 0)
+        return ir_const(roll(g, 2) ? roll(g, 20) - 5 : roll(g, 2000000) - 1000000);
+    return ir_temp(pick_var(g));
+}
+
+static void gen_statements(Generator *g, int count);
+
+/**
+ * @brief Emits an arithmetic, comparison, shift, unary, copy or division statement.
+ * @param g The generator.
+ */
+static void gen_arithmetic(Generator *g)
+{
+    static const IrOpcode binary[] = {
+        IR_ADD, IR_SUB, IR_MUL, IR_EQ, IR_NE, IR_LT, IR_LE, IR_GT, IR_GE, IR_SAR, IR_SHR, IR_ADD, IR_MUL,
+    };
+    static const IrOpcode unary[] = {IR_NEGATE, IR_COMPLEMENT, IR_NOT};
+    // No -1 or 0, so no division can fault.
+    static const int32_t divisors[] = {2, 3, 5, 7, -3, 10, 16, 1, -8, 1000, -7, 6, 4, INT32_MIN};
+
+    IrFunction *fn = g->fn;
+    IrValue a = pick(g);
+    IrValue b = pick(g);
+    int dst = pick_var(g);
+    int kind = roll(g, 10);
+    if (kind < 6)
+        ir_emit(fn, binary[roll(g, sizeof(binary) / sizeof(binary[0]))], ir_temp(dst), a, b);
+    else if (kind < 7)
+        ir_emit(fn, unary[roll(g, 3)], ir_temp(dst), a, ir_none());
+    else if (kind < 8)
+        ir_emit(fn, IR_COPY, ir_temp(dst), a, ir_none());
+    else
+    {
+        int32_t divisor = divisors[roll(g, sizeof(divisors) / sizeof(divisors[0]))];
+        ir_emit(fn, roll(g, 2) ? IR_DIV : IR_REM, ir_temp(dst), a, ir_const(divisor));
+    }
+}
+
+/**
+ * @brief Emits a call to a function defined earlier, sometimes discarding its result.
+ * @param g The generator; g->index must be positive.
+ */
+static void gen_call(Generator *g)
+{
+    int callee = roll(g, g->index);
+    int count = g->program->functions[callee].param_count;
+    IrValue args[16];
+    for (int i = 0; i < count; i++)
+        args[i] = pick(g);
+    IrValue dst = roll(g, 8) == 0 ? ir_none() : ir_temp(pick_var(g));
+    ir_emit_call(g->fn, dst, callee, args, count);
+}
+
+/**
+ * @brief Emits an if, or an if/else, on a random operand.
+ * @param g The generator.
+ */
+static void gen_if(Generator *g)
+{
+    IrFunction *fn = g->fn;
+    int else_label = ir_new_label(fn);
+    int end_label = ir_new_label(fn);
+    ir_emit_jump(fn, roll(g, 2) ? IR_JUMP_IF_ZERO : IR_JUMP_IF_NOT_ZERO, pick(g), else_label);
+    g->depth++;
+    gen_statements(g, 1 + roll(g, 3));
+    if (roll(g, 2))
+        ir_emit_jump(fn, IR_JUMP, ir_none(), end_label);
+    ir_emit_label(fn, else_label);
+    gen_statements(g, roll(g, 3));
+    g->depth--;
+    ir_emit_label(fn, end_label);
+}
+
+/**
+ * @brief Emits a conditional early return.
+ * @param g The generator.
+ */
+static void gen_early_return(Generator *g)
+{
+    IrFunction *fn = g->fn;
+    int skip = ir_new_label(fn);
+    ir_emit_jump(fn, IR_JUMP_IF_ZERO, pick(g), skip);
+    ir_emit(fn, IR_RETURN, ir_none(), pick(g), ir_none());
+    ir_emit_label(fn, skip);
+}
+
+/**
+ * @brief Emits a counted loop of at most a few iterations.
+ *
+ * The counter steps up or down by one or two against a bound, sometimes
+ * next to INT32_MIN or INT32_MAX, with the test written either way round;
+ * some loops are entered past their initialization.
+ *
+ * @param g The generator.
+ */
+static void gen_loop(Generator *g)
+{
+    static const IrOpcode negated[] = {
+        [IR_LT] = IR_GE, [IR_LE] = IR_GT, [IR_GT] = IR_LE, [IR_GE] = IR_LT, [IR_NE] = IR_EQ,
+    };
+
+    IrFunction *fn = g->fn;
+    int counter = ir_new_temp(fn);
+    int test = ir_new_temp(fn);
+    int top = ir_new_label(fn);
+    int end = ir_new_label(fn);
+
+    int32_t init = 0, bound = 1 + roll(g, 5), step = 1;
+    IrOpcode compare = IR_LT;
+    int mode = roll(g, 6);
+    if (mode == 1)
+    {
+        step = 2;
+        compare = roll(g, 2) ? IR_LT : IR_LE;
+        init = roll(g, 3) - 1;
+    }
+    else if (mode == 2)
+    {
+        step = -1 - roll(g, 2);
+        compare = roll(g, 2) ? IR_GT : IR_GE;
+        init = roll(g, 5);
+        bound = roll(g, 3) - 2;
+    }
+    else if (mode == 3 && roll(g, 2))
+    {
+        init = INT32_MAX - 3;
+        bound = INT32_MAX;
+    }
+    else if (mode == 3)
+    {
+        init = (1 << 30) - 4 + roll(g, 3);
+        bound = (1 << 30) + 4;
+        compare = roll(g, 2) ? IR_LT : IR_LE;
+    }
+    else if (mode == 4)
+    {
+        init = INT32_MIN + 3;
+        bound = INT32_MIN;
+        step = -1;
+        compare = IR_GT;
+    }
+    else if (mode == 5)
+        compare = IR_NE;
+    int invert = roll(g, 2);
+
+    ir_emit(fn, IR_COPY, ir_temp(counter), ir_const(init), ir_none());
+    if (mode == 0 && roll(g, 2))
+    {
+        ir_emit_jump(fn, roll(g, 2) ? IR_JUMP_IF_ZERO : IR_JUMP_IF_NOT_ZERO, pick(g), top);
+        ir_emit(fn, IR_COPY, ir_temp(counter), ir_const(roll(g, 3) - 1), ir_none());
+    }
+    ir_emit_label(fn, top);
+    if (invert)
+    {
+        ir_emit(fn, negated[compare], ir_temp(test), ir_temp(counter), ir_const(bound));
+        ir_emit_jump(fn, IR_JUMP_IF_NOT_ZERO, ir_temp(test), end);
+    }
+    else
+    {
+        ir_emit(fn, compare, ir_temp(test), ir_temp(counter), ir_const(bound));
+        ir_emit_jump(fn, IR_JUMP_IF_ZERO, ir_temp(test), end);
+    }
+
+    g->depth++;
+    int pushed = g->loop_var_count < MAX_LOOP_VARS;
+    if (pushed)
+        g->loop_vars[g->loop_var_count++] = counter;
+    if (roll(g, 2))
+    {
+        IrValue factor = roll(g, 2) ? ir_const(roll(g, 9) - 4) : pick(g);
+        ir_emit(fn, IR_MUL, ir_temp(pick_var(g)), ir_temp(counter), factor);
+    }
+    gen_statements(g, 1 + roll(g, 4));
+    if (pushed)
+        g->loop_var_count--;
+    g->depth--;
+
+    if (step > 0 && roll(g, 3) == 0)
+        ir_emit(fn, IR_SUB, ir_temp(counter), ir_temp(counter), ir_const(-step));
+    else
+        ir_emit(fn, IR_ADD, ir_temp(counter), ir_temp(counter), ir_const(step));
+    ir_emit_jump(fn, IR_JUMP, ir_none(), top);
+    ir_emit_label(fn, end);
+}
+
+/**
+ * @brief Emits one random statement.
+ * @param g The generator.
+ */
+static void gen_statement(Generator *g)
+{
+    int kind = roll(g, 20);
+    if (g->budget-- <= 0)
+        kind = 0;
+    else if (g->depth >= MAX_DEPTH && kind >= 12)
+        kind = roll(g, 12);
+
+    // A recursive function calls nothing else, or its running time would
+    // multiply at every level of the recursion.
+    if (kind < 8 || (kind < 10 && (g->index == 0 || g->recursion_temp >= 0)))
+        gen_arithmetic(g);
+    else if (kind < 10)
+        gen_call(g);
+    else if (kind < 12)
+        gen_if(g);
+    else if (kind < 13)
+        gen_early_return(g);
+    else
+        gen_loop(g);
+}
+
+/**
+ * @brief Emits several random statements.
+ * @param g The generator.
+ * @param count The number of statements.
+ */
+static void gen_statements(Generator *g, int count)
+{
+    for (int i = 0; i < count; i++)
+        gen_statement(g);
+}
+
+/**
+ * @brief Ends a helper by returning the result of calling itself with a smaller depth as its first argument.
+ *
+ * The depth is the first parameter reduced to [-7, 7] on entry, before the
+ * body can change it, so the recursion is at most eight calls deep whatever
+ * the arguments are.
+ *
+ * @param g The generator; g->recursion_temp holds the depth.
+ */
+static void gen_tail_recursion(Generator *g)
+{
+    IrFunction *fn = g->fn;
+    int depth = g->recursion_temp;
+    int done = ir_new_label(fn);
+    int test = ir_new_temp(fn);
+    ir_emit(fn, IR_LE, ir_temp(test), ir_temp(depth), ir_const(0));
+    ir_emit_jump(fn, IR_JUMP_IF_NOT_ZERO, ir_temp(test), done);
+
+    IrValue args[16];
+    args[0] = ir_temp(ir_new_temp(fn));
+    ir_emit(fn, IR_SUB, args[0], ir_temp(depth), ir_const(1));
+    for (int i = 1; i < fn->param_count; i++)
+        args[i] = roll(g, 2) ? ir_temp(roll(g, fn->param_count)) : pick(g);
+    int result = ir_new_temp(fn);
+    ir_emit_call(fn, ir_temp(result), g->index, args, fn->param_count);
+    ir_emit(fn, IR_RETURN, ir_none(), ir_temp(result), ir_none());
+
+    ir_emit_label(fn, done);
+    ir_emit(fn, IR_RETURN, ir_none(), pick(g), ir_none());
+}
+
+/**
+ * @brief Generates a random, terminating IR program whose entry point is main.
+ * @param seed Selects the program; the same seed always gives the same program.
+ * @return The program, out of SSA form. Free it with ir_program_free.
+ */
+IrProgram *random_program(unsigned seed)
+{
+    Generator g;
+    memset(&g, 0, sizeof(Generator));
+    g.state = seed * 2654435761u + 1;
+    g.program = ir_program_new();
+
+    int helpers = roll(&g, 4);
+    char name[16];
+    for (int i = 0; i <= helpers; i++)
+    {
+        if (i == helpers)
+            snprintf(name, sizeof(name), "main");
+        else
+            snprintf(name, sizeof(name), "h%d", i);
+        ir_add_function(g.program, name, i == helpers ? 0 : roll(&g, 10));
+    }
+
+    for (int i = 0; i <= helpers; i++)
+    {
+        g.fn = &g.program->functions[i];
+        g.fn->defined = 1;
+        g.index = i;
+        g.var_count = 0;
+        g.loop_var_count = 0;
+        g.depth = 0;
+        g.recursion_temp = -1;
+        g.budget = 30 + roll(&g, 40);
+        if (i < helpers && g.fn->param_count > 0 && roll(&g, 3) == 0)
+        {
+            g.recursion_temp = ir_new_temp(g.fn);
+            ir_emit(g.fn, IR_REM, ir_temp(g.recursion_temp), ir_temp(0), ir_const(8));
+        }
+
+        for (int p = 0; p < g.fn->param_count; p++)
+            g.vars[g.var_count++] = p;
+        int locals = 2 + roll(&g, 5);
+        for (int v = 0; v < locals; v++)
+        {
+            int temp = ir_new_temp(g.fn);
+            g.vars[g.var_count++] = temp;
+            ir_emit(g.fn, IR_COPY, ir_temp(temp), ir_const(roll(&g, 100) - 50), ir_none());
+        }
+
+        gen_statements(&g, 3 + roll(&g, 8));
+        if (g.recursion_temp >= 0)
+            gen_tail_recursion(&g);
+        else if (roll(&g, 6) > 0)
+            ir_emit(g.fn, IR_RETURN, ir_none(), pick(&g), ir_none());
+        // Otherwise the function falls off its end and returns 0.
+    }
+    return g.program;
+}
+
+/**
+ * @brief Generates a program whose helper keeps thousands of values live at once.
+ *
+ * main calls wide(a, b), and wide computes a chain of width values. Each one
+ * combines the value before it with one about WIDE_REACH back, so that many
+ * are live at every point and a large share of them spill. The parameters
+ * keep the optimizer from folding the chain, and the helper is far too large
+ * to inline.
+ *
+ * @param seed Selects the operations and the arguments.
+ * @param width The number of values in the chain; at least 2.
+ * @return The program, out of SSA form. Free it with ir_program_free.
+ */
+IrProgram *random_wide_program(unsigned seed, int width)
+{
+    static const IrOpcode binary[] = {IR_ADD, IR_SUB, IR_MUL, IR_ADD, IR_SUB, IR_LT, IR_SAR, IR_SHR};
+
+    Generator g;
+    memset(&g, 0, sizeof(Generator));
+    g.state = seed * 2654435761u + 1;
+    g.program = ir_program_new();
+    ir_add_function(g.program, "wide", 2);
+    ir_add_function(g.program, "main", 0);
+
+    IrFunction *fn = &g.program->functions[0];
+    fn->defined = 1;
+    int *values = malloc(width * sizeof(int));
+    values[0] = 0;
+    values[1] = 1;
+    for (int i = 2; i < width; i++)
+    {
+        int back = WIDE_REACH - roll(&g, 8);
+        if (back > i - 1)
+            back = i - 1;
+        IrOpcode op = binary[roll(&g, sizeof(binary) / sizeof(binary[0]))];
+        // Shift counts are constants, so values do not collapse to 0 or -1.
+        IrValue b = op == IR_SAR || op == IR_SHR ? ir_const(roll(&g, 8)) : ir_temp(values[i - 1 - back]);
+        values[i] = ir_new_temp(fn);
+        ir_emit(fn, op, ir_temp(values[i]), ir_temp(values[i - 1]), b);
+    }
+    ir_emit(fn, IR_RETURN, ir_none(), ir_temp(values[width - 1]), ir_none());
+    free(values);
+
+    fn = &g.program->functions[1];
+    fn->defined = 1;
+    IrValue args[2] = {ir_const(roll(&g, 2000) - 1000), ir_const(roll(&g, 2000) - 1000)};
+    int result = ir_new_temp(fn);
+    ir_emit_call(fn, ir_temp(result), 0, args, 2);
+    ir_emit(fn, IR_RETURN, ir_none(), ir_temp(result), ir_none());
+    return g.program;
+}
@@ -0,0 +1,23 @@
+#ifndef RANDOM_PROGRAM_H
+#define RANDOM_PROGRAM_H
+
+#include "ir.h"
+
+// --- Random IR Programs ---
+// The front end only parses `int main(void) { return N; }`, so the optimizer
+// and the backend are exercised with generated IR instead. A program is a
+// main and up to three helpers, each a mix of arithmetic, comparisons,
+// shifts, division by constants, calls to earlier functions, nested if/else,
+// early returns and counted loops, including loops whose bounds sit next to
+// INT32_MIN and INT32_MAX. A helper sometimes ends in a bounded call to
+// itself in tail position. Every program terminates and never divides by
+// zero, so the interpreter can always produce the expected result.
+//
+// random_wide_program instead builds one helper with thousands of values
+// live at once, past the size limits where the register allocator and stack
+// slot sharing switch to their representations for large functions.
+
+IrProgram *random_program(unsigned seed);
+IrProgram *random_wide_program(unsigned seed, int width);
+
+#endif
@@ -0,0 +1,116 @@
+#!/bin/sh
+# Builds the test tools and runs them:
+#   fuzz            1500 random programs at each optimization level, checked
+#                   through the interpreter and then run natively; then the
+#                   same programs optimized at -O2 with 1 and 8 workers,
+#                   which must give identical IR; and at -O2, programs
+#                   with a helper of thousands of live values, past the
+#                   size where graph coloring keeps its interference graph
+#                   in a hash set instead of a bit matrix, and past the
+#                   number of spilled values where stack slot sharing
+#                   gives up.
+#   cc              The compiler driver on return_2.c with -fprofile-generate:
+#                   counts add up over runs, -fprofile-use takes them, and
+#                   profiles of another program or cut short are refused
+#                   with a warning. Then fuzz profiles 300 programs once at
+#                   -O0 and twice at -O2, and each -O2 profile must count
+#                   the branches the optimizer inverted the right way round.
+#   div_const_test  Division by constants on 340k divisors; with --exhaustive,
+#                   every dividend for 33 chosen divisors (hours, not run here).
+#   ssa_bench       SSA construction and destruction on 3k to 60k blocks.
+#
+# Usage: tests/run.sh [output directory]   (default: a fresh temporary one)
+# CC selects the system compiler used to build the tools and link the
+# generated assembly; it must target x86-64 Linux.
+
+set -e
+root=$(cd "$(dirname "$0")/.." && pwd)
+out=${1:-$(mktemp -d)}
+cc=${CC:-gcc}
+mkdir -p "$out"
+
+sources=$(ls "$root"/*.c | grep -v -e '/compiler_driver\.c$' -e '/return_2\.c$')
+$cc -std=gnu11 -O1 -g -I"$root" -I"$root/tests" "$root/tests/fuzz.c" "$root/tests/random_program.c" \
+    $sources -o "$out/fuzz" -lpthread
+
+$cc -std=gnu11 -O1 -g -I"$root" "$root/tests/div_const_test.c" $sources -o "$out/div_const_test" -lpthread
+$cc -std=gnu11 -O1 -g -I"$root" "$root/tests/ssa_bench.c" $sources -o "$out/ssa_bench" -lpthread
+$cc -std=gnu11 -O1 -g -I"$root" "$root/compiler_driver.c" $sources -o "$out/cc" -lpthread
+
+for level in 0 1 2; do
+    "$out/fuzz" -O$level --native="$out"
+    $cc -O1 "$out/fuzz.s" "$out/fuzz_main.c" -o "$out/fuzz_native"
+    "$out/fuzz_native"
+done
+"$out/fuzz" -O2 --jobs=8
+for width in 8000 12000; do
+    "$out/fuzz" -O2 --wide=$width --count=3 --native="$out"
+    $cc -O1 "$out/fuzz.s" "$out/fuzz_main.c" -o "$out/fuzz_native"
+    "$out/fuzz_native"
+done
+
+# Runs a program built by the driver and checks its exit status.
+expect_status() {
+    status=0
+    "$1" || status=$?
+    if [ "$status" -ne "$2" ]; then
+        echo "$1 exits with $status, expected $2" >&2
+        exit 1
+    fi
+}
+# Checks that the entry count of main, the first counter, is $2.
+expect_main_count() {
+    count=$(od -A n -t u8 -j 32 -N 8 "$1" | tr -d ' ')
+    if [ "$count" != "$2" ]; then
+        echo "$1 counts main $count times, expected $2" >&2
+        exit 1
+    fi
+}
+# Compiles return_2.c with -fprofile-use=$1 and checks the warning printed.
+expect_profile_warning() {
+    "$out/cc" "$out/return_2.c" -O2 -fprofile-use="$1" > "$out/profile.log" 2>&1
+    if ! grep -q "$2" "$out/profile.log"; then
+        echo "-fprofile-use=$1 does not warn that the profile is $2" >&2
+        exit 1
+    fi
+    expect_status "$out/return_2" 2
+}
+
+cp "$root/return_2.c" "$out/return_2.c"
+rm -f "$out/p.prof"
+"$out/cc" "$out/return_2.c" -O2 -fprofile-generate="$out/p.prof" > /dev/null 2>&1
+expect_status "$out/return_2" 2
+expect_status "$out/return_2" 2
+expect_main_count "$out/p.prof" 2
+"$out/cc" "$out/return_2.c" -O2 -fprofile-use="$out/p.prof" > "$out/profile.log" 2>&1
+if grep Warning "$out/profile.log" >&2; then
+    exit 1
+fi
+expect_status "$out/return_2" 2
+
+for level in 0 2; do
+    rm -rf "$out/profile$level"
+    mkdir -p "$out/profile$level"
+    "$out/fuzz" -O$level --count=300 --native="$out/profile$level" --profile-generate
+    $cc -O1 "$out/profile$level"/s*.s "$out/profile$level/fuzz_main.c" -o "$out/profile$level/fuzz_native"
+    "$out/profile$level/fuzz_native"
+done
+"$out/profile2/fuzz_native"
+"$out/fuzz" -O2 --count=300 --profile-use="$out/profile2" --profile-check="$out/profile0" --profile-runs=2 \
+    --native="$out"
+$cc -O1 "$out/fuzz.s" "$out/fuzz_main.c" -o "$out/fuzz_native"
+"$out/fuzz_native"
+
+expect_profile_warning "$out/profile0/s1.prof" "recorded for a different program"
+head -c 36 "$out/p.prof" > "$out/short.prof"
+expect_profile_warning "$out/short.prof" "truncated"
+# An instrumented program replaces a profile of another program rather than
+# adding to it.
+cp "$out/profile0/s1.prof" "$out/p.prof"
+"$out/cc" "$out/return_2.c" -O2 -fprofile-generate="$out/p.prof" > /dev/null 2>&1
+expect_status "$out/return_2" 2
+expect_main_count "$out/p.prof" 1
+
+"$out/div_const_test"
+"$out/ssa_bench"
+echo "All tests passed; tools and outputs are in $out"
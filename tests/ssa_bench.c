@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cfg.h"
+#include "interp.h"
+#include "ssa.h"
+#include "stats.h"
+
+// --- SSA Construction Benchmark ---
+// Times ssa_build (dominators, dominance frontiers, liveness, phi placement
+// and renaming) and ssa_destroy on one large function: a loop around N
+// if/else diamonds over a handful of variables, so that nearly every
+// diamond needs phis at its join and at the loop header. Each size is
+// checked with the interpreter before and after the round trip.
+
+#define VARIABLES 8
+#define ROUNDS 3
+
+/**
+ * @brief Builds main as a three-iteration loop around a chain of if/else diamonds.
+ * @param diamonds The number of diamonds.
+ * @return The program.
+ */
+static IrProgram *diamond_program(int diamonds)
+{
+    IrProgram *program = ir_program_new();
+    IrFunction *fn = ir_add_function(program, "main", 0);
+    fn->defined = 1;
+
+    for (int v = 0; v < VARIABLES; v++)
+    {
+        ir_new_temp(fn);
+        ir_emit(fn, IR_COPY, ir_temp(v), ir_const(v * 7 - 20), ir_none());
+    }
+    int counter = ir_new_temp(fn);
+    int test = ir_new_temp(fn);
+    int top = ir_new_label(fn);
+    int end = ir_new_label(fn);
+    ir_emit(fn, IR_COPY, ir_temp(counter), ir_const(0), ir_none());
+    ir_emit_label(fn, top);
+    ir_emit(fn, IR_LT, ir_temp(test), ir_temp(counter), ir_const(ROUNDS));
+    ir_emit_jump(fn, IR_JUMP_IF_ZERO, ir_temp(test), end);
+
+    for (int d = 0; d < diamonds; d++)
+    {
+        int a = d % VARIABLES, b = (d * 3 + 1) % VARIABLES, c = (d * 5 + 2) % VARIABLES;
+        int other = ir_new_label(fn);
+        int join = ir_new_label(fn);
+        ir_emit(fn, IR_LT, ir_temp(test), ir_temp(b), ir_temp(c));
+        ir_emit_jump(fn, IR_JUMP_IF_ZERO, ir_temp(test), other);
+        ir_emit(fn, IR_ADD, ir_temp(a), ir_temp(b), ir_const(d % 13 + 1));
+        ir_emit_jump(fn, IR_JUMP, ir_none(), join);
+        ir_emit_label(fn, other);
+        ir_emit(fn, IR_SUB, ir_temp(a), ir_temp(c), ir_temp(b));
+        ir_emit_label(fn, join);
+    }
+
+    ir_emit(fn, IR_ADD, ir_temp(counter), ir_temp(counter), ir_const(1));
+    ir_emit_jump(fn, IR_JUMP, ir_none(), top);
+    ir_emit_label(fn, end);
+    ir_emit(fn, IR_RETURN, ir_none(), ir_temp(0), ir_none());
+    return program;
+}
+
+/**
+ * @brief Entry point: times the SSA round trip for each diamond count on the command line.
+ * @param argc The argument count.
+ * @param argv Diamond counts; 1000, 5000 and 20000 when none are given.
+ * @return EXIT_SUCCESS if every round trip kept main's value.
+ */
+int main(int argc, char *argv[])
+{
+    static const char *default_sizes[] = {"1000", "5000", "20000"};
+    const char **sizes = argc > 1 ? (const char **)argv + 1 : default_sizes;
+    int size_count = argc > 1 ? argc - 1 : 3;
+
+    int failures = 0;
+    for (int i = 0; i < size_count; i++)
+    {
+        IrProgram *program = diamond_program(atoi(sizes[i]));
+        IrFunction *fn = &program->functions[0];
+        Cfg *cfg = cfg_build(fn);
+        int blocks = cfg->block_count;
+        cfg_free(cfg);
+
+        int expected = 0, actual = 0;
+        ir_interpret(program, &expected);
+        double start = stats_now_seconds();
+        ssa_build(fn);
+        double built = stats_now_seconds();
+        ssa_destroy(fn);
+        double destroyed = stats_now_seconds();
+        ir_interpret(program, &actual);
+
+        printf("%6d blocks: build %.2f ms, destroy %.2f ms%s\n", blocks, (built - start) * 1e3,
+               (destroyed - built) * 1e3, actual == expected ? "" : " (value changed)");
+        failures += actual != expected;
+        ir_program_free(program);
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,180 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+//--- Task Deque ---
+// Every task is pushed before the workers start, so a deque only ever shrinks:
+// the owner pops from the bottom and thieves take from the top. Once every
+// deque is empty no work can reappear, which is how workers know to stop.
+typedef struct
+{
+    pthread_mutex_t lock;
+    int *tasks;
+    int top;            // Next task to steal
+    int bottom;         // One past the owner's next task
+} TaskDeque;
+
+//--- Shared Pool State ---
+typedef struct
+{
+    TaskDeque *deques;
+    int worker_count;
+    TaskFn fn;
+    void *context;
+} Pool;
+
+//--- Worker Start Arguments ---
+typedef struct
+{
+    Pool *pool;
+    int worker;
+} WorkerArgs;
+
+/**
+ * @brief Takes the newest task from a worker's own deque.
+ * @param d The deque.
+ * @param task Receives the task.
+ * @return 1 if a task was taken.
+ */
+static int deque_pop(TaskDeque *d, int *task)
+{
+    pthread_mutex_lock(&d->lock);
+    int found = d->bottom > d->top;
+    if (found)
+        *task = d->tasks[--d->bottom];
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+/**
+ * @brief Takes the oldest task from another worker's deque.
+ * @param d The victim's deque.
+ * @param task Receives the task.
+ * @return 1 if a task was stolen.
+ */
+static int deque_steal(TaskDeque *d, int *task)
+{
+    pthread_mutex_lock(&d->lock);
+    int found = d->bottom > d->top;
+    if (found)
+        *task = d->tasks[d->top++];
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+/**
+ * @brief Runs tasks until no deque has any left.
+ * @param arg The WorkerArgs for this thread.
+ * @return NULL.
+ */
+static void *worker_main(void *arg)
+{
+    WorkerArgs *args = arg;
+    Pool *pool = args->pool;
+    int self = args->worker;
+    int task;
+
+    for (;;)
+    {
+        if (deque_pop(&pool->deques[self], &task))
+        {
+            pool->fn(pool->context, task, self);
+            continue;
+        }
+
+        int stolen = 0;
+        for (int k = 1; k < pool->worker_count && !stolen; k++)
+        {
+            int victim = (self + k) % pool->worker_count;
+            stolen = deque_steal(&pool->deques[victim], &task);
+        }
+        if (!stolen)
+            break;
+        pool->fn(pool->context, task, self);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the number of online processors, at least 1.
+ * @return The default worker count.
+ */
+int thread_pool_default_workers(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+/**
+ * @brief Runs every task once and returns when all have finished.
+ *
+ * Tasks are dealt round-robin in the given order, so putting the most
+ * expensive ones first spreads them across workers before any stealing is
+ * needed. The calling thread acts as worker 0. With one worker, or if threads
+ * cannot be created, tasks run on the calling thread.
+ *
+ * @param task_count The number of tasks.
+ * @param order Task numbers in the order to deal them out, or NULL for 0, 1, 2, ...
+ * @param worker_count The number of threads to use.
+ * @param fn The function run for each task.
+ * @param context Passed to fn.
+ * @return The number of workers actually used.
+ */
+int thread_pool_run(int task_count, const int *order, int worker_count, TaskFn fn, void *context)
+{
+    if (worker_count > task_count) worker_count = task_count;
+    if (worker_count <= 1)
+    {
+        for (int i = 0; i < task_count; i++)
+            fn(context, order ? order[i] : i, 0);
+        return 1;
+    }
+
+    Pool pool = {NULL, worker_count, fn, context};
+    pool.deques = calloc(worker_count, sizeof(TaskDeque));
+    int per_worker = (task_count + worker_count - 1) / worker_count;
+    for (int w = 0; w < worker_count; w++)
+    {
+        pthread_mutex_init(&pool.deques[w].lock, NULL);
+        pool.deques[w].tasks = malloc(per_worker * sizeof(int));
+    }
+
+    // Deal from the back so each owner pops its share in the given order.
+    for (int i = task_count - 1; i >= 0; i--)
+    {
+        TaskDeque *d = &pool.deques[i % worker_count];
+        d->tasks[d->bottom++] = order ? order[i] : i;
+    }
+
+    pthread_t *threads = malloc(worker_count * sizeof(pthread_t));
+    WorkerArgs *args = malloc(worker_count * sizeof(WorkerArgs));
+    int started = 1;
+    for (int w = 1; w < worker_count; w++)
+    {
+        args[w].pool = &pool;
+        args[w].worker = w;
+        if (pthread_create(&threads[w], NULL, worker_main, &args[w]) != 0)
+            break;
+        started++;
+    }
+
+    // Deques of workers that failed to start are emptied by stealing.
+    args[0].pool = &pool;
+    args[0].worker = 0;
+    worker_main(&args[0]);
+    for (int w = 1; w < started; w++)
+        pthread_join(threads[w], NULL);
+
+    for (int w = 0; w < worker_count; w++)
+    {
+        pthread_mutex_destroy(&pool.deques[w].lock);
+        free(pool.deques[w].tasks);
+    }
+    free(args);
+    free(threads);
+    free(pool.deques);
+    return started;
+}
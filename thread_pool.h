@@ -0,0 +1,16 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// --- Work-Stealing Thread Pool ---
+// Runs a fixed set of independent tasks on several threads. Each worker owns a
+// deque seeded with its share of the tasks: it takes work from the bottom of
+// its own deque and, once that is empty, steals from the top of the others.
+
+// Called once per task; worker is in [0, worker_count) and identifies the
+// thread, so per-worker state can be indexed without locking.
+typedef void (*TaskFn)(void *context, int task, int worker);
+
+int thread_pool_default_workers(void);
+int thread_pool_run(int task_count, const int *order, int worker_count, TaskFn fn, void *context);
+
+#endif
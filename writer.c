@@ -0,0 +1,251 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "writer.h"
+
+// POSIX guarantees at least this many iovecs per writev call.
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/**
+ * @brief Initializes a writer for a file descriptor.
+ * @param w The writer to initialize.
+ * @param fd The destination file descriptor (e.g. STDOUT_FILENO).
+ */
+void writer_init(Writer *w, int fd)
+{
+    w->fd = fd;
+    w->len = 0;
+    w->capacity = WRITER_BUFFER_SIZE;
+    w->total = 0;
+    w->error = 0;
+    w->collect = 0;
+    w->data = w->buffer;
+    w->chunks = NULL;
+    w->chunk_count = 0;
+    w->chunk_capacity = 0;
+}
+
+/**
+ * @brief Initializes a writer that holds all output in memory until writer_flush.
+ * @param w The writer to initialize.
+ * @param fd The destination file descriptor.
+ */
+void writer_init_collect(Writer *w, int fd)
+{
+    writer_init(w, fd);
+    w->collect = 1;
+}
+
+/**
+ * @brief Writes a byte range to the writer's descriptor, retrying short writes.
+ * @param w The writer.
+ * @param s The bytes.
+ * @param n The number of bytes.
+ */
+static void write_all(Writer *w, const char *s, size_t n)
+{
+    size_t done = 0;
+    while (done < n && !w->error) 
+    {
+        ssize_t written = write(w->fd, s + done, n - done);
+        if (written < 0) 
+        {
+            if (errno == EINTR) continue;
+            w->error = 1;
+            break;
+        }
+        done += (size_t)written;
+    }
+}
+
+/**
+ * @brief Files the current buffer as a full chunk and starts a new one.
+ * @param w A collecting writer.
+ */
+static void start_chunk(Writer *w)
+{
+    char *chunk = malloc(WRITER_CHUNK_SIZE);
+    if (!chunk)
+    {
+        // Out of memory: write out what has been collected and keep going as a plain writer.
+        writer_flush(w);
+        w->collect = 0;
+        return;
+    }
+    if (w->chunk_count == w->chunk_capacity)
+    {
+        w->chunk_capacity = w->chunk_capacity ? 2 * w->chunk_capacity : 16;
+        w->chunks = realloc(w->chunks, w->chunk_capacity * sizeof(char *));
+    }
+    w->chunks[w->chunk_count++] = w->data;
+    w->total += w->len;
+    w->data = chunk;
+    w->capacity = WRITER_CHUNK_SIZE;
+    w->len = 0;
+}
+
+/**
+ * @brief Writes the chunks of a collecting writer with writev and frees them.
+ *
+ * Every chunk but the last is full, so each one's length follows from
+ * whether it is the inline buffer or a heap chunk.
+ *
+ * @param w A collecting writer.
+ */
+static void flush_chunks(Writer *w)
+{
+    int count = w->chunk_count + 1;
+    struct iovec *iov = malloc(count * sizeof(struct iovec));
+    for (int i = 0; i < w->chunk_count; i++)
+    {
+        iov[i].iov_base = w->chunks[i];
+        iov[i].iov_len = w->chunks[i] == w->buffer ? WRITER_BUFFER_SIZE : WRITER_CHUNK_SIZE;
+    }
+    iov[count - 1].iov_base = w->data;
+    iov[count - 1].iov_len = w->len;
+
+    int i = 0;
+    while (i < count && !w->error)
+    {
+        int batch = count - i < IOV_MAX ? count - i : IOV_MAX;
+        ssize_t n = writev(w->fd, iov + i, batch);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            w->error = 1;
+            break;
+        }
+        while (i < count && (size_t)n >= iov[i].iov_len)
+        {
+            n -= (ssize_t)iov[i].iov_len;
+            i++;
+        }
+        // A short write stopped inside a chunk: finish that chunk with write.
+        if (n > 0)
+        {
+            write_all(w, (const char *)iov[i].iov_base + n, iov[i].iov_len - (size_t)n);
+            i++;
+        }
+    }
+
+    for (int c = 0; c < w->chunk_count; c++)
+    {
+        if (w->chunks[c] != w->buffer)
+            free(w->chunks[c]);
+    }
+    if (w->data != w->buffer)
+        free(w->data);
+    free(iov);
+    free(w->chunks);
+    w->chunks = NULL;
+    w->chunk_count = 0;
+    w->chunk_capacity = 0;
+    w->data = w->buffer;
+    w->capacity = WRITER_BUFFER_SIZE;
+}
+
+/**
+ * @brief Writes out everything currently buffered.
+ *
+ * A collecting writer also releases its chunks, so flush it once at the end.
+ *
+ * @param w The writer to flush.
+ * @return 0 on success, -1 if any write so far has failed.
+ */
+int writer_flush(Writer *w)
+{
+    w->total += w->len;
+    if (w->collect)
+        flush_chunks(w);
+    else
+        write_all(w, w->data, w->len);
+    w->len = 0;
+    return w->error ? -1 : 0;
+}
+
+/**
+ * @brief Appends raw bytes to the writer.
+ * @param w The writer.
+ * @param s The bytes to append.
+ * @param n The number of bytes.
+ */
+void writer_write(Writer *w, const char *s, size_t n)
+{
+    while (n > 0) 
+    {
+        if (w->len == w->capacity) 
+        {
+            if (w->collect) start_chunk(w);
+            else writer_flush(w);
+        }
+
+        size_t chunk = w->capacity - w->len;
+        if (chunk > n) chunk = n;
+        memcpy(w->data + w->len, s, chunk);
+        w->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+/**
+ * @brief Appends a NUL-terminated string to the writer.
+ * @param w The writer.
+ * @param s The string to append.
+ */
+void writer_puts(Writer *w, const char *s)
+{
+    writer_write(w, s, strlen(s));
+}
+
+/**
+ * @brief Appends a signed decimal integer to the writer.
+ * @param w The writer.
+ * @param value The integer to format.
+ */
+void writer_put_long(Writer *w, long value)
+{
+    // Formatted backwards by hand: snprintf's format parsing dominated
+    // assembly output, which is mostly short offsets and label numbers.
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    do
+    {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+        *--p = '-';
+
+    if (w->capacity - w->len >= sizeof(digits))
+    {
+        memcpy(w->data + w->len, p, (size_t)(end - p));
+        w->len += (size_t)(end - p);
+    }
+    else
+        writer_write(w, p, (size_t)(end - p));
+}
+
+/**
+ * @brief Appends `width` spaces of indentation.
+ * @param w The writer.
+ * @param width The number of spaces.
+ */
+void writer_indent(Writer *w, int width)
+{
+    static const char spaces[] = "                                                                ";
+    while (width > 0) 
+    {
+        int chunk = width < (int)sizeof(spaces) - 1 ? width : (int)sizeof(spaces) - 1;
+        writer_write(w, spaces, (size_t)chunk);
+        width -= chunk;
+    }
+}
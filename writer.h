@@ -0,0 +1,53 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+
+#define WRITER_BUFFER_SIZE (64 * 1024)
+#define WRITER_CHUNK_SIZE (1024 * 1024)
+
+//--- Buffered Writer ---
+// Collects output in a fixed buffer and hands it to write(2) in large chunks,
+// so dumps cost one system call per WRITER_BUFFER_SIZE bytes instead of one per line.
+// A collecting writer (writer_init_collect) instead keeps everything in
+// WRITER_CHUNK_SIZE heap chunks until writer_flush, which passes them all to
+// a single writev(2).
+typedef struct
+{
+    int fd;
+    size_t len;             // Bytes used in data
+    size_t capacity;        // Size of data
+    size_t total;           // Bytes flushed or filed as chunks since initialization
+    int error;
+    int collect;
+    char *data;             // The inline buffer, or the newest chunk when collecting
+    char **chunks;          // Full chunks awaiting writer_flush
+    int chunk_count;
+    int chunk_capacity;
+    char buffer[WRITER_BUFFER_SIZE];
+} Writer;
+
+void writer_init(Writer *w, int fd);
+void writer_init_collect(Writer *w, int fd);
+void writer_write(Writer *w, const char *s, size_t n);
+void writer_puts(Writer *w, const char *s);
+void writer_put_long(Writer *w, long value);
+void writer_indent(Writer *w, int width);
+int writer_flush(Writer *w);
+
+/**
+ * @brief Appends a single character to the writer.
+ * @param w The writer.
+ * @param c The character to append.
+ */
+static inline void writer_putc(Writer *w, char c)
+{
+    if (w->len == w->capacity)
+    {
+        writer_write(w, &c, 1);
+        return;
+    }
+    w->data[w->len++] = c;
+}
+
+#endif